@@ -1,5 +1,6 @@
 #include "audio_codecs.h"
 #include "audio_codecs_internal.h"
+#include "codec_io.h"
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -35,6 +36,55 @@ codec_format_t codec_detect_format(const char *filepath)
     return CODEC_FORMAT_UNKNOWN;
 }
 
+//--------------------------------------------------------------------+
+// Open cache (record layout in audio_codecs_internal.h)
+//--------------------------------------------------------------------+
+
+static bool open_cache_load(const codec_cache_key_t *key, codec_open_cache_t *rec)
+{
+    return codec_cache_load(key, CODEC_OPEN_CACHE_EXT, CODEC_OPEN_CACHE_MAGIC,
+                            CODEC_OPEN_CACHE_VERSION, rec, sizeof(*rec));
+}
+
+const void *codec_open_cached(const codec_handle_t *h, size_t len)
+{
+    if (!h->open_hit || h->open_cache->state_len != len) return NULL;
+    return h->open_cache->state;
+}
+
+void codec_open_remember(codec_handle_t *h, const void *state, size_t len)
+{
+    if (!h->open_cache || len > CODEC_OPEN_STATE_MAX) return;
+    memcpy(h->open_cache->state, state, len);
+    h->open_cache->state_len = (uint32_t)len;
+    h->open_dirty = true;
+}
+
+// After a successful open: queue the record unless it is already on SD
+static void open_cache_save(codec_handle_t *h)
+{
+    codec_open_cache_t *rec = h->open_cache;
+    if (!rec || (h->open_hit && !h->open_dirty)) return;
+
+    rec->info          = h->info;
+    rec->priming       = h->priming;
+    rec->packet_frames = h->packet_frames;
+    rec->end_frame     = h->end_frame;
+    codec_cache_store(&h->key, CODEC_OPEN_CACHE_EXT, CODEC_OPEN_CACHE_MAGIC,
+                      CODEC_OPEN_CACHE_VERSION, rec, sizeof(*rec));
+}
+
+bool codec_probe(const char *filepath, codec_info_t *info)
+{
+    codec_cache_key_t key;
+    if (!filepath || !codec_cache_key(filepath, &key)) return false;
+
+    codec_open_cache_t rec;
+    if (!open_cache_load(&key, &rec)) return false;
+    *info = rec.info;
+    return true;
+}
+
 //--------------------------------------------------------------------+
 // Open: allocate handle, detect format, dispatch to decoder
 //--------------------------------------------------------------------+
@@ -49,12 +99,11 @@ codec_handle_t *codec_open(const char *filepath)
         return NULL;
     }
 
-    FILE *f = fopen(filepath, "rb");
+    FILE *f = codec_io_open(filepath);
     if (!f) {
         ESP_LOGE(TAG, "Cannot open: %s", filepath);
         return NULL;
     }
-    setvbuf(f, NULL, _IOFBF, 32768);  // 32KB read-ahead buffer for SD throughput
 
     codec_handle_t *h = calloc(1, sizeof(codec_handle_t));
     if (!h) {
@@ -64,8 +113,19 @@ codec_handle_t *codec_open(const char *filepath)
     }
 
     h->file = f;
+    h->path = filepath;
     h->info.format = fmt;
 
+    // Record of the last open; a track replaced since then is a miss
+    h->key_valid = codec_cache_key(filepath, &h->key);
+    if (h->key_valid) {
+        h->open_cache = calloc(1, sizeof(codec_open_cache_t));
+        h->open_hit = h->open_cache && open_cache_load(&h->key, h->open_cache);
+        if (h->open_cache && !h->open_hit) {
+            memset(h->open_cache, 0, sizeof(codec_open_cache_t));
+        }
+    }
+
     bool ok = false;
     switch (fmt) {
         case CODEC_FORMAT_WAV:
@@ -96,15 +156,25 @@ codec_handle_t *codec_open(const char *filepath)
     if (!ok) {
         ESP_LOGE(TAG, "Decoder init failed: %s", filepath);
         fclose(f);
+        free(h->open_cache);
         free(h);
         return NULL;
     }
 
+    h->path = NULL;
+    h->skip = h->priming;
+
     // Calculate duration if total_frames is known
     if (h->info.total_frames > 0 && h->info.sample_rate > 0) {
         h->info.duration_ms = (uint32_t)((h->info.total_frames * 1000ULL) / h->info.sample_rate);
     }
 
+    open_cache_save(h);
+    bool open_hit = h->open_hit;
+    free(h->open_cache);
+    h->open_cache = NULL;
+    h->open_hit = h->open_dirty = false;
+
     static const char *fmt_names[] = {
         "???", "WAV", "FLAC", "MP3", "DSD", "AAC", "Opus", "M4A", "ALAC"
     };
@@ -112,12 +182,12 @@ codec_handle_t *codec_open(const char *filepath)
     uint32_t actual_fmt = (uint32_t)h->info.format;
     const char *fmt_name = (actual_fmt < sizeof(fmt_names)/sizeof(fmt_names[0]))
                          ? fmt_names[actual_fmt] : "???";
-    ESP_LOGI(TAG, "Opened: %s [%s %luHz %d-bit %dch %llu frames %.1fs gain=%.2fdB]",
+    ESP_LOGI(TAG, "Opened: %s [%s %luHz %d-bit %dch %llu frames %.1fs gain=%.2fdB%s]",
              filepath, fmt_name,
              h->info.sample_rate, h->info.bits_per_sample,
              h->info.channels, h->info.total_frames,
              h->info.duration_ms / 1000.0f,
-             h->info.gain_db);
+             h->info.gain_db, open_hit ? " cached" : "");
 
     return h;
 }
@@ -126,16 +196,79 @@ codec_handle_t *codec_open(const char *filepath)
 // Decode / Seek / Info / Close — dispatch to vtable
 //--------------------------------------------------------------------+
 
+// One decoder call. Packet decoders write straight into the caller's
+// buffer when a whole packet fits, otherwise into the carry buffer.
+static int32_t decode_raw(codec_handle_t *h, int32_t *buffer, uint32_t max_frames)
+{
+    if (h->carry_pos < h->carry_len) {
+        uint32_t n = h->carry_len - h->carry_pos;
+        if (n > max_frames) n = max_frames;
+        memcpy(buffer, h->carry + (size_t)h->carry_pos * 2, (size_t)n * 2 * sizeof(int32_t));
+        h->carry_pos += n;
+        return (int32_t)n;
+    }
+
+    if (h->packet_frames == 0 || max_frames >= h->packet_frames) {
+        return h->vt->decode(h, buffer, max_frames);
+    }
+
+    if (!h->carry) {
+        h->carry = malloc((size_t)h->packet_frames * 2 * sizeof(int32_t));
+        if (!h->carry) {
+            ESP_LOGE(TAG, "Out of memory for %lu-frame carry buffer",
+                     (unsigned long)h->packet_frames);
+            return -1;
+        }
+    }
+    int32_t got = h->vt->decode(h, h->carry, h->packet_frames);
+    if (got <= 0) return got;
+
+    uint32_t n = ((uint32_t)got < max_frames) ? (uint32_t)got : max_frames;
+    memcpy(buffer, h->carry, (size_t)n * 2 * sizeof(int32_t));
+    h->carry_pos = n;
+    h->carry_len = (uint32_t)got;
+    return (int32_t)n;
+}
+
 int32_t codec_decode(codec_handle_t *h, int32_t *buffer, uint32_t max_frames)
 {
     if (!h || !h->vt || !h->vt->decode) return -1;
-    return h->vt->decode(h, buffer, max_frames);
+
+    // Padding: stop exactly at the last valid frame
+    if (h->end_frame) {
+        if (h->out_pos >= h->end_frame) return 0;
+        uint64_t left = h->end_frame - h->out_pos;
+        if (max_frames > left) max_frames = (uint32_t)left;
+    }
+
+    for (;;) {
+        int32_t got = decode_raw(h, buffer, max_frames);
+        if (got <= 0) return got;
+
+        // Priming: drop the encoder delay at stream start
+        if (h->skip) {
+            uint32_t drop = ((uint32_t)got < h->skip) ? (uint32_t)got : h->skip;
+            h->skip -= drop;
+            got -= (int32_t)drop;
+            if (got == 0) continue;
+            memmove(buffer, buffer + (size_t)drop * 2, (size_t)got * 2 * sizeof(int32_t));
+        }
+
+        h->out_pos += (uint32_t)got;
+        return got;
+    }
 }
 
 bool codec_seek(codec_handle_t *h, uint64_t frame_pos)
 {
     if (!h || !h->vt || !h->vt->seek) return false;
-    return h->vt->seek(h, frame_pos);
+
+    // Positions are in trimmed frames; the decoder counts priming too
+    h->carry_pos = h->carry_len = 0;
+    if (!h->vt->seek(h, frame_pos ? frame_pos + h->priming : 0)) return false;
+    h->skip    = frame_pos ? 0 : h->priming;
+    h->out_pos = frame_pos;
+    return true;
 }
 
 const codec_info_t *codec_get_info(const codec_handle_t *h)
@@ -153,5 +286,6 @@ void codec_close(codec_handle_t *h)
     if (h->file) {
         fclose(h->file);
     }
+    free(h->carry);
     free(h);
 }
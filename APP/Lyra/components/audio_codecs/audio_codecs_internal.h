@@ -1,6 +1,7 @@
 #pragma once
 
 #include "audio_codecs.h"
+#include "codec_cache.h"
 #include <stdio.h>
 
 //--------------------------------------------------------------------+
@@ -15,6 +16,32 @@ typedef struct {
     void    (*close)(codec_handle_t *h);
 } codec_vtable_t;
 
+//--------------------------------------------------------------------+
+// Open cache: what the last codec_open() of a track found, on SD
+//--------------------------------------------------------------------+
+//
+// codec_open() reads the record of the track before dispatching. Openers
+// that probe (ReplayGain scan, tail scan for the duration, moov walk)
+// ask codec_open_cached() for the state they saved last time and skip
+// the probe on a hit; on a miss they probe and hand the result to
+// codec_open_remember(). The record is written by the cache worker after
+// a successful open. Bump CODEC_OPEN_CACHE_VERSION when codec_info_t or
+// any opener's state layout changes.
+
+#define CODEC_OPEN_CACHE_EXT        "nfo"
+#define CODEC_OPEN_CACHE_MAGIC      0x314F464Eu     // "NFO1"
+#define CODEC_OPEN_CACHE_VERSION    2
+#define CODEC_OPEN_STATE_MAX        192
+
+typedef struct {
+    codec_info_t info;              // as returned by codec_get_info()
+    uint32_t priming;
+    uint32_t packet_frames;
+    uint64_t end_frame;
+    uint32_t state_len;             // bytes of state[] used by the opener
+    uint8_t  state[CODEC_OPEN_STATE_MAX];
+} codec_open_cache_t;
+
 //--------------------------------------------------------------------+
 // Decoder handle (internal structure)
 //--------------------------------------------------------------------+
@@ -23,6 +50,29 @@ struct codec_handle_s {
     codec_info_t info;
     const codec_vtable_t *vt;
     FILE *file;
+    const char *path;               // codec_open() argument, valid while the opener runs
+
+    // Open cache, valid while the opener runs (key also kept for the decoder)
+    codec_cache_key_t key;          // track identity (key_valid: stat() succeeded)
+    bool key_valid;
+    bool open_hit;                  // open_cache holds the record of this track
+    bool open_dirty;                // opener changed open_cache->state
+    codec_open_cache_t *open_cache;
+
+    // Packet decoders (AAC, ALAC, Opus) emit one whole packet per call.
+    // codec_decode() keeps the part that did not fit the caller's buffer
+    // for the next call instead of dropping it.
+    uint32_t packet_frames;         // largest packet in frames (0 = any size)
+    int32_t *carry;                 // [packet_frames * 2], allocated on demand
+    uint32_t carry_pos;
+    uint32_t carry_len;
+
+    // Gapless trimming applied by codec_decode() (set by the opener when the
+    // decoder does not trim by itself — dr_mp3 handles LAME delay/padding)
+    uint32_t priming;               // encoder delay: frames dropped after open / seek(0)
+    uint64_t end_frame;             // valid frames in the stream (0 = unknown)
+    uint32_t skip;                  // priming frames still to drop
+    uint64_t out_pos;               // frames returned since start of stream
     union {
         // WAV/AIFF decoder state (dr_wav — in-place struct, heap-allocated)
         struct {
@@ -35,6 +85,7 @@ struct codec_handle_s {
         // MP3 decoder state (dr_mp3 — in-place struct, heap-allocated)
         struct {
             void *drmp3;            // drmp3* handle
+            void *index;            // mp3_index_t* (seek index on SD), NULL if unused
         } mp3;
         // DSD decoder state (DSF/DFF container, outputs DoP int32_t frames)
         struct {
@@ -65,6 +116,19 @@ struct codec_handle_s {
 extern "C" {
 #endif
 
+/**
+ * @brief Opener state saved by the last open of this track
+ *
+ * @param len Size of the opener's state struct
+ * @return Saved state, or NULL on miss / different layout
+ */
+const void *codec_open_cached(const codec_handle_t *h, size_t len);
+
+/**
+ * @brief Opener state to save for the next open of this track
+ */
+void codec_open_remember(codec_handle_t *h, const void *state, size_t len);
+
 // WAV/AIFF: dr_wav decoder, supports PCM/float/extensible/ADPCM/AIFF
 bool codec_wav_open(codec_handle_t *h);
 
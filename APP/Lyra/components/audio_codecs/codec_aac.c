@@ -4,6 +4,8 @@
  * Two input modes:
  *   ADTS (.aac)  — raw ADTS bitstream; approximate seek via avg frame size
  *   M4A  (.m4a)  — ISO BMFF container; exact seek via sample table
+ *                  gapless via iTunSMPB (delay / valid samples, trimmed
+ *                  by codec_decode())
  *
  * Output: int32_t stereo interleaved, left-justified (16-bit PCM << 16).
  */
@@ -17,6 +19,9 @@
 
 static const char *TAG = "codec_aac";
 
+/* Largest decoded packet: HE-AAC (SBR) doubles the 1024-sample core frame */
+#define AAC_MAX_PACKET_FRAMES  2048
+
 /* ADTS sampling frequency index table (ISO 14496-3 Table 1.16) */
 static const uint32_t k_aac_sample_rates[13] = {
     96000, 88200, 64000, 48000, 44100, 32000,
@@ -100,8 +105,9 @@ static int32_t aac_decode(codec_handle_t *h, int32_t *buffer, uint32_t max_frame
         /* ----- M4A-AAC: raw frames from sample table ----- */
         if (st->m4a_frame_idx >= st->m4a.sample_count) return 0;  /* EOF */
 
-        uint64_t off  = st->m4a.sample_offsets[st->m4a_frame_idx];
-        uint32_t size = st->m4a.sample_sizes[st->m4a_frame_idx];
+        uint64_t off;
+        uint32_t size;
+        if (!m4a_sample(h->file, &st->m4a, st->m4a_frame_idx, &off, &size)) return -1;
 
         if (size == 0 || size > st->m4a_frame_buf_sz) {
             st->m4a_frame_idx++;
@@ -202,6 +208,8 @@ static bool aac_seek(codec_handle_t *h, uint64_t frame_pos)
         /* M4A-AAC: exact seek by sample-table index */
         uint32_t frames_per_packet = (uint32_t)st->ext.frameLength;
         if (frames_per_packet == 0) frames_per_packet = 1024;  /* AAC-LC default */
+        if (st->ext.aacPlusUpsamplingFactor > 1)               /* HE-AAC output  */
+            frames_per_packet *= (uint32_t)st->ext.aacPlusUpsamplingFactor;
         uint32_t new_idx = (uint32_t)(frame_pos / frames_per_packet);
         if (new_idx >= st->m4a.sample_count) new_idx = st->m4a.sample_count;
         st->m4a_frame_idx = new_idx;
@@ -295,27 +303,43 @@ static bool aac_alloc_decoder(aac_state_t *st)
  * codec_aac_open — ADTS (.aac) path
  * ----------------------------------------------------------------------- */
 
+/* Open cache state: first sync and frame size average of the ADTS path */
+typedef struct {
+    int64_t  sync_offset;
+    uint32_t sample_rate;
+    uint32_t avg_frame_bytes;
+    uint8_t  channels;
+} aac_open_state_t;
+
 bool codec_aac_open(codec_handle_t *h)
 {
+    const aac_open_state_t *cached = codec_open_cached(h, sizeof(aac_open_state_t));
+
     /* Scan up to 64 KB for the first valid ADTS sync word (skips ID3 tags) */
     uint8_t  scan[512];
     long     sync_offset = -1;
     uint32_t sr_hz       = 0;
     uint8_t  channels    = 0;
 
-    for (long base = 0; base < 65536; base += (long)sizeof(scan)) {
-        size_t got = fread(scan, 1, sizeof(scan), h->file);
-        if (got < 7) break;
-        for (size_t i = 0; i + 7 <= got; i++) {
-            uint32_t fl = adts_parse(&scan[i], &sr_hz, &channels, NULL);
-            if (fl >= 7 && fl <= PVMP4AUDIODECODER_INBUFSIZE && sr_hz > 0) {
-                sync_offset = base + (long)i;
-                break;
+    if (cached) {
+        sync_offset = (long)cached->sync_offset;
+        sr_hz       = cached->sample_rate;
+        channels    = cached->channels;
+    } else {
+        for (long base = 0; base < 65536; base += (long)sizeof(scan)) {
+            size_t got = fread(scan, 1, sizeof(scan), h->file);
+            if (got < 7) break;
+            for (size_t i = 0; i + 7 <= got; i++) {
+                uint32_t fl = adts_parse(&scan[i], &sr_hz, &channels, NULL);
+                if (fl >= 7 && fl <= PVMP4AUDIODECODER_INBUFSIZE && sr_hz > 0) {
+                    sync_offset = base + (long)i;
+                    break;
+                }
             }
+            if (sync_offset >= 0) break;
+            if (got < sizeof(scan)) break;
+            fseek(h->file, -8, SEEK_CUR);  /* overlap to avoid missing cross-boundary syncs */
         }
-        if (sync_offset >= 0) break;
-        if (got < sizeof(scan)) break;
-        fseek(h->file, -8, SEEK_CUR);  /* overlap to avoid missing cross-boundary syncs */
     }
 
     if (sync_offset < 0 || sr_hz == 0) {
@@ -332,7 +356,9 @@ bool codec_aac_open(codec_handle_t *h)
     fseek(h->file, sync_offset, SEEK_SET);
 
     /* Sample ~50 ADTS frames to compute avg_frame_bytes for seek estimation */
-    {
+    if (cached) {
+        st->avg_frame_bytes = cached->avg_frame_bytes;
+    } else {
         uint32_t total = 0, count = 0;
         for (int i = 0; i < 50; i++) {
             uint8_t hdr[7];
@@ -345,6 +371,14 @@ bool codec_aac_open(codec_handle_t *h)
         }
         st->avg_frame_bytes = count ? (total / count) : 0;
         fseek(h->file, sync_offset, SEEK_SET);
+
+        aac_open_state_t state = {
+            .sync_offset     = sync_offset,
+            .sample_rate     = sr_hz,
+            .avg_frame_bytes = st->avg_frame_bytes,
+            .channels        = channels,
+        };
+        codec_open_remember(h, &state, sizeof(state));
     }
 
     h->aac.state            = st;
@@ -353,6 +387,7 @@ bool codec_aac_open(codec_handle_t *h)
     h->info.channels        = channels;
     h->info.total_frames    = 0;
     h->info.duration_ms     = 0;
+    h->packet_frames        = AAC_MAX_PACKET_FRAMES;
     h->vt                   = &aac_vtable;
 
     ESP_LOGI(TAG, "AAC(ADTS): %lu Hz %d-ch  avg_frame=%lu B",
@@ -365,8 +400,7 @@ bool codec_aac_open(codec_handle_t *h)
  * codec_aac_open_m4a — M4A-AAC path
  *
  * Called from codec_m4a_open (codec_alac.cpp) with a pre-parsed m4a_info_t.
- * Takes ownership of info->sample_sizes and info->sample_offsets on success
- * (frees them on failure too).
+ * Takes ownership of info->samples on success (frees it on failure too).
  * ----------------------------------------------------------------------- */
 
 bool codec_aac_open_m4a(codec_handle_t *h, m4a_info_t *info)
@@ -392,12 +426,11 @@ bool codec_aac_open_m4a(codec_handle_t *h, m4a_info_t *info)
         /* Non-fatal: decoder still initialised; metadata from stsd is used */
     }
 
-    /* Find worst-case compressed frame size for the read buffer */
-    uint32_t max_frame = 0;
-    for (uint32_t i = 0; i < info->sample_count; i++)
-        if (info->sample_sizes[i] > max_frame)
-            max_frame = info->sample_sizes[i];
-    if (max_frame == 0) max_frame = PVMP4AUDIODECODER_INBUFSIZE;
+    /* Read buffer: the decoder's input limit (6144 bits per channel, larger
+     * frames are skipped by aac_decode), or the constant stsz size */
+    uint32_t max_frame = info->sample_size;
+    if (max_frame == 0 || max_frame > PVMP4AUDIODECODER_INBUFSIZE)
+        max_frame = PVMP4AUDIODECODER_INBUFSIZE;
 
     st->m4a_frame_buf = malloc(max_frame);
     if (!st->m4a_frame_buf) {
@@ -410,8 +443,7 @@ bool codec_aac_open_m4a(codec_handle_t *h, m4a_info_t *info)
 
     /* Transfer sample table ownership */
     st->m4a = *info;
-    info->sample_sizes   = NULL;
-    info->sample_offsets = NULL;
+    info->samples = NULL;
 
     st->is_m4a = true;
 
@@ -422,8 +454,19 @@ bool codec_aac_open_m4a(codec_handle_t *h, m4a_info_t *info)
     h->info.total_frames    = st->m4a.total_samples;
     h->info.duration_ms     = st->m4a.duration_ms;
     h->info.format          = CODEC_FORMAT_AAC;
+    h->packet_frames        = AAC_MAX_PACKET_FRAMES;
     h->vt                   = &aac_vtable;
 
+    /* Gapless: drop encoder priming, stop before the padding */
+    if (st->m4a.valid_samples > 0) {
+        h->priming           = st->m4a.enc_delay;
+        h->end_frame         = st->m4a.valid_samples;
+        h->info.total_frames = st->m4a.valid_samples;
+        if (st->m4a.sample_rate > 0)
+            h->info.duration_ms = (uint32_t)(st->m4a.valid_samples * 1000ULL
+                                             / st->m4a.sample_rate);
+    }
+
     ESP_LOGI(TAG, "AAC(M4A): %lu Hz %d-ch | %lu frames | %lu ms",
              (unsigned long)st->m4a.sample_rate, st->m4a.channels,
              (unsigned long)st->m4a.sample_count,
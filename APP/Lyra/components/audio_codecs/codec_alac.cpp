@@ -6,7 +6,8 @@
  * to locate each compressed frame in the file.
  *
  * Also implements codec_m4a_open() — the single dispatcher called for
- * .m4a / .m4b / .mp4 files.  It runs m4a_parse() once and then either
+ * .m4a / .m4b / .mp4 files.  It runs m4a_parse() once (or reloads just
+ * the sample tables when the open cache knows the track) and then either
  * initialises the ALAC decoder (here) or calls codec_aac_open_m4a()
  * (defined in codec_aac.c) for M4A-AAC files.
  *
@@ -39,7 +40,7 @@ static const char *TAG = "codec_alac";
 /* ------------------------------------------------------------------ */
 
 typedef struct {
-    m4a_info_t   m4a;            /* sample table (owns sample_sizes/offsets) */
+    m4a_info_t   m4a;            /* sample table (owns m4a.samples)           */
     uint32_t     frame_idx;      /* next compressed frame to decode           */
     ALACDecoder *dec;            /* C++ decoder instance                      */
     uint8_t     *frame_buf;      /* compressed-frame read buffer              */
@@ -61,8 +62,9 @@ static int32_t alac_decode_fn(codec_handle_t *h, int32_t *buffer,
     m4a_info_t *m4a = &st->m4a;
     if (st->frame_idx >= m4a->sample_count) return 0;   /* EOF */
 
-    uint64_t off  = m4a->sample_offsets[st->frame_idx];
-    uint32_t size = m4a->sample_sizes[st->frame_idx];
+    uint64_t off;
+    uint32_t size;
+    if (!m4a_sample(h->file, m4a, st->frame_idx, &off, &size)) return -1;
 
     if (size == 0 || size > st->frame_buf_max) {
         st->frame_idx++;
@@ -188,7 +190,7 @@ static const codec_vtable_t alac_vtable = {
 
 /* ------------------------------------------------------------------ */
 /* Internal: initialise ALAC state from a pre-parsed m4a_info_t       */
-/* (called from codec_m4a_open; takes ownership of info's heap arrays) */
+/* (called from codec_m4a_open; takes ownership of info's sample table) */
 /* ------------------------------------------------------------------ */
 
 static bool alac_init_state(codec_handle_t *h, m4a_info_t *info)
@@ -198,8 +200,7 @@ static bool alac_init_state(codec_handle_t *h, m4a_info_t *info)
 
     /* Transfer heap ownership */
     st->m4a = *info;
-    info->sample_sizes   = NULL;
-    info->sample_offsets = NULL;
+    info->samples = NULL;
 
     /* Create and initialise ALACDecoder */
     st->dec = new ALACDecoder();
@@ -212,11 +213,17 @@ static bool alac_init_state(codec_handle_t *h, m4a_info_t *info)
         return false;
     }
 
-    /* Compressed-frame read buffer: scan for worst-case frame size */
-    uint32_t max_frame = 0;
-    for (uint32_t i = 0; i < st->m4a.sample_count; i++)
-        if (st->m4a.sample_sizes[i] > max_frame)
-            max_frame = st->m4a.sample_sizes[i];
+    /*
+     * Compressed-frame read buffer: a frame never exceeds the escape
+     * (uncompressed) frame plus its header, unless the cookie says more.
+     * Constant-size tables give the exact size.
+     */
+    const ALACSpecificConfig &cfg = st->dec->mConfig;
+    uint32_t max_frame = st->m4a.sample_size;
+    if (max_frame == 0) {
+        max_frame = cfg.frameLength * cfg.numChannels * ((cfg.bitDepth + 7u) / 8u) + 64u;
+        if (cfg.maxFrameBytes > max_frame) max_frame = cfg.maxFrameBytes;
+    }
     if (max_frame == 0) max_frame = 65536;
 
     st->frame_buf_max = max_frame;
@@ -248,6 +255,7 @@ static bool alac_init_state(codec_handle_t *h, m4a_info_t *info)
     h->info.total_frames   = st->m4a.total_samples;
     h->info.duration_ms    = st->m4a.duration_ms;
     h->info.format         = CODEC_FORMAT_ALAC;
+    h->packet_frames       = st->dec->mConfig.frameLength;  /* 4096 typical */
     h->vt                  = &alac_vtable;
 
     ESP_LOGI(TAG, "ALAC: %luHz %d-ch %d-bit | %lu frames | %lu ms",
@@ -265,12 +273,30 @@ static bool alac_init_state(codec_handle_t *h, m4a_info_t *info)
 /* Forward declaration of the M4A-AAC path (defined in codec_aac.c)  */
 extern "C" bool codec_aac_open_m4a(codec_handle_t *h, m4a_info_t *info);
 
+/*
+ * Open cache state: the m4a_parse() result without its sample table,
+ * which is set up again from info.tables, skipping the moov walk.
+ */
+static_assert(sizeof(m4a_info_t) <= CODEC_OPEN_STATE_MAX, "m4a_info_t outgrew the open cache");
+
 extern "C" bool codec_m4a_open(codec_handle_t *h)
 {
     m4a_info_t info;
-    if (!m4a_parse(h->file, &info)) {
-        ESP_LOGE(TAG, "m4a_parse failed");
-        return false;
+    const m4a_info_t *cached = (const m4a_info_t *)codec_open_cached(h, sizeof(m4a_info_t));
+    bool loaded = false;
+    if (cached) {
+        info   = *cached;
+        loaded = m4a_load_tables(h->file, &info);
+    }
+
+    if (!loaded) {
+        if (!m4a_parse(h->file, &info)) {
+            ESP_LOGE(TAG, "m4a_parse failed");
+            return false;
+        }
+        m4a_info_t state = info;
+        state.samples = NULL;
+        codec_open_remember(h, &state, sizeof(state));
     }
 
     if (info.codec == M4A_CODEC_ALAC) {
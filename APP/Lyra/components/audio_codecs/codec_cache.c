@@ -0,0 +1,247 @@
+#include "codec_cache.h"
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *TAG = "codec_cache";
+
+//--------------------------------------------------------------------+
+// Key and file names
+//--------------------------------------------------------------------+
+
+bool codec_cache_key(const char *path, codec_cache_key_t *key)
+{
+    struct stat st;
+    if (!path || stat(path, &st) != 0) return false;
+
+    uint32_t fnv = 2166136261u, djb = 5381;
+    for (const uint8_t *p = (const uint8_t *)path; *p; p++) {
+        fnv = (fnv ^ *p) * 16777619u;
+        djb = djb * 33 + *p;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->name  = fnv;
+    key->check = djb;
+    key->size  = (uint64_t)st.st_size;
+    key->mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+static void cache_path(char *out, size_t len, const codec_cache_key_t *key,
+                       const char *ext, bool tmp)
+{
+    snprintf(out, len, CODEC_CACHE_DIR "/%08lx.%s%s",
+             (unsigned long)key->name, ext, tmp ? ".tmp" : "");
+}
+
+static void mkdir_if_needed(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        mkdir(path, 0775);
+    }
+}
+
+//--------------------------------------------------------------------+
+// Read / write
+//--------------------------------------------------------------------+
+
+FILE *codec_cache_open(const codec_cache_key_t *key, const char *ext,
+                       uint32_t magic, uint16_t version)
+{
+    char path[48];
+    cache_path(path, sizeof(path), key, ext, false);
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    codec_cache_hdr_t hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+        hdr.magic != magic || hdr.version != version ||
+        memcmp(&hdr.key, key, sizeof(*key)) != 0) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+FILE *codec_cache_create(const codec_cache_key_t *key, const char *ext,
+                         uint32_t magic, uint16_t version)
+{
+    mkdir_if_needed("/sdcard/.lyra");
+    mkdir_if_needed(CODEC_CACHE_DIR);
+
+    char path[48];
+    cache_path(path, sizeof(path), key, ext, true);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        ESP_LOGW(TAG, "Cannot create %s", path);
+        return NULL;
+    }
+
+    codec_cache_hdr_t hdr = {
+        .magic   = magic,
+        .version = version,
+        .key     = *key,
+    };
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+        fclose(f);
+        unlink(path);
+        return NULL;
+    }
+    return f;
+}
+
+bool codec_cache_commit(FILE *f, const codec_cache_key_t *key, const char *ext, bool ok)
+{
+    char tmp[48], path[48];
+    cache_path(tmp, sizeof(tmp), key, ext, true);
+    cache_path(path, sizeof(path), key, ext, false);
+
+    if (fclose(f) != 0) ok = false;
+    if (!ok) {
+        unlink(tmp);
+        return false;
+    }
+
+    // FATFS does not rename over an existing file
+    unlink(path);
+    if (rename(tmp, path) != 0) {
+        ESP_LOGW(TAG, "Cannot publish %s", path);
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// Background builder
+//--------------------------------------------------------------------+
+
+// A build (path + build) or a record to write (key + blob)
+typedef struct {
+    char path[CODEC_CACHE_PATH_MAX];
+    codec_cache_build_fn build;
+    codec_cache_key_t key;
+    char ext[4];
+    uint32_t magic;
+    uint16_t version;
+    void *blob;                         // heap copy, freed by the task
+    size_t len;
+} cache_job_t;
+
+static QueueHandle_t s_jobs;
+static uint32_t s_last_name;            // name of the last build queued (0 = none)
+
+static void cache_write(const cache_job_t *job)
+{
+    FILE *f = codec_cache_create(&job->key, job->ext, job->magic, job->version);
+    if (!f) return;
+    bool ok = fwrite(job->blob, 1, job->len, f) == job->len;
+    codec_cache_commit(f, &job->key, job->ext, ok);
+}
+
+static void codec_cache_task(void *arg)
+{
+    QueueHandle_t jobs = (QueueHandle_t)arg;
+    static cache_job_t job;
+
+    for (;;) {
+        if (xQueueReceive(jobs, &job, portMAX_DELAY) != pdTRUE) continue;
+
+        if (job.blob) {
+            cache_write(&job);
+            free(job.blob);
+            continue;
+        }
+
+        codec_cache_key_t key;
+        if (!codec_cache_key(job.path, &key)) continue;
+
+        uint32_t t0 = esp_log_timestamp();
+        bool ok = job.build(job.path, &key);
+        ESP_LOGI(TAG, "%s %s (%lu ms)", ok ? "Built" : "No cache for", job.path,
+                 (unsigned long)(esp_log_timestamp() - t0));
+
+        __atomic_compare_exchange_n(&s_last_name, &key.name, 0, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+}
+
+// Created on demand by the first opener
+static bool cache_task_start(void)
+{
+    if (s_jobs) return true;
+
+    QueueHandle_t q = xQueueCreate(CODEC_CACHE_QUEUE_LEN, sizeof(cache_job_t));
+    if (!q) return false;
+    if (xTaskCreatePinnedToCore(codec_cache_task, "codec_cache", CODEC_CACHE_TASK_STACK,
+                                q, CODEC_CACHE_TASK_PRIO, NULL, 0) != pdPASS) {
+        vQueueDelete(q);
+        return false;
+    }
+    s_jobs = q;
+    return true;
+}
+
+bool codec_cache_request(const char *path, codec_cache_build_fn build)
+{
+    if (!path || !build || strlen(path) >= CODEC_CACHE_PATH_MAX) return false;
+    if (!cache_task_start()) return false;
+
+    codec_cache_key_t key;
+    if (!codec_cache_key(path, &key)) return false;
+    if (__atomic_load_n(&s_last_name, __ATOMIC_RELAXED) == key.name) return false;
+
+    cache_job_t job = { .build = build };
+    strcpy(job.path, path);
+    if (xQueueSend(s_jobs, &job, 0) != pdTRUE) return false;
+
+    __atomic_store_n(&s_last_name, key.name, __ATOMIC_RELAXED);
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// Fixed-size records
+//--------------------------------------------------------------------+
+
+bool codec_cache_load(const codec_cache_key_t *key, const char *ext,
+                      uint32_t magic, uint16_t version, void *data, size_t len)
+{
+    FILE *f = codec_cache_open(key, ext, magic, version);
+    if (!f) return false;
+    bool ok = fread(data, 1, len, f) == len;
+    fclose(f);
+    return ok;
+}
+
+bool codec_cache_store(const codec_cache_key_t *key, const char *ext,
+                       uint32_t magic, uint16_t version, const void *data, size_t len)
+{
+    if (strlen(ext) >= sizeof(((cache_job_t *)0)->ext)) return false;
+    if (!cache_task_start()) return false;
+
+    cache_job_t job = {
+        .key     = *key,
+        .magic   = magic,
+        .version = version,
+        .blob    = malloc(len),
+        .len     = len,
+    };
+    if (!job.blob) return false;
+    strcpy(job.ext, ext);
+    memcpy(job.blob, data, len);
+
+    if (xQueueSend(s_jobs, &job, 0) != pdTRUE) {
+        free(job.blob);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+//--------------------------------------------------------------------+
+// Codec cache: small per-track files on SD, rebuilt when the track changes
+//--------------------------------------------------------------------+
+//
+// Files live in CODEC_CACHE_DIR, one per track and kind, named after a
+// hash of the track path ("1a2b3c4d.mpx"). Each starts with a common
+// header that repeats the key, so a renamed, replaced or edited track
+// (different size or mtime) just reads as a miss:
+//
+//   codec_cache_hdr_t     magic/version of the kind, key
+//   payload               kind-specific, written by the builder
+//
+// Writers go through a ".tmp" file renamed into place on commit, so a
+// card pulled mid-write leaves either the old file or no file.
+//
+// Builders that need a full pass over the track (seek indexes) run on
+// one low-priority worker task on core 0, queued by codec_cache_request()
+// from the opener; the track plays meanwhile without the cache. Small
+// records known at open (codec_cache_store()) are written by the same
+// task, so the opener never waits for a write.
+//--------------------------------------------------------------------+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CODEC_CACHE_DIR         "/sdcard/.lyra/codec"
+
+// Worker task (created on the first request)
+#define CODEC_CACHE_TASK_STACK  4096
+#define CODEC_CACHE_TASK_PRIO   1
+#define CODEC_CACHE_QUEUE_LEN   4
+#define CODEC_CACHE_PATH_MAX    256
+
+// Identity of a track: path hashes + size + mtime
+typedef struct {
+    uint32_t name;                  // FNV-1a of the path (file name)
+    uint32_t check;                 // djb2 of the path (guards name collisions)
+    uint64_t size;
+    int64_t  mtime;
+} codec_cache_key_t;
+
+// Common header at offset 0 of every cache file
+typedef struct {
+    uint32_t magic;                 // kind, e.g. 'M','P','X','1'
+    uint16_t version;               // bumped when the payload layout changes
+    uint16_t reserved;
+    codec_cache_key_t key;
+} codec_cache_hdr_t;
+
+#define CODEC_CACHE_PAYLOAD     ((long)sizeof(codec_cache_hdr_t))
+
+// Builds the cache of one kind for one track (worker task)
+typedef bool (*codec_cache_build_fn)(const char *path, const codec_cache_key_t *key);
+
+/**
+ * @brief Key of a track from its path and stat()
+ *
+ * @return false if the track cannot be stat()ed
+ */
+bool codec_cache_key(const char *path, codec_cache_key_t *key);
+
+/**
+ * @brief Open the cache file of one kind for reading
+ *
+ * @param ext Kind's file extension (3 chars, e.g. "mpx")
+ * @return File positioned at the payload, or NULL on miss / stale key
+ */
+FILE *codec_cache_open(const codec_cache_key_t *key, const char *ext,
+                       uint32_t magic, uint16_t version);
+
+/**
+ * @brief Start writing a cache file (common header written)
+ *
+ * @return File positioned at the payload, or NULL (no card, no space)
+ */
+FILE *codec_cache_create(const codec_cache_key_t *key, const char *ext,
+                         uint32_t magic, uint16_t version);
+
+/**
+ * @brief Close a file from codec_cache_create() and publish it
+ *
+ * @param ok false discards the file (builder failed half way)
+ * @return true if the file is in place
+ */
+bool codec_cache_commit(FILE *f, const codec_cache_key_t *key, const char *ext, bool ok);
+
+/**
+ * @brief Queue a build on the worker task (non-blocking)
+ *
+ * Dropped when the queue is full or @p path is the build already queued
+ * last; the next open of the track asks again.
+ *
+ * @return true if queued
+ */
+bool codec_cache_request(const char *path, codec_cache_build_fn build);
+
+/**
+ * @brief Read a whole fixed-size cache file of one kind
+ *
+ * @return false on miss, stale key or short file
+ */
+bool codec_cache_load(const codec_cache_key_t *key, const char *ext,
+                      uint32_t magic, uint16_t version, void *data, size_t len);
+
+/**
+ * @brief Queue a write of a fixed-size record on the worker task
+ *
+ * @p data is copied; dropped (false) when the queue is full.
+ */
+bool codec_cache_store(const codec_cache_key_t *key, const char *ext,
+                       uint32_t magic, uint16_t version, const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -27,10 +27,25 @@
  * The I2S driver sees this as normal 32-bit PCM at the DoP rate.
  * The ES9039Q2M detects the 0x05/0xFA markers and switches to DSD mode internally.
  * The DSP chain (EQ/biquad) must be bypassed — check codec_info_t.is_dsd.
+ *
+ * PCM output (codec_set_dsd_output() = CODEC_DSD_PCM_88K / _176K):
+ *   The same raw bytes go through the dsd2pcm decimator instead and come
+ *   out as 88.2 / 176.4 kHz PCM (is_dsd = false), so EQ, ReplayGain,
+ *   the resampler and gapless splicing apply like for any PCM track.
+ *   Frame counts and seek positions are then in PCM frames.
+ *
+ * I/O: h->file is the codec_io read-ahead stream (SD reads land in its
+ * PSRAM ring from the I/O task), or a plain FILE when codec_io falls
+ * back. The FILE is unbuffered, so each refill of our read-ahead buffer
+ * is one copy out of that ring rather than two through a stdio buffer.
+ * DSF block pairs and DFF frames are packed from the buffer in place —
+ * no per-block copies.
  */
 
 #include "audio_codecs_internal.h"
+#include "dsd2pcm.h"
 #include <esp_log.h>
+#include <esp_heap_caps.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -42,6 +57,21 @@ static const char *TAG = "codec_dsd";
 #define DOP_MARKER_A  0x05u
 #define DOP_MARKER_B  0xFAu
 
+/* Marker words for an A/B frame pair */
+#define DOP_WORD_A    ((uint32_t)DOP_MARKER_A << 16)
+#define DOP_WORD_B    ((uint32_t)DOP_MARKER_B << 16)
+
+/* Read-ahead buffer: refills end on a sector boundary and compaction keeps
+ * the file offset ↔ buffer index relation cache-line aligned, so the
+ * copies out of the codec_io ring (whose slots are sector multiples) run
+ * aligned on both sides */
+#define DSD_SECTOR     512u
+#define DSD_RD_ALIGN   64u
+#define DSD_RD_BYTES   32768u
+
+/* Output mode for the next codec_dsd_open() (set from the control task) */
+static volatile codec_dsd_output_t s_dsd_output = CODEC_DSD_DOP;
+
 /* ------------------------------------------------------------------ */
 /* Internal decoder state                                              */
 /* ------------------------------------------------------------------ */
@@ -53,10 +83,18 @@ typedef struct {
     uint8_t  dop_marker;          /* Current alternating marker (A or B)          */
     uint64_t dop_frames_out;      /* Total DoP frames emitted (for seek tracking) */
 
-    /* DSF-only: block I/O buffers */
+    /* Read-ahead: rd_buf[i] holds file byte rd_base + i, valid below rd_len */
+    uint8_t *rd_buf;
+    uint32_t rd_cap;
+    uint32_t rd_len;
+    uint32_t rd_pos;              /* next unread byte                             */
+    uint64_t rd_base;
+    uint64_t data_end;            /* file offset past the last DSD byte           */
+
+    /* DSF-only: current block pair (points into rd_buf) */
     uint32_t block_size;          /* bytes per channel per interleaved block       */
-    uint8_t *blk_l;               /* Current L channel block (heap, DSF only)     */
-    uint8_t *blk_r;               /* Current R channel block (heap, DSF only)     */
+    uint8_t *blk_l;               /* Current L channel block                      */
+    uint8_t *blk_r;               /* Current R channel block                      */
     uint32_t blk_frame_pos;       /* Next DoP frame index within current blocks   */
     uint32_t blk_frames;          /* DoP frames available in current block pair   */
     bool     blk_loaded;          /* false = must load first block on first call  */
@@ -64,6 +102,10 @@ typedef struct {
     /* DFF-only: is_dff flag + audio data size */
     bool     is_dff;
     uint64_t dff_data_size;       /* DSD audio bytes in the DSD chunk             */
+
+    /* PCM output mode (NULL = DoP) */
+    dsd2pcm_t *pcm;               /* DSD→PCM decimator                            */
+    uint32_t   pcm_bpf;           /* DSD bytes per channel per PCM frame          */
 } dsd_state_t;
 
 /* ------------------------------------------------------------------ */
@@ -225,6 +267,7 @@ static bool dff_parse(FILE *f, dsd_state_t *st, codec_info_t *info)
     fseek(f, (long)dsd_data_offset, SEEK_SET);
 
     st->data_offset       = dsd_data_offset;
+    st->data_end          = dsd_data_offset + dsd_data_size;
     st->dff_data_size     = dsd_data_size;
     st->is_dff            = true;
     /* DSD samples per channel = data_size_bytes / num_channels */
@@ -239,6 +282,7 @@ static bool dff_parse(FILE *f, dsd_state_t *st, codec_info_t *info)
     info->channels        = 2;
     info->total_frames    = dsd_data_size / 4; /* 4 bytes per DoP frame (stereo) */
     info->is_dsd          = true;
+    info->dsd_rate        = sample_rate;
     info->format          = CODEC_FORMAT_DSD;
 
     const char *lvl = (sample_rate == 2822400)  ? "DSD64"
@@ -320,6 +364,7 @@ static bool dsf_parse(FILE *f, dsd_state_t *st, codec_info_t *info)
 
     /* Populate decoder state */
     st->data_offset       = (uint64_t)pos;
+    st->data_end          = (uint64_t)pos + (data_chunk_size - 12);  /* metadata may follow */
     st->total_dsd_samples = sample_count;
     st->block_size        = block_size;
     st->blk_frames        = block_size / 2;  /* 2 DSD bytes → 1 DoP frame (16 bits/ch) */
@@ -334,6 +379,7 @@ static bool dsf_parse(FILE *f, dsd_state_t *st, codec_info_t *info)
     info->channels        = 2;
     info->total_frames    = sample_count / 16;/* DoP frames = DSD samples / 16           */
     info->is_dsd          = true;
+    info->dsd_rate        = sample_rate;
     info->format          = CODEC_FORMAT_DSD;
 
     const char *level = (sample_rate == 2822400)  ? "DSD64"  :
@@ -352,31 +398,210 @@ static bool dsf_parse(FILE *f, dsd_state_t *st, codec_info_t *info)
 }
 
 /* ------------------------------------------------------------------ */
-/* Block loader: reads one [L block][R block] pair from file           */
+/* Read-ahead buffer                                                   */
+/* ------------------------------------------------------------------ */
+
+/* Restart reading at an absolute file offset (from the sector start) */
+static bool dsd_rd_seek(codec_handle_t *h, uint64_t off)
+{
+    dsd_state_t *st = (dsd_state_t *)h->dsd.state;
+    uint64_t base = off & ~(uint64_t)(DSD_SECTOR - 1);
+
+    if (fseek(h->file, (long)base, SEEK_SET) != 0) return false;
+    st->rd_base = base;
+    st->rd_len  = 0;
+    st->rd_pos  = (uint32_t)(off - base);
+    return true;
+}
+
+/*
+ * Make at least `need` bytes readable at rd_buf + rd_pos (fewer at the
+ * end of the data). Returns the bytes available.
+ */
+static uint32_t dsd_rd_fill(codec_handle_t *h, uint32_t need)
+{
+    dsd_state_t *st = (dsd_state_t *)h->dsd.state;
+    uint32_t avail = (st->rd_len > st->rd_pos) ? st->rd_len - st->rd_pos : 0;
+    if (avail >= need) return avail;
+
+    /* Drop what was consumed, keeping the cache-line phase */
+    uint32_t shift = st->rd_pos & ~(DSD_RD_ALIGN - 1);
+    if (shift > st->rd_len) shift = st->rd_len & ~(DSD_RD_ALIGN - 1);
+    if (shift) {
+        memmove(st->rd_buf, st->rd_buf + shift, st->rd_len - shift);
+        st->rd_base += shift;
+        st->rd_pos  -= shift;
+        st->rd_len  -= shift;
+    }
+
+    /* Refill up to the last whole sector that fits (or the data end) */
+    uint64_t from = st->rd_base + st->rd_len;
+    uint64_t to   = (st->rd_base + st->rd_cap) & ~(uint64_t)(DSD_SECTOR - 1);
+    if (to > st->data_end) to = st->data_end;
+    if (to > from) {
+        st->rd_len += (uint32_t)fread(st->rd_buf + st->rd_len, 1, (size_t)(to - from), h->file);
+    }
+    return (st->rd_len > st->rd_pos) ? st->rd_len - st->rd_pos : 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Block loader: next [L block][R block] pair, in place in rd_buf      */
 /* ------------------------------------------------------------------ */
 
 static bool dsd_load_next_block(codec_handle_t *h)
 {
     dsd_state_t *st = (dsd_state_t *)h->dsd.state;
+    const uint32_t bs = st->block_size;
 
-    /* DSF interleaved layout: block_size bytes L, block_size bytes R */
-    size_t n_l = fread(st->blk_l, 1, st->block_size, h->file);
-    if (n_l == 0) return false;  /* EOF */
+    uint32_t avail = dsd_rd_fill(h, 2 * bs);
+    if (avail == 0) return false;  /* EOF */
 
-    size_t n_r = fread(st->blk_r, 1, st->block_size, h->file);
+    /* DSF interleaved layout: block_size bytes L, block_size bytes R */
+    uint32_t n_l = (avail < bs) ? avail : bs;
+    uint32_t n_r = (avail - n_l < bs) ? avail - n_l : bs;
+    st->blk_l = st->rd_buf + st->rd_pos;
+    st->blk_r = st->blk_l + bs;
+    st->rd_pos += n_l + n_r;
 
-    /* Pad partial reads with DSD silence (0x69 = alternating bits, mid-code) */
-    if (n_l < st->block_size) memset(st->blk_l + n_l, 0x69, st->block_size - n_l);
-    if (n_r < st->block_size) memset(st->blk_r + n_r, 0x69, st->block_size - n_r);
+    /* Pad partial reads with DSD silence (0x69 = alternating bits, mid-code).
+     * rd_cap leaves room for a whole pair past the compacted position. */
+    if (n_l < bs) memset(st->blk_l + n_l, 0x69, bs - n_l);
+    if (n_r < bs) memset(st->blk_r + n_r, 0x69, bs - n_r);
 
     /* DoP frames from this block = bytes / 2 (capped to what L delivered) */
-    st->blk_frames    = (uint32_t)(n_l / 2);
+    st->blk_frames    = n_l / 2;
     st->blk_frame_pos = 0;
     st->blk_loaded    = true;
 
     return (st->blk_frames > 0);
 }
 
+/* ------------------------------------------------------------------ */
+/* DoP packers                                                         */
+/*                                                                     */
+/* Bytes are carried as stored, earlier byte in bits [7:0] (see the    */
+/* DSF / DFF layout notes above). Frames go in A/B marker pairs, read  */
+/* a 32-bit word at a time (RISC-V is little-endian: byte 0 → [7:0]).  */
+/* ------------------------------------------------------------------ */
+
+static inline uint32_t load_u32(const uint8_t *p)
+{
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+/* DSF: per-channel blocks, 2 consecutive bytes per channel per frame */
+__attribute__((hot))
+static void dop_pack_dsf(const uint8_t *l, const uint8_t *r, uint32_t frames,
+                         uint8_t *marker, int32_t *out)
+{
+    uint32_t mk_a = (*marker == DOP_MARKER_A) ? DOP_WORD_A : DOP_WORD_B;
+    uint32_t mk_b = mk_a ^ (DOP_WORD_A ^ DOP_WORD_B);
+    uint32_t i = 0;
+
+    /* Odd start (frame at a 2-byte offset): one frame to reach word alignment */
+    if (frames && (((uintptr_t)l | (uintptr_t)r) & 2)) {
+        out[0] = (int32_t)(mk_a | l[0] | ((uint32_t)l[1] << 8));
+        out[1] = (int32_t)(mk_a | r[0] | ((uint32_t)r[1] << 8));
+        uint32_t t = mk_a; mk_a = mk_b; mk_b = t;
+        out += 2;
+        i = 1;
+    }
+
+    if ((((uintptr_t)(l + 2 * i) | (uintptr_t)(r + 2 * i)) & 3) == 0) {
+        for (; i + 2 <= frames; i += 2) {
+            const uint32_t wl = load_u32(__builtin_assume_aligned(l + 2 * i, 4));
+            const uint32_t wr = load_u32(__builtin_assume_aligned(r + 2 * i, 4));
+            out[0] = (int32_t)(mk_a | (wl & 0xFFFFu));
+            out[1] = (int32_t)(mk_a | (wr & 0xFFFFu));
+            out[2] = (int32_t)(mk_b | (wl >> 16));
+            out[3] = (int32_t)(mk_b | (wr >> 16));
+            out += 4;
+        }
+    }
+
+    for (; i < frames; i++) {
+        out[0] = (int32_t)(mk_a | l[2 * i] | ((uint32_t)l[2 * i + 1] << 8));
+        out[1] = (int32_t)(mk_a | r[2 * i] | ((uint32_t)r[2 * i + 1] << 8));
+        uint32_t t = mk_a; mk_a = mk_b; mk_b = t;
+        out += 2;
+    }
+    *marker = (uint8_t)(mk_a >> 16);
+}
+
+/* DFF: L0 R0 L1 R1 per frame → dop_l = L1:L0, dop_r = R1:R0 */
+__attribute__((hot))
+static void dop_pack_dff(const uint8_t *p, uint32_t frames, uint8_t *marker, int32_t *out)
+{
+    uint32_t mk_a = (*marker == DOP_MARKER_A) ? DOP_WORD_A : DOP_WORD_B;
+    uint32_t mk_b = mk_a ^ (DOP_WORD_A ^ DOP_WORD_B);
+    uint32_t i = 0;
+
+    for (; i + 2 <= frames; i += 2, p += 8, out += 4) {
+        const uint32_t w0 = load_u32(p);
+        const uint32_t w1 = load_u32(p + 4);
+        out[0] = (int32_t)(mk_a | (w0 & 0xFFu) | ((w0 >> 8) & 0xFF00u));
+        out[1] = (int32_t)(mk_a | ((w0 >> 8) & 0xFFu) | ((w0 >> 16) & 0xFF00u));
+        out[2] = (int32_t)(mk_b | (w1 & 0xFFu) | ((w1 >> 8) & 0xFF00u));
+        out[3] = (int32_t)(mk_b | ((w1 >> 8) & 0xFFu) | ((w1 >> 16) & 0xFF00u));
+    }
+    if (i < frames) {
+        const uint32_t w0 = load_u32(p);
+        out[0] = (int32_t)(mk_a | (w0 & 0xFFu) | ((w0 >> 8) & 0xFF00u));
+        out[1] = (int32_t)(mk_a | ((w0 >> 8) & 0xFFu) | ((w0 >> 16) & 0xFF00u));
+        mk_a = mk_b;
+    }
+    *marker = (uint8_t)(mk_a >> 16);
+}
+
+/* ------------------------------------------------------------------ */
+/* PCM output: raw DSD bytes → dsd2pcm                                 */
+/* ------------------------------------------------------------------ */
+
+static int32_t dsd_decode_pcm(codec_handle_t *h, int32_t *buf, uint32_t max_frames)
+{
+    dsd_state_t *st = (dsd_state_t *)h->dsd.state;
+    const uint32_t bpf = st->pcm_bpf;
+    uint32_t out = 0;
+
+    /* ── DFF path: interleaved L R bytes, decimated with stride 2 ─── */
+    if (st->is_dff) {
+        while (out < max_frames) {
+            uint32_t n = dsd_rd_fill(h, (max_frames - out) * 2 * bpf) / (2 * bpf);
+            if (n == 0) break;
+            if (n > max_frames - out) n = max_frames - out;
+            const uint8_t *p = st->rd_buf + st->rd_pos;
+            out += dsd2pcm_process(st->pcm, p, p + 1, 2, n * bpf, buf + out * 2);
+            st->rd_pos += n * 2 * bpf;
+            st->dop_frames_out += n * bpf / 2;
+        }
+        return (int32_t)out;
+    }
+
+    /* ── DSF path: straight from the per-channel blocks ───────────── */
+    while (out < max_frames) {
+        if (st->blk_frame_pos >= st->blk_frames) {
+            if (!dsd_load_next_block(h)) break;   /* EOF */
+        }
+
+        /* Whole PCM frames only: a short tail (last, partial block) is dropped */
+        uint32_t avail = (st->blk_frames - st->blk_frame_pos) * 2 / bpf;
+        if (avail == 0) {
+            st->blk_frame_pos = st->blk_frames;
+            continue;
+        }
+        uint32_t emit = (avail < (max_frames - out)) ? avail : (max_frames - out);
+
+        uint32_t bi = st->blk_frame_pos * 2;
+        out += dsd2pcm_process(st->pcm, st->blk_l + bi, st->blk_r + bi, 1,
+                               emit * bpf, buf + out * 2);
+        st->blk_frame_pos  += emit * bpf / 2;
+        st->dop_frames_out += emit * bpf / 2;
+    }
+    return (int32_t)out;
+}
+
 /* ------------------------------------------------------------------ */
 /* vtable — decode                                                     */
 /* ------------------------------------------------------------------ */
@@ -386,27 +611,17 @@ static int32_t dsd_decode(codec_handle_t *h, int32_t *buf, uint32_t max_frames)
     dsd_state_t *st = (dsd_state_t *)h->dsd.state;
     uint32_t out = 0;
 
-    /* ── DFF path: read directly from interleaved file stream ─────── */
+    if (st->pcm) return dsd_decode_pcm(h, buf, max_frames);
+
+    /* ── DFF path: interleaved L R bytes from the read-ahead buffer ─ */
     if (st->is_dff) {
-        uint8_t raw[512];   /* 128 DoP frames × 4 bytes */
         while (out < max_frames) {
-            uint32_t batch = max_frames - out;
-            if (batch > 128) batch = 128;
-            size_t n = fread(raw, 4, batch, h->file);
+            uint32_t n = dsd_rd_fill(h, (max_frames - out) * 4) / 4;
             if (n == 0) break;
-            uint8_t mk = st->dop_marker;
-            for (size_t i = 0; i < n; i++) {
-                uint8_t *p = raw + i * 4;
-                /* DFF interleaved: L0=p[0], R0=p[1], L1=p[2], R1=p[3]
-                 * DoP: earlier byte at [7:0], later byte at [15:8]    */
-                buf[out * 2]     = (int32_t)(((uint32_t)mk << 16)
-                                 | ((uint32_t)p[2] << 8) | p[0]);
-                buf[out * 2 + 1] = (int32_t)(((uint32_t)mk << 16)
-                                 | ((uint32_t)p[3] << 8) | p[1]);
-                mk = (mk == DOP_MARKER_A) ? DOP_MARKER_B : DOP_MARKER_A;
-                out++;
-            }
-            st->dop_marker = mk;
+            if (n > max_frames - out) n = max_frames - out;
+            dop_pack_dff(st->rd_buf + st->rd_pos, n, &st->dop_marker, buf + out * 2);
+            st->rd_pos += n * 4;
+            out += n;
         }
         st->dop_frames_out += out;
         return (int32_t)out;
@@ -422,40 +637,12 @@ static int32_t dsd_decode(codec_handle_t *h, int32_t *buf, uint32_t max_frames)
 
         uint32_t avail = st->blk_frames - st->blk_frame_pos;
         uint32_t emit  = (avail < (max_frames - out)) ? avail : (max_frames - out);
+        uint32_t bi    = st->blk_frame_pos * 2;  /* 2 bytes per channel per DoP frame */
 
-        uint32_t pos = st->blk_frame_pos;
-        uint8_t  mk  = st->dop_marker;
-
-        for (uint32_t i = 0; i < emit; i++, pos++) {
-            uint32_t bi = pos * 2;  /* byte index into block (2 bytes per DoP frame) */
-
-            /*
-             * Pack two consecutive DSF bytes (16 DSD bits) per channel into a DoP word.
-             * DSF stores bits LSB-first within each byte (bit 0 = earliest DSD sample).
-             * DoP carries them as-is, little-endian in bits [15:0]:
-             *   bits [15:8] = second DSF byte  (DSD samples 8-15)
-             *   bits  [7:0] = first  DSF byte  (DSD samples 0-7)
-             * Bits [23:16] = DoP marker (0x05 or 0xFA).
-             * Bits [31:24] = 0x00 (padding).
-             */
-            uint32_t dop_l = ((uint32_t)mk            << 16)
-                           | ((uint32_t)st->blk_l[bi + 1] <<  8)
-                           |  (uint32_t)st->blk_l[bi];
-
-            uint32_t dop_r = ((uint32_t)mk            << 16)
-                           | ((uint32_t)st->blk_r[bi + 1] <<  8)
-                           |  (uint32_t)st->blk_r[bi];
-
-            buf[out * 2]     = (int32_t)dop_l;
-            buf[out * 2 + 1] = (int32_t)dop_r;
-
-            /* Alternate marker every DoP frame */
-            mk = (mk == DOP_MARKER_A) ? DOP_MARKER_B : DOP_MARKER_A;
-            out++;
-        }
+        dop_pack_dsf(st->blk_l + bi, st->blk_r + bi, emit, &st->dop_marker, buf + out * 2);
 
-        st->blk_frame_pos  = pos;
-        st->dop_marker     = mk;
+        out                += emit;
+        st->blk_frame_pos  += emit;
         st->dop_frames_out += emit;
     }
 
@@ -466,7 +653,7 @@ static int32_t dsd_decode(codec_handle_t *h, int32_t *buf, uint32_t max_frames)
 /* vtable — seek                                                       */
 /* ------------------------------------------------------------------ */
 
-static bool dsd_seek(codec_handle_t *h, uint64_t frame_pos)
+static bool dsd_seek_dop(codec_handle_t *h, uint64_t frame_pos)
 {
     dsd_state_t *st = (dsd_state_t *)h->dsd.state;
 
@@ -474,7 +661,7 @@ static bool dsd_seek(codec_handle_t *h, uint64_t frame_pos)
     if (st->is_dff) {
         /* 4 bytes per DoP frame (L0,R0,L1,R1) */
         uint64_t byte_off = st->data_offset + frame_pos * 4;
-        if (fseek(h->file, (long)byte_off, SEEK_SET) != 0) {
+        if (!dsd_rd_seek(h, byte_off)) {
             ESP_LOGE(TAG, "DFF seek failed (offset=%llu)",
                      (unsigned long long)byte_off);
             return false;
@@ -500,7 +687,7 @@ static bool dsd_seek(codec_handle_t *h, uint64_t frame_pos)
 
     uint64_t byte_off = st->data_offset + block_idx * (uint64_t)st->block_size * 2;
 
-    if (fseek(h->file, (long)byte_off, SEEK_SET) != 0) {
+    if (!dsd_rd_seek(h, byte_off)) {
         ESP_LOGE(TAG, "DSD seek failed (offset=%llu)", (unsigned long long)byte_off);
         return false;
     }
@@ -518,6 +705,18 @@ static bool dsd_seek(codec_handle_t *h, uint64_t frame_pos)
     return true;
 }
 
+static bool dsd_seek(codec_handle_t *h, uint64_t frame_pos)
+{
+    dsd_state_t *st = (dsd_state_t *)h->dsd.state;
+    if (!st->pcm) return dsd_seek_dop(h, frame_pos);
+
+    /* PCM frame → DoP frame (2 bytes per channel); lands on a PCM frame
+     * boundary inside the DSF block since pcm_bpf divides block_size */
+    if (!dsd_seek_dop(h, frame_pos * st->pcm_bpf / 2)) return false;
+    dsd2pcm_reset(st->pcm);
+    return true;
+}
+
 /* ------------------------------------------------------------------ */
 /* vtable — close                                                      */
 /* ------------------------------------------------------------------ */
@@ -526,8 +725,8 @@ static void dsd_close(codec_handle_t *h)
 {
     dsd_state_t *st = (dsd_state_t *)h->dsd.state;
     if (st) {
-        free(st->blk_l);
-        free(st->blk_r);
+        dsd2pcm_destroy(st->pcm);
+        free(st->rd_buf);
         free(st);
         h->dsd.state = NULL;
     }
@@ -543,6 +742,56 @@ static const codec_vtable_t s_dsd_vtable = {
     .close  = dsd_close,
 };
 
+/* ------------------------------------------------------------------ */
+/* Output mode                                                         */
+/* ------------------------------------------------------------------ */
+
+void codec_set_dsd_output(codec_dsd_output_t mode)
+{
+    if (mode >= CODEC_DSD_OUTPUT_COUNT) mode = CODEC_DSD_DOP;
+    s_dsd_output = mode;
+}
+
+codec_dsd_output_t codec_get_dsd_output(void)
+{
+    return s_dsd_output;
+}
+
+/*
+ * Switch a freshly parsed stream to PCM output. Falls back to DoP (with a
+ * warning) when the decimator cannot be built — the track still plays.
+ */
+static void dsd_enable_pcm(codec_handle_t *h, dsd_state_t *st, uint32_t pcm_rate)
+{
+    const uint32_t dsd_rate = h->info.dsd_rate;
+    const uint32_t bpf = dsd_rate / pcm_rate / 8;
+
+    if (!st->is_dff && (st->block_size % bpf) != 0) {
+        ESP_LOGW(TAG, "DSF block size %lu not a multiple of %lu, keeping DoP",
+                 (unsigned long)st->block_size, (unsigned long)bpf);
+        return;
+    }
+    st->pcm = dsd2pcm_create(dsd_rate, pcm_rate, !st->is_dff);
+    if (!st->pcm) {
+        ESP_LOGW(TAG, "OOM for DSD→PCM decimator, keeping DoP");
+        return;
+    }
+    st->pcm_bpf = bpf;
+
+    h->info.sample_rate     = pcm_rate;
+    h->info.bits_per_sample = 24;
+    h->info.total_frames    = st->total_dsd_samples / (dsd_rate / pcm_rate);
+    h->info.is_dsd          = false;
+    /* The last DSF block is padded with zero bytes — a full-scale negative
+     * level once decimated. Stop at the last real frame instead. */
+    h->end_frame            = h->info.total_frames;
+
+    ESP_LOGI(TAG, "DSD %lu Hz → PCM %lu Hz (÷%lu, ~%lu cycles/frame)",
+             (unsigned long)dsd_rate, (unsigned long)pcm_rate,
+             (unsigned long)(dsd_rate / pcm_rate),
+             (unsigned long)dsd2pcm_cycles_per_frame(dsd_rate, pcm_rate));
+}
+
 /* ------------------------------------------------------------------ */
 /* codec_dsd_open — entry point called by codec_open()                 */
 /* ------------------------------------------------------------------ */
@@ -555,6 +804,10 @@ bool codec_dsd_open(codec_handle_t *h)
         return false;
     }
 
+    /* Our read-ahead buffer replaces stdio's (set before any I/O): codec_io
+     * already buffers the file, a second stdio copy would only add a memcpy */
+    setvbuf(h->file, NULL, _IONBF, 0);
+
     /* Detect container by magic (file is at offset 0) */
     char magic[4];
     if (fread(magic, 1, 4, h->file) != 4) {
@@ -583,21 +836,32 @@ bool codec_dsd_open(codec_handle_t *h)
         return false;
     }
 
-    /* Allocate block I/O buffers for DSF (not needed for DFF) */
+    /* Read-ahead buffer in PSRAM, filled by memcpy from the codec_io ring
+     * (no DMA into it, so no internal RAM needed). DSF: room for a block
+     * pair past any compacted position. */
+    st->rd_cap = DSD_RD_BYTES;
     if (!st->is_dff) {
-        st->blk_l = malloc(st->block_size);
-        st->blk_r = malloc(st->block_size);
-        if (!st->blk_l || !st->blk_r) {
-            ESP_LOGE(TAG, "OOM for DSD block buffers (%lu bytes each)",
-                     (unsigned long)st->block_size);
-            free(st->blk_l);
-            free(st->blk_r);
-            free(st);
-            return false;
-        }
+        uint32_t pair = 2 * st->block_size + DSD_SECTOR + DSD_RD_ALIGN;
+        pair = (pair + DSD_SECTOR - 1) & ~(DSD_SECTOR - 1);
+        if (st->rd_cap < pair) st->rd_cap = pair;
     }
-
+    st->rd_buf = heap_caps_aligned_alloc(DSD_RD_ALIGN, st->rd_cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!st->rd_buf) st->rd_buf = heap_caps_aligned_alloc(DSD_RD_ALIGN, st->rd_cap, MALLOC_CAP_8BIT);
     h->dsd.state = st;
-    h->vt        = &s_dsd_vtable;
+    if (!st->rd_buf || !dsd_rd_seek(h, st->data_offset)) {
+        ESP_LOGE(TAG, "OOM for DSD read buffer (%lu bytes)", (unsigned long)st->rd_cap);
+        free(st->rd_buf);
+        free(st);
+        h->dsd.state = NULL;
+        return false;
+    }
+
+    codec_dsd_output_t mode = s_dsd_output;
+    if (mode != CODEC_DSD_DOP) {
+        dsd_enable_pcm(h, st, mode == CODEC_DSD_PCM_88K ? DSD2PCM_RATE_88K
+                                                        : DSD2PCM_RATE_176K);
+    }
+
+    h->vt = &s_dsd_vtable;
     return true;
 }
@@ -197,11 +197,25 @@ static const codec_vtable_t flac_vtable = {
 // FLAC open: pre-scan for ReplayGain, then init dr_flac with custom I/O
 //--------------------------------------------------------------------+
 
+/* Open cache state: the ReplayGain found by the pre-scan */
+typedef struct {
+    float gain_db;
+} flac_open_state_t;
+
 bool codec_flac_open(codec_handle_t *h)
 {
     /* Pre-scan metadata blocks for REPLAYGAIN_TRACK_GAIN before dr_flac
-     * takes ownership of the read position.  The scan rewinds to 0. */
-    float gain_db = flac_read_replaygain(h->file);
+     * takes ownership of the read position.  The scan rewinds to 0.
+     * Skipped when the open cache has the result of a previous scan. */
+    const flac_open_state_t *cached = codec_open_cached(h, sizeof(flac_open_state_t));
+    float gain_db;
+    if (cached) {
+        gain_db = cached->gain_db;
+    } else {
+        gain_db = flac_read_replaygain(h->file);
+        flac_open_state_t state = { .gain_db = gain_db };
+        codec_open_remember(h, &state, sizeof(state));
+    }
 
     drflac *flac = drflac_open(flac_read_cb, flac_seek_cb, flac_tell_cb, h->file, NULL);
     if (!flac) {
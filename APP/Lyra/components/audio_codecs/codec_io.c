@@ -0,0 +1,310 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                     // fopencookie
+#endif
+#include "codec_io.h"
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *TAG = "codec_io";
+
+//--------------------------------------------------------------------+
+// Stream state
+//--------------------------------------------------------------------+
+
+enum { SLOT_EMPTY, SLOT_PENDING, SLOT_READY };
+
+typedef struct {
+    int64_t  off;                       // file offset, multiple of CODEC_IO_SLOT
+    int32_t  len;                       // bytes read (READY), -1 on error
+    uint32_t used;                      // reader's access stamp (LRU)
+    uint8_t  state;                     // written by the I/O task, read by the reader
+} io_slot_t;
+
+typedef struct {
+    int      fd;
+    int64_t  size;
+    int64_t  pos;                       // reader position
+    uint8_t *ring;                      // [CODEC_IO_SLOTS * CODEC_IO_SLOT], PSRAM
+    io_slot_t slot[CODEC_IO_SLOTS];
+
+    uint32_t ahead;                     // slots kept in flight past the current one
+    int64_t  last;                      // offset of the slot read last
+    uint32_t stamp;
+
+    SemaphoreHandle_t done;             // given by the I/O task per slot
+    uint32_t inflight;                  // requests queued or running
+
+    // Stats, logged on close
+    uint32_t hits, misses, stall_ms;
+} io_stream_t;
+
+typedef struct {
+    io_stream_t *s;
+    uint32_t     idx;
+} io_req_t;
+
+static QueueHandle_t s_reqs;
+
+//--------------------------------------------------------------------+
+// I/O task
+//--------------------------------------------------------------------+
+
+static int32_t read_slot(int fd, int64_t off, uint8_t *buf)
+{
+    if (lseek(fd, (off_t)off, SEEK_SET) < 0) return -1;
+
+    int32_t got = 0;
+    while (got < CODEC_IO_SLOT) {
+        ssize_t n = read(fd, buf + got, CODEC_IO_SLOT - got);
+        if (n < 0) return -1;
+        if (n == 0) break;              // EOF
+        got += (int32_t)n;
+    }
+    return got;
+}
+
+static void codec_io_task(void *arg)
+{
+    QueueHandle_t reqs = (QueueHandle_t)arg;
+    io_req_t r;
+
+    for (;;) {
+        if (xQueueReceive(reqs, &r, portMAX_DELAY) != pdTRUE) continue;
+
+        io_slot_t *sl = &r.s->slot[r.idx];
+        sl->len = read_slot(r.s->fd, sl->off, r.s->ring + (size_t)r.idx * CODEC_IO_SLOT);
+        __atomic_store_n(&sl->state, SLOT_READY, __ATOMIC_RELEASE);
+        xSemaphoreGive(r.s->done);
+
+        // Last touch of the stream: close waits for this
+        __atomic_sub_fetch(&r.s->inflight, 1, __ATOMIC_RELEASE);
+    }
+}
+
+// Created on demand by the first open
+static bool io_task_start(void)
+{
+    if (s_reqs) return true;
+
+    QueueHandle_t q = xQueueCreate(CODEC_IO_QUEUE_LEN, sizeof(io_req_t));
+    if (!q) return false;
+    if (xTaskCreatePinnedToCore(codec_io_task, "codec_io", CODEC_IO_TASK_STACK,
+                                q, CODEC_IO_TASK_PRIO, NULL, 0) != pdPASS) {
+        vQueueDelete(q);
+        return false;
+    }
+    s_reqs = q;
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// Ring management (reader side)
+//--------------------------------------------------------------------+
+
+static uint8_t slot_state(const io_slot_t *sl)
+{
+    return __atomic_load_n(&sl->state, __ATOMIC_ACQUIRE);
+}
+
+static io_slot_t *slot_find(io_stream_t *s, int64_t off)
+{
+    for (int i = 0; i < CODEC_IO_SLOTS; i++) {
+        if (slot_state(&s->slot[i]) != SLOT_EMPTY && s->slot[i].off == off) return &s->slot[i];
+    }
+    return NULL;
+}
+
+// Queue a read of the slot at @p off, recycling the least recently used
+// slot outside [cur, end). False if every slot is in flight or in use.
+static bool slot_request(io_stream_t *s, int64_t off, int64_t cur, int64_t end)
+{
+    int victim = -1;
+    for (int i = 0; i < CODEC_IO_SLOTS; i++) {
+        io_slot_t *sl = &s->slot[i];
+        uint8_t st = slot_state(sl);
+        if (st == SLOT_PENDING) continue;
+        if (st == SLOT_READY && sl->off >= cur && sl->off < end) continue;
+        if (st == SLOT_EMPTY) { victim = i; break; }
+        if (victim < 0 || sl->used < s->slot[victim].used) victim = i;
+    }
+    if (victim < 0) return false;
+
+    io_slot_t *sl = &s->slot[victim];
+    sl->off   = off;
+    sl->len   = 0;
+    sl->used  = s->stamp;
+    sl->state = SLOT_PENDING;
+    __atomic_add_fetch(&s->inflight, 1, __ATOMIC_RELAXED);
+
+    io_req_t r = { .s = s, .idx = (uint32_t)victim };
+    xQueueSend(s_reqs, &r, portMAX_DELAY);
+    return true;
+}
+
+// Keep the slots from cur to cur + ahead read or in flight
+static void prefetch(io_stream_t *s, int64_t cur)
+{
+    int64_t end = cur + (int64_t)(s->ahead + 1) * CODEC_IO_SLOT;
+    for (int64_t off = cur; off < end && off < s->size; off += CODEC_IO_SLOT) {
+        if (!slot_find(s, off) && !slot_request(s, off, cur, end)) break;
+    }
+}
+
+//--------------------------------------------------------------------+
+// stdio cookie
+//--------------------------------------------------------------------+
+
+static ssize_t io_read(void *cookie, char *buf, size_t n)
+{
+    io_stream_t *s = cookie;
+    size_t done = 0;
+
+    while (done < n && s->pos < s->size) {
+        int64_t cur = s->pos - s->pos % CODEC_IO_SLOT;
+        io_slot_t *sl = slot_find(s, cur);
+
+        // Entering a slot: sequential reads deepen the read-ahead
+        if (cur != s->last) {
+            if (cur == s->last + CODEC_IO_SLOT) {
+                s->ahead = (s->ahead * 2 < CODEC_IO_SLOTS - 1) ? s->ahead * 2 : CODEC_IO_SLOTS - 1;
+            } else {
+                s->ahead = 1;
+            }
+            if (sl && slot_state(sl) == SLOT_READY) s->hits++; else s->misses++;
+            s->last = cur;
+        }
+        s->stamp++;
+
+        prefetch(s, cur);
+        if (!(sl = slot_find(s, cur))) {
+            // Every slot in flight (after a jump): wait for one to land
+            xSemaphoreTake(s->done, portMAX_DELAY);
+            continue;
+        }
+
+        if (slot_state(sl) == SLOT_PENDING) {
+            uint32_t t0 = esp_log_timestamp();
+            while (slot_state(sl) == SLOT_PENDING) {
+                xSemaphoreTake(s->done, portMAX_DELAY);
+            }
+            s->stall_ms += esp_log_timestamp() - t0;
+        }
+        sl->used = s->stamp;
+
+        if (sl->len < 0) {
+            sl->state = SLOT_EMPTY;     // retried on the next read
+            return done ? (ssize_t)done : -1;
+        }
+        int64_t at = s->pos - cur;
+        if (at >= sl->len) break;       // file shorter than at open
+
+        size_t k = (size_t)(sl->len - at);
+        if (k > n - done) k = n - done;
+        memcpy(buf + done, s->ring + (size_t)(sl - s->slot) * CODEC_IO_SLOT + at, k);
+        s->pos += (int64_t)k;
+        done   += k;
+    }
+    return (ssize_t)done;
+}
+
+static int io_seek(void *cookie, _off64_t *off, int whence)
+{
+    io_stream_t *s = cookie;
+    int64_t base = (whence == SEEK_SET) ? 0 : (whence == SEEK_CUR) ? s->pos : s->size;
+    int64_t pos  = base + (int64_t)*off;
+    if (pos < 0) return -1;
+
+    // Lazy: the next read fetches from the new position
+    s->pos = pos;
+    *off   = pos;
+    return 0;
+}
+
+static int io_close(void *cookie)
+{
+    io_stream_t *s = cookie;
+
+    // The I/O task may still be filling slots of this stream
+    while (__atomic_load_n(&s->inflight, __ATOMIC_ACQUIRE)) {
+        xSemaphoreTake(s->done, 1);
+    }
+
+    ESP_LOGI(TAG, "Read-ahead: %lu hit / %lu miss, decoder stalled %lu ms",
+             (unsigned long)s->hits, (unsigned long)s->misses, (unsigned long)s->stall_ms);
+
+    close(s->fd);
+    vSemaphoreDelete(s->done);
+    heap_caps_free(s->ring);
+    free(s);
+    return 0;
+}
+
+//--------------------------------------------------------------------+
+// Open
+//--------------------------------------------------------------------+
+
+static FILE *open_plain(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f) setvbuf(f, NULL, _IOFBF, 32768);  // 32KB read-ahead buffer for SD throughput
+    return f;
+}
+
+FILE *codec_io_open(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    io_stream_t *s = NULL;
+    if (fstat(fd, &st) != 0 || !io_task_start() ||
+        (s = calloc(1, sizeof(*s))) == NULL) {
+        goto plain;
+    }
+
+    // SDMMC on the P4 DMAs to PSRAM when the buffer is cache-line aligned
+    s->ring = heap_caps_aligned_alloc(CODEC_IO_ALIGN, (size_t)CODEC_IO_SLOTS * CODEC_IO_SLOT,
+                                      MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s->done = xSemaphoreCreateBinary();
+    if (!s->ring || !s->done) goto plain;
+
+    s->fd    = fd;
+    s->size  = (int64_t)st.st_size;
+    s->ahead = 1;
+    s->last  = -CODEC_IO_SLOT;          // first slot counts as sequential
+
+    cookie_io_functions_t fns = {
+        .read  = io_read,
+        .write = NULL,
+        .seek  = io_seek,
+        .close = io_close,
+    };
+    FILE *f = fopencookie(s, "rb", fns);
+    if (!f) goto plain;
+    setvbuf(f, NULL, _IOFBF, CODEC_IO_STDIO_BUF);
+
+    // First slot now: header parsing starts right away
+    prefetch(s, 0);
+    return f;
+
+plain:
+    ESP_LOGW(TAG, "Read-ahead unavailable, using stdio for %s", path);
+    if (s) {
+        if (s->done) vSemaphoreDelete(s->done);
+        heap_caps_free(s->ring);
+        free(s);
+    }
+    close(fd);
+    return open_plain(path);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdio.h>
+
+//--------------------------------------------------------------------+
+// Codec I/O: asynchronous read-ahead for the decoders
+//--------------------------------------------------------------------+
+//
+// A track opened for decoding gets a ring of CODEC_IO_SLOTS slots in
+// PSRAM. One I/O task (shared by all open tracks) fills them ahead of
+// the decoder with CODEC_IO_SLOT-byte reads. Reads start at
+// slot-aligned file offsets into 64-byte-aligned slots, so FATFS
+// transfers whole sectors and SDMMC DMAs straight into the ring. An
+// unaligned buffer makes the driver bounce every sector, which is about
+// 10x slower (see usb_msc.c).
+//
+// Decoders keep using stdio: the ring is wrapped in a FILE (newlib
+// fopencookie), so fread/fseek/ftell in every decoder and the dr_*
+// callbacks read from the ring. Only the reader blocks, and only when
+// the slot it needs is still in flight, so an SD latency spike shorter
+// than the read-ahead window never reaches the decoder.
+//
+// Read-ahead depth adapts: sequential reads double it up to the whole
+// ring, and a jump (seek, M4A table lookup) drops it to one slot so a
+// random access does not read 256 KB it will not use.
+//--------------------------------------------------------------------+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CODEC_IO_SLOT           32768   // bytes per SD read (64 sectors)
+#define CODEC_IO_SLOTS          8       // ring = 256 KB of read-ahead per track
+#define CODEC_IO_ALIGN          64      // P4 cache line (SDMMC DMA)
+#define CODEC_IO_STDIO_BUF      4096    // stdio buffer over the ring (small reads)
+
+// I/O task (created on the first open)
+#define CODEC_IO_TASK_STACK     3072
+#define CODEC_IO_TASK_PRIO      6       // above the decode task (sd_play, 5)
+#define CODEC_IO_QUEUE_LEN      (CODEC_IO_SLOTS * 3)
+
+/**
+ * @brief Open a track for decoding through the read-ahead ring
+ *
+ * Falls back to a plain FILE with a 32 KB stdio buffer when the ring or
+ * the I/O task cannot be allocated. fclose() releases either.
+ *
+ * @return FILE positioned at 0, or NULL if the file cannot be opened
+ */
+FILE *codec_io_open(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
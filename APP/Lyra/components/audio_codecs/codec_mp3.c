@@ -3,8 +3,11 @@
 #define DR_MP3_NO_STDIO
 
 #include "audio_codecs_internal.h"
+#include "codec_cache.h"
 #include "dr_mp3.h"
 #include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <stdlib.h>
 
 static const char *TAG = "codec_mp3";
@@ -37,6 +40,261 @@ static drmp3_bool32 mp3_tell_cb(void *userdata, drmp3_int64 *pCursor)
     return DRMP3_TRUE;
 }
 
+//--------------------------------------------------------------------+
+// Seek index: MP3 frame offsets, built in the background, cached on SD
+//--------------------------------------------------------------------+
+//
+// Without an index dr_mp3 can only seek by decoding from the start of the
+// stream (seconds on a long mix). The indexer walks the frame headers
+// once, without decoding, and keeps the byte offset of every
+// MP3_INDEX_STEP-th audio frame:
+//
+//   codec_cache_hdr_t | mp3_index_hdr_t | uint32 offset[entries]
+//   offset[e] = file position of audio frame e × MP3_INDEX_STEP
+//
+// Audio frame 0 is the first frame after the Xing/Info frame, i.e. where
+// dr_mp3 starts counting PCM frames, so frame k starts at k × spf in
+// dr_mp3's raw domain (encoder delay included). A seek reads one entry
+// and hands dr_mp3 a single seek point MP3_INDEX_PRIME or more frames
+// before the target, to refill the bit reservoir: at most
+// STEP + PRIME + 1 frames are decoded, wherever the target is.
+//
+// ~4 bytes per 0.4 s of audio (12 KB for a 2-hour mix at 44.1 kHz).
+//--------------------------------------------------------------------+
+
+#define MP3_INDEX_EXT        "mpx"
+#define MP3_INDEX_MAGIC      0x3158504Du    // "MPX1"
+#define MP3_INDEX_VERSION    1
+#define MP3_INDEX_STEP       16             // MP3 frames per entry
+#define MP3_INDEX_PRIME      4              // frames decoded ahead of the target
+#define MP3_INDEX_MIN_BYTES  (1024 * 1024)  // shorter files seek fast enough
+#define MP3_SCAN_BUF         16384          // header scan read size
+#define MP3_SCAN_RESYNC      65536          // bytes searched for sync after garbage
+#define MP3_SCAN_YIELD       4              // reads between 1-tick pauses
+
+typedef struct {
+    uint32_t sample_rate;
+    uint16_t spf;                   // PCM frames per MP3 frame
+    uint16_t step;                  // MP3 frames per entry
+    uint32_t frames;                // audio frames (Xing/Info frame excluded)
+    uint32_t entries;               // offsets that follow
+} mp3_index_hdr_t;
+
+typedef struct {
+    codec_cache_key_t key;
+    mp3_index_hdr_t hdr;
+    bool ready;                     // index on SD matches the open file
+} mp3_index_t;
+
+// Buffered header reader over the raw file
+typedef struct {
+    FILE *f;
+    uint8_t *buf;
+    uint64_t base;                  // file position of buf[0]
+    uint32_t len;
+    uint64_t end;                   // first byte after the audio (ID3v1/APE excluded)
+    uint32_t reads;
+} mp3_scan_t;
+
+// n bytes at pos, or NULL past the end of the audio
+static const uint8_t *mp3_scan_at(mp3_scan_t *s, uint64_t pos, uint32_t n)
+{
+    if (pos + n > s->end) return NULL;
+    if (pos < s->base || pos + n > s->base + s->len) {
+        if (fseek(s->f, (long)pos, SEEK_SET) != 0) return NULL;
+        s->base = pos;
+        s->len  = fread(s->buf, 1, MP3_SCAN_BUF, s->f);
+        // Leave the card to the player between reads
+        if (++s->reads % MP3_SCAN_YIELD == 0) vTaskDelay(1);
+        if (pos + n > s->base + s->len) return NULL;
+    }
+    return s->buf + (pos - s->base);
+}
+
+// Length of the frame at pos if its header matches ref, else 0
+static uint32_t mp3_scan_frame(mp3_scan_t *s, uint64_t pos, const uint8_t *ref)
+{
+    const uint8_t *h = mp3_scan_at(s, pos, 4);
+    if (!h || !drmp3_hdr_compare(ref, h)) return 0;
+
+    int bytes = drmp3_hdr_frame_bytes(h, 0);
+    if (bytes <= 4) return 0;                       // free format: not indexed
+    uint32_t len = (uint32_t)(bytes + drmp3_hdr_padding(h));
+    return (pos + len <= s->end) ? len : 0;
+}
+
+// Next position from *pos where a matching frame is followed by another
+// matching frame (or by the end of the audio)
+static bool mp3_scan_sync(mp3_scan_t *s, uint64_t *pos, const uint8_t *ref)
+{
+    for (uint64_t p = *pos; p < *pos + MP3_SCAN_RESYNC; p++) {
+        const uint8_t *h = mp3_scan_at(s, p, 4);
+        if (!h) return false;
+        if (h[0] != 0xFF) continue;
+
+        uint32_t len = mp3_scan_frame(s, p, ref);
+        if (len && (p + len == s->end || mp3_scan_frame(s, p + len, ref))) {
+            *pos = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+// codec_cache_build_fn: walk the headers of one file and write its index
+static bool mp3_index_build(const char *path, const codec_cache_key_t *key)
+{
+    if (key->size < MP3_INDEX_MIN_BYTES || key->size > UINT32_MAX) return false;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    bool ok = false;
+    FILE *out = NULL;
+    uint8_t *buf = malloc(MP3_SCAN_BUF);
+    drmp3 *mp3 = calloc(1, sizeof(drmp3));
+    if (!buf || !mp3) goto done;
+
+    // dr_mp3 finds the audio bounds (ID3v2, Xing/Info frame, ID3v1/APE)
+    if (!drmp3_init(mp3, mp3_read_cb, mp3_seek_cb, mp3_tell_cb, NULL, f, NULL)) goto done;
+    mp3_scan_t s = {
+        .f   = f,
+        .buf = buf,
+        .end = (mp3->streamLength < key->size) ? mp3->streamLength : key->size,
+    };
+    uint64_t pos = mp3->streamStartOffset;
+    uint32_t sample_rate = mp3->sampleRate;
+    drmp3_uninit(mp3);
+
+    // Reference header: the first frame with a matching successor
+    uint8_t ref[4];
+    uint64_t limit = pos + MP3_SCAN_RESYNC;
+    for (;; pos++) {
+        const uint8_t *h = mp3_scan_at(&s, pos, 4);
+        if (!h || pos == limit) goto done;
+        if (!drmp3_hdr_valid(h)) continue;
+        memcpy(ref, h, 4);
+        uint32_t len = mp3_scan_frame(&s, pos, ref);
+        if (len && mp3_scan_frame(&s, pos + len, ref)) break;
+    }
+    if (drmp3_hdr_sample_rate_hz(ref) != sample_rate) goto done;
+
+    out = codec_cache_create(key, MP3_INDEX_EXT, MP3_INDEX_MAGIC, MP3_INDEX_VERSION);
+    if (!out) goto done;
+
+    mp3_index_hdr_t hdr = {
+        .sample_rate = sample_rate,
+        .spf         = (uint16_t)drmp3_hdr_frame_samples(ref),
+        .step        = MP3_INDEX_STEP,
+    };
+    if (fwrite(&hdr, sizeof(hdr), 1, out) != 1) goto done;
+
+    static uint32_t batch[256];     // one build at a time (worker task)
+    uint32_t n = 0;
+    uint32_t resyncs = 0;
+
+    for (;;) {
+        uint32_t len = mp3_scan_frame(&s, pos, ref);
+        if (!len) {
+            // Garbage inside the stream: skip to the next frame pair
+            pos++;
+            if (!mp3_scan_sync(&s, &pos, ref)) break;
+            resyncs++;
+            continue;
+        }
+        if (hdr.frames % MP3_INDEX_STEP == 0) {
+            batch[n++] = (uint32_t)pos;
+            hdr.entries++;
+            if (n == sizeof(batch) / sizeof(batch[0])) {
+                if (fwrite(batch, sizeof(uint32_t), n, out) != n) goto done;
+                n = 0;
+            }
+        }
+        hdr.frames++;
+        pos += len;
+    }
+    if (n && fwrite(batch, sizeof(uint32_t), n, out) != n) goto done;
+
+    // Header again, now with the counts
+    ok = hdr.entries > 0 &&
+         fseek(out, CODEC_CACHE_PAYLOAD, SEEK_SET) == 0 &&
+         fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+    if (ok) {
+        ESP_LOGI(TAG, "Indexed %lu frames, %lu entries, %lu resyncs",
+                 (unsigned long)hdr.frames, (unsigned long)hdr.entries,
+                 (unsigned long)resyncs);
+    }
+
+done:
+    if (out) ok = codec_cache_commit(out, key, MP3_INDEX_EXT, ok);
+    else ok = false;
+    free(mp3);
+    free(buf);
+    fclose(f);
+    return ok;
+}
+
+// Header of the index on SD, if there is one for this exact file
+static bool mp3_index_load(mp3_index_t *idx, const drmp3 *mp3)
+{
+    FILE *f = codec_cache_open(&idx->key, MP3_INDEX_EXT, MP3_INDEX_MAGIC, MP3_INDEX_VERSION);
+    if (!f) return false;
+
+    bool ok = fread(&idx->hdr, sizeof(idx->hdr), 1, f) == 1 &&
+              idx->hdr.sample_rate == mp3->sampleRate &&
+              idx->hdr.step == MP3_INDEX_STEP && idx->hdr.spf > 0 &&
+              idx->hdr.entries == (idx->hdr.frames + MP3_INDEX_STEP - 1) / MP3_INDEX_STEP;
+    fclose(f);
+    idx->ready = ok;
+    return ok;
+}
+
+// Byte offset of index entry e
+static bool mp3_index_entry(const mp3_index_t *idx, uint32_t e, uint32_t *offset)
+{
+    FILE *f = codec_cache_open(&idx->key, MP3_INDEX_EXT, MP3_INDEX_MAGIC, MP3_INDEX_VERSION);
+    if (!f) return false;
+
+    long at = CODEC_CACHE_PAYLOAD + (long)sizeof(mp3_index_hdr_t) + (long)e * 4;
+    bool ok = fseek(f, at, SEEK_SET) == 0 && fread(offset, 4, 1, f) == 1;
+    fclose(f);
+    return ok;
+}
+
+// Seek through the index; false → caller falls back to dr_mp3's own seek
+static bool mp3_index_seek(codec_handle_t *h, drmp3 *mp3, uint64_t frame_pos)
+{
+    mp3_index_t *idx = (mp3_index_t *)h->mp3.index;
+    if (!idx || frame_pos == 0) return false;
+    if (!idx->ready && !mp3_index_load(idx, mp3)) return false;
+
+    // Target MP3 frame in dr_mp3's raw domain (encoder delay included)
+    uint64_t raw = frame_pos + mp3->delayInPCMFrames;
+    uint64_t j = raw / idx->hdr.spf;
+    if (j < MP3_INDEX_PRIME + 1) return false;       // near the start anyway
+    if (j >= idx->hdr.frames) return false;          // past the end: let dr_mp3 fail
+
+    uint32_t e = (uint32_t)((j - MP3_INDEX_PRIME) / MP3_INDEX_STEP);
+    uint32_t offset;
+    if (!mp3_index_entry(idx, e, &offset)) {
+        idx->ready = false;
+        return false;
+    }
+
+    // dr_mp3 decodes frames b and b+1 from offset and resumes at b+1
+    uint64_t b = (uint64_t)e * MP3_INDEX_STEP;
+    drmp3_seek_point point = {
+        .seekPosInBytes     = offset,
+        .pcmFrameIndex      = (b + 1) * idx->hdr.spf,
+        .mp3FramesToDiscard = 2,
+        .pcmFramesToDiscard = 0,
+    };
+    drmp3_bind_seek_table(mp3, 1, &point);
+    bool ok = drmp3_seek_to_pcm_frame(mp3, raw) == DRMP3_TRUE;
+    drmp3_bind_seek_table(mp3, 0, NULL);
+    return ok;
+}
+
 //--------------------------------------------------------------------+
 // MP3 decode: dr_mp3 outputs float, we convert to int32 left-justified
 //--------------------------------------------------------------------+
@@ -44,11 +302,9 @@ static drmp3_bool32 mp3_tell_cb(void *userdata, drmp3_int64 *pCursor)
 // Static buffer for float→int32 conversion (480 stereo frames)
 static float s_mp3_float_buf[480 * 2];
 
-// Gapless: encoder delay/padding trimming state
-static uint64_t s_mp3_delay_remaining;  // frames to skip at start (encoder delay)
-static uint64_t s_mp3_total_playable;   // max frames to output (excludes padding)
-static uint64_t s_mp3_frames_output;    // frames delivered so far
-static bool     s_mp3_gapless;          // true if Xing/LAME header provided delay info
+// Gapless: dr_mp3 drops the LAME/Xing encoder delay and stops before the
+// padding by itself (drmp3_read_pcm_frames_raw), and seek positions are
+// already in trimmed frames — no extra trimming here.
 
 static int32_t mp3_decode(codec_handle_t *h, int32_t *buffer, uint32_t max_frames)
 {
@@ -57,26 +313,9 @@ static int32_t mp3_decode(codec_handle_t *h, int32_t *buffer, uint32_t max_frame
 
     if (max_frames > 480) max_frames = 480;  // clamp to static buffer size
 
-    // Skip encoder delay at start (gapless)
-    while (s_mp3_gapless && s_mp3_delay_remaining > 0) {
-        uint32_t skip = (s_mp3_delay_remaining > 480) ? 480 : (uint32_t)s_mp3_delay_remaining;
-        drmp3_uint64 got = drmp3_read_pcm_frames_f32(mp3, skip, s_mp3_float_buf);
-        if (got == 0) return 0;
-        s_mp3_delay_remaining -= got;
-    }
-
-    // Limit to avoid decoder padding at end (gapless)
-    if (s_mp3_gapless) {
-        uint64_t remaining = s_mp3_total_playable - s_mp3_frames_output;
-        if (remaining == 0) return 0;
-        if (max_frames > remaining) max_frames = (uint32_t)remaining;
-    }
-
     drmp3_uint64 frames = drmp3_read_pcm_frames_f32(mp3, max_frames, s_mp3_float_buf);
     if (frames == 0) return 0;
 
-    if (s_mp3_gapless) s_mp3_frames_output += frames;
-
     uint32_t channels = h->info.channels;
 
     if (channels == 1) {
@@ -106,12 +345,9 @@ static bool mp3_seek(codec_handle_t *h, uint64_t frame_pos)
     drmp3 *mp3 = (drmp3 *)h->mp3.drmp3;
     if (!mp3) return false;
 
-    // After seek, delay has already been skipped; update output counter
-    if (s_mp3_gapless) {
-        s_mp3_delay_remaining = 0;
-        s_mp3_frames_output = frame_pos;
-    }
-
+    // Exact seek through the index when there is one, else dr_mp3 decodes
+    // its way from the start (trimmed frame_pos, dr_mp3 adds the delay)
+    if (mp3_index_seek(h, mp3, frame_pos)) return true;
     return drmp3_seek_to_pcm_frame(mp3, frame_pos) == DRMP3_TRUE;
 }
 
@@ -127,7 +363,8 @@ static void mp3_close(codec_handle_t *h)
         free(mp3);
         h->mp3.drmp3 = NULL;
     }
-    s_mp3_gapless = false;
+    free(h->mp3.index);
+    h->mp3.index = NULL;
 }
 
 //--------------------------------------------------------------------+
@@ -144,12 +381,24 @@ static const codec_vtable_t mp3_vtable = {
 // MP3 open: init dr_mp3 with custom I/O
 //--------------------------------------------------------------------+
 
+// Open cache state: length found last time (exact once the seek index was ready)
+typedef struct {
+    uint64_t total_frames;
+} mp3_open_state_t;
+
 bool codec_mp3_open(codec_handle_t *h)
 {
+    const mp3_open_state_t *cached = codec_open_cached(h, sizeof(mp3_open_state_t));
+
     // Get file size before dr_mp3 init (file is at position 0 from codec_open)
-    fseek((FILE *)h->file, 0, SEEK_END);
-    long file_size = ftell((FILE *)h->file);
-    fseek((FILE *)h->file, 0, SEEK_SET);
+    long file_size;
+    if (h->key_valid) {
+        file_size = (long)h->key.size;
+    } else {
+        fseek((FILE *)h->file, 0, SEEK_END);
+        file_size = ftell((FILE *)h->file);
+        fseek((FILE *)h->file, 0, SEEK_SET);
+    }
 
     drmp3 *mp3 = calloc(1, sizeof(drmp3));
     if (!mp3) {
@@ -180,18 +429,13 @@ bool codec_mp3_open(codec_handle_t *h)
         if (total >= mp3->paddingInPCMFrames)
             total -= mp3->paddingInPCMFrames;
         h->info.total_frames = total;
-
-        // Enable gapless trimming
-        s_mp3_delay_remaining = mp3->delayInPCMFrames;
-        s_mp3_total_playable  = total;
-        s_mp3_frames_output   = 0;
-        s_mp3_gapless         = true;
         ESP_LOGI(TAG, "MP3 gapless: delay=%llu padding=%llu playable=%llu",
                  (unsigned long long)mp3->delayInPCMFrames,
                  (unsigned long long)mp3->paddingInPCMFrames,
                  (unsigned long long)total);
+    } else if (cached) {
+        h->info.total_frames = cached->total_frames;
     } else if (file_size > 0 && mp3->sampleRate > 0) {
-        s_mp3_gapless = false;
         // No Xing header — estimate from file size + first frame bitrate
         // Bitrate lookup table (same as drmp3_hdr_bitrate_kbps internal function)
         static const uint8_t halfrate[2][3][15] = {
@@ -220,13 +464,34 @@ bool codec_mp3_open(codec_handle_t *h)
         }
     } else {
         h->info.total_frames = 0;
-        s_mp3_gapless = false;
+    }
+
+    // Seek index: use the one on SD, or have it built for next time
+    mp3_index_t *idx = NULL;
+    if (file_size >= MP3_INDEX_MIN_BYTES && h->key_valid &&
+        (idx = calloc(1, sizeof(*idx))) != NULL) {
+        idx->key = h->key;
+        if (mp3_index_load(idx, mp3)) {
+            // Exact length for files without a Xing/Info frame (VBR estimate above)
+            if (mp3->totalPCMFrameCount == uint64_max) {
+                h->info.total_frames = (uint64_t)idx->hdr.frames * idx->hdr.spf;
+            }
+        } else {
+            codec_cache_request(h->path, mp3_index_build);
+        }
+        h->mp3.index = idx;
+    }
+
+    if (!cached || cached->total_frames != h->info.total_frames) {
+        mp3_open_state_t state = { .total_frames = h->info.total_frames };
+        codec_open_remember(h, &state, sizeof(state));
     }
 
     h->vt = &mp3_vtable;
 
-    ESP_LOGI(TAG, "MP3: %luHz %dch, %llu frames",
-             h->info.sample_rate, h->info.channels, h->info.total_frames);
+    ESP_LOGI(TAG, "MP3: %luHz %dch, %llu frames, seek index %s",
+             h->info.sample_rate, h->info.channels, h->info.total_frames,
+             !idx ? "off" : idx->ready ? "ready" : "pending");
 
     return true;
 }
@@ -7,13 +7,20 @@
  * Output: int32_t stereo interleaved, left-justified (16-bit PCM << 16).
  *
  * ReplayGain: R128_TRACK_GAIN (int16 Q7.8) from OpusTags → info.gain_db
- * Total frames: scanned from final Ogg page granule at open time.
- * Seek: linear interpolation of byte offset + Ogg forward-sync.
+ * Total frames: final Ogg page granule — from the codec cache when the
+ *               file was seen before, else scanned at open time.
+ * Gapless: pre-skip and end trimming (final granule) are applied by
+ *          codec_decode() through h->priming / h->end_frame.
+ * Seek: exact — granule bisection over the pages (or one lookup in the
+ *       page index cached on SD), 80 ms pre-roll decoded and dropped.
  */
 
 #include "audio_codecs_internal.h"
+#include "codec_cache.h"
 #include <opus.h>
 #include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -23,6 +30,32 @@ static const char *TAG = "codec_opus";
 #define OPUS_MAX_FRAME_SZ  5760
 /* Ogg packet buffer: 8 KB covers any realistic Opus packet                */
 #define OGG_PKT_BUF_SZ     8192
+/* Decoded and dropped before a seek target (RFC 7845 §4.6: 80 ms)        */
+#define OPUS_PREROLL       3840
+/* Bisection stops below this span and walks the remaining pages          */
+#define OGG_BISECT_WINDOW  16384
+/* Page search read size                                                  */
+#define OGG_SCAN_BUF       4096
+
+/* Page index cached on SD (codec_cache): duration + page offsets         */
+#define OPUS_INDEX_EXT     "opx"
+#define OPUS_INDEX_MAGIC   0x3158504Fu  /* "OPX1" */
+#define OPUS_INDEX_VERSION 1
+#define OPUS_INDEX_SPAN    48000        /* granule between entries (1 s)  */
+#define OPUS_INDEX_YIELD   64           /* pages between 1-tick pauses    */
+
+/*
+ * Index payload: header + uint32 offset[entries].
+ * offset[k] = start of the page that follows the last page with granule
+ * < (k + 1) × SPAN, i.e. where decoding starts for a target in that second.
+ */
+typedef struct {
+    int64_t  last_granule;      /* final granule (duration + pre-skip)   */
+    uint32_t first_audio;       /* offset of the first audio page        */
+    uint32_t serial;            /* logical bitstream the index is for    */
+    uint32_t span;
+    uint32_t entries;
+} opus_index_hdr_t;
 
 /* -----------------------------------------------------------------------
  * Decoder state
@@ -40,7 +73,8 @@ typedef struct {
     long     first_audio_offset; /* file offset after OpusTags page */
     long     file_size;          /* total file size (for seek estimation) */
 
-    /* Pre-skip (from OpusHead) — samples to discard at stream start */
+    /* Pre-skip (from OpusHead) — samples to discard at stream start.
+     * Applied by codec_decode() (h->priming), also after seek(0). */
     int32_t  pre_skip;
 
     /* ReplayGain: R128_TRACK_GAIN from OpusTags (0.0 = no tag) */
@@ -55,6 +89,15 @@ typedef struct {
 
     /* PCM output scratch (heap) */
     int16_t *pcm_scratch;        /* OPUS_MAX_FRAME_SZ * channels */
+
+    /* Exact seek: decoded samples still to drop (pre-roll + offset in page) */
+    uint32_t discard;
+
+    /* Page index on SD (key_valid: file stat()ed at open) */
+    codec_cache_key_t key;
+    bool             key_valid;
+    bool             index_ready;
+    opus_index_hdr_t index;
 } opus_state_t;
 
 /* -----------------------------------------------------------------------
@@ -193,6 +236,335 @@ static int ogg_next_packet(FILE *f, opus_state_t *st, uint8_t *buf, uint32_t buf
     }
 }
 
+/* -----------------------------------------------------------------------
+ * Page probe (seek and index): headers only, bodies are skipped
+ * ----------------------------------------------------------------------- */
+
+typedef struct {
+    long     offset;            /* "OggS"                                 */
+    long     body;              /* first body byte                        */
+    long     next;              /* first byte after the page              */
+    int64_t  granule;           /* -1: no packet ends on this page        */
+    uint8_t  flags;             /* header_type (0x01: continued packet)   */
+    uint8_t  nsegs;
+    uint8_t  segs[255];
+} ogg_page_t;
+
+/* Page of bitstream sn starting exactly at off */
+static bool ogg_probe_page(FILE *f, uint32_t sn, long off, ogg_page_t *pg)
+{
+    uint8_t hdr[27];
+    if (fseek(f, off, SEEK_SET) != 0 || fread(hdr, 1, 27, f) != 27) return false;
+    if (memcmp(hdr, "OggS", 4) != 0 || hdr[4] != 0 || rd_le32(hdr + 14) != sn)
+        return false;
+
+    pg->nsegs = hdr[26];
+    if (pg->nsegs && fread(pg->segs, 1, pg->nsegs, f) != pg->nsegs) return false;
+
+    uint32_t body = 0;
+    for (uint32_t i = 0; i < pg->nsegs; i++) body += pg->segs[i];
+    pg->offset  = off;
+    pg->body    = off + 27 + pg->nsegs;
+    pg->next    = pg->body + (long)body;
+    pg->granule = rd_le64(hdr + 6);
+    pg->flags   = hdr[5];
+    return true;
+}
+
+/*
+ * First page of bitstream sn starting in [from, limit).
+ * scratch: OGG_SCAN_BUF bytes. Moves the file position.
+ */
+static bool ogg_find_page(FILE *f, uint32_t sn, long from, long limit,
+                          uint8_t *scratch, ogg_page_t *pg)
+{
+    long pos = from;
+    while (pos < limit) {
+        if (fseek(f, pos, SEEK_SET) != 0) return false;
+        size_t n = fread(scratch, 1, OGG_SCAN_BUF, f);
+        if (n < 27) return false;
+
+        for (size_t i = 0; i + 4 <= n; i++) {
+            if (pos + (long)i >= limit) return false;
+            if (scratch[i] != 'O' || memcmp(scratch + i, "OggS", 4) != 0) continue;
+            if (ogg_probe_page(f, sn, pos + (long)i, pg)) return true;
+        }
+        pos += (long)n - 3;     /* "OggS" split across two reads */
+    }
+    return false;
+}
+
+/*
+ * Granule where the first packet that starts on pg begins: the page
+ * granule minus every packet completed on the page (durations from the
+ * TOC bytes). A packet continued from the previous page cannot be
+ * decoded and is skipped: *skip_segs / *skip_bytes.
+ */
+static bool ogg_page_start(FILE *f, const ogg_page_t *pg, int64_t *start,
+                           uint32_t *skip_segs, long *skip_bytes)
+{
+    if (pg->granule < 0) return false;
+
+    uint32_t i  = 0;
+    long     at = pg->body;
+    if (pg->flags & 0x01) {
+        uint8_t l = 255;
+        while (i < pg->nsegs && l == 255) {
+            l = pg->segs[i++];
+            at += l;
+        }
+        if (l == 255) return false;     /* continues past this page too */
+    }
+    *skip_segs  = i;
+    *skip_bytes = at - pg->body;
+
+    int64_t samples = 0;
+    while (i < pg->nsegs) {
+        long     pkt = at;
+        uint32_t len = 0;
+        uint8_t  l   = 255;
+        while (i < pg->nsegs && l == 255) {
+            l = pg->segs[i++];
+            len += l;
+        }
+        at += (long)len;
+        if (l == 255) break;            /* ends on the next page: not counted */
+
+        uint8_t toc[2];
+        uint32_t n = (len < 2) ? len : 2;
+        if (n == 0 || fseek(f, pkt, SEEK_SET) != 0 || fread(toc, 1, n, f) != n)
+            return false;
+        int ns = opus_packet_get_nb_samples(toc, (opus_int32)n, 48000);
+        if (ns <= 0) return false;
+        samples += ns;
+    }
+
+    *start = pg->granule - samples;
+    return true;
+}
+
+/*
+ * Granule of the page that ends at off (-1 if none): the final page's
+ * granule is end-trimmed, so its packets start where the previous page
+ * ended, not at granule minus their durations. One page is < 64 KB.
+ */
+static int64_t ogg_prev_granule(FILE *f, uint32_t sn, long first, long off,
+                                uint8_t *scratch)
+{
+    long from = (off - 65536 > first) ? off - 65536 : first;
+    int64_t gran = -1;
+    ogg_page_t pg;
+    while (from < off && ogg_find_page(f, sn, from, off, scratch, &pg)) {
+        if (pg.next > off) break;
+        if (pg.granule >= 0) gran = pg.granule;
+        if (pg.next == off) return gran;
+        from = pg.next;
+    }
+    return -1;
+}
+
+/* -----------------------------------------------------------------------
+ * Page index: built in the background (codec_cache), one entry per second
+ * ----------------------------------------------------------------------- */
+
+/* codec_cache_build_fn: walk the page headers of one file */
+static bool opus_index_build(const char *path, const codec_cache_key_t *key)
+{
+    if (key->size > UINT32_MAX) return false;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    setvbuf(f, NULL, _IOFBF, 16384);
+
+    bool ok = false;
+    FILE *out = NULL;
+    uint8_t *scratch = malloc(OGG_SCAN_BUF);
+    uint8_t bos[27];
+    if (!scratch || fread(bos, 1, 27, f) != 27 || memcmp(bos, "OggS", 4) != 0) goto done;
+
+    out = codec_cache_create(key, OPUS_INDEX_EXT, OPUS_INDEX_MAGIC, OPUS_INDEX_VERSION);
+    if (!out) goto done;
+
+    opus_index_hdr_t hdr = {
+        .last_granule = -1,
+        .serial       = rd_le32(bos + 14),
+        .span         = OPUS_INDEX_SPAN,
+    };
+    if (fwrite(&hdr, sizeof(hdr), 1, out) != 1) goto done;
+
+    static uint32_t batch[256];     /* one build at a time (worker task) */
+    uint32_t n = 0, pages = 0;
+    int64_t  threshold = OPUS_INDEX_SPAN;
+    long     prev_next = -1;        /* page after the last page below threshold */
+    long     from = 0;
+    ogg_page_t pg;
+
+    while (ogg_find_page(f, hdr.serial, from, (long)key->size, scratch, &pg)) {
+        if (++pages % OPUS_INDEX_YIELD == 0) vTaskDelay(1);
+        from = pg.next;
+        if (pg.granule < 0) continue;
+        if (pg.granule == 0) {          /* OpusHead / OpusTags pages */
+            hdr.first_audio = (uint32_t)pg.next;
+            prev_next = pg.next;
+            continue;
+        }
+
+        for (; threshold <= pg.granule; threshold += OPUS_INDEX_SPAN) {
+            if (prev_next < 0) goto done;
+            batch[n++] = (uint32_t)prev_next;
+            hdr.entries++;
+            if (n == sizeof(batch) / sizeof(batch[0])) {
+                if (fwrite(batch, sizeof(uint32_t), n, out) != n) goto done;
+                n = 0;
+            }
+        }
+        prev_next = pg.next;
+        if (pg.granule > hdr.last_granule) hdr.last_granule = pg.granule;
+    }
+    if (n && fwrite(batch, sizeof(uint32_t), n, out) != n) goto done;
+
+    ok = hdr.last_granule > 0 && hdr.first_audio > 0 &&
+         fseek(out, CODEC_CACHE_PAYLOAD, SEEK_SET) == 0 &&
+         fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+    if (ok) {
+        ESP_LOGI(TAG, "Indexed %lu pages, %lu entries",
+                 (unsigned long)pages, (unsigned long)hdr.entries);
+    }
+
+done:
+    if (out) ok = codec_cache_commit(out, key, OPUS_INDEX_EXT, ok);
+    else ok = false;
+    free(scratch);
+    fclose(f);
+    return ok;
+}
+
+/* Header of the index on SD, if there is one for this exact stream */
+static bool opus_index_load(opus_state_t *st)
+{
+    FILE *f = codec_cache_open(&st->key, OPUS_INDEX_EXT, OPUS_INDEX_MAGIC, OPUS_INDEX_VERSION);
+    if (!f) return false;
+
+    bool ok = fread(&st->index, sizeof(st->index), 1, f) == 1 &&
+              st->index.serial == st->serial_number &&
+              st->index.first_audio == (uint32_t)st->first_audio_offset &&
+              st->index.span == OPUS_INDEX_SPAN;
+    fclose(f);
+    st->index_ready = ok;
+    return ok;
+}
+
+/* Byte offset of index entry e */
+static bool opus_index_entry(const opus_state_t *st, uint32_t e, uint32_t *offset)
+{
+    FILE *f = codec_cache_open(&st->key, OPUS_INDEX_EXT, OPUS_INDEX_MAGIC, OPUS_INDEX_VERSION);
+    if (!f) return false;
+
+    long at = CODEC_CACHE_PAYLOAD + (long)sizeof(opus_index_hdr_t) + (long)e * 4;
+    bool ok = fseek(f, at, SEEK_SET) == 0 && fread(offset, 4, 1, f) == 1;
+    fclose(f);
+    return ok;
+}
+
+/* -----------------------------------------------------------------------
+ * Exact seek
+ * ----------------------------------------------------------------------- */
+
+/*
+ * A page start from which decoding reaches granule g: every page before
+ * it ends below g. Index entry when there is one, else bisection on the
+ * page granules down to OGG_BISECT_WINDOW bytes (~log2(size / 16 KB)
+ * page probes).
+ */
+static long opus_seek_lower_bound(codec_handle_t *h, opus_state_t *st, int64_t g)
+{
+    long lo = st->first_audio_offset;
+    if (g <= 0) return lo;
+
+    if (!st->index_ready && st->key_valid) opus_index_load(st);
+    if (st->index_ready) {
+        uint32_t k = (uint32_t)(g / OPUS_INDEX_SPAN);
+        if (k == 0) return lo;
+        if (k <= st->index.entries) {
+            uint32_t off;
+            if (opus_index_entry(st, k - 1, &off)) return (long)off;
+            st->index_ready = false;
+        }
+    }
+
+    long hi = st->file_size;
+    ogg_page_t pg;
+    while (hi - lo > OGG_BISECT_WINDOW) {
+        long mid = lo + (hi - lo) / 2;
+        long from = mid;
+        bool found = false;
+        while (ogg_find_page(h->file, st->serial_number, from, hi, st->pkt_buf, &pg)) {
+            if (pg.granule >= 0) { found = true; break; }
+            from = pg.next;
+        }
+        if (found && pg.granule < g) lo = pg.next;
+        else                          hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * Leave the stream at the first packet that starts at or before target -
+ * OPUS_PREROLL, with st->discard set so the first sample returned is
+ * exactly target (granule domain, pre-skip included).
+ */
+static bool opus_seek_exact(codec_handle_t *h, opus_state_t *st, int64_t target)
+{
+    /* A packet continued into the chosen page is skipped, which can move
+     * the start past the pre-roll: retry once a max packet earlier */
+    int64_t g = target - OPUS_PREROLL;
+    for (int attempt = 0; attempt < 2; attempt++, g -= OPUS_MAX_FRAME_SZ) {
+        long y = opus_seek_lower_bound(h, st, g);
+
+        /* Walk to the last page that ends below g: decoding starts after it */
+        ogg_page_t pg;
+        long from = y;
+        while (ogg_find_page(h->file, st->serial_number, from, st->file_size, st->pkt_buf, &pg)) {
+            if (pg.granule >= g) break;
+            if (pg.granule >= 0) y = pg.next;
+            from = pg.next;
+        }
+
+        /* First page where a packet starts (a large packet can fill whole
+         * pages, which hold no packet start and no granule) */
+        int64_t  start;
+        uint32_t skip_segs;
+        long     skip_bytes;
+        int      pages = 0;
+        for (;;) {
+            if (!ogg_probe_page(h->file, st->serial_number, y, &pg) || ++pages > 8)
+                return false;
+            if (ogg_page_start(h->file, &pg, &start, &skip_segs, &skip_bytes)) break;
+            y = pg.next;
+        }
+
+        if ((pg.flags & 0x05) == 0x04) {
+            int64_t prev = ogg_prev_granule(h->file, st->serial_number,
+                                            st->first_audio_offset, y, st->pkt_buf);
+            start = (prev >= 0) ? prev : 0;
+        }
+
+        if (start > target) {
+            if (y > st->first_audio_offset) continue;
+            start = target;             /* stream starts late: nothing to drop */
+        }
+
+        if (fseek(h->file, pg.body + skip_bytes, SEEK_SET) != 0) return false;
+        memcpy(st->seg_table, pg.segs, pg.nsegs);
+        st->num_segs   = pg.nsegs;
+        st->seg_idx    = skip_segs;
+        st->serial_set = true;
+        st->discard    = (uint32_t)(target - start);
+        return true;
+    }
+    return false;
+}
+
 /* -----------------------------------------------------------------------
  * Vtable: decode
  * ----------------------------------------------------------------------- */
@@ -221,20 +593,20 @@ static int32_t opus_decode_fn(codec_handle_t *h, int32_t *buffer,
             continue;
         }
 
-        /* Apply pre-skip (drop leading samples from the first packet) */
-        int32_t start = 0;
-        if (st->pre_skip > 0) {
-            int32_t skip = (st->pre_skip < frames) ? st->pre_skip : frames;
-            start         = skip;
-            st->pre_skip -= skip;
+        /* After a seek: pre-roll and the head of the first page */
+        uint32_t first = 0;
+        if (st->discard) {
+            first = ((uint32_t)frames < st->discard) ? (uint32_t)frames : st->discard;
+            st->discard -= first;
         }
 
-        uint32_t actual = (uint32_t)(frames - start);
+        /* codec_decode() always offers a whole packet (packet_frames) */
+        uint32_t actual = (uint32_t)frames - first;
         if (actual > max_frames) actual = max_frames;
         if (actual == 0) continue;
 
         /* Convert int16_t → int32_t left-justified */
-        const int16_t *src = st->pcm_scratch + (size_t)start * (size_t)st->channels;
+        const int16_t *src = st->pcm_scratch + (size_t)first * st->channels;
         if (st->channels == 1) {
             for (uint32_t i = 0; i < actual; i++) {
                 int32_t s = (int32_t)src[i] << 16;
@@ -255,9 +627,11 @@ static int32_t opus_decode_fn(codec_handle_t *h, int32_t *buffer,
  * Vtable: seek
  *
  * frame_pos == 0  → exact rewind to first audio page.
- * frame_pos  > 0  → linear-interpolation estimate of byte offset,
- *                   then forward-scan for the next OggS page boundary.
- *                   Requires total_frames to have been determined at open.
+ * frame_pos  > 0  → exact: page found by index / bisection, pre-roll
+ *                   dropped by the decode call (st->discard).
+ *                   Fallback when the page structure is broken: linear-
+ *                   interpolation estimate of byte offset, then
+ *                   forward-scan for the next OggS page boundary.
  * ----------------------------------------------------------------------- */
 
 static bool opus_seek_fn(codec_handle_t *h, uint64_t frame_pos)
@@ -269,13 +643,21 @@ static bool opus_seek_fn(codec_handle_t *h, uint64_t frame_pos)
     st->num_segs   = 0;
     st->seg_idx    = 0;
     st->serial_set = false;
-    st->pre_skip   = 0;  /* pre-skip already applied during original open */
+    st->discard    = 0;
+    opus_decoder_ctl(st->dec, OPUS_RESET_STATE);
 
     if (frame_pos == 0) {
         fseek(h->file, st->first_audio_offset, SEEK_SET);
         return true;
     }
 
+    if (opus_seek_exact(h, st, (int64_t)frame_pos)) return true;
+
+    st->num_segs   = 0;
+    st->seg_idx    = 0;
+    st->serial_set = false;
+    ESP_LOGW(TAG, "Exact seek failed, estimating");
+
     /* Approximate seek: linear interpolation of byte offset */
     if (h->info.total_frames == 0 || st->file_size <= (long)st->first_audio_offset)
         return false;
@@ -315,28 +697,34 @@ static const codec_vtable_t opus_vtable = {
 };
 
 /* -----------------------------------------------------------------------
- * codec_opus_open — parse OpusHead, read OpusTags for R128_TRACK_GAIN,
- *                   scan final page for total_frames, init decoder
+ * Open helpers
  * ----------------------------------------------------------------------- */
 
-bool codec_opus_open(codec_handle_t *h)
-{
-    opus_state_t *st = calloc(1, sizeof(opus_state_t));
-    if (!st) return false;
+/* Open cache state: everything the header pages and the tail scan give */
+typedef struct {
+    int64_t  first_audio_offset;
+    int64_t  last_granule;      /* -1 if not found */
+    uint32_t serial_number;
+    int32_t  pre_skip;
+    int32_t  channels;
+    float    gain_db;
+} opus_open_state_t;
 
+/* Parse OpusHead and OpusTags (R128_TRACK_GAIN); leaves the file at the
+ * first audio page and st->first_audio_offset set */
+static bool opus_read_headers(FILE *f, opus_state_t *st)
+{
     /* --- Read first Ogg page (BOS, contains OpusHead) --- */
     int8_t htype;
-    if (!ogg_read_page(h->file, st, &htype, NULL)) {
+    if (!ogg_read_page(f, st, &htype, NULL)) {
         ESP_LOGE(TAG, "Failed to read first Ogg page");
-        free(st);
         return false;
     }
 
     uint8_t head[64];
-    int head_len = ogg_next_packet(h->file, st, head, sizeof(head));
+    int head_len = ogg_next_packet(f, st, head, sizeof(head));
     if (head_len < 19 || memcmp(head, "OpusHead", 8) != 0) {
         ESP_LOGE(TAG, "OpusHead not found (len=%d)", head_len);
-        free(st);
         return false;
     }
 
@@ -358,7 +746,7 @@ bool codec_opus_open(codec_handle_t *h)
      * (e.g. embedded cover art) — in that case gain_db stays 0.0.
      */
     {
-        int tags_len = ogg_next_packet(h->file, st, st->pkt_buf, OGG_PKT_BUF_SZ);
+        int tags_len = ogg_next_packet(f, st, st->pkt_buf, OGG_PKT_BUF_SZ);
         if (tags_len >= 16 && memcmp(st->pkt_buf, "OpusTags", 8) == 0) {
             /*
              * Vorbis comment format (RFC 7845 §5.2):
@@ -402,56 +790,114 @@ bool codec_opus_open(codec_handle_t *h)
     }
 
     /* Record file offset: audio packets start here */
-    st->first_audio_offset = ftell(h->file);
+    st->first_audio_offset = ftell(f);
     /* Reset segment state so ogg_next_packet fetches the next page cleanly */
     st->num_segs = 0;
     st->seg_idx  = 0;
+    return true;
+}
 
-    /* --- Scan last ~64 KB of file to find final granule → total_frames --- */
-    {
-        fseek(h->file, 0, SEEK_END);
-        long fsize = ftell(h->file);
-        st->file_size = fsize;
-
-        long scan_from = fsize - 65536;
-        if (scan_from < st->first_audio_offset)
-            scan_from = st->first_audio_offset;
-        fseek(h->file, scan_from, SEEK_SET);
-
-        /*
-         * We know serial_number from the BOS page (set during ogg_read_page above,
-         * before we reset serial_set below).  Use it to filter pages here.
-         */
-        uint32_t target_sn  = st->serial_number;
-        int64_t  last_gran  = -1;
-        uint8_t  phdr[27];
-        uint8_t  segtab[255];
-
-        while (ftell(h->file) + 27 <= fsize) {
-            if (fread(phdr, 1, 4, h->file) != 4) break;
-            if (memcmp(phdr, "OggS", 4) != 0) {
-                fseek(h->file, -3, SEEK_CUR);
-                continue;
-            }
-            if (fread(phdr + 4, 1, 23, h->file) != 23) break;
-            int64_t  gran = rd_le64(phdr + 6);
-            uint32_t sn   = rd_le32(phdr + 14);
-            uint8_t  ns   = phdr[26];
-            if (ns && fread(segtab, 1, ns, h->file) != ns) break;
-            uint32_t body = 0;
-            for (uint8_t i = 0; i < ns; i++) body += segtab[i];
-            if (sn == target_sn && gran > last_gran) last_gran = gran;
-            fseek(h->file, (long)body, SEEK_CUR);
+/* Final granule of the stream: scan the last ~64 KB for the last page of
+ * the selected serial (also sets st->file_size).  Returns -1 if none found. */
+static int64_t opus_scan_last_granule(FILE *f, opus_state_t *st)
+{
+    fseek(f, 0, SEEK_END);
+    long fsize = ftell(f);
+    st->file_size = fsize;
+
+    long scan_from = fsize - 65536;
+    if (scan_from < st->first_audio_offset)
+        scan_from = st->first_audio_offset;
+    fseek(f, scan_from, SEEK_SET);
+
+    /*
+     * We know serial_number from the BOS page (set by opus_read_headers,
+     * before codec_opus_open resets serial_set).  Use it to filter pages here.
+     */
+    uint32_t target_sn  = st->serial_number;
+    int64_t  last_gran  = -1;
+    uint8_t  phdr[27];
+    uint8_t  segtab[255];
+
+    while (ftell(f) + 27 <= fsize) {
+        if (fread(phdr, 1, 4, f) != 4) break;
+        if (memcmp(phdr, "OggS", 4) != 0) {
+            fseek(f, -3, SEEK_CUR);
+            continue;
         }
+        if (fread(phdr + 4, 1, 23, f) != 23) break;
+        int64_t  gran = rd_le64(phdr + 6);
+        uint32_t sn   = rd_le32(phdr + 14);
+        uint8_t  ns   = phdr[26];
+        if (ns && fread(segtab, 1, ns, f) != ns) break;
+        uint32_t body = 0;
+        for (uint8_t i = 0; i < ns; i++) body += segtab[i];
+        if (sn == target_sn && gran > last_gran) last_gran = gran;
+        fseek(f, (long)body, SEEK_CUR);
+    }
+    return last_gran;
+}
 
-        if (last_gran > st->pre_skip) {
-            h->info.total_frames = (uint64_t)(last_gran - st->pre_skip);
-            h->info.duration_ms  =
-                (uint32_t)(h->info.total_frames * 1000ULL / 48000ULL);
+/* -----------------------------------------------------------------------
+ * codec_opus_open — parse OpusHead, read OpusTags for R128_TRACK_GAIN,
+ *                   scan final page for total_frames, init decoder
+ *                   (headers and final granule come from the open cache
+ *                   when the track was opened before)
+ * ----------------------------------------------------------------------- */
+
+bool codec_opus_open(codec_handle_t *h)
+{
+    opus_state_t *st = calloc(1, sizeof(opus_state_t));
+    if (!st) return false;
+
+    const opus_open_state_t *cached = codec_open_cached(h, sizeof(opus_open_state_t));
+    if (cached) {
+        st->first_audio_offset = (long)cached->first_audio_offset;
+        st->serial_number      = cached->serial_number;
+        st->pre_skip           = cached->pre_skip;
+        st->channels           = cached->channels;
+        st->gain_db            = cached->gain_db;
+    } else if (!opus_read_headers(h->file, st)) {
+        free(st);
+        return false;
+    }
+
+    /* --- Final granule → total_frames: from the page index or the open
+     *     cache when the file was seen before, else scan the tail --- */
+    int64_t last_gran;
+    st->key       = h->key;
+    st->key_valid = h->key_valid;
+    if (st->key_valid && opus_index_load(st)) {
+        st->file_size = (long)st->key.size;
+        last_gran     = st->index.last_granule;
+    } else {
+        if (st->key_valid) codec_cache_request(h->path, opus_index_build);
+        if (cached) {
+            st->file_size = (long)st->key.size;
+            last_gran     = cached->last_granule;
+        } else {
+            last_gran = opus_scan_last_granule(h->file, st);
         }
+    }
 
-        fseek(h->file, st->first_audio_offset, SEEK_SET);
+    if (!cached) {
+        opus_open_state_t state = {
+            .first_audio_offset = st->first_audio_offset,
+            .last_granule       = last_gran,
+            .serial_number      = st->serial_number,
+            .pre_skip           = st->pre_skip,
+            .channels           = st->channels,
+            .gain_db            = st->gain_db,
+        };
+        codec_open_remember(h, &state, sizeof(state));
+    }
+
+    if (last_gran > st->pre_skip) {
+        h->info.total_frames = (uint64_t)(last_gran - st->pre_skip);
+        h->info.duration_ms  =
+            (uint32_t)(h->info.total_frames * 1000ULL / 48000ULL);
     }
+    fseek(h->file, st->first_audio_offset, SEEK_SET);
 
     st->serial_set = false; /* Will re-detect on first audio page */
 
@@ -477,10 +923,14 @@ bool codec_opus_open(codec_handle_t *h)
     h->info.bits_per_sample = 16;
     h->info.channels        = (uint8_t)st->channels;
     h->info.gain_db         = st->gain_db;
+    h->packet_frames        = OPUS_MAX_FRAME_SZ;
+    h->priming              = (uint32_t)st->pre_skip;
+    h->end_frame            = h->info.total_frames;
     h->vt                   = &opus_vtable;
 
-    ESP_LOGI(TAG, "Opus: %d-ch, pre_skip=%ld, gain=%.2f dB, frames=%llu",
+    ESP_LOGI(TAG, "Opus: %d-ch, pre_skip=%ld, gain=%.2f dB, frames=%llu, page index %s",
              st->channels, (long)st->pre_skip, st->gain_db,
-             (unsigned long long)h->info.total_frames);
+             (unsigned long long)h->info.total_frames,
+             st->index_ready ? "ready" : "pending");
     return true;
 }
@@ -0,0 +1,304 @@
+#include "dsd2pcm.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//--------------------------------------------------------------------+
+// Filter layout
+//--------------------------------------------------------------------+
+
+// Stage 1: 128 taps over 16 DSD bytes, one output every 2 bytes (÷16).
+// Stopband from 7/8 of the stage-1 output rate: everything that folds
+// into the lowest 1/8 of it (0 .. 22.05 kHz at DSD64) is ≥ 100 dB down.
+#define S1_BYTES    16
+#define S1_TAPS     (S1_BYTES * 8)
+#define S1_HIST     (S1_BYTES - 2)
+#define S1_STOP     (7.0 / 128.0)
+#define S1_ATTEN    110.0
+
+// Half-bands: 4·m − 1 taps, m non-zero coefficients per side. The short
+// one only has to protect the final passband (stopband from 7/16 of its
+// input rate), the long one does the last halving (from 3/8).
+#define HB_SHORT    6
+#define HB_LONG     8
+#define HB_HIST     (4 * HB_LONG - 2)
+#define HB_ATTEN    110.0
+#define HB_STAGES   3
+
+#define PCM_CHUNK   (DSD2PCM_CHUNK / 2)
+
+// Cost model, cycles per output of one channel: a stage-1 output is 16
+// (load byte, index, load float, add); a half-band output m pairs of
+// (2 loads, add, multiply-add). Plus the float → int32 store per frame.
+#define CYCLES_S1        70
+#define CYCLES_HB_SHORT  32
+#define CYCLES_HB_LONG   40
+#define CYCLES_OUT       8
+
+#define INT32_MAX_FLOAT  2147483520.0f
+
+struct dsd2pcm_s {
+    uint32_t dsd_rate;
+    uint32_t pcm_rate;
+    uint8_t  stages;            // half-band stages after stage 1 (0..3)
+    uint8_t  bytes_per_frame;
+
+    // Stage 1 tables, reversed: lut[i] applies to the i-th oldest byte of
+    // the 16-byte window
+    float    lut[S1_BYTES][256];
+    uint8_t  in[2][S1_HIST + DSD2PCM_CHUNK];
+
+    // Half-band coefficients (odd taps next to the 0.5 centre, innermost first)
+    float    hb_short[HB_SHORT];
+    float    hb_long[HB_LONG];
+    float    hb[HB_STAGES][2][HB_HIST + PCM_CHUNK];
+
+    float    pcm[2][PCM_CHUNK];
+};
+
+//--------------------------------------------------------------------+
+// Design (not real-time)
+//--------------------------------------------------------------------+
+
+// Zeroth-order modified Bessel function of the first kind
+static double d2p_bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 64; k++) {
+        term *= q / ((double)k * (double)k);
+        sum += term;
+        if (term < sum * 1e-17) break;
+    }
+    return sum;
+}
+
+/**
+ * @brief Kaiser-windowed sinc, n taps, cutoff fc (cycles per sample)
+ */
+static void d2p_kaiser_sinc(double *h, int n, double fc, double atten_db)
+{
+    const double beta = 0.1102 * (atten_db - 8.7);
+    const double i0_beta = d2p_bessel_i0(beta);
+    const double centre = 0.5 * (double)(n - 1);
+
+    for (int i = 0; i < n; i++) {
+        const double t = (double)i - centre;
+        const double x = 2.0 * fc * t;
+        const double sinc = (fabs(x) < 1e-12) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+        const double r = t / centre;
+        h[i] = 2.0 * fc * sinc * d2p_bessel_i0(beta * sqrt(fmax(0.0, 1.0 - r * r))) / i0_beta;
+    }
+}
+
+/**
+ * @brief Stage-1 byte tables
+ *
+ * The filter runs at the DSD rate on ±1 samples. Byte j of the window
+ * (j = 0 newest) covers taps 8j .. 8j+7; within it the earliest bit has
+ * the largest lag. lut[S1_BYTES − 1 − j][v] = Σ_b ±h[lag(b)].
+ */
+static void d2p_design_s1(dsd2pcm_t *c, bool lsb_first)
+{
+    double h[S1_TAPS];
+    // Kaiser transition width for this length; cutoff half of it below
+    // the stopband edge. Passband: -0.05 dB at 20 kHz for DSD64, flat
+    // for DSD128/256.
+    const double dw = (S1_ATTEN - 7.95) / (2.285 * 2.0 * M_PI * (S1_TAPS - 1));
+    d2p_kaiser_sinc(h, S1_TAPS, S1_STOP - 0.5 * dw, S1_ATTEN);
+
+    double sum = 0.0;
+    for (int i = 0; i < S1_TAPS; i++) sum += h[i];
+
+    for (int j = 0; j < S1_BYTES; j++) {
+        float *t = c->lut[S1_BYTES - 1 - j];
+        for (int v = 0; v < 256; v++) {
+            double acc = 0.0;
+            for (int b = 0; b < 8; b++) {
+                const int lag = 8 * j + (lsb_first ? 7 - b : b);
+                acc += ((v >> b) & 1) ? h[lag] : -h[lag];
+            }
+            t[v] = (float)(acc / sum);
+        }
+    }
+}
+
+/**
+ * @brief Half-band: cutoff fs/4, keep the odd taps around the centre
+ */
+static void d2p_design_hb(float *coef, int m)
+{
+    const int n = 4 * m - 1;
+    double h[4 * HB_LONG - 1];
+    d2p_kaiser_sinc(h, n, 0.25, HB_ATTEN);
+
+    // Normalise so the centre is exactly 0.5 and the DC gain exactly 1:
+    // centre + 2·Σ coef = 1
+    const int centre = n / 2;
+    double side = 0.0;
+    for (int k = 0; k < m; k++) side += h[centre + 2 * k + 1];
+    const double g = 0.25 / side;
+    for (int k = 0; k < m; k++) coef[k] = (float)(h[centre + 2 * k + 1] * g);
+}
+
+bool dsd2pcm_supported(uint32_t dsd_rate, uint32_t pcm_rate)
+{
+    if (dsd_rate != 2822400 && dsd_rate != 5644800 && dsd_rate != 11289600) return false;
+    return pcm_rate == DSD2PCM_RATE_88K || pcm_rate == DSD2PCM_RATE_176K;
+}
+
+dsd2pcm_t *dsd2pcm_create(uint32_t dsd_rate, uint32_t pcm_rate, bool lsb_first)
+{
+    if (!dsd2pcm_supported(dsd_rate, pcm_rate)) return NULL;
+
+    dsd2pcm_t *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+
+    c->dsd_rate = dsd_rate;
+    c->pcm_rate = pcm_rate;
+    const uint32_t decim = dsd_rate / pcm_rate;     // 16 .. 128
+    c->bytes_per_frame = (uint8_t)(decim / 8);
+    for (uint32_t d = decim / 16; d > 1; d >>= 1) c->stages++;
+
+    d2p_design_s1(c, lsb_first);
+    d2p_design_hb(c->hb_short, HB_SHORT);
+    d2p_design_hb(c->hb_long, HB_LONG);
+    dsd2pcm_reset(c);
+    return c;
+}
+
+void dsd2pcm_destroy(dsd2pcm_t *c)
+{
+    free(c);
+}
+
+void dsd2pcm_reset(dsd2pcm_t *c)
+{
+    // 0x69 = DSD silence (as many ones as zeros)
+    memset(c->in, 0x69, sizeof(c->in));
+    memset(c->hb, 0, sizeof(c->hb));
+}
+
+uint32_t dsd2pcm_bytes_per_frame(const dsd2pcm_t *c)
+{
+    return c->bytes_per_frame;
+}
+
+uint32_t dsd2pcm_cycles_per_frame(uint32_t dsd_rate, uint32_t pcm_rate)
+{
+    if (!dsd2pcm_supported(dsd_rate, pcm_rate)) return 0;
+
+    const uint32_t decim = dsd_rate / pcm_rate;
+    uint32_t per_ch = (decim / 16) * CYCLES_S1;
+    // Half-band s runs 2^(stages−1−s) times per output frame; the last is the long one
+    uint32_t runs = 1;
+    for (uint32_t d = decim / 16; d > 1; d >>= 1) {
+        per_ch += runs * (runs == 1 ? CYCLES_HB_LONG : CYCLES_HB_SHORT);
+        runs <<= 1;
+    }
+    return 2 * per_ch + CYCLES_OUT;
+}
+
+//--------------------------------------------------------------------+
+// Processing
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Stage 1: n bytes (even) → n/2 samples
+ *
+ * in holds S1_HIST bytes of history followed by the n new ones.
+ */
+__attribute__((hot))
+static void d2p_stage1(const float (*lut)[256], uint8_t *in, uint32_t n, float *dst)
+{
+    for (uint32_t m = 0; m < n / 2; m++) {
+        const uint8_t *b = in + 2 * m;
+        // Four accumulators: the lookups are independent
+        float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+        for (int i = 0; i < S1_BYTES; i += 4) {
+            a0 += lut[i][b[i]];
+            a1 += lut[i + 1][b[i + 1]];
+            a2 += lut[i + 2][b[i + 2]];
+            a3 += lut[i + 3][b[i + 3]];
+        }
+        dst[m] = (a0 + a1) + (a2 + a3);
+    }
+    memmove(in, in + n, S1_HIST);
+}
+
+/**
+ * @brief Half-band ÷2: buf holds HB_HIST samples of history then n new ones
+ */
+__attribute__((hot))
+static void d2p_halfband(const float *coef, int m, float *buf, uint32_t n, float *dst)
+{
+    for (uint32_t j = 0; j < n / 2; j++) {
+        // Window ends at the newest sample buf[HB_HIST + 2j + 1]
+        const float *mid = buf + 2 * j + 1 + HB_HIST / 2;
+        float a0 = 0.5f * mid[0], a1 = 0.0f;
+        for (int k = 0; k < m - 1; k += 2) {
+            a0 += coef[k]     * (mid[-(2 * k + 1)] + mid[2 * k + 1]);
+            a1 += coef[k + 1] * (mid[-(2 * k + 3)] + mid[2 * k + 3]);
+        }
+        if (m & 1) a0 += coef[m - 1] * (mid[-(2 * m - 1)] + mid[2 * m - 1]);
+        dst[j] = a0 + a1;
+    }
+    memmove(buf, buf + n, HB_HIST * sizeof(float));
+}
+
+static inline int32_t d2p_to_int32(float x)
+{
+    x *= 2147483648.0f;
+    if (x > INT32_MAX_FLOAT) return INT32_MAX;
+    if (x < -2147483648.0f) return INT32_MIN;
+    return (int32_t)x;
+}
+
+__attribute__((hot))
+uint32_t dsd2pcm_process(dsd2pcm_t *c, const uint8_t *left, const uint8_t *right,
+                         uint32_t stride, uint32_t bytes, int32_t *out)
+{
+    const uint32_t bpf = c->bytes_per_frame;
+    bytes -= bytes % bpf;
+    uint32_t frames = 0;
+
+    while (bytes > 0) {
+        const uint32_t n = (bytes < DSD2PCM_CHUNK) ? bytes : DSD2PCM_CHUNK;
+
+        for (int ch = 0; ch < 2; ch++) {
+            const uint8_t *src = ch ? right : left;
+            uint8_t *in = c->in[ch] + S1_HIST;
+            if (stride == 1) {
+                memcpy(in, src, n);
+            } else {
+                for (uint32_t i = 0; i < n; i++) in[i] = src[i * stride];
+            }
+
+            // Stage 1 feeds the first half-band's input (or the output)
+            uint32_t cnt = n / 2;
+            float *dst = c->stages ? c->hb[0][ch] + HB_HIST : c->pcm[ch];
+            d2p_stage1((const float (*)[256])c->lut, c->in[ch], n, dst);
+
+            for (int s = 0; s < c->stages; s++) {
+                const bool last = (s == c->stages - 1);
+                float *next = last ? c->pcm[ch] : c->hb[s + 1][ch] + HB_HIST;
+                d2p_halfband(last ? c->hb_long : c->hb_short, last ? HB_LONG : HB_SHORT,
+                             c->hb[s][ch], cnt, next);
+                cnt /= 2;
+            }
+        }
+
+        const uint32_t got = n / bpf;
+        for (uint32_t i = 0; i < got; i++) {
+            out[2 * i]     = d2p_to_int32(c->pcm[0][i]);
+            out[2 * i + 1] = d2p_to_int32(c->pcm[1][i]);
+        }
+
+        out    += 2 * got;
+        frames += got;
+        left   += n * stride;
+        right  += n * stride;
+        bytes  -= n;
+    }
+    return frames;
+}
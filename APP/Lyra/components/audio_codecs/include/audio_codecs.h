@@ -12,8 +12,8 @@ typedef enum {
     CODEC_FORMAT_WAV,
     CODEC_FORMAT_FLAC,
     CODEC_FORMAT_MP3,
-    CODEC_FORMAT_DSD,   /* DSF/DFF container — codec_decode() outputs DoP int32_t frames,
-                           DSP pipeline must be bypassed for this format */
+    CODEC_FORMAT_DSD,   /* DSF/DFF container — codec_decode() outputs DoP int32_t frames
+                           (DSP pipeline bypassed) or decimated PCM, see codec_set_dsd_output() */
     CODEC_FORMAT_AAC,   /* AAC-LC / HE-AAC in ADTS container (.aac) */
     CODEC_FORMAT_OPUS,  /* Opus audio in Ogg container (.opus) — always 48 kHz output */
     CODEC_FORMAT_M4A,   /* M4A/M4B/MP4 container — dispatcher; sub-opens as AAC or ALAC */
@@ -27,16 +27,30 @@ typedef enum {
 typedef struct {
     uint32_t sample_rate;      /* PCM: audio sample rate.
                                   DSD:  DoP PCM rate = DSD_rate / 16
-                                        (DSD64→176400, DSD128→352800, DSD256→705600) */
-    uint8_t  bits_per_sample;  /* PCM: original bit depth (16/24/32).  DSD: always 32 (DoP) */
+                                        (DSD64→176400, DSD128→352800, DSD256→705600)
+                                        or 88200 / 176400 when decimated to PCM */
+    uint8_t  bits_per_sample;  /* PCM: original bit depth (16/24/32).  DSD: 32 (DoP), 24 (PCM) */
     uint8_t  channels;         /* 1 (mono) or 2 (stereo) */
-    uint64_t total_frames;     /* PCM: stereo frames.  DSD: DoP frames (DSD samples / 16) */
+    uint64_t total_frames;     /* PCM: stereo frames.  DSD: DoP frames (DSD samples / 16)
+                                  or PCM frames at sample_rate */
     uint32_t duration_ms;      /* Duration in milliseconds (0 if unknown) */
     codec_format_t format;
     bool     is_dsd;           /* true → output is DoP, DSP chain must be bypassed */
+    uint32_t dsd_rate;         /* DSD source bit rate (2822400…), 0 for PCM formats */
     float    gain_db;          /* ReplayGain track gain in dB (0.0 = no tag / no adjustment) */
 } codec_info_t;
 
+//--------------------------------------------------------------------+
+// DSD output mode
+//--------------------------------------------------------------------+
+
+typedef enum {
+    CODEC_DSD_DOP = 0,  /* DoP words at DSD_rate / 16, bit-exact to the DAC */
+    CODEC_DSD_PCM_88K,  /* decimated to 88.2 kHz PCM, goes through the DSP chain */
+    CODEC_DSD_PCM_176K, /* decimated to 176.4 kHz PCM */
+    CODEC_DSD_OUTPUT_COUNT
+} codec_dsd_output_t;
+
 //--------------------------------------------------------------------+
 // Opaque decoder handle
 //--------------------------------------------------------------------+
@@ -93,6 +107,17 @@ const codec_info_t *codec_get_info(const codec_handle_t *handle);
  */
 void codec_close(codec_handle_t *handle);
 
+/**
+ * @brief Info of a track from the open cache on SD, without opening it
+ *
+ * Fills @p info as the last codec_open() of the track reported it (DSD
+ * rate fields follow the DSD output mode of that open). For library
+ * browsing: one small read instead of probing the file.
+ *
+ * @return false if the track was never opened or has changed since
+ */
+bool codec_probe(const char *filepath, codec_info_t *info);
+
 /**
  * @brief Detect codec format from file extension
  *
@@ -100,3 +125,17 @@ void codec_close(codec_handle_t *handle);
  * @return Detected format or CODEC_FORMAT_UNKNOWN
  */
 codec_format_t codec_detect_format(const char *filepath);
+
+/**
+ * @brief Choose how DSD files opened from now on are decoded
+ *
+ * Read by codec_open(), so it applies per track: a track already open
+ * keeps its mode. PCM modes run the DSD→PCM decimator (dsd2pcm.h) in
+ * codec_decode() and report a normal PCM stream (is_dsd = false).
+ */
+void codec_set_dsd_output(codec_dsd_output_t mode);
+
+/**
+ * @brief Current DSD output mode
+ */
+codec_dsd_output_t codec_get_dsd_output(void);
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// DSD → PCM decimator
+//--------------------------------------------------------------------+
+//
+// Multistage decimating FIR from 1-bit DSD (DSD64/128/256) to PCM at
+// 88.2 or 176.4 kHz, so DSD files can run through the DSP chain:
+//
+//   stage 1  ÷16   128-tap FIR evaluated one DSD byte at a time: every
+//                  byte value's contribution to each 8-tap slice of the
+//                  filter is precomputed (16 tables × 256 floats), so an
+//                  output is 16 table lookups + adds, no bit unpacking
+//   stage 2+ ÷2    polyphase half-band FIRs (every other tap is zero,
+//                  centre tap 0.5) until the target rate is reached:
+//                  23-tap ones first, a 31-tap one for the last halving
+//
+//   DSD64  → 176.4k  stage 1                  (÷16)
+//   DSD64  →  88.2k  stage 1 + 1 half-band    (÷32)
+//   DSD256 →  88.2k  stage 1 + 3 half-bands   (÷128)
+//
+// Every stage has ≥ 100 dB stopband over the bands that alias into the
+// audio band (0 .. 22 kHz); passband -0.05 dB at 20 kHz for DSD64, flat
+// for DSD128/256. DSD's rising ultrasonic noise above that is attenuated
+// but not removed — the DSP chain / DAC filter take care of it.
+//
+// Gain: DSD full modulation maps to PCM full scale, so the SACD 0 dB
+// reference (50 % modulation) comes out at -6 dBFS and the +3 dB SACD
+// maximum still has headroom.
+//
+// Output is int32 stereo interleaved (left-justified) like every codec.
+// Latency ~64 DSD samples + 15 samples of the last half-band: not
+// compensated, it is well under one output block.
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Supported PCM output rates
+ */
+#define DSD2PCM_RATE_88K   88200
+#define DSD2PCM_RATE_176K  176400
+
+/**
+ * @brief Largest number of DSD bytes per channel one process() call
+ *        works on internally (callers may pass more)
+ */
+#define DSD2PCM_CHUNK      256
+
+/**
+ * @brief Opaque converter
+ */
+typedef struct dsd2pcm_s dsd2pcm_t;
+
+/**
+ * @brief Whether dsd_rate (2822400 / 5644800 / 11289600) → pcm_rate is supported
+ */
+bool dsd2pcm_supported(uint32_t dsd_rate, uint32_t pcm_rate);
+
+/**
+ * @brief Create a converter (designs the filters; not real-time)
+ *
+ * @param dsd_rate  DSD bit rate per channel
+ * @param pcm_rate  DSD2PCM_RATE_88K or DSD2PCM_RATE_176K
+ * @param lsb_first Bit order within a byte: true for DSF (bit 0 is the
+ *                  earliest sample), false for DFF (bit 7 first)
+ * @return Converter, or NULL if unsupported / out of memory
+ */
+dsd2pcm_t *dsd2pcm_create(uint32_t dsd_rate, uint32_t pcm_rate, bool lsb_first);
+
+/**
+ * @brief Free a converter
+ */
+void dsd2pcm_destroy(dsd2pcm_t *c);
+
+/**
+ * @brief Clear the filter history (after a seek)
+ */
+void dsd2pcm_reset(dsd2pcm_t *c);
+
+/**
+ * @brief DSD bytes per channel consumed per PCM output frame
+ *        (decimation / 8: 2 .. 16)
+ */
+uint32_t dsd2pcm_bytes_per_frame(const dsd2pcm_t *c);
+
+/**
+ * @brief Convert DSD bytes to PCM frames
+ *
+ * @param c      Converter
+ * @param left   Left channel bytes, oldest first
+ * @param right  Right channel bytes
+ * @param stride Distance between consecutive bytes of one channel
+ *               (1 for DSF blocks, 2 for DFF interleaved L R L R …)
+ * @param bytes  Bytes per channel, a multiple of dsd2pcm_bytes_per_frame()
+ *               (any remainder is ignored)
+ * @param out    int32 stereo interleaved, room for bytes / bytes_per_frame frames
+ * @return Frames written (= bytes / bytes_per_frame)
+ */
+uint32_t dsd2pcm_process(dsd2pcm_t *c, const uint8_t *left, const uint8_t *right,
+                         uint32_t stride, uint32_t bytes, int32_t *out);
+
+/**
+ * @brief Estimated cost in CPU cycles per PCM output frame (stereo)
+ *
+ * Compare with the DSP budget: cycles × pcm_rate is the load on the
+ * decoder core. Verify with `dsp bench dsd`.
+ */
+uint32_t dsd2pcm_cycles_per_frame(uint32_t dsd_rate, uint32_t pcm_rate);
+
+#ifdef __cplusplus
+}
+#endif
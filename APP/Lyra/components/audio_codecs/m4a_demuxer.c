@@ -14,6 +14,16 @@
  *
  * moov-at-end ("streaming" optimisation) is supported: the top-level scan
  * finds moov regardless of position.
+ *
+ * Gapless: the iTunes 'iTunSMPB' tag (moov → udta → meta → ilst → '----')
+ * gives the encoder delay, padding and valid sample count.
+ *
+ * Sample table: stsz and stco/co64 stay in the file.  Open reads only
+ * their headers plus stsc, kept as runs of chunks with equal
+ * samples-per-chunk.  m4a_sample() resolves one sample through a window
+ * of each table (refilled from the file) and a cursor that makes the
+ * next sample of the same chunk a single addition, so open time and RAM
+ * do not grow with the track length (20 h audiobooks included).
  */
 
 #include "m4a_demuxer.h"
@@ -112,21 +122,19 @@ typedef struct {
     uint32_t sample_rate;
     bool     stsd_ok;
 
-    /* stsz results */
+    /* stsz / stsc / stco|co64 headers (tables stay in the file) */
     uint32_t  sample_count;
-    uint32_t *sample_sizes;      /* heap                                 */
+    uint32_t  sample_size;       /* stsz uniform size, 0 = per sample    */
     bool      stsz_ok;
-
-    /* stsc results (run-length encoded chunk → samples table) */
-    uint32_t  stsc_count;
-    uint32_t *stsc_fc;           /* first_chunk (1-indexed), heap        */
-    uint32_t *stsc_spc;          /* samples_per_chunk, heap              */
     bool      stsc_ok;
-
-    /* stco / co64 results */
-    uint32_t  chunk_count;
-    uint64_t *chunk_offsets;     /* heap                                 */
     bool      stco_ok;
+    m4a_table_pos_t tables;
+
+    /* iTunSMPB gapless info */
+    uint32_t  enc_delay;
+    uint32_t  enc_padding;
+    uint64_t  valid_samples;
+    bool      smpb_ok;
 } pctx_t;
 
 /* Forward declaration */
@@ -301,101 +309,82 @@ static void parse_mdhd(FILE *f, pctx_t *ctx)
 }
 
 /* ------------------------------------------------------------------ */
-/* stsz — sample size table                                            */
+/* stsz / stsc / stco — sample table headers (bodies read on demand)   */
 /* ------------------------------------------------------------------ */
 
 static void parse_stsz(FILE *f, pctx_t *ctx)
 {
     /* FullBox(4) + sample_size(4) + sample_count(4) = 12 bytes */
     uint8_t hdr[12];
+    ctx->tables.stsz = ftell(f);
     if (fread(hdr, 1, 12, f) != 12) return;
 
-    uint32_t uniform_size = rd32(hdr + 4);
-    uint32_t count        = rd32(hdr + 8);
-    if (count == 0) return;
-
-    ctx->sample_sizes = malloc(count * sizeof(uint32_t));
-    if (!ctx->sample_sizes) return;
-
-    if (uniform_size != 0) {
-        for (uint32_t i = 0; i < count; i++)
-            ctx->sample_sizes[i] = uniform_size;
-    } else {
-        for (uint32_t i = 0; i < count; i++) {
-            uint8_t b[4];
-            if (fread(b, 1, 4, f) != 4) {
-                free(ctx->sample_sizes);
-                ctx->sample_sizes = NULL;
-                return;
-            }
-            ctx->sample_sizes[i] = rd32(b);
-        }
-    }
-    ctx->sample_count = count;
-    ctx->stsz_ok      = true;
+    ctx->sample_size  = rd32(hdr + 4);
+    ctx->sample_count = rd32(hdr + 8);
+    ctx->stsz_ok      = ctx->sample_count > 0;
 }
 
-/* ------------------------------------------------------------------ */
-/* stsc — sample-to-chunk table (run-length encoded)                   */
-/* ------------------------------------------------------------------ */
-
 static void parse_stsc(FILE *f, pctx_t *ctx)
 {
     uint8_t hdr[8];
+    ctx->tables.stsc = ftell(f);
     if (fread(hdr, 1, 8, f) != 8) return;
-    uint32_t count = rd32(hdr + 4);
-    if (count == 0) return;
-
-    ctx->stsc_fc  = malloc(count * sizeof(uint32_t));
-    ctx->stsc_spc = malloc(count * sizeof(uint32_t));
-    if (!ctx->stsc_fc || !ctx->stsc_spc) {
-        free(ctx->stsc_fc);  ctx->stsc_fc  = NULL;
-        free(ctx->stsc_spc); ctx->stsc_spc = NULL;
-        return;
-    }
+    ctx->stsc_ok = rd32(hdr + 4) > 0;
+}
 
-    for (uint32_t i = 0; i < count; i++) {
-        uint8_t e[12];
-        if (fread(e, 1, 12, f) != 12) {
-            free(ctx->stsc_fc);  ctx->stsc_fc  = NULL;
-            free(ctx->stsc_spc); ctx->stsc_spc = NULL;
-            return;
-        }
-        ctx->stsc_fc[i]  = rd32(e);      /* first_chunk (1-indexed) */
-        ctx->stsc_spc[i] = rd32(e + 4);  /* samples_per_chunk       */
-        /* ignore sample_description_index at e+8 */
-    }
-    ctx->stsc_count = count;
-    ctx->stsc_ok    = true;
+static void parse_stco(FILE *f, pctx_t *ctx, bool is64)
+{
+    uint8_t hdr[8];
+    ctx->tables.stco = ftell(f);
+    ctx->tables.co64 = is64;
+    if (fread(hdr, 1, 8, f) != 8) return;
+    ctx->stco_ok = rd32(hdr + 4) > 0;
 }
 
 /* ------------------------------------------------------------------ */
-/* stco / co64 — chunk offset tables                                   */
+/* '----' — iTunes freeform tag (only iTunSMPB is used)               */
 /* ------------------------------------------------------------------ */
 
-static void parse_stco(FILE *f, pctx_t *ctx, bool is64)
+/*
+ * Children: 'mean' (FullBox + "com.apple.iTunes"), 'name' (FullBox + tag
+ * name), 'data' (type(4) + locale(4) + value).  The iTunSMPB value is
+ * text: " 00000000 DDDDDDDD PPPPPPPP LLLLLLLLLLLLLLLL ..." (hex) with
+ * D = encoder delay, P = padding, L = valid samples.
+ */
+static void parse_freeform(FILE *f, pctx_t *ctx, int64_t body_end)
 {
-    uint8_t hdr[8];
-    if (fread(hdr, 1, 8, f) != 8) return;
-    uint32_t count = rd32(hdr + 4);
-    if (count == 0) return;
-
-    ctx->chunk_offsets = malloc(count * sizeof(uint64_t));
-    if (!ctx->chunk_offsets) return;
-
-    for (uint32_t i = 0; i < count; i++) {
-        if (is64) {
-            uint8_t b[8];
-            if (fread(b, 1, 8, f) != 8) { free(ctx->chunk_offsets); ctx->chunk_offsets = NULL; return; }
-            ctx->chunk_offsets[i] = rd64(b);
-        } else {
-            uint8_t b[4];
-            if (fread(b, 1, 4, f) != 4) { free(ctx->chunk_offsets); ctx->chunk_offsets = NULL; return; }
-            ctx->chunk_offsets[i] = rd32(b);
+    uint8_t buf[256];
+    long    start = ftell(f);
+    if (body_end - start > (int64_t)sizeof(buf)) return;   /* not iTunSMPB */
+    uint32_t len = (uint32_t)(body_end - start);
+    if (fread(buf, 1, len, f) != len) return;
+
+    bool is_smpb = false;
+    for (uint32_t pos = 0; pos + 8 <= len; ) {
+        uint32_t sz = rd32(buf + pos);
+        if (sz < 8 || pos + sz > len) return;
+        const uint8_t *type = buf + pos + 4;
+
+        if (feq4(type, "name") && sz >= 12) {
+            is_smpb = (sz - 12 == 8) && memcmp(buf + pos + 12, "iTunSMPB", 8) == 0;
+        } else if (feq4(type, "data") && is_smpb && sz > 16) {
+            char     text[128];
+            uint32_t tlen = sz - 16;
+            if (tlen >= sizeof(text)) tlen = sizeof(text) - 1;
+            memcpy(text, buf + pos + 16, tlen);
+            text[tlen] = '\0';
+
+            unsigned long      zero, delay, padding;
+            unsigned long long valid;
+            if (sscanf(text, "%lx %lx %lx %llx", &zero, &delay, &padding, &valid) == 4) {
+                ctx->enc_delay     = (uint32_t)delay;
+                ctx->enc_padding   = (uint32_t)padding;
+                ctx->valid_samples = (uint64_t)valid;
+                ctx->smpb_ok       = true;
+            }
         }
+        pos += sz;
     }
-    ctx->chunk_count = count;
-    ctx->stco_ok     = true;
 }
 
 /* ------------------------------------------------------------------ */
@@ -406,8 +395,21 @@ static void dispatch_box(FILE *f, const uint8_t *type, int64_t body_end,
                           pctx_t *ctx, int depth)
 {
     if (feq4(type, "moov") || feq4(type, "mdia") ||
-        feq4(type, "minf") || feq4(type, "stbl")) {
+        feq4(type, "minf") || feq4(type, "stbl") ||
+        feq4(type, "udta") || feq4(type, "ilst")) {
+        parse_children(f, body_end, ctx, depth + 1);
+
+    } else if (feq4(type, "meta")) {
+        /* FullBox: skip version/flags.  Its 'mdir' hdlr must not clear the
+         * audio-trak flag when meta sits inside trak/udta. */
+        uint8_t vf[4];
+        if (fread(vf, 1, 4, f) != 4) return;
+        bool save_is_audio = ctx->is_audio;
         parse_children(f, body_end, ctx, depth + 1);
+        ctx->is_audio = save_is_audio;
+
+    } else if (feq4(type, "----") && !ctx->smpb_ok) {
+        parse_freeform(f, ctx, body_end);
 
     } else if (feq4(type, "trak")) {
         /*
@@ -481,44 +483,129 @@ static void parse_children(FILE *f, int64_t end, pctx_t *ctx, int depth)
 }
 
 /* ------------------------------------------------------------------ */
-/* Sample offset reconstruction (stsc + stco + stsz → flat table)     */
+/* Lazy sample table                                                   */
 /* ------------------------------------------------------------------ */
 
-static bool build_offsets(pctx_t *ctx, m4a_info_t *out)
+#define M4A_SIZE_WIN    256     /* stsz entries per window (1 KB)      */
+#define M4A_CHUNK_WIN   64      /* stco/co64 entries per window        */
+
+/* stsc entry, with the index of its first sample precomputed */
+typedef struct {
+    uint32_t first_chunk;       /* 0-based                              */
+    uint32_t spc;               /* samples per chunk                    */
+    uint32_t first_sample;
+} m4a_run_t;
+
+struct m4a_samples_s {
+    uint32_t   chunk_count;
+    uint32_t   run_count;
+    m4a_run_t *runs;            /* heap, merged runs of equal spc       */
+
+    /* Windows over stsz and stco/co64 (base = first entry held) */
+    uint32_t size_base, size_len;
+    uint32_t size_win[M4A_SIZE_WIN];
+    uint32_t chunk_base, chunk_len;
+    uint64_t chunk_win[M4A_CHUNK_WIN];
+
+    /* Cursor: last sample resolved and the end of its chunk */
+    uint32_t cur_sample;        /* UINT32_MAX = none                    */
+    uint32_t cur_chunk_end;
+    uint64_t cur_offset;
+    uint32_t cur_size;
+};
+
+static bool sample_size_at(FILE *f, const m4a_info_t *info, uint32_t idx, uint32_t *size)
 {
-    uint32_t N = ctx->sample_count;
-    out->sample_offsets = malloc(N * sizeof(uint64_t));
-    if (!out->sample_offsets) return false;
+    if (info->sample_size) {
+        *size = info->sample_size;
+        return true;
+    }
 
-    uint32_t sample_idx = 0;
-    uint32_t run        = 0;   /* current stsc entry index */
+    m4a_samples_t *t = info->samples;
+    if (idx - t->size_base >= t->size_len) {
+        uint32_t base = idx - idx % M4A_SIZE_WIN;
+        uint32_t n    = info->sample_count - base;
+        if (n > M4A_SIZE_WIN) n = M4A_SIZE_WIN;
+
+        t->size_len = 0;
+        if (fseek(f, (long)(info->tables.stsz + 12 + (int64_t)base * 4), SEEK_SET) != 0 ||
+            fread(t->size_win, 4, n, f) != n) return false;
+        for (uint32_t i = 0; i < n; i++)
+            t->size_win[i] = rd32((const uint8_t *)&t->size_win[i]);
+        t->size_base = base;
+        t->size_len  = n;
+    }
+    *size = t->size_win[idx - t->size_base];
+    return true;
+}
 
-    for (uint32_t chunk = 0; chunk < ctx->chunk_count && sample_idx < N; chunk++) {
-        /*
-         * stsc is run-length encoded.  Each entry says "starting from chunk
-         * first_chunk (1-based), every chunk has samples_per_chunk samples,
-         * until the next entry changes it."
-         * Advance run when the next entry's first_chunk <= current chunk+1.
-         */
-        uint32_t chunk1 = chunk + 1;
-        while (run + 1 < ctx->stsc_count && ctx->stsc_fc[run + 1] <= chunk1)
-            run++;
+static bool chunk_offset_at(FILE *f, const m4a_info_t *info, uint32_t chunk, uint64_t *off)
+{
+    m4a_samples_t *t = info->samples;
+    if (chunk - t->chunk_base >= t->chunk_len) {
+        uint32_t base  = chunk - chunk % M4A_CHUNK_WIN;
+        uint32_t n     = t->chunk_count - base;
+        uint32_t width = info->tables.co64 ? 8 : 4;
+        if (n > M4A_CHUNK_WIN) n = M4A_CHUNK_WIN;
+
+        /* Read into the window's tail, widen front to back in place */
+        uint8_t *raw = (uint8_t *)t->chunk_win + sizeof(t->chunk_win) - (size_t)n * width;
+        t->chunk_len = 0;
+        if (fseek(f, (long)(info->tables.stco + 8 + (int64_t)base * width), SEEK_SET) != 0 ||
+            fread(raw, width, n, f) != n) return false;
+        for (uint32_t i = 0; i < n; i++)
+            t->chunk_win[i] = (width == 8) ? rd64(raw + (size_t)i * 8) : rd32(raw + (size_t)i * 4);
+        t->chunk_base = base;
+        t->chunk_len  = n;
+    }
+    *off = t->chunk_win[chunk - t->chunk_base];
+    return true;
+}
 
-        uint32_t spc      = ctx->stsc_spc[run];
-        uint64_t byte_pos = ctx->chunk_offsets[chunk];
+bool m4a_sample(FILE *f, m4a_info_t *info, uint32_t idx, uint64_t *offset, uint32_t *size)
+{
+    m4a_samples_t *t = info->samples;
+    if (!t || idx >= info->sample_count) return false;
+
+    /* Next sample in the cursor's chunk: right after the previous one */
+    if (idx == t->cur_sample + 1 && idx < t->cur_chunk_end) {
+        if (!sample_size_at(f, info, idx, size)) return false;
+        t->cur_offset += t->cur_size;
+        t->cur_sample  = idx;
+        t->cur_size    = *size;
+        *offset        = t->cur_offset;
+        return true;
+    }
 
-        for (uint32_t s = 0; s < spc && sample_idx < N; s++) {
-            out->sample_offsets[sample_idx] = byte_pos;
-            byte_pos += ctx->sample_sizes[sample_idx];
-            sample_idx++;
+    /* Run holding idx: last one starting at or before it */
+    uint32_t lo = 0, hi = t->run_count;
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if (t->runs[mid].first_sample <= idx) lo = mid; else hi = mid;
+    }
+    const m4a_run_t *r = &t->runs[lo];
+    uint32_t chunk = r->first_chunk + (idx - r->first_sample) / r->spc;
+    uint32_t first = r->first_sample + (chunk - r->first_chunk) * r->spc;
+
+    /* Chunk start + sizes of the samples before idx in the chunk */
+    uint64_t off;
+    if (!chunk_offset_at(f, info, chunk, &off)) return false;
+    if (info->sample_size) {
+        off += (uint64_t)(idx - first) * info->sample_size;
+    } else {
+        for (uint32_t s = first; s < idx; s++) {
+            uint32_t sz;
+            if (!sample_size_at(f, info, s, &sz)) return false;
+            off += sz;
         }
     }
+    if (!sample_size_at(f, info, idx, size)) return false;
 
-    if (sample_idx < N) {
-        ESP_LOGW(TAG, "Offset reconstruction: expected %lu frames, got %lu",
-                 (unsigned long)N, (unsigned long)sample_idx);
-        out->sample_count = sample_idx;   /* truncate to what we have */
-    }
+    t->cur_sample    = idx;
+    t->cur_chunk_end = first + r->spc;
+    t->cur_offset    = off;
+    t->cur_size      = *size;
+    *offset          = off;
     return true;
 }
 
@@ -559,11 +646,11 @@ bool m4a_parse(FILE *f, m4a_info_t *out)
     fseek(f, moov_body_start, SEEK_SET);
     parse_children(f, moov_end, &ctx, 0);
 
-    /* Validate all required tables were found */
-    if (!ctx.stsd_ok) { ESP_LOGE(TAG, "stsd parse failed");      goto fail; }
-    if (!ctx.stsz_ok) { ESP_LOGE(TAG, "stsz parse failed");      goto fail; }
-    if (!ctx.stsc_ok) { ESP_LOGE(TAG, "stsc parse failed");      goto fail; }
-    if (!ctx.stco_ok) { ESP_LOGE(TAG, "stco/co64 parse failed"); goto fail; }
+    /* Validate all required boxes were found */
+    if (!ctx.stsd_ok) { ESP_LOGE(TAG, "stsd parse failed");      return false; }
+    if (!ctx.stsz_ok) { ESP_LOGE(TAG, "stsz parse failed");      return false; }
+    if (!ctx.stsc_ok) { ESP_LOGE(TAG, "stsc parse failed");      return false; }
+    if (!ctx.stco_ok) { ESP_LOGE(TAG, "stco/co64 parse failed"); return false; }
 
     /* Populate output */
     out->codec           = ctx.codec;
@@ -572,54 +659,112 @@ bool m4a_parse(FILE *f, m4a_info_t *out)
     out->bits_per_sample = ctx.bits_per_sample;
     memcpy(out->config, ctx.config, ctx.config_size);
     out->config_size     = ctx.config_size;
+    out->tables          = ctx.tables;
     out->sample_count    = ctx.sample_count;
+    out->sample_size     = ctx.sample_size;
     out->timescale       = ctx.timescale;
     out->total_samples   = ctx.mdhd_ok ? ctx.mdhd_duration : (uint64_t)ctx.sample_count;
     out->duration_ms     = (ctx.mdhd_ok && ctx.timescale > 0)
                          ? (uint32_t)((ctx.mdhd_duration * 1000ULL) / ctx.timescale)
                          : 0;
 
-    /* Transfer sample_sizes ownership (avoid free in fail path) */
-    out->sample_sizes  = ctx.sample_sizes;
-    ctx.sample_sizes   = NULL;
-
-    /* Reconstruct flat sample_offsets from stsc + stco + stsz */
-    if (!build_offsets(&ctx, out)) {
-        ESP_LOGE(TAG, "OOM for sample_offsets");
-        goto fail;
+    if (ctx.smpb_ok) {
+        out->enc_delay     = ctx.enc_delay;
+        out->enc_padding   = ctx.enc_padding;
+        out->valid_samples = ctx.valid_samples;
     }
 
+    if (!m4a_load_tables(f, out)) return false;
+
     ESP_LOGI(TAG, "M4A: %s %luHz %d-ch %d-bit | %lu frames | %lu ms",
              out->codec == M4A_CODEC_AAC ? "AAC" : "ALAC",
              (unsigned long)out->sample_rate,
              out->channels, out->bits_per_sample,
              (unsigned long)out->sample_count,
              (unsigned long)out->duration_ms);
+    if (ctx.smpb_ok) {
+        ESP_LOGI(TAG, "iTunSMPB: delay=%lu padding=%lu valid=%llu",
+                 (unsigned long)out->enc_delay, (unsigned long)out->enc_padding,
+                 (unsigned long long)out->valid_samples);
+    }
+    return true;
+}
+
+bool m4a_load_tables(FILE *f, m4a_info_t *out)
+{
+    uint8_t hdr[8];
+    out->samples = NULL;
+
+    m4a_samples_t *t = calloc(1, sizeof(*t));
+    if (!t) return false;
+    t->cur_sample = UINT32_MAX;
+
+    /* Chunk count from the stco/co64 header */
+    if (fseek(f, (long)out->tables.stco, SEEK_SET) != 0 ||
+        fread(hdr, 1, 8, f) != 8 || (t->chunk_count = rd32(hdr + 4)) == 0) {
+        ESP_LOGE(TAG, "stco/co64 parse failed");
+        goto fail;
+    }
+
+    /* stsc → runs; consecutive entries with the same spc are one run */
+    if (fseek(f, (long)out->tables.stsc, SEEK_SET) != 0 || fread(hdr, 1, 8, f) != 8) {
+        ESP_LOGE(TAG, "stsc parse failed");
+        goto fail;
+    }
+    uint32_t entries = rd32(hdr + 4);
+    for (uint32_t i = 0; i < entries; i++) {
+        uint8_t e[12];
+        if (fread(e, 1, 12, f) != 12) {
+            ESP_LOGE(TAG, "stsc parse failed");
+            goto fail;
+        }
+        uint32_t fc  = rd32(e);          /* first_chunk (1-indexed) */
+        uint32_t spc = rd32(e + 4);      /* samples_per_chunk       */
+        /* ignore sample_description_index at e+8 */
+
+        m4a_run_t *prev = t->run_count ? &t->runs[t->run_count - 1] : NULL;
+        if (fc == 0 || fc > t->chunk_count || (prev && fc - 1 <= prev->first_chunk)) break;
+        uint32_t first = prev ? prev->first_sample + (fc - 1 - prev->first_chunk) * prev->spc : 0;
+        if (prev && prev->spc == spc) continue;
+        if (prev && prev->spc == 0) t->run_count--;     /* empty chunks: drop the run */
+        if (spc == 0 && !prev) continue;
+
+        if ((t->run_count & 7) == 0) {
+            m4a_run_t *runs = realloc(t->runs, (t->run_count + 8) * sizeof(m4a_run_t));
+            if (!runs) goto fail;
+            t->runs = runs;
+        }
+        t->runs[t->run_count++] = (m4a_run_t){ fc - 1, spc, first };
+    }
+    if (t->run_count == 0 || t->runs[t->run_count - 1].spc == 0) {
+        ESP_LOGE(TAG, "stsc parse failed");
+        goto fail;
+    }
+
+    /* More samples in stsz than the chunks hold: play what is there */
+    const m4a_run_t *last = &t->runs[t->run_count - 1];
+    uint64_t held = last->first_sample
+                  + (uint64_t)(t->chunk_count - last->first_chunk) * last->spc;
+    if (held < out->sample_count) {
+        ESP_LOGW(TAG, "Sample table: expected %lu frames, chunks hold %lu",
+                 (unsigned long)out->sample_count, (unsigned long)held);
+        out->sample_count = (uint32_t)held;
+    }
 
-    /* Release temporary tables */
-    free(ctx.stsc_fc);
-    free(ctx.stsc_spc);
-    free(ctx.chunk_offsets);
+    out->samples = t;
     return true;
 
 fail:
-    free(ctx.sample_sizes);
-    free(ctx.stsc_fc);
-    free(ctx.stsc_spc);
-    free(ctx.chunk_offsets);
-    free(out->sample_sizes);
-    free(out->sample_offsets);
-    out->sample_sizes   = NULL;
-    out->sample_offsets = NULL;
+    free(t->runs);
+    free(t);
     return false;
 }
 
 void m4a_free(m4a_info_t *info)
 {
-    if (info) {
-        free(info->sample_sizes);
-        free(info->sample_offsets);
-        info->sample_sizes   = NULL;
-        info->sample_offsets = NULL;
+    if (info && info->samples) {
+        free(info->samples->runs);
+        free(info->samples);
+        info->samples = NULL;
     }
 }
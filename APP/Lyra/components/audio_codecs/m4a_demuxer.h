@@ -11,15 +11,28 @@ typedef enum {
 } m4a_codec_t;
 
 /*
- * Parsed M4A audio track information + flat sample table.
- *
- * sample_sizes[]   — bytes of each compressed frame (heap-allocated)
- * sample_offsets[] — absolute file offset of each compressed frame (heap-allocated)
+ * File positions of the audio track's sample table boxes (start of each
+ * box body).  The tables are read from there on demand.
+ */
+typedef struct {
+    int64_t stsz;
+    int64_t stsc;
+    int64_t stco;              /* stco or co64 body */
+    bool    co64;
+} m4a_table_pos_t;
+
+/* Sample table cursor and windows (m4a_demuxer.c), about 2 KB */
+typedef struct m4a_samples_s m4a_samples_t;
+
+/*
+ * Parsed M4A audio track information + lazy sample table.
  *
- * Memory estimate: ~12 bytes/frame.
- * Example: 1h ALAC 48kHz (frameLength=4096) ≈ 42 000 frames ≈ 500 KB → PSRAM OK.
+ * Only the stsc runs (a handful of entries in practice) live in RAM;
+ * sample sizes and chunk offsets are read from the file by m4a_sample()
+ * through small windows, so memory and open time do not depend on the
+ * track length.
  *
- * Call m4a_free() to release sample table arrays.
+ * Call m4a_free() to release the sample table.
  */
 typedef struct {
     uint32_t    sample_rate;
@@ -38,10 +51,16 @@ typedef struct {
     uint8_t  config[64];
     uint32_t config_size;
 
-    /* Flat sample table */
-    uint32_t  sample_count;
-    uint32_t *sample_sizes;    /* [sample_count] compressed bytes per frame */
-    uint64_t *sample_offsets;  /* [sample_count] absolute file byte offsets  */
+    /* Gapless info from the iTunSMPB tag (all 0 when absent) */
+    uint32_t enc_delay;        /* priming samples at stream start        */
+    uint32_t enc_padding;      /* padding samples at stream end          */
+    uint64_t valid_samples;    /* samples between priming and padding    */
+
+    /* Sample table */
+    m4a_table_pos_t tables;
+    uint32_t       sample_count;
+    uint32_t       sample_size;  /* constant compressed size, 0 = per sample (stsz) */
+    m4a_samples_t *samples;      /* heap, NULL until m4a_load_tables()        */
 } m4a_info_t;
 
 #ifdef __cplusplus
@@ -49,12 +68,13 @@ extern "C" {
 #endif
 
 /**
- * @brief Parse an M4A/MP4/M4B file and extract the audio track sample table.
+ * @brief Parse an M4A/MP4/M4B file and set up the audio track sample table.
  *
  * Scans the top-level box structure for 'moov', then recursively parses
  * moov → trak (audio) → mdia → mdhd/hdlr/minf → stbl → stsd/stsc/stsz/stco.
+ * Only the table headers are read here (see m4a_load_tables()).
  *
- * On success, out->sample_sizes and out->sample_offsets are heap-allocated.
+ * On success, out->samples is heap-allocated.
  * The caller must call m4a_free(out) when done.
  *
  * @param f    Open FILE* (may be positioned anywhere; function uses fseek internally)
@@ -63,7 +83,29 @@ extern "C" {
  */
 bool m4a_parse(FILE *f, m4a_info_t *out);
 
-/** @brief Release heap arrays allocated by m4a_parse(). Safe to call on zeroed struct. */
+/**
+ * @brief Set up the sample table from known box positions.
+ *
+ * Called by m4a_parse(); also on its own for an m4a_info_t saved from an
+ * earlier parse of the same file (samples NULL, every other field valid),
+ * which skips the moov walk.  Reads the stsc runs and the stco header.
+ *
+ * @return true on success (out->samples heap-allocated)
+ */
+bool m4a_load_tables(FILE *f, m4a_info_t *out);
+
+/**
+ * @brief File offset and size of one compressed sample.
+ *
+ * Sequential calls cost one addition (plus a table window refill every
+ * 256 samples); a random index costs one chunk lookup and the sizes of
+ * the samples before it in its chunk.  Moves the file position.
+ *
+ * @return false if idx is past the end or the table cannot be read
+ */
+bool m4a_sample(FILE *f, m4a_info_t *info, uint32_t idx, uint64_t *offset, uint32_t *size);
+
+/** @brief Release the sample table. Safe to call on zeroed struct. */
 void m4a_free(m4a_info_t *info);
 
 #ifdef __cplusplus
@@ -0,0 +1,404 @@
+#include "audio_engine.h"
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "audio_trace.h"
+#include "audio_pipeline.h"
+
+static const char *TAG = "audio_engine";
+
+#define Q28_ONE  (1 << 28)
+
+// Fixed output rate policy (set from the control task, read at stream start)
+static volatile uint32_t          s_fixed_rate;
+static volatile dsp_src_quality_t s_fixed_quality = DSP_SRC_QUALITY_MEDIUM;
+
+// Oversampling policy (same: control task writes, stream start reads)
+static volatile uint8_t        s_os_factor = 1;
+static volatile dsp_os_phase_t s_os_phase = DSP_OS_PHASE_LINEAR;
+
+//--------------------------------------------------------------------+
+// Configuration
+//--------------------------------------------------------------------+
+
+uint32_t audio_engine_block_frames(uint32_t sample_rate, uint32_t min_frames)
+{
+    // Full ring block from 32 kHz up (one MPEG-1 Layer III frame, ~26 ms
+    // at 44.1k). Below that MPEG-2/2.5 frames are 576 samples and a full
+    // block would last 50-144 ms, leaving the low-rate jitter buffer only
+    // a handful of blocks deep.
+    uint32_t frames = AUDIO_ENGINE_MAX_FRAMES;
+    if (sample_rate > 0 && sample_rate < 32000) frames = AUDIO_ENGINE_MAX_FRAMES / 2;
+
+    if (frames < min_frames) frames = min_frames;
+    if (frames > AUDIO_ENGINE_MAX_FRAMES) frames = AUDIO_ENGINE_MAX_FRAMES;
+    return frames;
+}
+
+static void diag_clear(audio_engine_diag_t *d)
+{
+    uint64_t total = d->total_frames;
+    memset(d, 0, sizeof(*d));
+    d->ring_min = UINT32_MAX;
+    d->total_frames = total;
+}
+
+void audio_engine_init(audio_engine_t *eng, audio_engine_pull_fn pull, void *ctx,
+                       const audio_engine_output_t *out)
+{
+    memset(eng, 0, sizeof(*eng));
+    eng->pull = pull;
+    eng->ctx  = ctx;
+    eng->out  = *out;
+    audio_engine_start(eng, 0, 0);
+}
+
+void audio_engine_set_fixed_rate(uint32_t rate, dsp_src_quality_t quality)
+{
+    if (quality >= DSP_SRC_QUALITY_COUNT) quality = DSP_SRC_QUALITY_MEDIUM;
+    s_fixed_quality = quality;
+    s_fixed_rate    = rate;
+}
+
+uint32_t audio_engine_get_fixed_rate(dsp_src_quality_t *quality)
+{
+    if (quality) *quality = s_fixed_quality;
+    return s_fixed_rate;
+}
+
+void audio_engine_set_oversampling(uint8_t factor, dsp_os_phase_t phase)
+{
+    if (factor != 2 && factor != 4 && factor != 8) factor = 1;
+    if (phase >= DSP_OS_PHASE_COUNT) phase = DSP_OS_PHASE_LINEAR;
+    s_os_phase  = phase;
+    s_os_factor = factor;
+}
+
+uint8_t audio_engine_get_oversampling(dsp_os_phase_t *phase)
+{
+    if (phase) *phase = s_os_phase;
+    return s_os_factor;
+}
+
+// Rate gain / DSP / volume run at: the fixed rate, or the stream's own
+static uint32_t engine_dsp_rate(uint32_t stream_rate, bool bit_exact)
+{
+    uint32_t fixed = s_fixed_rate;
+    if (fixed == 0 || stream_rate == 0 || bit_exact) return stream_rate;
+    return fixed;
+}
+
+uint32_t audio_engine_output_rate(uint32_t stream_rate, bool bit_exact)
+{
+    uint32_t rate = engine_dsp_rate(stream_rate, bit_exact);
+    if (bit_exact || rate == 0) return rate;
+    return rate * dsp_os_factor_for(rate, s_os_factor);
+}
+
+// Bring the resampler in line with sample_rate → dsp_rate and the
+// oversampler with os_factor. Only checks the parameters here: both are
+// built on the first run() (filter design is not free, and DoP turns
+// them off right after start). An SRC for the same ratio and quality,
+// an oversampler for the same factor and phase, are reused across
+// streams.
+static void engine_setup_src(audio_engine_t *eng)
+{
+    if (eng->src && (eng->dsp_rate == eng->sample_rate ||
+                     dsp_src_get_in_rate(eng->src) != eng->sample_rate ||
+                     dsp_src_get_out_rate(eng->src) != eng->dsp_rate ||
+                     dsp_src_get_quality(eng->src) != s_fixed_quality)) {
+        dsp_src_destroy(eng->src);
+        eng->src = NULL;
+    }
+
+    if (eng->dsp_rate != eng->sample_rate &&
+        !dsp_src_supported(eng->sample_rate, eng->dsp_rate)) {
+        ESP_LOGW(TAG, "Cannot resample %lu → %lu Hz, playing at native rate",
+                 (unsigned long)eng->sample_rate, (unsigned long)eng->dsp_rate);
+        eng->dsp_rate = eng->sample_rate;
+        eng->os_factor = dsp_os_factor_for(eng->dsp_rate, s_os_factor);
+    }
+    eng->out_rate = eng->dsp_rate * eng->os_factor;
+
+    if (eng->os && (eng->os_factor == 1 ||
+                    dsp_os_get_factor(eng->os) != eng->os_factor ||
+                    dsp_os_get_phase(eng->os) != s_os_phase)) {
+        dsp_os_destroy(eng->os);
+        eng->os = NULL;
+    }
+    audio_engine_flush(eng);
+}
+
+static bool engine_src_ready(audio_engine_t *eng)
+{
+    if (!eng->src) eng->src = dsp_src_create(eng->sample_rate, eng->dsp_rate, s_fixed_quality);
+    if (!eng->src_in) eng->src_in = malloc(AUDIO_ENGINE_MAX_FRAMES * 2 * sizeof(int32_t));
+    return eng->src && eng->src_in;
+}
+
+static bool engine_os_ready(audio_engine_t *eng)
+{
+    if (!eng->os) eng->os = dsp_os_create(eng->os_factor, s_os_phase);
+    if (!eng->os_buf) eng->os_buf = malloc(AUDIO_ENGINE_MAX_FRAMES * 2 * sizeof(int32_t));
+    return eng->os && eng->os_buf;
+}
+
+void audio_engine_flush(audio_engine_t *eng)
+{
+    if (eng->src) dsp_src_reset(eng->src);
+    eng->src_in_pos = 0;
+    eng->src_in_len = 0;
+    if (eng->os) dsp_os_reset(eng->os);
+    eng->os_pos = 0;
+    eng->os_len = 0;
+}
+
+// The chain runs at dsp_rate, not at the I2S rate: hand the pipeline
+// this stream's factor once, through its serialized setter, before the
+// source configures the output (audio_pipeline_update_format() splits
+// the I2S rate by it)
+void audio_engine_sync_pipeline(const audio_engine_t *eng)
+{
+    if (eng->sample_rate == 0) return;      // audio_engine_init(): no stream yet
+    audio_pipeline_set_oversampling(eng->os_factor,
+                                    eng->os ? dsp_os_get_phase(eng->os) : s_os_phase);
+}
+
+void audio_engine_start(audio_engine_t *eng, uint32_t sample_rate, uint32_t min_frames)
+{
+    eng->sample_rate  = sample_rate;
+    eng->dsp_rate     = engine_dsp_rate(sample_rate, false);
+    eng->os_factor    = dsp_os_factor_for(eng->dsp_rate, s_os_factor);
+    engine_setup_src(eng);
+    // Packet-size constraints apply to the decoder side only. When
+    // oversampling this is the block decoded at dsp_rate; ring blocks
+    // are filled whole from it.
+    eng->block_frames = audio_engine_block_frames(eng->dsp_rate,
+                            eng->dsp_rate != sample_rate ? 0 : min_frames);
+    eng->dsp_bypass   = false;
+    eng->gain_db      = 0.0f;
+    eng->gain_q28     = Q28_ONE;
+    dsp_volume_init(&eng->volume);
+    eng->diag.total_frames = 0;
+    diag_clear(&eng->diag);
+    audio_engine_sync_pipeline(eng);
+}
+
+void audio_engine_set_gain_db(audio_engine_t *eng, float gain_db)
+{
+    // Q3.28 gain recomputed only when the value changes (+18 dB fits)
+    if (gain_db == eng->gain_db) return;
+    eng->gain_db  = gain_db;
+    if (gain_db > 18.0f) gain_db = 18.0f;
+    eng->gain_q28 = (gain_db == 0.0f) ? Q28_ONE
+                  : (int32_t)lrint(pow(10.0, gain_db / 20.0) * Q28_ONE);
+}
+
+void audio_engine_set_volume(audio_engine_t *eng, uint16_t volume)
+{
+    // 65535 maps to exact unity so full volume skips the stage
+    uint32_t gain = (volume == UINT16_MAX) ? DSP_VOLUME_UNITY : (uint32_t)volume << 15;
+    if (gain != eng->volume.target) {
+        // A new stream starts at the volume, later changes ramp
+        uint32_t ramp = eng->diag.total_frames ? eng->dsp_rate * DSP_VOLUME_RAMP_MS / 1000u : 0;
+        dsp_volume_set_target(&eng->volume, gain, ramp);
+    }
+}
+
+void audio_engine_set_dsp_bypass(audio_engine_t *eng, bool bypass)
+{
+    eng->dsp_bypass = bypass;
+    // DoP markers must reach the DAC bit-exact: never resample or oversample
+    if (bypass && eng->out_rate != eng->sample_rate) {
+        eng->dsp_rate = eng->sample_rate;
+        eng->os_factor = 1;
+        engine_setup_src(eng);
+        eng->block_frames = audio_engine_block_frames(eng->out_rate, 0);
+        audio_engine_sync_pipeline(eng);
+    }
+}
+
+//--------------------------------------------------------------------+
+// Hot loop
+//--------------------------------------------------------------------+
+
+// Rounded, not truncated: a truncating gain leaves a −½ LSB DC offset
+// and error correlated with the signal
+static void apply_gain(int32_t *p, uint32_t n, int32_t gq)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        int64_t s = ((int64_t)p[i] * gq + (Q28_ONE >> 1)) >> 28;
+        if      (s > INT32_MAX) s = INT32_MAX;
+        else if (s < INT32_MIN) s = INT32_MIN;
+        p[i] = (int32_t)s;
+    }
+}
+
+// Fill one output block through the SRC. Decoder frames are pulled only
+// as far as the block needs; leftovers stay staged for the next block.
+// A short block is committed on EOF / STARVED, the result comes back on
+// the next call.
+static int32_t engine_pull_resampled(audio_engine_t *eng, int32_t *blk, uint32_t max_frames)
+{
+    uint32_t produced = 0;
+    int32_t  result = AUDIO_ENGINE_EOF;
+
+    while (produced < max_frames) {
+        uint32_t avail = eng->src_in_len - eng->src_in_pos;
+        uint32_t want = avail ? 0 : dsp_src_input_needed(eng->src, max_frames - produced);
+        if (want > 0) {
+            if (want > AUDIO_ENGINE_MAX_FRAMES) want = AUDIO_ENGINE_MAX_FRAMES;
+            int32_t got = eng->pull(eng->ctx, eng->src_in, want);
+            if (got <= 0) {
+                result = got;
+                break;
+            }
+            if ((uint32_t)got > want) got = (int32_t)want;
+            eng->src_in_pos = 0;
+            eng->src_in_len = (uint32_t)got;
+            eng->in_frames += (uint32_t)got;
+            avail = (uint32_t)got;
+        }
+
+        uint32_t used = 0;
+        produced += dsp_src_process(eng->src, eng->src_in + 2 * eng->src_in_pos, avail,
+                                    blk + 2 * produced, max_frames - produced, &used);
+        eng->src_in_pos += used;
+    }
+
+    return produced ? (int32_t)produced : result;
+}
+
+// Decoder frames at dsp_rate, straight or through the SRC
+static int32_t engine_decode(audio_engine_t *eng, int32_t *dst, uint32_t max_frames)
+{
+    if (eng->dsp_rate == eng->sample_rate) {
+        int32_t frames = eng->pull(eng->ctx, dst, max_frames);
+        if (frames > (int32_t)max_frames) frames = (int32_t)max_frames;
+        if (frames > 0) eng->in_frames = (uint32_t)frames;
+        return frames;
+    }
+    if (engine_src_ready(eng)) {
+        return engine_pull_resampled(eng, dst, max_frames);
+    }
+    ESP_LOGE(TAG, "Out of memory for the resampler");
+    return AUDIO_ENGINE_ERROR;
+}
+
+// Gain, DSP and volume in place at dsp_rate
+static void engine_process(audio_engine_t *eng, int32_t *p, uint32_t frames)
+{
+    if (eng->dsp_bypass) return;
+
+    if (eng->gain_q28 != Q28_ONE) apply_gain(p, frames * 2, eng->gain_q28);
+    eng->out.process_audio(p, frames);
+    // After DSP so the EQ runs at full precision regardless of volume
+    if (dsp_volume_has_gain(&eng->volume)) dsp_volume_process(&eng->volume, p, frames);
+}
+
+// Oversampled block: a whole decoder block is decoded and processed into
+// os_buf, then oversampled into as many ring blocks as it takes. *t_dsp
+// marks the end of decoding.
+static int32_t engine_run_oversampled(audio_engine_t *eng, int32_t *blk, uint32_t max_frames,
+                                      uint32_t *t_dsp)
+{
+    if (!engine_os_ready(eng)) {
+        ESP_LOGE(TAG, "Out of memory for the oversampler");
+        *t_dsp = (uint32_t)esp_timer_get_time();
+        return AUDIO_ENGINE_ERROR;
+    }
+
+    bool fresh = false;
+    if (eng->os_pos == eng->os_len) {
+        AUDIO_TRACE_BEGIN(AUDIO_TRACE_DECODE);
+        int32_t got = engine_decode(eng, eng->os_buf, eng->block_frames);
+        AUDIO_TRACE_END(AUDIO_TRACE_DECODE, got > 0 ? got : 0);
+        if (got <= 0) {
+            *t_dsp = (uint32_t)esp_timer_get_time();
+            return got;
+        }
+        eng->os_pos = 0;
+        eng->os_len = (uint32_t)got;
+        fresh = true;
+    }
+    *t_dsp = (uint32_t)esp_timer_get_time();
+    if (fresh) engine_process(eng, eng->os_buf, eng->os_len);
+
+    uint32_t n = eng->os_len - eng->os_pos;
+    if (n > max_frames / eng->os_factor) n = max_frames / eng->os_factor;
+    uint32_t frames = dsp_os_process(eng->os, eng->os_buf + 2 * eng->os_pos, n, blk);
+    eng->os_pos += n;
+    return (int32_t)frames;
+}
+
+int32_t audio_engine_run(audio_engine_t *eng, uint32_t wait_ms)
+{
+    // Backpressure: the I2S feeder notifies the producer task whenever it
+    // releases a block — waiting here is the natural yield point
+    uint32_t max_frames = 0;
+    int32_t *blk = eng->out.ring_acquire(&max_frames);
+    if (!blk) {
+        eng->diag.backpressure++;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms));
+        return AUDIO_ENGINE_FULL;
+    }
+
+    // Decode straight into the ring block (resampling counts as decode),
+    // or into the oversampler's staging buffer
+    uint32_t t_loop = (uint32_t)esp_timer_get_time();
+    uint32_t t_dsp;
+    int32_t frames;
+    eng->in_frames = 0;
+    if (eng->os_factor > 1) {
+        if (max_frames > AUDIO_ENGINE_MAX_FRAMES) max_frames = AUDIO_ENGINE_MAX_FRAMES;
+        frames = engine_run_oversampled(eng, blk, max_frames, &t_dsp);
+    } else {
+        if (max_frames > eng->block_frames) max_frames = eng->block_frames;
+        AUDIO_TRACE_BEGIN(AUDIO_TRACE_DECODE);
+        frames = engine_decode(eng, blk, max_frames);
+        AUDIO_TRACE_END(AUDIO_TRACE_DECODE, frames > 0 ? frames : 0);
+        t_dsp = (uint32_t)esp_timer_get_time();
+        if (frames > 0) engine_process(eng, blk, (uint32_t)frames);
+    }
+
+    if (frames <= 0) {
+        if (frames == AUDIO_ENGINE_STARVED) eng->diag.starved++;
+        return frames;
+    }
+    uint32_t t_commit = (uint32_t)esp_timer_get_time();
+
+    // Hand the block to the I2S feeder
+    eng->out.ring_commit((uint32_t)frames);
+
+    uint32_t t_end = (uint32_t)esp_timer_get_time();
+    uint32_t decode_us = t_dsp - t_loop;
+    uint32_t dsp_us    = t_commit - t_dsp;
+    uint32_t loop_us   = t_end - t_loop;
+
+    audio_engine_diag_t *d = &eng->diag;
+    if (decode_us > d->decode_max_us) d->decode_max_us = decode_us;
+    if (dsp_us > d->dsp_max_us) d->dsp_max_us = dsp_us;
+    if (loop_us > d->loop_max_us) d->loop_max_us = loop_us;
+    d->blocks++;
+    d->active_us += loop_us;
+    d->total_frames += (uint32_t)frames;
+
+    if (eng->out.ring_used) {
+        uint32_t used = (uint32_t)eng->out.ring_used();
+        if (used < d->ring_min) d->ring_min = used;
+        if (used > d->ring_max) d->ring_max = used;
+    }
+
+    return frames;
+}
+
+void audio_engine_take_diag(audio_engine_t *eng, audio_engine_diag_t *out)
+{
+    *out = eng->diag;
+    if (out->ring_min == UINT32_MAX) out->ring_min = 0;
+    diag_clear(&eng->diag);
+}
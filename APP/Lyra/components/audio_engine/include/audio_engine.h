@@ -0,0 +1,183 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "dsp_src.h"
+#include "dsp_os.h"
+#include "dsp_volume.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Audio producer engine: decoder → gain → DSP → volume → output ring
+//--------------------------------------------------------------------+
+//
+// Shared hot loop for every decoding source (SD player, HTTP streams,
+// Spotify). The source task keeps its own control flow (commands, EOF,
+// track changes) and calls audio_engine_run() once per block; the engine
+// owns everything in between:
+//
+//   acquire ring block ──(full: wait for feeder)──┐
+//   pull(decoder) straight into the block         │ backpressure
+//     (or via the SRC in fixed output rate mode)  │
+//   ReplayGain (Q3.28, rounded, pre-DSP)          │
+//   process_audio() (skipped for DSD/DoP)         │
+//   volume (64-bit, ramped, post-DSP)             │
+//   oversampling (optional, 2x/4x/8x)             │
+//   commit → I2S feeder                           │
+//   diagnostics + trace                           ┘
+//
+// Block size per sample rate lives in audio_engine_block_frames().
+//
+// Fixed output rate: with audio_engine_set_fixed_rate() every PCM stream
+// is resampled (dsp_src) to one rate, so track and source changes never
+// retune the I2S clock. DSD / DoP always plays at its native rate. The
+// source asks the engine for the rate to configure the output with
+// (eng->out_rate after audio_engine_start()); gain, DSP and volume run
+// at that rate.
+//
+// Oversampling: with audio_engine_set_oversampling() the processed
+// stream (eng->dsp_rate) is raised by 2/4/8 (dsp_os half-band cascade)
+// before it reaches the ring, up to DSP_OS_MAX_RATE. A whole decoder
+// block is decoded and processed at dsp_rate, then handed out over
+// several ring blocks. audio_engine_start() puts the DSP chain at
+// dsp_rate (audio_pipeline_set_oversampling(), once per stream) while
+// I2S runs at out_rate.
+// DSD / DoP is never oversampled.
+//--------------------------------------------------------------------+
+
+// Largest block the engine asks a decoder for (int32 stereo frames).
+// Matches AUDIO_RING_BLOCK_FRAMES: one MPEG-1 Layer III frame.
+#define AUDIO_ENGINE_MAX_FRAMES  1152
+
+// Pull results (≤ 0). Same convention as codec_decode(): 0 = EOF, -1 = error.
+#define AUDIO_ENGINE_EOF         0
+#define AUDIO_ENGINE_ERROR      (-1)
+#define AUDIO_ENGINE_STARVED    (-2)    // Decoder has no input yet (retry later)
+#define AUDIO_ENGINE_FULL       (-3)    // run(): ring stayed full, nothing decoded
+
+// Decoder callback: write up to max_frames int32 stereo interleaved
+// (left-justified) frames to out. Returns frames written, or one of the
+// results above.
+typedef int32_t (*audio_engine_pull_fn)(void *ctx, int32_t *out, uint32_t max_frames);
+
+// Output side — the same ring / DSP callbacks the source received from main
+typedef struct {
+    int32_t *(*ring_acquire)(uint32_t *max_frames);  // free output block or NULL
+    void     (*ring_commit)(uint32_t frames);        // queue it for I2S
+    size_t   (*ring_used)(void);                     // bytes queued (optional, diagnostics)
+    void     (*process_audio)(int32_t *buffer, uint32_t frames);
+} audio_engine_output_t;
+
+// Diagnostics since the last audio_engine_take_diag()
+typedef struct {
+    uint32_t decode_max_us;
+    uint32_t dsp_max_us;      // gain + DSP + volume + oversampling
+    uint32_t loop_max_us;     // decode → commit
+    uint32_t blocks;          // blocks committed
+    uint32_t backpressure;    // ring was full
+    uint32_t starved;         // decoder had no input
+    uint32_t ring_min;        // bytes queued after commit
+    uint32_t ring_max;
+    uint32_t active_us;       // total time decode → commit
+    uint64_t total_frames;    // frames committed since audio_engine_start()
+} audio_engine_diag_t;
+
+typedef struct {
+    // Set by audio_engine_init()
+    audio_engine_pull_fn  pull;
+    void                 *ctx;
+    audio_engine_output_t out;
+
+    // Per-stream state
+    uint32_t sample_rate;     // decoder rate
+    uint32_t dsp_rate;        // gain / DSP / volume rate (≠ sample_rate when resampling)
+    uint32_t out_rate;        // ring / I2S rate (dsp_rate × os_factor)
+    uint8_t  os_factor;       // 1 = no oversampling
+    uint32_t block_frames;
+    bool     dsp_bypass;      // DSD over PCM (DoP) must reach the DAC bit-exact
+    float    gain_db;         // ReplayGain
+    int32_t  gain_q28;        // 1 << 28 = unity
+    dsp_volume_t volume;      // stream volume (the device volume is in the DSP chain)
+    uint32_t in_frames;       // decoder frames pulled by the last run()
+
+    // Resampler (fixed output rate mode), kept across streams of equal rates
+    dsp_src_t *src;
+    int32_t   *src_in;        // decoder frames staged for the SRC
+    uint32_t   src_in_pos;
+    uint32_t   src_in_len;
+
+    // Oversampler, kept across streams of equal factor and phase
+    dsp_os_t  *os;
+    int32_t   *os_buf;        // processed frames at dsp_rate, not yet oversampled
+    uint32_t   os_pos;
+    uint32_t   os_len;
+
+    audio_engine_diag_t diag;
+} audio_engine_t;
+
+// Bind a decoder and the output callbacks (once per source)
+void audio_engine_init(audio_engine_t *eng, audio_engine_pull_fn pull, void *ctx,
+                       const audio_engine_output_t *out);
+
+// New stream: picks the output rate (fixed rate policy) and sets up the
+// resampler, tells the DSP pipeline the oversampling factor, sets the
+// block size for that rate, clears gain, volume, DSP
+// bypass and diagnostics. min_frames: smallest block the decoder can
+// fill without dropping audio (codecs that emit whole packets and truncate
+// to max_frames), 0 if it streams at any size.
+void audio_engine_start(audio_engine_t *eng, uint32_t sample_rate, uint32_t min_frames);
+
+// Re-send this stream's oversampling factor to the DSP pipeline: a source
+// that resumes without audio_engine_start() (another source ran in
+// between and reset the factor) calls it before switching back
+void audio_engine_sync_pipeline(const audio_engine_t *eng);
+
+// Drop resampler / oversampler history and staged frames (seek, flush)
+void audio_engine_flush(audio_engine_t *eng);
+
+// ReplayGain in dB applied before DSP (0 = off, at most +18 dB). Cheap to
+// call per block.
+void audio_engine_set_gain_db(audio_engine_t *eng, float gain_db);
+
+// Linear volume applied after DSP (0..65535, 65535 = unity), ramped over
+// DSP_VOLUME_RAMP_MS. Cheap to call per block.
+void audio_engine_set_volume(audio_engine_t *eng, uint16_t volume);
+
+// Skip gain, DSP, volume, resampling and oversampling (DSD / DoP):
+// out_rate falls back to sample_rate, call before configuring the output
+void audio_engine_set_dsp_bypass(audio_engine_t *eng, bool bypass);
+
+// Produce one block. Waits up to wait_ms on the producer notification if
+// the ring is full. Returns frames committed (> 0, at out_rate) or an
+// AUDIO_ENGINE_* result; on EOF / ERROR / STARVED nothing is committed.
+// eng->in_frames holds the decoder frames consumed, for stream position.
+int32_t audio_engine_run(audio_engine_t *eng, uint32_t wait_ms);
+
+// Frames per block for a sample rate (≤ AUDIO_ENGINE_MAX_FRAMES)
+uint32_t audio_engine_block_frames(uint32_t sample_rate, uint32_t min_frames);
+
+// Copy the diagnostics window and start a new one (total_frames is kept)
+void audio_engine_take_diag(audio_engine_t *eng, audio_engine_diag_t *out);
+
+// Fixed output rate for PCM streams (0 = follow each stream's rate).
+// Takes effect at the next audio_engine_start().
+void audio_engine_set_fixed_rate(uint32_t rate, dsp_src_quality_t quality);
+uint32_t audio_engine_get_fixed_rate(dsp_src_quality_t *quality);
+
+// Oversampling of PCM streams: up to `factor` (1 = off, 2, 4, 8), capped
+// so the output stays ≤ DSP_OS_MAX_RATE. Takes effect at the next
+// audio_engine_start().
+void audio_engine_set_oversampling(uint8_t factor, dsp_os_phase_t phase);
+uint8_t audio_engine_get_oversampling(dsp_os_phase_t *phase);
+
+// Output rate a stream will play at under the current policy (fixed
+// rate, then oversampling)
+uint32_t audio_engine_output_rate(uint32_t stream_rate, bool bit_exact);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,449 @@
+#include "audio_analysis.h"
+#include "dsp_fft.h"
+#include "dsp_limiter.h"
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "audio_analysis";
+
+#define ANALYSIS_TASK_STACK  4096
+#define ANALYSIS_TASK_PRIO   1
+
+#define FFT_N        AUDIO_ANALYSIS_FFT_SIZE
+#define CIC_ORDER    3
+#define CIC_MAX_LEN  (CIC_ORDER * (AUDIO_ANALYSIS_MAX_DECIM - 1) + 1)
+#define WIN_MAX      (FFT_N * AUDIO_ANALYSIS_MAX_DECIM + CIC_MAX_LEN - 1)
+
+// Frames per true-peak chunk (the interpolator history is carried over)
+#define TP_CHUNK     256
+#define TP_HIST      (DSP_LIMITER_TP_TAPS - 1)
+
+#define BAND_LO_HZ   20.0f
+#define BAND_HI_HZ   20000.0f
+
+// Level meters at −120 dBFS and below read as the floor
+#define LEVEL_MIN    1e-6f
+
+// Tap states: the analysis task arms, the audio task fills, the
+// analysis task reads and re-arms. Whoever does not own the state
+// leaves the window alone.
+enum {
+    TAP_IDLE = 0,
+    TAP_ARMED,
+    TAP_READY,
+};
+
+//--------------------------------------------------------------------+
+// Private State
+//--------------------------------------------------------------------+
+
+// Shared with the audio task
+static struct {
+    uint32_t state;         // TAP_*, atomic
+    uint32_t rate;          // Rate of the window being filled (producer)
+    uint32_t need;          // Frames per window at that rate (producer)
+    uint32_t fill;          // Frames copied so far (producer while armed)
+    int32_t *win;           // Interleaved stereo, WIN_MAX frames (PSRAM)
+} s_tap;
+
+// Analysis task only
+static dsp_fft_plan_t s_plan;
+static float   *s_fft;                      // FFT_N complex
+static float   *s_hann;                     // FFT_N
+static uint32_t s_rate;                     // Rate the tables below were built for
+static uint32_t s_decim;
+static float    s_cic[CIC_MAX_LEN];         // Decimator taps, scaled to ±1.0 input
+static uint16_t s_cic_len;
+static uint16_t s_band_lo[AUDIO_ANALYSIS_BANDS];
+static uint16_t s_band_hi[AUDIO_ANALYSIS_BANDS];
+static float    s_band_scale[AUDIO_ANALYSIS_BANDS];   // 0 = band above Nyquist
+static float    s_tp_buf[TP_HIST + TP_CHUNK];
+static audio_analysis_t s_res;              // Shown values (with ballistics)
+static float    s_hold_ms[2];
+static float    s_clip_ms;
+
+// Published result
+static uint32_t s_pub_seq;                  // Odd while being written
+static audio_analysis_t s_pub;
+static uint32_t s_last_read;                // Tick of the last audio_analysis_get()
+
+//--------------------------------------------------------------------+
+// Tap (audio task)
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Decimation factor before the FFT: down to 44.1/48 kHz
+ */
+static uint32_t analysis_decim(uint32_t sample_rate)
+{
+    uint32_t d = 1;
+    while (d < AUDIO_ANALYSIS_MAX_DECIM && sample_rate / (d * 2) >= 44100) {
+        d *= 2;
+    }
+    return d;
+}
+
+// The CIC needs (order × (D − 1)) frames past the last decimated point
+static uint32_t analysis_window_frames(uint32_t decim)
+{
+    return FFT_N * decim + CIC_ORDER * (decim - 1);
+}
+
+void audio_analysis_tap(const int32_t *buf, uint32_t frames, uint32_t sample_rate)
+{
+    if (__atomic_load_n(&s_tap.state, __ATOMIC_ACQUIRE) != TAP_ARMED) {
+        return;
+    }
+
+    if (sample_rate != s_tap.rate) {
+        // A window spans one rate only: start over
+        s_tap.rate = sample_rate;
+        s_tap.need = analysis_window_frames(analysis_decim(sample_rate));
+        s_tap.fill = 0;
+    }
+
+    uint32_t n = s_tap.need - s_tap.fill;
+    if (n > frames) n = frames;
+    memcpy(&s_tap.win[s_tap.fill * 2], buf, n * 2 * sizeof(int32_t));
+    s_tap.fill += n;
+
+    if (s_tap.fill == s_tap.need) {
+        __atomic_store_n(&s_tap.state, TAP_READY, __ATOMIC_RELEASE);
+    }
+}
+
+//--------------------------------------------------------------------+
+// Tables (analysis task, on a rate change)
+//--------------------------------------------------------------------+
+
+float audio_analysis_band_hz(uint8_t band)
+{
+    return BAND_LO_HZ * powf(BAND_HI_HZ / BAND_LO_HZ,
+                             ((float)band + 0.5f) / AUDIO_ANALYSIS_BANDS);
+}
+
+static void analysis_build_tables(uint32_t sample_rate)
+{
+    const uint32_t d = analysis_decim(sample_rate);
+    s_rate = sample_rate;
+    s_decim = d;
+
+    // CIC impulse response: a length-D boxcar convolved with itself
+    // CIC_ORDER times, normalised to unity DC gain and to ±1.0 input
+    float h[CIC_MAX_LEN] = { 1.0f };
+    uint32_t len = 1;
+    for (int k = 0; k < CIC_ORDER; k++) {
+        float t[CIC_MAX_LEN] = { 0 };
+        for (uint32_t i = 0; i < len; i++) {
+            for (uint32_t j = 0; j < d; j++) t[i + j] += h[i];
+        }
+        len += d - 1;
+        memcpy(h, t, sizeof(h));
+    }
+    const float norm = 1.0f / ((float)d * d * d * 2147483648.0f);
+    for (uint32_t i = 0; i < len; i++) s_cic[i] = h[i] * norm;
+    s_cic_len = (uint16_t)len;
+
+    // Band edges in bins; a band narrower than a bin shows the bin
+    // nearest its centre. A full-scale sine in a band reads 0 dB: Hann
+    // puts 3N²/32 of |X|² into one side of the spectrum.
+    const float fs = (float)sample_rate / (float)d;
+    const float bin_hz = fs / FFT_N;
+    const float ratio = BAND_HI_HZ / BAND_LO_HZ;
+    const float hann_norm = 3.0f * FFT_N * FFT_N / 32.0f;
+
+    for (int b = 0; b < AUDIO_ANALYSIS_BANDS; b++) {
+        const float lo = BAND_LO_HZ * powf(ratio, (float)b / AUDIO_ANALYSIS_BANDS);
+        const float hi = BAND_LO_HZ * powf(ratio, (float)(b + 1) / AUDIO_ANALYSIS_BANDS);
+        const float fc = audio_analysis_band_hz(b);
+
+        if (lo >= fs / 2) {
+            s_band_lo[b] = s_band_hi[b] = 0;
+            s_band_scale[b] = 0.0f;
+            continue;
+        }
+        int32_t k0 = (int32_t)ceilf(lo / bin_hz);
+        int32_t k1 = (int32_t)ceilf(hi / bin_hz) - 1;
+        if (k1 > FFT_N / 2 - 1) k1 = FFT_N / 2 - 1;
+        if (k1 < k0) k0 = k1 = (int32_t)lrintf(fc / bin_hz);
+        if (k0 < 1) k0 = 1;
+        if (k1 < k0) k1 = k0;
+        s_band_lo[b] = (uint16_t)k0;
+        s_band_hi[b] = (uint16_t)k1;
+
+        // CIC droop at the band centre, |H(f)|² = (sin(πfD/fs) / (D sin(πf/fs)))^2N
+        float droop = 1.0f;
+        if (d > 1) {
+            const float x = (float)M_PI * fc / (float)sample_rate;
+            const float r = sinf(x * d) / ((float)d * sinf(x));
+            droop = powf(r * r, CIC_ORDER);
+        }
+        // (|Z[k]|² + |Z[N−k]|²) / 4 is the L/R mean power of bin k
+        s_band_scale[b] = 0.25f / (hann_norm * droop);
+    }
+}
+
+//--------------------------------------------------------------------+
+// Analysis
+//--------------------------------------------------------------------+
+
+static float analysis_db(float level)
+{
+    return (level > LEVEL_MIN) ? 20.0f * log10f(level) : AUDIO_ANALYSIS_FLOOR_DB;
+}
+
+/**
+ * @brief Sample peak, RMS and true peak of one channel of the window
+ */
+static void analysis_levels(const int32_t *win, uint32_t frames, bool true_peak,
+                            float *peak_db, float *rms_db, float *tp_db)
+{
+    int64_t peak = 0;
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < frames; i++) {
+        const int32_t x = win[i * 2];
+        const int64_t a = (x < 0) ? -(int64_t)x : x;
+        if (a > peak) peak = a;
+        // 23 significant bits squared: 16 k frames stay inside int64
+        const int64_t s = x >> 8;
+        sum += s * s;
+    }
+    const float peak_lin = (float)peak / 2147483648.0f;
+    *peak_db = analysis_db(peak_lin);
+    *rms_db = analysis_db(sqrtf((float)sum / (float)frames) / 8388608.0f);
+
+    float tp = peak_lin;
+    if (true_peak) {
+        memset(s_tp_buf, 0, TP_HIST * sizeof(float));
+        for (uint32_t done = 0; done < frames; ) {
+            uint32_t n = frames - done;
+            if (n > TP_CHUNK) n = TP_CHUNK;
+            for (uint32_t i = 0; i < n; i++) {
+                s_tp_buf[TP_HIST + i] = (float)win[(done + i) * 2] * (1.0f / 2147483648.0f);
+            }
+            const float p = dsp_limiter_true_peak(s_tp_buf, TP_HIST + n);
+            if (p > tp) tp = p;
+            memmove(s_tp_buf, &s_tp_buf[n], TP_HIST * sizeof(float));
+            done += n;
+        }
+    }
+    *tp_db = analysis_db(tp);
+}
+
+/**
+ * @brief Band levels in dBFS: decimate, window, one complex FFT for both
+ *        channels (L real, R imaginary)
+ */
+static void analysis_spectrum(const int32_t *win, float *band_db)
+{
+    const uint32_t d = s_decim;
+    const uint16_t len = s_cic_len;
+
+    for (uint32_t m = 0; m < FFT_N; m++) {
+        const int32_t *x = &win[m * d * 2];
+        float l = 0.0f, r = 0.0f;
+        for (uint16_t j = 0; j < len; j++) {
+            l += s_cic[j] * (float)x[j * 2];
+            r += s_cic[j] * (float)x[j * 2 + 1];
+        }
+        s_fft[m * 2]     = l * s_hann[m];
+        s_fft[m * 2 + 1] = r * s_hann[m];
+    }
+
+    dsp_fft_forward(&s_plan, s_fft);
+
+    // Z[k] = L[k] + jR[k]: |L[k]|² + |R[k]|² = (|Z[k]|² + |Z[N−k]|²) / 2
+    for (int b = 0; b < AUDIO_ANALYSIS_BANDS; b++) {
+        if (s_band_scale[b] == 0.0f) {
+            band_db[b] = AUDIO_ANALYSIS_FLOOR_DB;
+            continue;
+        }
+        float p = 0.0f;
+        for (uint32_t k = s_band_lo[b]; k <= s_band_hi[b]; k++) {
+            const float *z = &s_fft[k * 2];
+            const float *y = &s_fft[(FFT_N - k) * 2];
+            p += z[0] * z[0] + z[1] * z[1] + y[0] * y[0] + y[1] * y[1];
+        }
+        p *= s_band_scale[b];
+        band_db[b] = (p > LEVEL_MIN * LEVEL_MIN) ? 10.0f * log10f(p) : AUDIO_ANALYSIS_FLOOR_DB;
+    }
+}
+
+// Instant rise, linear fall in dB
+static float analysis_fall(float shown, float now_db, float drop_db)
+{
+    float v = shown - drop_db;
+    if (now_db > v) v = now_db;
+    return (v < AUDIO_ANALYSIS_FLOOR_DB) ? AUDIO_ANALYSIS_FLOOR_DB : v;
+}
+
+/**
+ * @brief One update: measure a ready window (if any), apply ballistics
+ *
+ * Without a window (no audio, or the source stopped) everything falls
+ * towards the floor.
+ */
+static void analysis_update(bool spectrum, float dt_ms)
+{
+    float peak[2], rms[2], tp[2];
+    float bands[AUDIO_ANALYSIS_BANDS];
+    bool got = false;
+
+    for (int ch = 0; ch < 2; ch++) {
+        peak[ch] = rms[ch] = tp[ch] = AUDIO_ANALYSIS_FLOOR_DB;
+    }
+    for (int b = 0; b < AUDIO_ANALYSIS_BANDS; b++) bands[b] = AUDIO_ANALYSIS_FLOOR_DB;
+
+    const uint32_t state = __atomic_load_n(&s_tap.state, __ATOMIC_ACQUIRE);
+    if (state == TAP_READY) {
+        const uint32_t rate = s_tap.rate;
+        const uint32_t frames = s_tap.need;
+        if (rate != s_rate) analysis_build_tables(rate);
+
+        for (int ch = 0; ch < 2; ch++) {
+            analysis_levels(&s_tap.win[ch], frames, rate <= 96000,
+                            &peak[ch], &rms[ch], &tp[ch]);
+        }
+        if (spectrum) analysis_spectrum(s_tap.win, bands);
+        s_res.sample_rate = rate;
+        got = true;
+    }
+    if (state != TAP_ARMED) {
+        s_tap.fill = 0;
+        __atomic_store_n(&s_tap.state, TAP_ARMED, __ATOMIC_RELEASE);
+    }
+
+    const float drop = AUDIO_ANALYSIS_FALL_DB_S * dt_ms / 1000.0f;
+    for (int ch = 0; ch < 2; ch++) {
+        s_res.peak_db[ch] = analysis_fall(s_res.peak_db[ch], peak[ch], drop);
+        s_res.rms_db[ch] = analysis_fall(s_res.rms_db[ch], rms[ch], drop);
+        s_res.true_peak_db[ch] = analysis_fall(s_res.true_peak_db[ch], tp[ch], drop);
+
+        if (tp[ch] >= s_res.hold_db[ch]) {
+            s_res.hold_db[ch] = tp[ch];
+            s_hold_ms[ch] = AUDIO_ANALYSIS_HOLD_MS;
+        } else if (s_hold_ms[ch] > 0.0f) {
+            s_hold_ms[ch] -= dt_ms;
+        } else {
+            s_res.hold_db[ch] = analysis_fall(s_res.hold_db[ch], tp[ch], drop);
+        }
+
+        // Samples at full scale (a 16-bit output tops out 0.0003 dB
+        // below), or a reconstructed peak above it
+        if (peak[ch] > -0.001f || tp[ch] > 0.0f) s_clip_ms = AUDIO_ANALYSIS_HOLD_MS;
+    }
+    s_clip_ms = (s_clip_ms > dt_ms) ? s_clip_ms - dt_ms : 0.0f;
+    s_res.clip = s_clip_ms > 0.0f;
+
+    if (spectrum) {
+        for (int b = 0; b < AUDIO_ANALYSIS_BANDS; b++) {
+            s_res.band_db[b] = analysis_fall(s_res.band_db[b], bands[b], drop);
+        }
+    }
+    // Live once a window went through the FFT; stale as soon as it stops
+    s_res.spectrum_valid = spectrum && (got || s_res.spectrum_valid);
+    s_res.seq++;
+}
+
+static void analysis_publish(void)
+{
+    const uint32_t seq = s_pub_seq;
+    __atomic_store_n(&s_pub_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&s_pub, &s_res, sizeof(s_pub));
+    __atomic_store_n(&s_pub_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static void analysis_task(void *arg)
+{
+    (void)arg;
+    TickType_t last = xTaskGetTickCount();
+
+    for (;;) {
+        const TickType_t since_read =
+            xTaskGetTickCount() - __atomic_load_n(&s_last_read, __ATOMIC_RELAXED);
+        const bool read = since_read < pdMS_TO_TICKS(AUDIO_ANALYSIS_STALE_MS);
+
+        vTaskDelay(pdMS_TO_TICKS(read ? AUDIO_ANALYSIS_PERIOD_MS : AUDIO_ANALYSIS_IDLE_MS));
+
+        const TickType_t now = xTaskGetTickCount();
+        analysis_update(read, (float)((now - last) * portTICK_PERIOD_MS));
+        last = now;
+        analysis_publish();
+    }
+}
+
+//--------------------------------------------------------------------+
+// Public API
+//--------------------------------------------------------------------+
+
+bool audio_analysis_start(void)
+{
+    if (s_tap.win) {
+        return true;
+    }
+
+    s_tap.win = heap_caps_calloc(WIN_MAX * 2, sizeof(int32_t), MALLOC_CAP_SPIRAM);
+    s_fft = heap_caps_malloc(FFT_N * 2 * sizeof(float), MALLOC_CAP_INTERNAL);
+    s_hann = heap_caps_malloc(FFT_N * sizeof(float), MALLOC_CAP_INTERNAL);
+    if (!s_tap.win || !s_fft || !s_hann || !dsp_fft_plan_init(&s_plan, FFT_N)) {
+        ESP_LOGE(TAG, "Out of memory for the analysis window");
+        heap_caps_free(s_tap.win);
+        heap_caps_free(s_fft);
+        heap_caps_free(s_hann);
+        s_tap.win = NULL;
+        s_fft = s_hann = NULL;
+        return false;
+    }
+
+    for (uint32_t i = 0; i < FFT_N; i++) {
+        s_hann[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * (float)i / FFT_N);
+    }
+    for (int ch = 0; ch < 2; ch++) {
+        s_res.peak_db[ch] = s_res.rms_db[ch] = AUDIO_ANALYSIS_FLOOR_DB;
+        s_res.true_peak_db[ch] = s_res.hold_db[ch] = AUDIO_ANALYSIS_FLOOR_DB;
+    }
+    for (int b = 0; b < AUDIO_ANALYSIS_BANDS; b++) s_res.band_db[b] = AUDIO_ANALYSIS_FLOOR_DB;
+    // Start idle: nobody has read yet
+    s_last_read = xTaskGetTickCount() - pdMS_TO_TICKS(AUDIO_ANALYSIS_STALE_MS);
+
+    BaseType_t ret = xTaskCreatePinnedToCore(analysis_task, "analysis",
+                                             ANALYSIS_TASK_STACK, NULL,
+                                             ANALYSIS_TASK_PRIO, NULL, 0);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create analysis task");
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Post-DSP analysis: %u-point FFT, %u bands, %u KB window",
+             FFT_N, AUDIO_ANALYSIS_BANDS,
+             (unsigned)(WIN_MAX * 2 * sizeof(int32_t) / 1024));
+    return true;
+}
+
+bool audio_analysis_get(audio_analysis_t *out)
+{
+    __atomic_store_n(&s_last_read, xTaskGetTickCount(), __ATOMIC_RELAXED);
+
+    // The writer runs on the same core at a lower priority: if it was
+    // preempted mid-copy, retrying here would spin on it. Give up instead.
+    for (int tries = 0; tries < 2; tries++) {
+        const uint32_t seq = __atomic_load_n(&s_pub_seq, __ATOMIC_ACQUIRE);
+        if (seq == 0 || (seq & 1)) {
+            return false;
+        }
+        audio_analysis_t copy;
+        memcpy(&copy, &s_pub, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&s_pub_seq, __ATOMIC_RELAXED) == seq) {
+            *out = copy;
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,6 +1,14 @@
 #include "audio_pipeline.h"
+#include "audio_analysis.h"
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
 #include <esp_log.h>
+#include <esp_cpu.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "audio_trace.h"
+#include "dsd2pcm.h"
 
 static const char *TAG = "audio_pipeline";
 
@@ -10,6 +18,26 @@ static const char *TAG = "audio_pipeline";
 
 static dsp_chain_t g_dsp_chain;
 static bool g_initialized = false;
+static uint32_t g_out_rate;                 // I2S rate; the chain runs at g_out_rate / g_os_factor
+static uint8_t g_os_factor = 1;
+static dsp_os_phase_t g_os_phase = DSP_OS_PHASE_LINEAR;
+
+// Serializes every dsp_chain writer. The coefficient triple buffer has a
+// single writer, and setters run from the CDC/UI tasks, the USB audio
+// task (format changes) and the source switch: two publishes at once
+// would hand the same slot to both sides for good.
+static SemaphoreHandle_t g_lock;
+static StaticSemaphore_t g_lock_buf;
+
+static void pipeline_lock(void)
+{
+    if (g_lock) xSemaphoreTake(g_lock, portMAX_DELAY);
+}
+
+static void pipeline_unlock(void)
+{
+    if (g_lock) xSemaphoreGive(g_lock);
+}
 
 //--------------------------------------------------------------------+
 // Initialization
@@ -26,8 +54,11 @@ void audio_pipeline_init(uint32_t sample_rate, uint8_t bits_per_sample)
         .channels = 2,  // stereo
     };
 
+    g_lock = xSemaphoreCreateMutexStatic(&g_lock_buf);
+
     // Initialize DSP chain
     dsp_chain_init(&g_dsp_chain, &format);
+    g_out_rate = sample_rate;
 
     // Load default preset (Flat = bypass)
     dsp_chain_load_preset(&g_dsp_chain, PRESET_FLAT);
@@ -49,7 +80,10 @@ bool audio_pipeline_set_preset(eq_preset_t preset)
     }
 
     ESP_LOGI(TAG, "Setting preset: %s", preset_get_name(preset));
-    return dsp_chain_load_preset(&g_dsp_chain, preset);
+    pipeline_lock();
+    bool ok = dsp_chain_load_preset(&g_dsp_chain, preset);
+    pipeline_unlock();
+    return ok;
 }
 
 eq_preset_t audio_pipeline_get_preset(void)
@@ -63,7 +97,9 @@ eq_preset_t audio_pipeline_get_preset(void)
 
 void audio_pipeline_set_enabled(bool enable)
 {
+    pipeline_lock();
     dsp_chain_set_bypass(&g_dsp_chain, !enable);
+    pipeline_unlock();
     ESP_LOGI(TAG, "DSP processing: %s", enable ? "ENABLED" : "DISABLED (bypass)");
 }
 
@@ -74,7 +110,9 @@ bool audio_pipeline_is_enabled(void)
 
 void audio_pipeline_set_limiter_mode(dsp_limiter_mode_t mode)
 {
+    pipeline_lock();
     dsp_chain_set_limiter_mode(&g_dsp_chain, mode);
+    pipeline_unlock();
 }
 
 dsp_limiter_mode_t audio_pipeline_get_limiter_mode(void)
@@ -82,9 +120,51 @@ dsp_limiter_mode_t audio_pipeline_get_limiter_mode(void)
     return dsp_chain_get_limiter_mode(&g_dsp_chain);
 }
 
+void audio_pipeline_set_kernel_mode(dsp_kernel_mode_t mode)
+{
+    pipeline_lock();
+    dsp_chain_set_kernel_mode(&g_dsp_chain, mode);
+    pipeline_unlock();
+}
+
+dsp_kernel_mode_t audio_pipeline_get_kernel_mode(void)
+{
+    return dsp_chain_get_kernel_mode(&g_dsp_chain);
+}
+
+bool audio_pipeline_update_quality(void)
+{
+    if (!g_initialized) {
+        return false;
+    }
+    pipeline_lock();
+    bool changed = dsp_chain_update_quality(&g_dsp_chain);
+    pipeline_unlock();
+    return changed;
+}
+
+void audio_pipeline_set_quality_adaptive(bool enabled)
+{
+    pipeline_lock();
+    dsp_chain_set_quality_adaptive(&g_dsp_chain, enabled);
+    pipeline_unlock();
+}
+
+bool audio_pipeline_get_quality_adaptive(void)
+{
+    return dsp_chain_get_quality_adaptive(&g_dsp_chain);
+}
+
+dsp_quality_t audio_pipeline_get_quality(void)
+{
+    return dsp_chain_get_quality(&g_dsp_chain);
+}
+
 void audio_pipeline_set_crossfeed(bool enabled)
 {
+    pipeline_lock();
     dsp_chain_set_crossfeed(&g_dsp_chain, enabled);
+    pipeline_unlock();
 }
 
 bool audio_pipeline_get_crossfeed(void)
@@ -92,9 +172,67 @@ bool audio_pipeline_get_crossfeed(void)
     return dsp_chain_get_crossfeed(&g_dsp_chain);
 }
 
+void audio_pipeline_set_loudness(bool enabled)
+{
+    pipeline_lock();
+    dsp_chain_set_loudness(&g_dsp_chain, enabled);
+    pipeline_unlock();
+}
+
+bool audio_pipeline_get_loudness(void)
+{
+    return dsp_chain_get_loudness(&g_dsp_chain);
+}
+
+void audio_pipeline_set_listening_level(float volume_db)
+{
+    dsp_chain_set_listening_level(&g_dsp_chain, volume_db);
+}
+
+float audio_pipeline_get_listening_level(void)
+{
+    return dsp_chain_get_listening_level(&g_dsp_chain);
+}
+
+void audio_pipeline_set_volume(float volume_db)
+{
+    dsp_chain_set_volume(&g_dsp_chain, volume_db);
+    dsp_chain_set_listening_level(&g_dsp_chain, volume_db);
+}
+
+float audio_pipeline_get_volume(void)
+{
+    return dsp_chain_get_volume(&g_dsp_chain);
+}
+
+void audio_pipeline_set_mute(bool muted)
+{
+    dsp_chain_set_mute(&g_dsp_chain, muted);
+}
+
+bool audio_pipeline_get_mute(void)
+{
+    return dsp_chain_get_mute(&g_dsp_chain);
+}
+
+void audio_pipeline_set_dither(dsp_dither_t dither)
+{
+    pipeline_lock();
+    dsp_chain_set_dither(&g_dsp_chain, dither);
+    pipeline_unlock();
+}
+
+dsp_dither_t audio_pipeline_get_dither(void)
+{
+    return dsp_chain_get_dither(&g_dsp_chain);
+}
+
 bool audio_pipeline_set_user_band(uint8_t band, const biquad_params_t *params)
 {
-    return dsp_chain_set_user_band(&g_dsp_chain, band, params);
+    pipeline_lock();
+    bool ok = dsp_chain_set_user_band(&g_dsp_chain, band, params);
+    pipeline_unlock();
+    return ok;
 }
 
 uint8_t audio_pipeline_get_user_band_count(void)
@@ -111,6 +249,21 @@ const biquad_params_t *audio_pipeline_get_user_band(uint8_t band)
 // Format Updates
 //--------------------------------------------------------------------+
 
+/**
+ * @brief Rate the chain runs at: the I2S rate before oversampling
+ *
+ * Falls back to the I2S rate if it does not divide (I2S refused the
+ * oversampled rate and fell back to a base one).
+ */
+static uint32_t pipeline_dsp_rate(void)
+{
+    if (g_os_factor > 1 && g_out_rate % g_os_factor == 0 &&
+        g_out_rate / g_os_factor >= 32000) {
+        return g_out_rate / g_os_factor;
+    }
+    return g_out_rate;
+}
+
 void audio_pipeline_update_format(uint32_t sample_rate, uint8_t bits_per_sample)
 {
     if (!g_initialized) {
@@ -118,16 +271,59 @@ void audio_pipeline_update_format(uint32_t sample_rate, uint8_t bits_per_sample)
         return;
     }
 
-    ESP_LOGI(TAG, "Format change: %lu Hz -> %lu Hz, %d-bit",
-             g_dsp_chain.format.sample_rate, sample_rate, bits_per_sample);
-
+    pipeline_lock();
+    g_out_rate = sample_rate;
     audio_format_t format = {
-        .sample_rate = sample_rate,
+        .sample_rate = pipeline_dsp_rate(),
         .bits_per_sample = bits_per_sample,
         .channels = 2,
     };
 
+    if (format.sample_rate != sample_rate) {
+        ESP_LOGI(TAG, "Format change: %lu Hz -> %lu Hz (%ux oversampled to %lu Hz), %d-bit",
+                 g_dsp_chain.format.sample_rate, format.sample_rate, g_os_factor,
+                 sample_rate, bits_per_sample);
+    } else {
+        ESP_LOGI(TAG, "Format change: %lu Hz -> %lu Hz, %d-bit",
+                 g_dsp_chain.format.sample_rate, sample_rate, bits_per_sample);
+    }
+
     dsp_chain_update_format(&g_dsp_chain, &format);
+    pipeline_unlock();
+}
+
+void audio_pipeline_set_oversampling(uint8_t factor, dsp_os_phase_t phase)
+{
+    if (!g_initialized) {
+        return;
+    }
+    if (factor < 1) factor = 1;
+
+    pipeline_lock();
+    if (factor == g_os_factor && (factor == 1 || phase == g_os_phase)) {
+        pipeline_unlock();
+        return;
+    }
+
+    g_os_factor = factor;
+    g_os_phase = phase;
+    // Budget units are per channel: half of the stereo frame cost
+    const uint16_t cycles = (factor > 1) ? (dsp_os_cycles_per_frame(factor, phase) + 1) / 2 : 0;
+    dsp_chain_set_oversampling(&g_dsp_chain, factor, cycles);
+
+    // Same I2S rate, different split between DSP and oversampler
+    const uint32_t rate = pipeline_dsp_rate();
+    if (rate != g_dsp_chain.format.sample_rate) {
+        audio_format_t format = g_dsp_chain.format;
+        format.sample_rate = rate;
+        dsp_chain_update_format(&g_dsp_chain, &format);
+    }
+    pipeline_unlock();
+}
+
+uint8_t audio_pipeline_get_oversampling(void)
+{
+    return g_os_factor;
 }
 
 //--------------------------------------------------------------------+
@@ -142,7 +338,12 @@ void audio_pipeline_process(int32_t *buffer, uint32_t frames)
     }
 
     // Process through DSP chain
+    AUDIO_TRACE_BEGIN(AUDIO_TRACE_DSP);
     dsp_chain_process(&g_dsp_chain, buffer, frames);
+    AUDIO_TRACE_END(AUDIO_TRACE_DSP, frames);
+
+    // Meters and spectrum see what leaves the chain (a copy, only when armed)
+    audio_analysis_tap(buffer, frames, g_dsp_chain.format.sample_rate);
 }
 
 //--------------------------------------------------------------------+
@@ -151,7 +352,7 @@ void audio_pipeline_process(int32_t *buffer, uint32_t frames)
 
 void audio_pipeline_get_format(uint32_t *sample_rate, uint8_t *bits_per_sample)
 {
-    if (sample_rate) *sample_rate = g_dsp_chain.format.sample_rate;
+    if (sample_rate) *sample_rate = g_out_rate;
     if (bits_per_sample) *bits_per_sample = g_dsp_chain.format.bits_per_sample;
 }
 
@@ -178,10 +379,618 @@ void audio_pipeline_print_stats(void)
     ESP_LOGI(TAG, "Preset: %s", preset_name);
     ESP_LOGI(TAG, "Active filters: %d", g_dsp_chain.num_biquads);
     ESP_LOGI(TAG, "Crossfeed: %s", g_dsp_chain.crossfeed_enabled ? "ON" : "OFF");
+    ESP_LOGI(TAG, "Loudness: %s (level %.1f dB)", g_dsp_chain.loudness_enabled ? "ON" : "OFF",
+             dsp_chain_get_listening_level(&g_dsp_chain));
+    ESP_LOGI(TAG, "Volume: %.1f dB%s, dither %s (%u-bit output)",
+             dsp_chain_get_volume(&g_dsp_chain),
+             dsp_chain_get_mute(&g_dsp_chain) ? " (muted)" : "",
+             dsp_dither_name(dsp_chain_get_dither(&g_dsp_chain)),
+             (g_dsp_chain.format.bits_per_sample <= 16) ? 16 : 32);
     ESP_LOGI(TAG, "Bypass: %s", g_dsp_chain.bypass ? "YES" : "NO");
-    ESP_LOGI(TAG, "CPU usage: %.1f%%", stats->cpu_usage_percent);
+    ESP_LOGI(TAG, "DSP load: %.1f%% of block deadline, %lu overruns, quality %s",
+             stats->cpu_usage_percent, stats->buffer_underruns,
+             dsp_chain_quality_name(dsp_chain_get_quality(&g_dsp_chain)));
+    dsp_prof_stats_t total;
+    dsp_chain_get_stage_stats(&g_dsp_chain, g_dsp_chain.format.sample_rate,
+                              DSP_STAGE_TOTAL, &total);
+    if (total.count) {
+        ESP_LOGI(TAG, "Measured: p50 %.1f / p99 %.1f / max %.1f cyc/sample (%lu blocks)",
+                 total.p50, total.p99, total.max, (unsigned long)total.count);
+    }
     ESP_LOGI(TAG, "Format: %lu Hz, %d-bit, %d ch",
              g_dsp_chain.format.sample_rate,
              g_dsp_chain.format.bits_per_sample,
              g_dsp_chain.format.channels);
+    if (g_os_factor > 1) {
+        ESP_LOGI(TAG, "Oversampling: %ux %s -> %lu Hz, %u cyc/sample reserved",
+                 g_os_factor, dsp_os_phase_name(g_os_phase), g_out_rate,
+                 g_dsp_chain.os_cycles);
+    }
+}
+
+void audio_pipeline_get_budget(dsp_budget_t *budget)
+{
+    pipeline_lock();
+    dsp_chain_get_budget(&g_dsp_chain, budget);
+    pipeline_unlock();
+}
+
+bool audio_pipeline_get_stage_stats(uint32_t sample_rate, dsp_stage_t stage,
+                                    dsp_prof_stats_t *out)
+{
+    return dsp_chain_get_stage_stats(&g_dsp_chain, sample_rate, stage, out);
+}
+
+void audio_pipeline_reset_profile(void)
+{
+    dsp_chain_reset_profile(&g_dsp_chain);
+}
+
+//--------------------------------------------------------------------+
+// FIR Convolution
+//--------------------------------------------------------------------+
+
+bool audio_pipeline_load_fir(const char *path, uint16_t block)
+{
+    if (!g_initialized) {
+        ESP_LOGE(TAG, "Pipeline not initialized");
+        return false;
+    }
+
+    dsp_conv_t *conv = dsp_conv_load_file(path, block ? block : DSP_CONV_BLOCK_DEFAULT);
+    if (!conv) {
+        return false;
+    }
+
+    pipeline_lock();
+    bool ok = dsp_chain_set_convolver(&g_dsp_chain, conv);
+    pipeline_unlock();
+    if (!ok) {
+        dsp_conv_destroy(conv);
+        return false;
+    }
+    return true;
+}
+
+void audio_pipeline_clear_fir(void)
+{
+    pipeline_lock();
+    dsp_chain_set_convolver(&g_dsp_chain, NULL);
+    pipeline_unlock();
+}
+
+//--------------------------------------------------------------------+
+// Benchmarks
+//--------------------------------------------------------------------+
+
+#define BENCH_PASSES 16
+
+static biquad_filter_t s_bench_ref[DSP_MAX_BIQUADS];
+static biquad_filter_t s_bench_cas[DSP_MAX_BIQUADS];
+static biquad_q31_t s_bench_q31[DSP_MAX_BIQUADS];
+static double s_bench_dbl_coef[DSP_MAX_BIQUADS][5];
+static double s_bench_dbl_w[DSP_MAX_BIQUADS][2];
+static float s_bench_ref_L[DSP_CHUNK_FRAMES], s_bench_ref_R[DSP_CHUNK_FRAMES];
+static float s_bench_cas_L[DSP_CHUNK_FRAMES], s_bench_cas_R[DSP_CHUNK_FRAMES];
+static int32_t s_bench_q31_L[DSP_CHUNK_FRAMES], s_bench_q31_R[DSP_CHUNK_FRAMES];
+static double s_bench_dbl[DSP_CHUNK_FRAMES];
+
+static void bench_fill(float *L, float *R, uint32_t seed)
+{
+    // xorshift32 noise at -6 dBFS — deterministic, no libc rand()
+    for (uint32_t i = 0; i < DSP_CHUNK_FRAMES; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        L[i] = (float)(int32_t)seed * (0.5f / 2147483648.0f);
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        R[i] = (float)(int32_t)seed * (0.5f / 2147483648.0f);
+    }
+}
+
+void audio_pipeline_bench_biquads(uint8_t num_filters, audio_pipeline_bench_t *out)
+{
+    if (num_filters > DSP_MAX_BIQUADS) num_filters = DSP_MAX_BIQUADS;
+
+    // Spread peaking bands over the audio range at the current rate. The
+    // Q31 bank and the double reference share the Q3.28 coefficients; the
+    // float kernel's own coefficient rounding counts as part of its error.
+    uint32_t fs = g_dsp_chain.format.sample_rate ? g_dsp_chain.format.sample_rate : 48000;
+    uint8_t num_q31 = 0;
+    for (uint8_t i = 0; i < num_filters; i++) {
+        biquad_params_t p = {
+            .type = BIQUAD_PEAK,
+            .freq = 31.25f * (float)(1u << (i % 10)),
+            .gain = (i & 1) ? -3.0f : 4.0f,
+            .q = 1.0f,
+            .sample_rate = fs,
+        };
+        biquad_init(&s_bench_ref[i], &p);
+        s_bench_cas[i] = s_bench_ref[i];
+
+        biquad_q31_t *q = &s_bench_q31[num_q31];
+        if (biquad_calculate_coeffs_q31(q->coef, &p)) {
+            biquad_q31_reset(q);
+            for (int k = 0; k < 5; k++) {
+                s_bench_dbl_coef[num_q31][k] = (double)q->coef[k] / (double)(1 << BIQUAD_Q31_FRAC);
+            }
+            s_bench_dbl_w[num_q31][0] = s_bench_dbl_w[num_q31][1] = 0.0;
+            num_q31++;
+        }
+    }
+
+    uint32_t best_ref = UINT32_MAX, best_cas = UINT32_MAX, best_q31 = UINT32_MAX;
+    bool identical = true;
+    double sig = 0.0, err_float = 0.0, err_q31 = 0.0;
+
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        bench_fill(s_bench_ref_L, s_bench_ref_R, 0x1234567u + pass);
+        memcpy(s_bench_cas_L, s_bench_ref_L, sizeof(s_bench_cas_L));
+        memcpy(s_bench_cas_R, s_bench_ref_R, sizeof(s_bench_cas_R));
+        for (uint32_t i = 0; i < DSP_CHUNK_FRAMES; i++) {
+            // Same samples; the cascade takes the chain's headroom
+            s_bench_q31_L[i] = (int32_t)(s_bench_ref_L[i] * 2147483648.0f);
+            s_bench_q31_R[i] = (int32_t)(s_bench_ref_R[i] * 2147483648.0f);
+            s_bench_dbl[i] = (double)s_bench_q31_L[i];
+        }
+
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        for (uint8_t i = 0; i < num_filters; i++) {
+            biquad_process_mono(s_bench_ref_L, DSP_CHUNK_FRAMES,
+                                s_bench_ref[i].coef, s_bench_ref[i].w[0]);
+            biquad_process_mono(s_bench_ref_R, DSP_CHUNK_FRAMES,
+                                s_bench_ref[i].coef, s_bench_ref[i].w[1]);
+        }
+        uint32_t t1 = esp_cpu_get_cycle_count();
+        biquad_cascade_process(s_bench_cas, num_filters,
+                               s_bench_cas_L, s_bench_cas_R, DSP_CHUNK_FRAMES);
+        uint32_t t2 = esp_cpu_get_cycle_count();
+        biquad_cascade_process_q31(s_bench_q31, num_q31,
+                                   s_bench_q31_L, s_bench_q31_R, DSP_CHUNK_FRAMES,
+                                   DSP_Q31_HEADROOM);
+        uint32_t t3 = esp_cpu_get_cycle_count();
+
+        if (t1 - t0 < best_ref) best_ref = t1 - t0;
+        if (t2 - t1 < best_cas) best_cas = t2 - t1;
+        if (t3 - t2 < best_q31) best_q31 = t3 - t2;
+
+        if (memcmp(s_bench_ref_L, s_bench_cas_L, sizeof(s_bench_cas_L)) != 0 ||
+            memcmp(s_bench_ref_R, s_bench_cas_R, sizeof(s_bench_cas_R)) != 0) {
+            identical = false;
+        }
+
+        // Double-precision DFII-T reference (untimed, soft-float)
+        for (uint8_t k = 0; k < num_q31; k++) {
+            const double *c = s_bench_dbl_coef[k];
+            double w0 = s_bench_dbl_w[k][0], w1 = s_bench_dbl_w[k][1];
+            for (uint32_t i = 0; i < DSP_CHUNK_FRAMES; i++) {
+                const double x = s_bench_dbl[i];
+                const double y = c[0] * x + w0;
+                w0 = c[1] * x - c[3] * y + w1;
+                w1 = c[2] * x - c[4] * y;
+                s_bench_dbl[i] = y;
+            }
+            s_bench_dbl_w[k][0] = w0;
+            s_bench_dbl_w[k][1] = w1;
+        }
+
+        const double int_to_float = 1.0 / 2147483648.0;
+        const double q31_to_float = 1.0 / (double)(1u << (31 - DSP_Q31_HEADROOM));
+        for (uint32_t i = 0; i < DSP_CHUNK_FRAMES; i++) {
+            const double ref = s_bench_dbl[i] * int_to_float;
+            const double ef = (double)s_bench_cas_L[i] - ref;
+            const double eq = (double)s_bench_q31_L[i] * q31_to_float - ref;
+            sig += ref * ref;
+            err_float += ef * ef;
+            err_q31 += eq * eq;
+        }
+    }
+
+    out->num_filters = num_filters;
+    out->frames = DSP_CHUNK_FRAMES;
+    out->ref_cycles_per_frame = (float)best_ref / DSP_CHUNK_FRAMES;
+    out->cascade_cycles_per_frame = (float)best_cas / DSP_CHUNK_FRAMES;
+    out->identical = identical;
+    out->q31_cycles_per_frame = (float)best_q31 / DSP_CHUNK_FRAMES;
+    out->q31_sections = num_q31;
+    // The reference only covers the sections that fit Q3.28
+    const bool comparable = (num_q31 == num_filters) && sig > 0.0;
+    out->float_snr_db = (comparable && err_float > 0.0) ? (float)(10.0 * log10(sig / err_float)) : 0.0f;
+    out->q31_snr_db = (comparable && err_q31 > 0.0) ? (float)(10.0 * log10(sig / err_q31)) : 0.0f;
+
+    ESP_LOGI(TAG, "Biquad bench: %u filters, ref %.1f cyc/frame, cascade %.1f cyc/frame, %s",
+             num_filters, out->ref_cycles_per_frame, out->cascade_cycles_per_frame,
+             identical ? "bit-identical" : "MISMATCH");
+    ESP_LOGI(TAG, "Biquad bench: Q31 %u sections %.1f cyc/frame, SNR float %.1f dB / Q31 %.1f dB",
+             num_q31, out->q31_cycles_per_frame, out->float_snr_db, out->q31_snr_db);
+}
+
+void audio_pipeline_bench_conv(uint16_t block, uint32_t taps, audio_pipeline_conv_bench_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->block = block;
+    out->taps = taps;
+    out->model_cycles = dsp_conv_cycles_per_sample(block, taps);
+
+    float *ir = malloc(taps * sizeof(float));
+    if (!ir) return;
+
+    // Decaying noise, same response on both channels
+    uint32_t seed = 0x2468ace1u;
+    float env = 0.5f;
+    for (uint32_t i = 0; i < taps; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        ir[i] = (float)(int32_t)seed * (env / 2147483648.0f);
+        env *= 0.999f;
+    }
+
+    uint32_t fs = g_dsp_chain.format.sample_rate ? g_dsp_chain.format.sample_rate : 48000;
+    dsp_conv_t *conv = dsp_conv_create(ir, ir, taps, block, fs);
+    free(ir);
+    if (!conv) return;
+
+    // Whole blocks only, so every pass runs the same number of FFTs
+    const uint32_t frames = DSP_CHUNK_FRAMES >= block ? DSP_CHUNK_FRAMES : block;
+    const uint32_t passes = (block > DSP_CHUNK_FRAMES) ? 4 : 4 * (DSP_CHUNK_FRAMES / block);
+    uint64_t total = 0;
+
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        for (uint32_t off = 0; off < frames; off += DSP_CHUNK_FRAMES) {
+            uint32_t n = frames - off;
+            if (n > DSP_CHUNK_FRAMES) n = DSP_CHUNK_FRAMES;
+            bench_fill(s_bench_ref_L, s_bench_ref_R, 0x55aa55aau + pass + off);
+            uint32_t t0 = esp_cpu_get_cycle_count();
+            dsp_conv_process(conv, s_bench_ref_L, s_bench_ref_R, n);
+            total += esp_cpu_get_cycle_count() - t0;
+        }
+    }
+    dsp_conv_destroy(conv);
+
+    // Budget units: one sample of one channel
+    out->cycles_per_sample = (float)total / (float)(passes * frames * 2);
+    out->ok = true;
+
+    ESP_LOGI(TAG, "Conv bench: block %u, %lu taps: %.1f cyc/sample (model %u)",
+             block, (unsigned long)taps, out->cycles_per_sample, out->model_cycles);
+}
+
+// Output frames fitted per test tone
+#define SRC_BENCH_FRAMES  2048
+#define SRC_BENCH_TONES   8
+#define SRC_BENCH_AMP     0.5
+
+/**
+ * @brief Fill stereo frames with a sine of w radians per frame
+ */
+static void bench_tone(int32_t *in, uint32_t frames, double w)
+{
+    // Rotating phasor (double: drift far below the fit)
+    double c = 1.0, s = 0.0;
+    const double wc = cos(w), ws = sin(w);
+    for (uint32_t i = 0; i < frames; i++) {
+        int32_t v = (int32_t)(s * SRC_BENCH_AMP * 2147483647.0);
+        in[2 * i] = v;
+        in[2 * i + 1] = v;
+        const double cn = c * wc - s * ws;
+        s = s * wc + c * ws;
+        c = cn;
+    }
+}
+
+/**
+ * @brief Least-squares fit y ≈ a·sin + b·cos over SRC_BENCH_FRAMES frames
+ *
+ * @param amp   Fitted amplitude (full scale = 1)
+ * @param resid RMS of what the fit leaves over, as a peak amplitude
+ */
+static void bench_fit_tone(const int32_t *y, double w, double *amp, double *resid)
+{
+    const double oc = cos(w), os = sin(w);
+    double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0, yy = 0;
+    double c = 1.0, s = 0.0;
+    for (uint32_t i = 0; i < SRC_BENCH_FRAMES; i++) {
+        const double v = y[2 * i] / 2147483648.0;
+        ss += s * s; cc += c * c; sc += s * c;
+        ys += v * s; yc += v * c; yy += v * v;
+        const double cn = c * oc - s * os;
+        s = s * oc + c * os;
+        c = cn;
+    }
+    const double det = ss * cc - sc * sc;
+    const double a = (ys * cc - yc * sc) / det;
+    const double b = (yc * ss - ys * sc) / det;
+    const double fitted = a * ys + b * yc;     // energy explained by the fit
+    const double left = (yy > fitted) ? yy - fitted : 0.0;
+
+    *amp = sqrt(a * a + b * b);
+    *resid = sqrt(2.0 * left / SRC_BENCH_FRAMES);
+}
+
+/**
+ * @brief Resample one tone and fit a sine of the same frequency to the output
+ *
+ * @param amp   Fitted amplitude (full scale = 1)
+ * @param resid RMS of what the fit leaves over, as a peak amplitude
+ * @return false if the converter produced too few frames
+ */
+static bool bench_src_tone(dsp_src_t *src, double freq, int32_t *in, uint32_t in_frames,
+                           int32_t *out, uint32_t skip, uint64_t *cycles, uint32_t *frames,
+                           double *amp, double *resid)
+{
+    const uint32_t in_rate = dsp_src_get_in_rate(src);
+    const uint32_t out_rate = dsp_src_get_out_rate(src);
+
+    bench_tone(in, in_frames, 2.0 * M_PI * freq / in_rate);
+
+    // Fed in decoder-sized chunks, like the producer engine does
+    dsp_src_reset(src);
+    const uint32_t want = skip + SRC_BENCH_FRAMES;
+    uint32_t produced = 0, pos = 0;
+    while (produced < want && pos < in_frames) {
+        uint32_t n = in_frames - pos;
+        if (n > 1152) n = 1152;
+        uint32_t used = 0;
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        uint32_t got = dsp_src_process(src, in + 2 * pos, n, out + 2 * produced,
+                                       want - produced, &used);
+        *cycles += esp_cpu_get_cycle_count() - t0;
+        *frames += got;
+        produced += got;
+        pos += used;
+        if (!got && !used) break;
+    }
+    if (produced < want) return false;
+
+    bench_fit_tone(out + 2 * skip, 2.0 * M_PI * freq / out_rate, amp, resid);
+    return true;
+}
+
+void audio_pipeline_bench_src(uint32_t in_rate, uint32_t out_rate, dsp_src_quality_t quality,
+                              audio_pipeline_src_bench_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->in_rate = in_rate;
+    out->out_rate = out_rate;
+    out->quality = quality;
+    out->model_cycles = dsp_src_cycles_per_frame(in_rate, out_rate, quality);
+
+    dsp_src_t *src = dsp_src_create(in_rate, out_rate, quality);
+    if (!src) return;
+    out->taps = dsp_src_get_taps(src);
+    out->passband_hz = dsp_src_get_passband(src);
+
+    // Skip the start-up transient (one filter length at the output rate)
+    const uint32_t skip = (uint32_t)((uint64_t)out->taps * out_rate / in_rate) + 16;
+    const uint32_t in_frames = dsp_src_input_needed(src, skip + SRC_BENCH_FRAMES) + 16;
+    int32_t *in = malloc((size_t)in_frames * 2 * sizeof(int32_t));
+    int32_t *res = malloc((size_t)(skip + SRC_BENCH_FRAMES) * 2 * sizeof(int32_t));
+    if (!in || !res) {
+        free(in);
+        free(res);
+        dsp_src_destroy(src);
+        return;
+    }
+
+    uint64_t cycles = 0;
+    uint32_t frames = 0;
+    double gmin = 1e9, gmax = -1e9, worst = 0.0;
+    bool ok = true;
+
+    // Passband: gain flatness + residual (images / aliases / noise)
+    for (int k = 1; k <= SRC_BENCH_TONES && ok; k++) {
+        double amp, resid;
+        double f = out->passband_hz * k / SRC_BENCH_TONES;
+        ok = bench_src_tone(src, f, in, in_frames, res, skip, &cycles, &frames, &amp, &resid);
+        const double g = 20.0 * log10(amp / SRC_BENCH_AMP);
+        if (g < gmin) gmin = g;
+        if (g > gmax) gmax = g;
+        if (resid > worst) worst = resid;
+    }
+
+    // Downsampling: tones between out_rate − passband and in_rate / 2
+    // fold back into the passband and must come out as nothing (none
+    // exist for small ratios like 48k → 44.1k)
+    const double lo = out_rate - out->passband_hz;
+    const double hi = (in_rate < 2 * out_rate ? in_rate : 2.0 * out_rate) * 0.5;
+    if (in_rate > out_rate && lo < hi) {
+        for (int k = 0; k < SRC_BENCH_TONES && ok; k++) {
+            double amp, resid;
+            double f = lo + (hi - lo) * (k + 0.5) / SRC_BENCH_TONES;
+            ok = bench_src_tone(src, f, in, in_frames, res, skip, &cycles, &frames, &amp, &resid);
+            // Everything at the output is alias: fitted + residual
+            const double total = sqrt(amp * amp + resid * resid);
+            if (total > worst) worst = total;
+        }
+    }
+
+    free(in);
+    free(res);
+    dsp_src_destroy(src);
+    if (!ok || frames == 0) return;
+
+    out->cycles_per_frame = (float)cycles / (float)frames;
+    out->ripple_db = (float)(gmax - gmin);
+    out->rejection_db = (worst > 0.0) ? (float)(-20.0 * log10(worst / SRC_BENCH_AMP)) : 200.0f;
+    out->ok = true;
+
+    ESP_LOGI(TAG, "SRC bench: %lu → %lu Hz %s, %u taps: %.1f cyc/frame (model %u), "
+             "ripple %.4f dB, rejection %.1f dB",
+             (unsigned long)in_rate, (unsigned long)out_rate, dsp_src_quality_name(quality),
+             out->taps, out->cycles_per_frame, out->model_cycles,
+             out->ripple_db, out->rejection_db);
+}
+
+// Input frames per call: one 2048-frame ring block at 8x
+#define OS_BENCH_CALL     256
+
+void audio_pipeline_bench_os(uint8_t factor, dsp_os_phase_t phase,
+                             audio_pipeline_os_bench_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->factor = factor;
+    out->phase = phase;
+    out->model_cycles = dsp_os_cycles_per_frame(factor, phase);
+
+    dsp_os_t *os = dsp_os_create(factor, phase);
+    if (!os) return;
+    for (uint8_t st = 0; (1u << st) < factor; st++) {
+        out->taps[out->stages++] = dsp_os_get_taps(os, st);
+    }
+    out->latency_frames = dsp_os_get_latency(os);
+
+    // Skip the start-up transient (every stage's length, at the input rate)
+    const uint32_t skip_in = out->taps[0] + 16;
+    const uint32_t in_frames = skip_in + SRC_BENCH_FRAMES / factor + 1;
+    int32_t *in = malloc((size_t)in_frames * 2 * sizeof(int32_t));
+    int32_t *res = malloc((size_t)in_frames * factor * 2 * sizeof(int32_t));
+    if (!in || !res) {
+        free(in);
+        free(res);
+        dsp_os_destroy(os);
+        return;
+    }
+
+    uint64_t cycles = 0;
+    uint32_t frames = 0;
+    double gmin = 1e9, gmax = -1e9, worst = 0.0;
+
+    // Tones over the passband (normalised to the input rate): gain
+    // flatness, and the residual is every image the cascade let through
+    for (int k = 1; k <= SRC_BENCH_TONES; k++) {
+        const double w = 2.0 * M_PI * DSP_OS_PASSBAND * k / SRC_BENCH_TONES;
+        bench_tone(in, in_frames, w);
+
+        dsp_os_reset(os);
+        for (uint32_t pos = 0; pos < in_frames; pos += OS_BENCH_CALL) {
+            uint32_t n = in_frames - pos;
+            if (n > OS_BENCH_CALL) n = OS_BENCH_CALL;
+            uint32_t t0 = esp_cpu_get_cycle_count();
+            dsp_os_process(os, in + 2 * pos, n, res + 2 * pos * factor);
+            cycles += esp_cpu_get_cycle_count() - t0;
+            frames += n;
+        }
+
+        double amp, resid;
+        bench_fit_tone(res + 2 * skip_in * factor, w / factor, &amp, &resid);
+        const double g = 20.0 * log10(amp / SRC_BENCH_AMP);
+        if (g < gmin) gmin = g;
+        if (g > gmax) gmax = g;
+        if (resid > worst) worst = resid;
+    }
+
+    free(in);
+    free(res);
+    dsp_os_destroy(os);
+
+    out->cycles_per_frame = (float)cycles / (float)frames;
+    out->ripple_db = (float)(gmax - gmin);
+    out->rejection_db = (worst > 0.0) ? (float)(-20.0 * log10(worst / SRC_BENCH_AMP)) : 200.0f;
+    out->ok = true;
+
+    ESP_LOGI(TAG, "OS bench: %ux %s, %u stages: %.1f cyc/in-frame (model %u), "
+             "ripple %.5f dB, rejection %.1f dB, latency %.1f frames",
+             factor, dsp_os_phase_name(phase), out->stages, out->cycles_per_frame,
+             out->model_cycles, out->ripple_db, out->rejection_db, out->latency_frames);
+}
+
+// Noise gain over bench_fill() (-6 dBFS): peaks near +9 dBFS
+#define LIMITER_BENCH_DRIVE   5.5f
+#define LIMITER_BENCH_CHUNKS  64
+
+void audio_pipeline_bench_limiter(dsp_limiter_mode_t mode, uint32_t sample_rate,
+                                  audio_pipeline_limiter_bench_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->mode = mode;
+    out->sample_rate = sample_rate;
+    if (mode < DSP_LIMITER_LOOKAHEAD || mode >= DSP_LIMITER_MODE_COUNT) return;
+
+    const bool true_peak = (mode == DSP_LIMITER_TRUE_PEAK);
+    out->model_cycles = dsp_limiter_cycles_per_sample(true_peak);
+
+    // ~20 KB of rings: heap, not another static next to the live chain
+    dsp_limiter_t *lim = malloc(sizeof(*lim));
+    if (!lim) return;
+
+    dsp_limiter_config_t cfg;
+    dsp_limiter_config(&cfg, sample_rate);
+    dsp_limiter_reset(lim, &cfg, true_peak);
+    out->lookahead = cfg.lookahead;
+    out->latency = dsp_limiter_latency(lim);
+
+    uint64_t total = 0;
+    float peak = 0.0f;
+    for (uint32_t pass = 0; pass < LIMITER_BENCH_CHUNKS; pass++) {
+        bench_fill(s_bench_ref_L, s_bench_ref_R, 0x0badcafeu + pass);
+        for (uint32_t i = 0; i < DSP_CHUNK_FRAMES; i++) {
+            s_bench_ref_L[i] *= LIMITER_BENCH_DRIVE;
+            s_bench_ref_R[i] *= LIMITER_BENCH_DRIVE;
+        }
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        dsp_limiter_process(lim, s_bench_ref_L, s_bench_ref_R, DSP_CHUNK_FRAMES);
+        total += esp_cpu_get_cycle_count() - t0;
+
+        for (uint32_t i = 0; i < DSP_CHUNK_FRAMES; i++) {
+            if (fabsf(s_bench_ref_L[i]) > peak) peak = fabsf(s_bench_ref_L[i]);
+            if (fabsf(s_bench_ref_R[i]) > peak) peak = fabsf(s_bench_ref_R[i]);
+        }
+    }
+    free(lim);
+
+    // Budget units: one sample of one channel
+    out->cycles_per_sample = (float)total / (float)(LIMITER_BENCH_CHUNKS * DSP_CHUNK_FRAMES * 2);
+    out->peak_db = (peak > 0.0f) ? 20.0f * log10f(peak) : -200.0f;
+    out->ok = true;
+
+    ESP_LOGI(TAG, "Limiter bench: %s @ %lu Hz, look-ahead %u, latency %u: "
+             "%.1f cyc/sample (model %u), peak %.2f dBFS",
+             dsp_chain_limiter_name(mode), (unsigned long)sample_rate, out->lookahead,
+             out->latency, out->cycles_per_sample, out->model_cycles, out->peak_db);
+}
+
+// One DSF block per channel per pass
+#define DSD_BENCH_BYTES   4096
+#define DSD_BENCH_PASSES  16
+
+void audio_pipeline_bench_dsd(uint32_t dsd_rate, uint32_t pcm_rate,
+                              audio_pipeline_dsd_bench_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->dsd_rate = dsd_rate;
+    out->pcm_rate = pcm_rate;
+    out->model_cycles = dsd2pcm_cycles_per_frame(dsd_rate, pcm_rate);
+
+    dsd2pcm_t *c = dsd2pcm_create(dsd_rate, pcm_rate, true);
+    uint8_t *dsd = malloc(2 * DSD_BENCH_BYTES);
+    int32_t *pcm = malloc(DSD_BENCH_BYTES * sizeof(int32_t));   // ≥ 2 × bytes / 2
+    if (!c || !dsd || !pcm) {
+        dsd2pcm_destroy(c);
+        free(dsd);
+        free(pcm);
+        return;
+    }
+
+    // Table lookups are data-independent: any bit pattern times the same
+    uint32_t x = 0x2545f491u;
+    for (uint32_t i = 0; i < 2 * DSD_BENCH_BYTES; i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        dsd[i] = (uint8_t)x;
+    }
+
+    uint64_t total = 0;
+    uint32_t frames = 0;
+    for (uint32_t pass = 0; pass < DSD_BENCH_PASSES; pass++) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        frames += dsd2pcm_process(c, dsd, dsd + DSD_BENCH_BYTES, 1, DSD_BENCH_BYTES, pcm);
+        total += esp_cpu_get_cycle_count() - t0;
+    }
+    dsd2pcm_destroy(c);
+    free(dsd);
+    free(pcm);
+
+    out->cycles_per_frame = frames ? (float)total / (float)frames : 0.0f;
+    out->mcycles_per_sec = out->cycles_per_frame * (float)pcm_rate / 1e6f;
+    out->ok = frames > 0;
+
+    ESP_LOGI(TAG, "DSD bench: %lu -> %lu Hz: %.1f cyc/frame (model %lu), %.1f Mcyc/s",
+             (unsigned long)dsd_rate, (unsigned long)pcm_rate, out->cycles_per_frame,
+             (unsigned long)out->model_cycles, out->mcycles_per_sec);
 }
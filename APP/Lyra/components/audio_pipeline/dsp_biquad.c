@@ -30,107 +30,363 @@ void biquad_reset(biquad_filter_t *filter)
 // Coefficient Calculation (RBJ Audio EQ Cookbook)
 // https://webaudio.github.io/Audio-EQ-Cookbook/audio-eq-cookbook.html
 //
-// Output: filter->coef[5] = {b0, b1, b2, a1, a2} normalized (a0=1)
+// Output: coef[5] = {b0, b1, b2, a1, a2} normalized (a0=1)
 // Compatible with esp-dsp dsps_biquad_f32().
 //--------------------------------------------------------------------+
 
-void biquad_calculate_coeffs(biquad_filter_t *filter, const biquad_params_t *params)
+/**
+ * @brief RBJ coefficients in double precision, normalized (a0 = 1)
+ *
+ * Shared by the float and Q31 kernels. Low-frequency sections at high
+ * rates have poles within 1e-4 of the unit circle: computing in float
+ * would already cost the Q31 path most of its coefficient precision.
+ */
+static void biquad_design(double coef[5], const biquad_params_t *params)
 {
     // Intermediate variables
-    float omega = 2.0f * M_PI * params->freq / params->sample_rate;
-    float sn = sinf(omega);
-    float cs = cosf(omega);
-    float alpha = sn / (2.0f * params->q);
-    float A = powf(10.0f, params->gain / 40.0f);  // sqrt(10^(gain_db/20))
+    double omega = 2.0 * M_PI * params->freq / params->sample_rate;
+    double sn = sin(omega);
+    double cs = cos(omega);
+    double alpha = sn / (2.0 * params->q);
+    double A = pow(10.0, params->gain / 40.0);  // sqrt(10^(gain_db/20))
 
     // Coefficients (unnormalized)
-    float a0, a1, a2, b0, b1, b2;
+    double a0, a1, a2, b0, b1, b2;
 
     switch (params->type) {
         case BIQUAD_LOWPASS:
-            b0 =  (1.0f - cs) / 2.0f;
-            b1 =   1.0f - cs;
-            b2 =  (1.0f - cs) / 2.0f;
-            a0 =   1.0f + alpha;
-            a1 =  -2.0f * cs;
-            a2 =   1.0f - alpha;
+            b0 =  (1.0 - cs) / 2.0;
+            b1 =   1.0 - cs;
+            b2 =  (1.0 - cs) / 2.0;
+            a0 =   1.0 + alpha;
+            a1 =  -2.0 * cs;
+            a2 =   1.0 - alpha;
             break;
 
         case BIQUAD_HIGHPASS:
-            b0 =  (1.0f + cs) / 2.0f;
-            b1 = -(1.0f + cs);
-            b2 =  (1.0f + cs) / 2.0f;
-            a0 =   1.0f + alpha;
-            a1 =  -2.0f * cs;
-            a2 =   1.0f - alpha;
+            b0 =  (1.0 + cs) / 2.0;
+            b1 = -(1.0 + cs);
+            b2 =  (1.0 + cs) / 2.0;
+            a0 =   1.0 + alpha;
+            a1 =  -2.0 * cs;
+            a2 =   1.0 - alpha;
             break;
 
         case BIQUAD_BANDPASS:
             b0 =   alpha;
-            b1 =   0.0f;
+            b1 =   0.0;
             b2 =  -alpha;
-            a0 =   1.0f + alpha;
-            a1 =  -2.0f * cs;
-            a2 =   1.0f - alpha;
+            a0 =   1.0 + alpha;
+            a1 =  -2.0 * cs;
+            a2 =   1.0 - alpha;
             break;
 
         case BIQUAD_NOTCH:
-            b0 =   1.0f;
-            b1 =  -2.0f * cs;
-            b2 =   1.0f;
-            a0 =   1.0f + alpha;
-            a1 =  -2.0f * cs;
-            a2 =   1.0f - alpha;
+            b0 =   1.0;
+            b1 =  -2.0 * cs;
+            b2 =   1.0;
+            a0 =   1.0 + alpha;
+            a1 =  -2.0 * cs;
+            a2 =   1.0 - alpha;
             break;
 
         case BIQUAD_PEAK:
-            b0 =   1.0f + alpha * A;
-            b1 =  -2.0f * cs;
-            b2 =   1.0f - alpha * A;
-            a0 =   1.0f + alpha / A;
-            a1 =  -2.0f * cs;
-            a2 =   1.0f - alpha / A;
+            b0 =   1.0 + alpha * A;
+            b1 =  -2.0 * cs;
+            b2 =   1.0 - alpha * A;
+            a0 =   1.0 + alpha / A;
+            a1 =  -2.0 * cs;
+            a2 =   1.0 - alpha / A;
             break;
 
         case BIQUAD_LOWSHELF:
-            b0 =    A * ((A + 1.0f) - (A - 1.0f) * cs + 2.0f * sqrtf(A) * alpha);
-            b1 =  2.0f * A * ((A - 1.0f) - (A + 1.0f) * cs);
-            b2 =    A * ((A + 1.0f) - (A - 1.0f) * cs - 2.0f * sqrtf(A) * alpha);
-            a0 =         (A + 1.0f) + (A - 1.0f) * cs + 2.0f * sqrtf(A) * alpha;
-            a1 = -2.0f * ((A - 1.0f) + (A + 1.0f) * cs);
-            a2 =         (A + 1.0f) + (A - 1.0f) * cs - 2.0f * sqrtf(A) * alpha;
+            b0 =    A * ((A + 1.0) - (A - 1.0) * cs + 2.0 * sqrt(A) * alpha);
+            b1 =  2.0 * A * ((A - 1.0) - (A + 1.0) * cs);
+            b2 =    A * ((A + 1.0) - (A - 1.0) * cs - 2.0 * sqrt(A) * alpha);
+            a0 =         (A + 1.0) + (A - 1.0) * cs + 2.0 * sqrt(A) * alpha;
+            a1 = -2.0 * ((A - 1.0) + (A + 1.0) * cs);
+            a2 =         (A + 1.0) + (A - 1.0) * cs - 2.0 * sqrt(A) * alpha;
             break;
 
         case BIQUAD_HIGHSHELF:
-            b0 =    A * ((A + 1.0f) + (A - 1.0f) * cs + 2.0f * sqrtf(A) * alpha);
-            b1 = -2.0f * A * ((A - 1.0f) + (A + 1.0f) * cs);
-            b2 =    A * ((A + 1.0f) + (A - 1.0f) * cs - 2.0f * sqrtf(A) * alpha);
-            a0 =         (A + 1.0f) - (A - 1.0f) * cs + 2.0f * sqrtf(A) * alpha;
-            a1 =  2.0f * ((A - 1.0f) - (A + 1.0f) * cs);
-            a2 =         (A + 1.0f) - (A - 1.0f) * cs - 2.0f * sqrtf(A) * alpha;
+            b0 =    A * ((A + 1.0) + (A - 1.0) * cs + 2.0 * sqrt(A) * alpha);
+            b1 = -2.0 * A * ((A - 1.0) + (A + 1.0) * cs);
+            b2 =    A * ((A + 1.0) + (A - 1.0) * cs - 2.0 * sqrt(A) * alpha);
+            a0 =         (A + 1.0) - (A - 1.0) * cs + 2.0 * sqrt(A) * alpha;
+            a1 =  2.0 * ((A - 1.0) - (A + 1.0) * cs);
+            a2 =         (A + 1.0) - (A - 1.0) * cs - 2.0 * sqrt(A) * alpha;
             break;
 
         case BIQUAD_ALLPASS:
-            b0 =   1.0f - alpha;
-            b1 =  -2.0f * cs;
-            b2 =   1.0f + alpha;
-            a0 =   1.0f + alpha;
-            a1 =  -2.0f * cs;
-            a2 =   1.0f - alpha;
+            b0 =   1.0 - alpha;
+            b1 =  -2.0 * cs;
+            b2 =   1.0 + alpha;
+            a0 =   1.0 + alpha;
+            a1 =  -2.0 * cs;
+            a2 =   1.0 - alpha;
             break;
 
         default:
             // Invalid type: set to bypass (all-pass with no phase shift)
-            b0 = 1.0f; b1 = 0.0f; b2 = 0.0f;
-            a0 = 1.0f; a1 = 0.0f; a2 = 0.0f;
+            b0 = 1.0; b1 = 0.0; b2 = 0.0;
+            a0 = 1.0; a1 = 0.0; a2 = 0.0;
             break;
     }
 
-    // Normalize coefficients (a0 = 1) and store in esp-dsp format
-    float inv_a0 = 1.0f / a0;
-    filter->coef[0] = b0 * inv_a0;  // b0
-    filter->coef[1] = b1 * inv_a0;  // b1
-    filter->coef[2] = b2 * inv_a0;  // b2
-    filter->coef[3] = a1 * inv_a0;  // a1
-    filter->coef[4] = a2 * inv_a0;  // a2
+    // Normalize coefficients (a0 = 1), esp-dsp order
+    double inv_a0 = 1.0 / a0;
+    coef[0] = b0 * inv_a0;  // b0
+    coef[1] = b1 * inv_a0;  // b1
+    coef[2] = b2 * inv_a0;  // b2
+    coef[3] = a1 * inv_a0;  // a1
+    coef[4] = a2 * inv_a0;  // a2
+}
+
+void biquad_calculate_coeffs(biquad_filter_t *filter, const biquad_params_t *params)
+{
+    double c[5];
+    biquad_design(c, params);
+    for (int k = 0; k < 5; k++) filter->coef[k] = (float)c[k];
+}
+
+bool biquad_calculate_coeffs_q31(int32_t coef[5], const biquad_params_t *params)
+{
+    double c[5];
+    biquad_design(c, params);
+
+    const double one = (double)(1 << BIQUAD_Q31_FRAC);
+    for (int k = 0; k < 5; k++) {
+        double v = nearbyint(c[k] * one);
+        if (v >= 2147483647.0 || v <= -2147483648.0) return false;
+        coef[k] = (int32_t)v;
+    }
+    return true;
+}
+
+float biquad_pole_margin(const float coef[5])
+{
+    // Poles are the roots of z² + a1·z + a2
+    const float a1 = coef[3], a2 = coef[4];
+    const float disc = a1 * a1 - 4.0f * a2;
+    float r;
+    if (disc < 0.0f) {
+        r = sqrtf(a2);                              // complex pair, |p|² = a2
+    } else {
+        r = 0.5f * (fabsf(a1) + sqrtf(disc));       // real, the larger one
+    }
+    return 1.0f - r;
+}
+
+//--------------------------------------------------------------------+
+// Biquad IIR — Direct Form II Transposed (DFII-T)
+//--------------------------------------------------------------------+
+// DFII-T keeps state at the OUTPUT level, avoiding the internal-state
+// blow-up of Direct Form II which causes precision loss with high-gain
+// filters (+20 dB peak → d0 ≈ 89× input in DFII, but only y ≈ 10× in
+// DFII-T).  Two state variables per channel, same coef[5] layout.
+//
+// y[n] = b0·x[n] + w0
+// w0   = b1·x[n] − a1·y[n] + w1
+// w1   = b2·x[n] − a2·y[n]
+//--------------------------------------------------------------------+
+
+__attribute__((hot))
+void biquad_process_mono(float *buf, uint32_t len, const float *coef, float *w)
+{
+    const float b0 = coef[0], b1 = coef[1], b2 = coef[2];
+    const float a1 = coef[3], a2 = coef[4];
+    float w0 = w[0], w1 = w[1];
+
+    for (uint32_t i = 0; i < len; i++) {
+        const float x = buf[i];
+        const float y = b0 * x + w0;
+        w0 = b1 * x - a1 * y + w1;
+        w1 = b2 * x - a2 * y;
+        buf[i] = y;
+    }
+
+    w[0] = w0;
+    w[1] = w1;
+}
+
+//--------------------------------------------------------------------+
+// Cascade kernel — two sections × two channels per pass
+//--------------------------------------------------------------------+
+// The reference path reloads state and walks the buffer once per
+// section per channel (2·N passes, each a single serial dependency
+// chain).  Here each pass carries four independent recurrences
+// (L/R × section k/k+1), which the in-order FPU can overlap, and the
+// intermediate y of section k never leaves a register.
+//
+// Register budget (RV32 F: 32 FP regs): 10 coef + 8 state + 4 temps.
+// Three sections per pass would spill on the P4.
+//
+// PIE on the ESP32-P4 only has integer lanes (s8/s16/s32), so there
+// is no packed-float variant of this kernel; the fixed-point Q31 path
+// is where PIE applies.
+//--------------------------------------------------------------------+
+
+#define DFIIT_STEP(x, y, b0, b1, b2, a1, a2, w0, w1) \
+    do {                                             \
+        (y)  = (b0) * (x) + (w0);                    \
+        (w0) = (b1) * (x) - (a1) * (y) + (w1);       \
+        (w1) = (b2) * (x) - (a2) * (y);              \
+    } while (0)
+
+__attribute__((hot))
+void biquad_cascade_process(biquad_filter_t *filters, uint8_t count,
+                            float *restrict buf_L, float *restrict buf_R, uint32_t len)
+{
+    uint8_t s = 0;
+
+    for (; s + 2 <= count; s += 2) {
+        biquad_filter_t *f = &filters[s];
+        biquad_filter_t *g = &filters[s + 1];
+
+        const float fb0 = f->coef[0], fb1 = f->coef[1], fb2 = f->coef[2];
+        const float fa1 = f->coef[3], fa2 = f->coef[4];
+        const float gb0 = g->coef[0], gb1 = g->coef[1], gb2 = g->coef[2];
+        const float ga1 = g->coef[3], ga2 = g->coef[4];
+
+        float fl0 = f->w[0][0], fl1 = f->w[0][1];
+        float fr0 = f->w[1][0], fr1 = f->w[1][1];
+        float gl0 = g->w[0][0], gl1 = g->w[0][1];
+        float gr0 = g->w[1][0], gr1 = g->w[1][1];
+
+        for (uint32_t i = 0; i < len; i++) {
+            const float xl = buf_L[i];
+            const float xr = buf_R[i];
+            float yl, yr, zl, zr;
+
+            DFIIT_STEP(xl, yl, fb0, fb1, fb2, fa1, fa2, fl0, fl1);
+            DFIIT_STEP(xr, yr, fb0, fb1, fb2, fa1, fa2, fr0, fr1);
+            DFIIT_STEP(yl, zl, gb0, gb1, gb2, ga1, ga2, gl0, gl1);
+            DFIIT_STEP(yr, zr, gb0, gb1, gb2, ga1, ga2, gr0, gr1);
+
+            buf_L[i] = zl;
+            buf_R[i] = zr;
+        }
+
+        f->w[0][0] = fl0; f->w[0][1] = fl1;
+        f->w[1][0] = fr0; f->w[1][1] = fr1;
+        g->w[0][0] = gl0; g->w[0][1] = gl1;
+        g->w[1][0] = gr0; g->w[1][1] = gr1;
+    }
+
+    // Odd section count: one section, both channels
+    if (s < count) {
+        biquad_filter_t *f = &filters[s];
+
+        const float b0 = f->coef[0], b1 = f->coef[1], b2 = f->coef[2];
+        const float a1 = f->coef[3], a2 = f->coef[4];
+        float l0 = f->w[0][0], l1 = f->w[0][1];
+        float r0 = f->w[1][0], r1 = f->w[1][1];
+
+        for (uint32_t i = 0; i < len; i++) {
+            const float xl = buf_L[i];
+            const float xr = buf_R[i];
+            float yl, yr;
+
+            DFIIT_STEP(xl, yl, b0, b1, b2, a1, a2, l0, l1);
+            DFIIT_STEP(xr, yr, b0, b1, b2, a1, a2, r0, r1);
+
+            buf_L[i] = yl;
+            buf_R[i] = yr;
+        }
+
+        f->w[0][0] = l0; f->w[0][1] = l1;
+        f->w[1][0] = r0; f->w[1][1] = r1;
+    }
+}
+
+//--------------------------------------------------------------------+
+// Q31 kernel — Direct Form I, 64-bit accumulator, error feedback
+//--------------------------------------------------------------------+
+// Samples are int32, coefficients Q3.28. Each output is one 64-bit sum
+// of five 32×32 products, so the only rounding is the final >> 28 —
+// and its residue is added to the next sample's sum (first-order error
+// feedback, "fraction saving"). That puts a zero at DC in the noise
+// transfer, right where a low-frequency pole near z = 1 would otherwise
+// amplify it.
+//
+// DF-I rather than DFII-T: the state is the plain input/output history
+// (int32, no growth), so the accumulator is the only wide value.
+//
+// Cost on RV32: a 64-bit product is mul + mulh and a 64-bit add four
+// ALU ops, so a section costs several times the float kernel per
+// sample. The chain only moves sections here when their poles make the
+// float recurrence noisy.
+//--------------------------------------------------------------------+
+
+#define Q31_FRAC_MASK  ((1u << BIQUAD_Q31_FRAC) - 1u)
+
+__attribute__((hot, always_inline))
+static inline int32_t q31_sat(int64_t v)
+{
+    if (v > INT32_MAX) return INT32_MAX;
+    if (v < INT32_MIN) return INT32_MIN;
+    return (int32_t)v;
+}
+
+// sh > 0 only on the first section of a cascade with headroom: its input
+// is the full int32 word, and shifting each product (not the sample)
+// keeps the low bits in the accumulator, where the error feedback sees them
+#define DF1_Q31_STEP(x, y, x1, x2, y1, y2, e, sh)                           \
+    do {                                                                    \
+        const int64_t acc = (int64_t)(e) + ((b0 * (x)) >> (sh))             \
+                          + ((b1 * (x1)) >> (sh)) + ((b2 * (x2)) >> (sh))   \
+                          - a1 * (y1) - a2 * (y2);                          \
+        (y)  = q31_sat(acc >> BIQUAD_Q31_FRAC);                             \
+        (e)  = (uint32_t)acc & Q31_FRAC_MASK;                               \
+        (x2) = (x1); (x1) = (x);                                            \
+        (y2) = (y1); (y1) = (y);                                            \
+    } while (0)
+
+void biquad_q31_reset(biquad_q31_t *filter)
+{
+    memset(filter->x, 0, sizeof(filter->x));
+    memset(filter->y, 0, sizeof(filter->y));
+    memset(filter->err, 0, sizeof(filter->err));
+}
+
+__attribute__((hot, always_inline))
+static inline void q31_section(biquad_q31_t *restrict f, int32_t *restrict buf_L,
+                               int32_t *restrict buf_R, uint32_t len, unsigned sh)
+{
+    const int64_t b0 = f->coef[0], b1 = f->coef[1], b2 = f->coef[2];
+    const int64_t a1 = f->coef[3], a2 = f->coef[4];
+    int32_t lx1 = f->x[0][0], lx2 = f->x[0][1], ly1 = f->y[0][0], ly2 = f->y[0][1];
+    int32_t rx1 = f->x[1][0], rx2 = f->x[1][1], ry1 = f->y[1][0], ry2 = f->y[1][1];
+    uint32_t le = f->err[0], re = f->err[1];
+
+    for (uint32_t i = 0; i < len; i++) {
+        const int32_t xl = buf_L[i];
+        const int32_t xr = buf_R[i];
+        int32_t yl, yr;
+
+        DF1_Q31_STEP(xl, yl, lx1, lx2, ly1, ly2, le, sh);
+        DF1_Q31_STEP(xr, yr, rx1, rx2, ry1, ry2, re, sh);
+
+        buf_L[i] = yl;
+        buf_R[i] = yr;
+    }
+
+    f->x[0][0] = lx1; f->x[0][1] = lx2; f->y[0][0] = ly1; f->y[0][1] = ly2;
+    f->x[1][0] = rx1; f->x[1][1] = rx2; f->y[1][0] = ry1; f->y[1][1] = ry2;
+    f->err[0] = le;   f->err[1] = re;
+}
+
+__attribute__((hot))
+void biquad_cascade_process_q31(biquad_q31_t *filters, uint8_t count,
+                                int32_t *restrict buf_L, int32_t *restrict buf_R, uint32_t len,
+                                unsigned headroom)
+{
+    uint8_t s = 0;
+    if (headroom && count) {
+        q31_section(&filters[0], buf_L, buf_R, len, headroom);
+        s = 1;
+    }
+    for (; s < count; s++) {
+        q31_section(&filters[s], buf_L, buf_R, len, 0);
+    }
 }
@@ -5,6 +5,9 @@
 
 static const char *TAG = "dsp_chain";
 
+// CPU configuration (budget model and block deadlines)
+#define ESP32P4_CPU_FREQ_MHZ DSP_PROF_CPU_MHZ
+
 // Conversion scale factors for int32 <-> float
 #define INT32_TO_FLOAT_SCALE  (1.0f / 2147483648.0f)   // 1 / 2^31
 #define FLOAT_TO_INT32_SCALE  (2147483648.0f)           // 2^31
@@ -14,6 +17,9 @@ static const char *TAG = "dsp_chain";
 #define INT32_MAX_FLOAT  ( 2147483520.0f)   // 2^31 - 128
 #define INT32_MIN_FLOAT  (-2147483648.0f)   // -2^31 (exact)
 
+// The Q31 stages leave samples DSP_Q31_HEADROOM bits down
+#define Q31_TO_FLOAT_SCALE  (1.0f / (float)(1u << (31 - DSP_Q31_HEADROOM)))
+
 // Soft limiter threshold (only used in DSP_LIMITER_SOFT mode)
 #define SOFT_LIMITER_THRESHOLD 0.95f
 
@@ -22,57 +28,45 @@ static const char *TAG = "dsp_chain";
 #define CROSSFEED_FEED_DB  (-4.5f)   // Feed level (dB)
 #define CROSSFEED_FEED     0.5957f   // 10^(-4.5/20) — pre-calculated
 
-// Maximum frames per batch (384kHz × 8 USB packets / 1000 = 392 max)
-#define MAX_BATCH_FRAMES 400
+// Coefficient publish flag (bit above the 0..2 slot index in coef_mid)
+#define DSP_COEF_FRESH  0x4u
+#define DSP_COEF_SLOT   0x3u
 
-// Deinterleave buffers for batch processing (mono, contiguous)
-static float s_buf_L[MAX_BATCH_FRAMES];
-static float s_buf_R[MAX_BATCH_FRAMES];
+// Sample rates with precomputed coefficient rows (DSP_NUM_RATES entries)
+static const uint32_t s_dsp_rates[DSP_NUM_RATES] = {
+    44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000,
+};
 
-//--------------------------------------------------------------------+
-// Biquad IIR — Direct Form II Transposed (DFII-T)
-//--------------------------------------------------------------------+
-// DFII-T keeps state at the OUTPUT level, avoiding the internal-state
-// blow-up of Direct Form II which causes precision loss with high-gain
-// filters (+20 dB peak → d0 ≈ 89× input in DFII, but only y ≈ 10× in
-// DFII-T).  Two state variables per channel, same coef[5] layout.
-//
-// y[n] = b0·x[n] + w0
-// w0   = b1·x[n] − a1·y[n] + w1
-// w1   = b2·x[n] − a2·y[n]
-//--------------------------------------------------------------------+
+// Pass-through section used as ramp endpoint for added/removed filters
+static const float s_identity_coef[5] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+static const int32_t s_identity_coef_q[5] = { 1 << BIQUAD_Q31_FRAC, 0, 0, 0, 0 };
 
-__attribute__((hot, always_inline))
-static inline void biquad_process_mono(float *buf, int len,
-                                       const float *coef, float *w)
+static int dsp_rate_index(uint32_t sample_rate)
 {
-    const float b0 = coef[0], b1 = coef[1], b2 = coef[2];
-    const float a1 = coef[3], a2 = coef[4];
-    float w0 = w[0], w1 = w[1];
-
-    for (int i = 0; i < len; i++) {
-        const float x = buf[i];
-        const float y = b0 * x + w0;
-        w0 = b1 * x - a1 * y + w1;
-        w1 = b2 * x - a2 * y;
-        buf[i] = y;
+    for (int i = 0; i < DSP_NUM_RATES; i++) {
+        if (s_dsp_rates[i] == sample_rate) return i;
     }
+    return -1;
+}
 
-    w[0] = w0;
-    w[1] = w1;
+// Gentle peak/shelf: first to go when the chain runs late
+static bool dsp_low_impact(const biquad_params_t *p)
+{
+    return (p->type == BIQUAD_PEAK || p->type == BIQUAD_LOWSHELF ||
+            p->type == BIQUAD_HIGHSHELF) && fabsf(p->gain) < DSP_QUALITY_MERGE_DB;
 }
 
 //--------------------------------------------------------------------+
-// Crossfeed initialization
+// Crossfeed coefficients
 //--------------------------------------------------------------------+
 
 /**
  * @brief Compute lowpass biquad coefficients for crossfeed
  *
  * RBJ Cookbook lowpass (Butterworth Q=0.7071) at the given crossover frequency.
- * Called once at init and when sample rate changes.
+ * Evaluated once per supported rate at init; never on the audio task.
  */
-static void crossfeed_init(crossfeed_state_t *cf, uint32_t sample_rate)
+static void crossfeed_calc_coeffs(float coef[5], uint32_t sample_rate)
 {
     // RBJ lowpass @ CROSSFEED_FREQ, Q=0.7071 (Butterworth)
     float w0 = 2.0f * (float)M_PI * CROSSFEED_FREQ / (float)sample_rate;
@@ -81,19 +75,30 @@ static void crossfeed_init(crossfeed_state_t *cf, uint32_t sample_rate)
     float alpha = sin_w0 / (2.0f * 0.7071f);
 
     float a0 = 1.0f + alpha;
-    cf->coef[0] = ((1.0f - cos_w0) / 2.0f) / a0;  // b0
-    cf->coef[1] = (1.0f - cos_w0)           / a0;  // b1
-    cf->coef[2] = ((1.0f - cos_w0) / 2.0f) / a0;  // b2
-    cf->coef[3] = (-2.0f * cos_w0)          / a0;  // a1
-    cf->coef[4] = (1.0f - alpha)             / a0;  // a2
+    coef[0] = ((1.0f - cos_w0) / 2.0f) / a0;  // b0
+    coef[1] = (1.0f - cos_w0)           / a0;  // b1
+    coef[2] = ((1.0f - cos_w0) / 2.0f) / a0;  // b2
+    coef[3] = (-2.0f * cos_w0)          / a0;  // a1
+    coef[4] = (1.0f - alpha)             / a0;  // a2
+}
 
-    cf->w_l[0] = cf->w_l[1] = 0.0f;
-    cf->w_r[0] = cf->w_r[1] = 0.0f;
-    cf->feed = CROSSFEED_FEED;
+static float s_crossfeed_coefs[DSP_NUM_RATES][5];
+static bool  s_crossfeed_coefs_ready = false;
 
-    ESP_LOGI(TAG, "Crossfeed initialized: %dHz crossover, %.1fdB feed, fs=%lu",
-             (int)CROSSFEED_FREQ, CROSSFEED_FEED_DB, (unsigned long)sample_rate);
-}
+// Loudness tables for every supported rate (shared by all chains)
+static dsp_loudness_row_t s_loudness_rows[DSP_NUM_RATES];
+static bool s_loudness_rows_ready = false;
+
+static void dsp_chain_publish(dsp_chain_t *chain, bool reset);
+static uint16_t dsp_chain_conv_cycles(const dsp_chain_t *chain);
+static uint16_t dsp_chain_limiter_cycles(dsp_limiter_mode_t mode);
+static uint16_t dsp_chain_loudness_cycles(const dsp_chain_t *chain);
+static uint16_t dsp_chain_volume_cycles(const dsp_chain_t *chain);
+static bool dsp_chain_conv_fits(const dsp_chain_t *chain);
+static uint32_t dsp_chain_select_kernels(dsp_chain_t *chain, const float (*coef)[5],
+                                         uint32_t q_ok);
+static uint16_t dsp_chain_model_cycles(const dsp_chain_t *chain, dsp_quality_t level,
+                                       uint8_t on_q31);
 
 //--------------------------------------------------------------------+
 // DSP Chain Initialization
@@ -105,16 +110,70 @@ void dsp_chain_init(dsp_chain_t *chain, const audio_format_t *format)
 
     // Store format
     chain->format = *format;
+    chain->os_factor = 1;
+
+    // Crossfeed lowpass for every supported rate (shared by all chains)
+    if (!s_crossfeed_coefs_ready) {
+        for (int i = 0; i < DSP_NUM_RATES; i++) {
+            crossfeed_calc_coeffs(s_crossfeed_coefs[i], s_dsp_rates[i]);
+        }
+        s_crossfeed_coefs_ready = true;
+        ESP_LOGI(TAG, "Crossfeed: %dHz crossover, %.1fdB feed, %d rates precomputed",
+                 (int)CROSSFEED_FREQ, CROSSFEED_FEED_DB, DSP_NUM_RATES);
+    }
+
+    // Loudness shelves: 61 volume steps for every supported rate, so that
+    // neither volume nor format changes design anything
+    if (!s_loudness_rows_ready) {
+        for (int i = 0; i < DSP_NUM_RATES; i++) {
+            dsp_loudness_build(s_loudness_rows[i], s_dsp_rates[i]);
+        }
+        s_loudness_rows_ready = true;
+        ESP_LOGI(TAG, "Loudness: %d volume steps x %d rates precomputed",
+                 DSP_LOUDNESS_STEPS, DSP_NUM_RATES);
+    }
+
+    // Triple buffer: audio owns slot 0, shared slot 1, control owns slot 2
+    chain->coef_front = 0;
+    chain->coef_mid   = 1;
+    chain->coef_back  = 2;
+    chain->ramp_pos   = DSP_RAMP_FRAMES;
 
     // Start with flat preset (bypass)
     chain->current_preset = PRESET_FLAT;
     chain->bypass = false;
     chain->limiter_mode = DSP_LIMITER_HARD_CLIP;
+    chain->kernel_mode = DSP_KERNEL_AUTO;
+    chain->quality_adaptive = true;
+    chain->quality = DSP_QUALITY_FULL;
+
+    // Output stage: unity, TPDF once the word gets shorter
+    dsp_volume_init(&chain->volume);
+    chain->volume_gain = DSP_VOLUME_UNITY;
+    chain->dither = DSP_DITHER_TPDF;
 
     ESP_LOGI(TAG, "DSP Chain initialized (DFII-T batch): %lu Hz, %d-bit, %d channels",
              format->sample_rate, format->bits_per_sample, format->channels);
 }
 
+/**
+ * @brief Float and Q3.28 coefficients of every configured filter at one rate
+ */
+static void dsp_chain_calc_row(dsp_chain_t *chain, int r, uint32_t sample_rate)
+{
+    chain->rate_q_ok[r] = 0;
+    for (uint8_t i = 0; i < chain->num_biquads; i++) {
+        biquad_filter_t tmp;
+        biquad_params_t params = chain->filter_params[i];
+        params.sample_rate = sample_rate;
+        biquad_calculate_coeffs(&tmp, &params);
+        memcpy(chain->rate_coefs[r][i], tmp.coef, sizeof(tmp.coef));
+        if (biquad_calculate_coeffs_q31(chain->rate_coefs_q[r][i], &params)) {
+            chain->rate_q_ok[r] |= 1u << i;
+        }
+    }
+}
+
 //--------------------------------------------------------------------+
 // Preset Loading
 //--------------------------------------------------------------------+
@@ -129,39 +188,478 @@ bool dsp_chain_load_preset(dsp_chain_t *chain, eq_preset_t preset)
 
     ESP_LOGI(TAG, "Loading preset: %s (%s)", config->name, config->description);
 
-    // Clear existing filters
-    chain->num_biquads = 0;
-
+    // Collect filter parameters — the running filters are untouched until
+    // the audio task adopts the published set at its next block boundary
+    uint8_t n = 0;
     if (preset == PRESET_USER) {
         // User-defined parametric EQ: use user_bands[] instead of preset config
-        for (uint8_t i = 0; i < chain->user_num_bands && i < DSP_MAX_BIQUADS; i++) {
-            biquad_params_t params = chain->user_bands[i];
-            params.sample_rate = chain->format.sample_rate;
-            biquad_init(&chain->biquads[i], &params);
-            chain->num_biquads++;
+        for (uint8_t i = 0; i < chain->user_num_bands && n < DSP_MAX_BIQUADS; i++) {
+            chain->filter_params[n++] = chain->user_bands[i];
         }
     } else {
-        // Load biquad filters from preset — always calculate dynamically
-        for (uint8_t i = 0; i < config->num_filters && i < DSP_MAX_BIQUADS; i++) {
-            biquad_params_t params = config->filters[i];
-            params.sample_rate = chain->format.sample_rate;
-            biquad_init(&chain->biquads[i], &params);
-            chain->num_biquads++;
+        for (uint8_t i = 0; i < config->num_filters && n < DSP_MAX_BIQUADS; i++) {
+            chain->filter_params[n++] = config->filters[i];
         }
     }
+    chain->num_biquads = n;
 
-    // Enable crossfeed if preset specifies
-    chain->crossfeed_enabled = config->enable_crossfeed;
-    if (chain->crossfeed_enabled) {
-        crossfeed_init(&chain->crossfeed, chain->format.sample_rate);
+    // Sections a loaded chain may fold away first (gentle peaks/shelves)
+    chain->low_mask = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        if (dsp_low_impact(&chain->filter_params[i])) {
+            chain->low_mask |= 1u << i;
+        }
     }
 
+    // Precompute coefficients for every supported rate so that format
+    // changes only select a row (no sinf/cosf/powf on that path)
+    for (int r = 0; r < DSP_NUM_RATES; r++) {
+        dsp_chain_calc_row(chain, r, s_dsp_rates[r]);
+    }
+
+    // Enable crossfeed if preset specifies
+    chain->crossfeed_enabled = config->enable_crossfeed;
     chain->current_preset = preset;
 
+    dsp_chain_publish(chain, false);
+
     ESP_LOGI(TAG, "Preset loaded: %d biquad filters (DFII-T batch)", chain->num_biquads);
     return true;
 }
 
+//--------------------------------------------------------------------+
+// Coefficient Publishing (control → audio)
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Build a coefficient set for the current format and hand it to the audio task
+ *
+ * Runs on the control task. Fills the control-owned slot and swaps it
+ * into the shared slot; a set that was published but not yet consumed is
+ * simply superseded. Single writer: two publishes at once would both
+ * fill coef_back and both swap it in, leaving control owning the slot
+ * the audio task runs. Every setter that gets here must hold the
+ * audio_pipeline lock (see audio_pipeline.c).
+ *
+ * Sections are split by kernel: the Q31 ones go to coef_q (they run
+ * first, on the int32 samples), the rest to coef. A biquad cascade is
+ * linear and time-invariant, so the order does not change the result.
+ * The quality level then strips what it gives up (Q31, low-impact
+ * sections, crossfeed) and tells the audio task when to ask for more.
+ */
+static void dsp_chain_publish(dsp_chain_t *chain, bool reset)
+{
+    dsp_coef_set_t *set = &chain->coef_sets[chain->coef_back];
+    int r = dsp_rate_index(chain->format.sample_rate);
+    const bool listed = (r >= 0);
+
+    if (!listed) {
+        // Unlisted rate: compute here, still off the audio task
+        r = DSP_NUM_RATES;
+        dsp_chain_calc_row(chain, r, chain->format.sample_rate);
+    }
+
+    chain->kernel_mask = dsp_chain_select_kernels(chain, (const float (*)[5])chain->rate_coefs[r],
+                                                  chain->rate_q_ok[r]);
+    chain->fixed_mask = (chain->quality < DSP_QUALITY_FLOAT) ? chain->kernel_mask : 0;
+    const uint32_t drop = (chain->quality >= DSP_QUALITY_MERGED) ? chain->low_mask : 0;
+
+    set->num_biquads = 0;
+    set->num_fixed = 0;
+    for (uint8_t i = 0; i < chain->num_biquads; i++) {
+        if (drop & (1u << i)) {
+            continue;
+        }
+        if (chain->fixed_mask & (1u << i)) {
+            memcpy(set->coef_q[set->num_fixed++], chain->rate_coefs_q[r][i], sizeof(set->coef_q[0]));
+        } else {
+            memcpy(set->coef[set->num_biquads++], chain->rate_coefs[r][i], sizeof(set->coef[0]));
+        }
+    }
+
+    set->crossfeed_enabled = chain->crossfeed_enabled && chain->quality < DSP_QUALITY_MINIMAL;
+    if (listed) {
+        memcpy(set->cf_coef, s_crossfeed_coefs[r], sizeof(set->cf_coef));
+    } else {
+        crossfeed_calc_coeffs(set->cf_coef, chain->format.sample_rate);
+    }
+
+    // Loudness table: precomputed row, or built once per unlisted rate
+    // (only while enabled) into the row owned by this set's slot — the
+    // sets the audio task holds point to their own slots' rows
+    set->loudness_enabled = chain->loudness_enabled;
+    set->loud_row = NULL;
+    if (listed) {
+        set->loud_row = (const int32_t (*)[DSP_LOUDNESS_SECTIONS][5])s_loudness_rows[r];
+    } else {
+        const uint8_t slot = chain->coef_back;
+        if (chain->loudness_enabled &&
+            chain->loud_unlisted_rate[slot] != chain->format.sample_rate) {
+            dsp_loudness_build(chain->loud_unlisted[slot], chain->format.sample_rate);
+            chain->loud_unlisted_rate[slot] = chain->format.sample_rate;
+        }
+        if (chain->loud_unlisted_rate[slot] == chain->format.sample_rate) {
+            set->loud_row = (const int32_t (*)[DSP_LOUDNESS_SECTIONS][5])chain->loud_unlisted[slot];
+        }
+    }
+    set->reset = reset;
+
+    // Only 16-bit streams leave the chain shorter than they entered it
+    // (24-bit travels in 32-bit words to a 32-bit DAC)
+    set->dither = chain->dither;
+    set->out_bits = (chain->format.bits_per_sample <= 16) ? 16 : 32;
+
+    set->limiter_mode = chain->limiter_mode;
+    dsp_limiter_config(&set->limiter, chain->format.sample_rate);
+
+    // FIR only at its design rate and only if the budget allows it
+    set->conv = NULL;
+    if (chain->conv) {
+        if (dsp_chain_conv_cycles(chain) == 0) {
+            ESP_LOGW(TAG, "FIR designed for %lu Hz, stream is %lu Hz — FIR inactive",
+                     (unsigned long)dsp_conv_get_sample_rate(chain->conv),
+                     (unsigned long)chain->format.sample_rate);
+        } else if (!dsp_chain_conv_fits(chain)) {
+            ESP_LOGW(TAG, "FIR (%lu taps) exceeds CPU budget at %lu Hz — FIR inactive",
+                     (unsigned long)dsp_conv_get_taps(chain->conv),
+                     (unsigned long)chain->format.sample_rate);
+        } else {
+            set->conv = chain->conv;
+        }
+    }
+
+    // Quality bookkeeping for the audio task: this set's modelled cost and
+    // the measured load under which the level above would still fit
+    set->quality = chain->quality;
+    set->model_cycles = dsp_chain_model_cycles(chain, chain->quality,
+                                               (uint8_t)__builtin_popcount(chain->fixed_mask));
+    // Deadline net of the oversampler, which shares the core and the block
+    uint32_t frame_cycles = ESP32P4_CPU_FREQ_MHZ * 1000000u / chain->format.sample_rate;
+    uint32_t os_frame = 2u * chain->os_cycles;
+    set->cycles_per_frame = (uint16_t)((frame_cycles > 2 * os_frame) ? frame_cycles - os_frame
+                                                                     : frame_cycles / 2);
+    set->rate_row = (uint8_t)r;
+    set->sample_rate = chain->format.sample_rate;
+    set->restore_load = 0;
+    set->restore_frames = (uint32_t)((uint64_t)chain->format.sample_rate * DSP_QUALITY_HOLD_MS / 1000u);
+    if (chain->quality > DSP_QUALITY_FULL && set->model_cycles > 0) {
+        dsp_quality_t up = (dsp_quality_t)(chain->quality - 1);
+        uint8_t up_q31 = (up < DSP_QUALITY_FLOAT) ? (uint8_t)__builtin_popcount(chain->kernel_mask) : 0;
+        uint16_t up_cycles = dsp_chain_model_cycles(chain, up, up_q31);
+        set->restore_load = (uint32_t)(DSP_QUALITY_RESTORE * 65536.0f *
+                                       set->model_cycles / up_cycles);
+    }
+
+    uint32_t prev = __atomic_exchange_n(&chain->coef_mid,
+                                        chain->coef_back | DSP_COEF_FRESH, __ATOMIC_ACQ_REL);
+    chain->coef_back = (uint8_t)(prev & DSP_COEF_SLOT);
+}
+
+//--------------------------------------------------------------------+
+// Loudness (audio task)
+//--------------------------------------------------------------------+
+
+// Attenuation the shelves should be at, 1/256 dB (0 = off)
+static uint32_t dsp_chain_loudness_target(const dsp_chain_t *chain)
+{
+    const dsp_coef_set_t *set = &chain->coef_sets[chain->coef_front];
+    if (!set->loudness_enabled || !set->loud_row) {
+        return 0;
+    }
+    const int32_t level = __atomic_load_n(&chain->listen_q8, __ATOMIC_RELAXED);
+    if (level >= 0) {
+        return 0;
+    }
+    const uint32_t atten = (uint32_t)-level;
+    const uint32_t max = (DSP_LOUDNESS_STEPS - 1) << 8;
+    return (atten > max) ? max : atten;
+}
+
+// Set the shelves for attenuation q8: table interpolation only, no trig.
+// Sections leaving or entering the chain start from a clean state.
+static void dsp_chain_loudness_set(dsp_chain_t *chain, uint32_t q8)
+{
+    const dsp_coef_set_t *set = &chain->coef_sets[chain->coef_front];
+
+    if (q8 == 0 || !set->loud_row) {
+        q8 = 0;
+    } else {
+        int32_t coef[DSP_LOUDNESS_SECTIONS][5];
+        dsp_loudness_lookup(set->loud_row, q8, coef);
+        for (int i = 0; i < DSP_LOUDNESS_SECTIONS; i++) {
+            memcpy(chain->loudness[i].coef, coef[i], sizeof(coef[i]));
+        }
+    }
+    if (q8 == 0 || chain->loud_q8 == 0) {
+        for (int i = 0; i < DSP_LOUDNESS_SECTIONS; i++) {
+            biquad_q31_reset(&chain->loudness[i]);
+        }
+    }
+    chain->loud_q8 = q8;
+}
+
+// The first Q31 stage keeps its input history at full scale: the EQ
+// sections when there are any, else the loudness shelves. Rescale the
+// shelves' history when the sections in front of them come or go.
+static void dsp_chain_set_live_fixed(dsp_chain_t *chain, uint8_t live_fixed)
+{
+    if (chain->loud_q8 && (chain->live_fixed == 0) != (live_fixed == 0)) {
+        int32_t (*x)[2] = chain->loudness[0].x;
+        for (int c = 0; c < 2; c++) {
+            for (int k = 0; k < 2; k++) {
+                x[c][k] = live_fixed ? x[c][k] >> DSP_Q31_HEADROOM
+                                     : (int32_t)((uint32_t)x[c][k] << DSP_Q31_HEADROOM);
+            }
+        }
+    }
+    chain->live_fixed = live_fixed;
+}
+
+/**
+ * @brief Move the shelves towards the listening level (before each chunk)
+ *
+ * At most DSP_LOUDNESS_SLEW_DB per second, one step per DSP_CHUNK_FRAMES
+ * of stream: the step is a fraction of a dB, well inside what a
+ * coefficient jump hides. Steps fall on a frame grid, not on the
+ * caller's blocks, so the chunk is cut at the next step.
+ *
+ * @return Frames of @p frames to run before the next call
+ */
+static uint32_t dsp_chain_loudness_step(dsp_chain_t *chain, uint32_t frames)
+{
+    const uint32_t target = dsp_chain_loudness_target(chain);
+    const uint32_t live = chain->loud_q8;
+    if (live == target) {
+        chain->loud_phase = 0;
+        return frames;
+    }
+
+    if (chain->loud_phase == 0) {
+        const uint32_t rate = chain->coef_sets[chain->coef_front].sample_rate;
+        const uint32_t slew = (uint32_t)((uint64_t)DSP_CHUNK_FRAMES *
+                                         (uint32_t)(DSP_LOUDNESS_SLEW_DB * 256.0f) / rate) + 1;
+        if (target > live) {
+            dsp_chain_loudness_set(chain, (target - live > slew) ? live + slew : target);
+        } else {
+            dsp_chain_loudness_set(chain, (live - target > slew) ? live - slew : target);
+        }
+    }
+
+    const uint32_t to_step = DSP_CHUNK_FRAMES - chain->loud_phase;
+    if (frames > to_step) frames = to_step;
+    chain->loud_phase = (uint16_t)((chain->loud_phase + frames) % DSP_CHUNK_FRAMES);
+    return frames;
+}
+
+//--------------------------------------------------------------------+
+// Output volume (audio task)
+//--------------------------------------------------------------------+
+
+// Gain the output stage should be at, Q1.31
+static uint32_t dsp_chain_volume_target(const dsp_chain_t *chain)
+{
+    if (__atomic_load_n(&chain->muted, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    return __atomic_load_n(&chain->volume_gain, __ATOMIC_RELAXED);
+}
+
+// Start a ramp when control moved the volume (block boundary)
+static void dsp_chain_volume_step(dsp_chain_t *chain)
+{
+    const uint32_t target = dsp_chain_volume_target(chain);
+    if (target != chain->volume.target) {
+        const uint32_t rate = chain->coef_sets[chain->coef_front].sample_rate;
+        dsp_volume_set_target(&chain->volume, target, rate * DSP_VOLUME_RAMP_MS / 1000u);
+    }
+}
+
+/**
+ * @brief Adopt the latest published set, if any (audio task, block boundary)
+ *
+ * Filter state carries over. Sections that appear or disappear ramp
+ * from/to a pass-through section, crossfeed ramps its feed gain.
+ */
+static void dsp_chain_consume(dsp_chain_t *chain)
+{
+    if (!(__atomic_load_n(&chain->coef_mid, __ATOMIC_ACQUIRE) & DSP_COEF_FRESH)) {
+        return;
+    }
+
+    uint32_t prev = __atomic_exchange_n(&chain->coef_mid, chain->coef_front, __ATOMIC_ACQ_REL);
+    chain->coef_front = (uint8_t)(prev & DSP_COEF_SLOT);
+
+    const dsp_coef_set_t *set = &chain->coef_sets[chain->coef_front];
+    crossfeed_state_t *cf = &chain->crossfeed;
+
+    // New quality level: carry the load average over in proportion to the
+    // modelled cost, so the next decision is not taken on the old level's
+    // load. A format change restarts the measurement.
+    if (set->reset) {
+        chain->load_avg = 0;
+        chain->calm_frames = 0;
+    } else if (set->quality != chain->quality_live && chain->model_live) {
+        chain->load_avg = (uint32_t)((uint64_t)chain->load_avg * set->model_cycles /
+                                     chain->model_live);
+        chain->calm_frames = 0;
+    }
+    chain->quality_live = set->quality;
+    chain->model_live = set->model_cycles;
+
+    // The unlisted-rate profile row starts over for each new such rate
+    if (set->rate_row == DSP_NUM_RATES && set->sample_rate != chain->prof_unlisted_rate) {
+        for (int st = 0; st < DSP_STAGE_COUNT; st++) {
+            dsp_prof_reset(&chain->prof[DSP_NUM_RATES][st]);
+        }
+        chain->prof_unlisted_rate = set->sample_rate;
+    }
+
+    // Convolver swap: a (re)adopted convolver starts from a clean delay
+    // line. Publishing conv_live tells control when the old one is free.
+    if (set->conv != chain->conv_live || (set->reset && set->conv)) {
+        if (set->conv) {
+            dsp_conv_reset(set->conv);
+        }
+        __atomic_store_n(&chain->conv_live, set->conv, __ATOMIC_RELEASE);
+    }
+
+    // Look-ahead limiter starts empty when switched in and on format change
+    bool lookahead = set->limiter_mode >= DSP_LIMITER_LOOKAHEAD;
+    if (set->limiter_mode != chain->limiter_live || (set->reset && lookahead)) {
+        if (lookahead) {
+            dsp_limiter_reset(&chain->limiter, &set->limiter,
+                              set->limiter_mode == DSP_LIMITER_TRUE_PEAK);
+        }
+        chain->limiter_live = set->limiter_mode;
+    }
+
+    // New output word or dither; a format change also restarts the shaper
+    // and jumps to the current volume
+    dsp_volume_t *vol = &chain->volume;
+    if (set->reset || set->out_bits != vol->out_bits || set->dither != vol->dither) {
+        dsp_volume_config(vol, set->sample_rate, set->out_bits, set->dither);
+    }
+
+    if (set->reset) {
+        // Format change: stream restarted, jump straight to the new set
+        dsp_volume_set_target(vol, dsp_chain_volume_target(chain), 0);
+        for (uint8_t i = 0; i < set->num_biquads; i++) {
+            memcpy(chain->biquads[i].coef, set->coef[i], sizeof(set->coef[i]));
+            biquad_reset(&chain->biquads[i]);
+        }
+        chain->live_biquads = set->num_biquads;
+        for (uint8_t i = 0; i < set->num_fixed; i++) {
+            memcpy(chain->biquads_q[i].coef, set->coef_q[i], sizeof(set->coef_q[i]));
+            biquad_q31_reset(&chain->biquads_q[i]);
+        }
+        dsp_chain_set_live_fixed(chain, set->num_fixed);
+        memcpy(cf->coef, set->cf_coef, sizeof(cf->coef));
+        cf->w_l[0] = cf->w_l[1] = 0.0f;
+        cf->w_r[0] = cf->w_r[1] = 0.0f;
+        cf->feed = set->crossfeed_enabled ? CROSSFEED_FEED : 0.0f;
+        chain->loud_q8 = 0;
+        chain->loud_phase = 0;
+        dsp_chain_loudness_set(chain, dsp_chain_loudness_target(chain));
+        chain->ramp_pos = DSP_RAMP_FRAMES;
+        return;
+    }
+
+    // Ramp start points: running coefficients, pass-through for new sections
+    uint8_t live = chain->live_biquads;
+    uint8_t span = (set->num_biquads > live) ? set->num_biquads : live;
+    for (uint8_t i = 0; i < span; i++) {
+        if (i < live) {
+            memcpy(chain->ramp_from[i], chain->biquads[i].coef, sizeof(chain->ramp_from[i]));
+        } else {
+            memcpy(chain->ramp_from[i], s_identity_coef, sizeof(s_identity_coef));
+            memcpy(chain->biquads[i].coef, s_identity_coef, sizeof(s_identity_coef));
+            biquad_reset(&chain->biquads[i]);
+        }
+    }
+    chain->live_biquads = span;
+
+    // Same for the Q31 sections (a section changing kernel leaves one
+    // list through a pass-through ramp and enters the other one)
+    live = chain->live_fixed;
+    span = (set->num_fixed > live) ? set->num_fixed : live;
+    for (uint8_t i = 0; i < span; i++) {
+        if (i < live) {
+            memcpy(chain->ramp_from_q[i], chain->biquads_q[i].coef, sizeof(chain->ramp_from_q[i]));
+        } else {
+            memcpy(chain->ramp_from_q[i], s_identity_coef_q, sizeof(s_identity_coef_q));
+            memcpy(chain->biquads_q[i].coef, s_identity_coef_q, sizeof(s_identity_coef_q));
+            biquad_q31_reset(&chain->biquads_q[i]);
+        }
+    }
+    dsp_chain_set_live_fixed(chain, span);
+
+    // Crossfeed coefficients only change with rate (always a reset), so
+    // only the feed gain needs to ramp
+    if (cf->feed == 0.0f) {
+        memcpy(cf->coef, set->cf_coef, sizeof(cf->coef));
+        cf->w_l[0] = cf->w_l[1] = 0.0f;
+        cf->w_r[0] = cf->w_r[1] = 0.0f;
+    }
+    chain->ramp_feed_from = cf->feed;
+    chain->ramp_pos = 0;
+}
+
+/**
+ * @brief Set running coefficients for the ramp step ending at step_end
+ *
+ * Coefficients depend only on the ramp position, not on how the caller
+ * split its blocks.
+ */
+static void dsp_chain_ramp_step(dsp_chain_t *chain, uint32_t step_end)
+{
+    const dsp_coef_set_t *set = &chain->coef_sets[chain->coef_front];
+    const float t = (float)step_end / (float)DSP_RAMP_FRAMES;
+
+    for (uint8_t i = 0; i < chain->live_biquads; i++) {
+        const float *from = chain->ramp_from[i];
+        const float *to = (i < set->num_biquads) ? set->coef[i] : s_identity_coef;
+        float *c = chain->biquads[i].coef;
+        for (int k = 0; k < 5; k++) {
+            c[k] = from[k] + (to[k] - from[k]) * t;
+        }
+    }
+
+    // Q3.28: exact integer interpolation, same convexity argument
+    for (uint8_t i = 0; i < chain->live_fixed; i++) {
+        const int32_t *from = chain->ramp_from_q[i];
+        const int32_t *to = (i < set->num_fixed) ? set->coef_q[i] : s_identity_coef_q;
+        int32_t *c = chain->biquads_q[i].coef;
+        for (int k = 0; k < 5; k++) {
+            c[k] = from[k] + (int32_t)((((int64_t)to[k] - from[k]) * (int64_t)step_end)
+                                       / DSP_RAMP_FRAMES);
+        }
+    }
+
+    const float feed_to = set->crossfeed_enabled ? CROSSFEED_FEED : 0.0f;
+    chain->crossfeed.feed = chain->ramp_feed_from + (feed_to - chain->ramp_feed_from) * t;
+}
+
+/**
+ * @brief Ramp complete: land exactly on the target and drop removed sections
+ *
+ * Removed sections ran the whole last step as pass-through, so their
+ * residual state has already flushed.
+ */
+static void dsp_chain_ramp_finish(dsp_chain_t *chain)
+{
+    const dsp_coef_set_t *set = &chain->coef_sets[chain->coef_front];
+
+    for (uint8_t i = 0; i < set->num_biquads; i++) {
+        memcpy(chain->biquads[i].coef, set->coef[i], sizeof(set->coef[i]));
+    }
+    chain->live_biquads = set->num_biquads;
+    for (uint8_t i = 0; i < set->num_fixed; i++) {
+        memcpy(chain->biquads_q[i].coef, set->coef_q[i], sizeof(set->coef_q[i]));
+    }
+    dsp_chain_set_live_fixed(chain, set->num_fixed);
+    chain->crossfeed.feed = set->crossfeed_enabled ? CROSSFEED_FEED : 0.0f;
+}
+
 //--------------------------------------------------------------------+
 // Audio Processing — esp-dsp batch architecture
 //--------------------------------------------------------------------+
@@ -217,93 +715,226 @@ static inline float soft_limit(float sample)
 }
 
 /**
- * @brief Process audio buffer through DSP chain
+ * @brief Crossfeed (Bauer stereophonic-to-binaural)
  *
- * Architecture: batch deinterleave → DFII-T biquad per channel → soft limit → reinterleave
+ * Mix a lowpassed version of the opposite channel.
+ * L_out = L + feed * LP(R), R_out = R + feed * LP(L)
  *
- * 1. Deinterleave stereo int32 → float L[] / R[] (one pass)
- * 2. For each biquad: biquad_process_mono (DFII-T, in-place)
- * 3. Soft limit + reinterleave float → int32 (one pass)
+ * Uses DFII-T inline to compute the lowpass output per sample
+ * without modifying the original buffers (non-destructive).
  */
 __attribute__((hot))
-void dsp_chain_process(dsp_chain_t *restrict chain, int32_t *restrict buffer_i32, uint32_t frames)
+static void crossfeed_process(crossfeed_state_t *cf, float *restrict buf_L,
+                              float *restrict buf_R, uint32_t frames)
 {
-#ifdef DSP_DEBUG_LOGGING
-    static uint32_t process_count = 0;
-    if (++process_count % 1000 == 0) {
-        ESP_LOGI(TAG, "DSP processing: %lu calls, %d filters active, preset=%d",
-                 process_count, chain->num_biquads, chain->current_preset);
-    }
-#endif
+    const float b0 = cf->coef[0], b1 = cf->coef[1], b2 = cf->coef[2];
+    const float a1 = cf->coef[3], a2 = cf->coef[4];
+    const float feed = cf->feed;
+    float wl0 = cf->w_l[0], wl1 = cf->w_l[1];
+    float wr0 = cf->w_r[0], wr1 = cf->w_r[1];
 
-    if (chain->bypass) {
-        return;
+    for (uint32_t i = 0; i < frames; i++) {
+        // LP filter on left channel (produces signal to feed into right)
+        float xl = buf_L[i];
+        float lp_l = b0 * xl + wl0;
+        wl0 = b1 * xl - a1 * lp_l + wl1;
+        wl1 = b2 * xl - a2 * lp_l;
+
+        // LP filter on right channel (produces signal to feed into left)
+        float xr = buf_R[i];
+        float lp_r = b0 * xr + wr0;
+        wr0 = b1 * xr - a1 * lp_r + wr1;
+        wr1 = b2 * xr - a2 * lp_r;
+
+        // Mix crossfeed
+        buf_L[i] = xl + feed * lp_r;
+        buf_R[i] = xr + feed * lp_l;
     }
 
-    // Nothing to do if no filters and no crossfeed
-    if (chain->num_biquads == 0 && !chain->crossfeed_enabled) {
-        return;
-    }
+    cf->w_l[0] = wl0; cf->w_l[1] = wl1;
+    cf->w_r[0] = wr0; cf->w_r[1] = wr1;
+}
 
-    // Clamp to buffer size
-    if (frames > MAX_BATCH_FRAMES) {
-        frames = MAX_BATCH_FRAMES;
-    }
+/**
+ * @brief Process one chunk (≤ DSP_CHUNK_FRAMES) through the DSP chain
+ *
+ * Architecture: batch deinterleave → DFII-T biquad per channel → soft limit → reinterleave
+ *
+ * 1. Deinterleave stereo int32 → float L[] / R[] (one pass), or to int32
+ *    L[] / R[] when Q31 sections are live; the first Q31 section takes
+ *    the full word and leaves DSP_Q31_HEADROOM bits of headroom
+ * 2. Q31 sections and the loudness shelves, then biquad_cascade_process
+ *    (DFII-T, in-place, sections fused in pairs), then crossfeed; stepped
+ *    in DSP_RAMP_STEP sub-blocks while ramping, then FIR and the
+ *    look-ahead limiter when active
+ * 3. Soft limit + reinterleave float → int32 (one pass), with the output
+ *    volume and requantisation fused in when they do anything. With only
+ *    Q31 sections and the hard clip, the samples never leave int32.
+ *
+ * All filter state lives in the chain and is carried per sample, so
+ * splitting a block into chunks yields bit-identical output.
+ */
+__attribute__((hot))
+static void dsp_chain_process_chunk(dsp_chain_t *restrict chain,
+                                    int32_t *restrict buffer_i32, uint32_t frames)
+{
+    float *restrict buf_L = chain->scratch_L;
+    float *restrict buf_R = chain->scratch_R;
+    int32_t *restrict q_L = chain->scratch_qL;
+    int32_t *restrict q_R = chain->scratch_qR;
+    dsp_prof_hist_t *prof = chain->prof[chain->coef_sets[chain->coef_front].rate_row];
+    const uint32_t samples = frames * 2;
+    uint32_t t = dsp_prof_now();
+
+    // Anything after the Q31 sections that needs float? (A ramp may be
+    // bringing crossfeed or float sections in.)
+    const bool loud = chain->loud_q8 > 0;
+    const bool fixed = chain->live_fixed > 0 || loud;
+    const bool floating = !fixed || chain->live_biquads > 0 || chain->crossfeed.feed != 0.0f ||
+                          chain->ramp_pos < DSP_RAMP_FRAMES || chain->conv_live ||
+                          chain->limiter_live != DSP_LIMITER_HARD_CLIP;
 
     //----------------------------------------------------------------
     // Step 1: Deinterleave int32 stereo → float mono L[] / R[]
+    // (int32 as is for the Q31 sections)
     //----------------------------------------------------------------
-    for (uint32_t i = 0; i < frames; i++) {
-        s_buf_L[i] = (float)buffer_i32[i * 2]     * INT32_TO_FLOAT_SCALE;
-        s_buf_R[i] = (float)buffer_i32[i * 2 + 1] * INT32_TO_FLOAT_SCALE;
+    if (fixed) {
+        for (uint32_t i = 0; i < frames; i++) {
+            q_L[i] = buffer_i32[i * 2];
+            q_R[i] = buffer_i32[i * 2 + 1];
+        }
+    } else {
+        for (uint32_t i = 0; i < frames; i++) {
+            buf_L[i] = (float)buffer_i32[i * 2]     * INT32_TO_FLOAT_SCALE;
+            buf_R[i] = (float)buffer_i32[i * 2 + 1] * INT32_TO_FLOAT_SCALE;
+        }
     }
+    uint32_t now = dsp_prof_now();
+    dsp_prof_record(&prof[DSP_STAGE_DEINTERLEAVE], now - t, samples);
+    t = now;
 
     //----------------------------------------------------------------
-    // Step 2: Process biquad chain — DFII-T, in-place, per channel
+    // Step 2: Q31 sections, biquad cascade (DFII-T, in-place, L+R
+    // fused) + crossfeed
+    //
+    // While a coefficient ramp is running the chunk is cut at ramp-step
+    // boundaries and the coefficients are stepped between sub-blocks.
     //----------------------------------------------------------------
-    for (uint8_t i = 0; i < chain->num_biquads; i++) {
-        biquad_filter_t *f = &chain->biquads[i];
-        biquad_process_mono(s_buf_L, frames, f->coef, f->w[0]);
-        biquad_process_mono(s_buf_R, frames, f->coef, f->w[1]);
+    // Sub-blocks accumulate per stage, recorded once per chunk
+    uint32_t cyc_q31 = 0, cyc_loud = 0, cyc_biquad = 0, cyc_cf = 0;
+    bool ran_cf = false;
+    uint32_t off = 0;
+    while (off < frames) {
+        uint32_t n = frames - off;
+        bool ramping = chain->ramp_pos < DSP_RAMP_FRAMES;
+
+        if (ramping) {
+            uint32_t in_step = chain->ramp_pos % DSP_RAMP_STEP;
+            if (in_step == 0) {
+                dsp_chain_ramp_step(chain, chain->ramp_pos + DSP_RAMP_STEP);
+            }
+            if (n > DSP_RAMP_STEP - in_step) n = DSP_RAMP_STEP - in_step;
+            chain->ramp_pos += n;
+        }
+
+        t = dsp_prof_now();
+        if (fixed) {
+            // Whichever stage comes first takes the full input word
+            const uint8_t nq = chain->live_fixed;
+            biquad_cascade_process_q31(chain->biquads_q, nq,
+                                       q_L + off, q_R + off, n, DSP_Q31_HEADROOM);
+            if (loud) {
+                now = dsp_prof_now();
+                cyc_q31 += now - t;
+                t = now;
+                biquad_cascade_process_q31(chain->loudness, DSP_LOUDNESS_SECTIONS,
+                                           q_L + off, q_R + off, n,
+                                           nq ? 0 : DSP_Q31_HEADROOM);
+                now = dsp_prof_now();
+                cyc_loud += now - t;
+                t = now;
+            }
+            if (floating) {
+                // A ramp removing the last Q31 section leaves the rest
+                // of the chunk unscaled
+                const float scale = (nq || loud) ? Q31_TO_FLOAT_SCALE : INT32_TO_FLOAT_SCALE;
+                for (uint32_t i = off; i < off + n; i++) {
+                    buf_L[i] = (float)q_L[i] * scale;
+                    buf_R[i] = (float)q_R[i] * scale;
+                }
+            }
+            now = dsp_prof_now();
+            cyc_q31 += now - t;
+            t = now;
+        }
+        if (floating) {
+            biquad_cascade_process(chain->biquads, chain->live_biquads,
+                                   buf_L + off, buf_R + off, n);
+            now = dsp_prof_now();
+            cyc_biquad += now - t;
+            t = now;
+            if (chain->crossfeed.feed != 0.0f) {
+                crossfeed_process(&chain->crossfeed, buf_L + off, buf_R + off, n);
+                now = dsp_prof_now();
+                cyc_cf += now - t;
+                t = now;
+                ran_cf = true;
+            }
+        }
+
+        if (ramping && chain->ramp_pos >= DSP_RAMP_FRAMES) {
+            dsp_chain_ramp_finish(chain);
+        }
+        off += n;
     }
 
+    if (fixed) dsp_prof_record(&prof[DSP_STAGE_Q31], cyc_q31, samples);
+    if (loud) dsp_prof_record(&prof[DSP_STAGE_LOUDNESS], cyc_loud, samples);
+    if (floating && chain->live_biquads) dsp_prof_record(&prof[DSP_STAGE_BIQUAD], cyc_biquad, samples);
+    if (ran_cf) dsp_prof_record(&prof[DSP_STAGE_CROSSFEED], cyc_cf, samples);
+    t = dsp_prof_now();
+
     //----------------------------------------------------------------
-    // Step 2.5: Crossfeed (if enabled)
-    //
-    // Bauer stereophonic-to-binaural: mix a lowpassed version of the
-    // opposite channel.  L_out = L + feed * LP(R), R_out = R + feed * LP(L)
-    //
-    // Uses DFII-T inline to compute the lowpass output per sample
-    // without modifying the original buffers (non-destructive).
+    // Integer only: undo the headroom, saturating (= the hard clip)
     //----------------------------------------------------------------
-    if (chain->crossfeed_enabled) {
-        crossfeed_state_t *cf = &chain->crossfeed;
-        const float b0 = cf->coef[0], b1 = cf->coef[1], b2 = cf->coef[2];
-        const float a1 = cf->coef[3], a2 = cf->coef[4];
-        const float feed = cf->feed;
-        float wl0 = cf->w_l[0], wl1 = cf->w_l[1];
-        float wr0 = cf->w_r[0], wr1 = cf->w_r[1];
-
+    dsp_volume_t *vol = &chain->volume;
+    if (!floating && dsp_volume_active(vol)) {
+        dsp_volume_interleave_q31(vol, q_L, q_R, buffer_i32, frames, DSP_Q31_HEADROOM);
+        dsp_prof_record(&prof[DSP_STAGE_INTERLEAVE], dsp_prof_now() - t, samples);
+        return;
+    }
+    if (!floating) {
+        const int32_t lim = INT32_MAX >> DSP_Q31_HEADROOM;
         for (uint32_t i = 0; i < frames; i++) {
-            // LP filter on left channel (produces signal to feed into right)
-            float xl = s_buf_L[i];
-            float lp_l = b0 * xl + wl0;
-            wl0 = b1 * xl - a1 * lp_l + wl1;
-            wl1 = b2 * xl - a2 * lp_l;
-
-            // LP filter on right channel (produces signal to feed into left)
-            float xr = s_buf_R[i];
-            float lp_r = b0 * xr + wr0;
-            wr0 = b1 * xr - a1 * lp_r + wr1;
-            wr1 = b2 * xr - a2 * lp_r;
-
-            // Mix crossfeed
-            s_buf_L[i] = xl + feed * lp_r;
-            s_buf_R[i] = xr + feed * lp_l;
+            int32_t l = q_L[i], r = q_R[i];
+            if (l > lim) l = lim; else if (l < -lim - 1) l = -lim - 1;
+            if (r > lim) r = lim; else if (r < -lim - 1) r = -lim - 1;
+            buffer_i32[i * 2]     = (int32_t)((uint32_t)l << DSP_Q31_HEADROOM);
+            buffer_i32[i * 2 + 1] = (int32_t)((uint32_t)r << DSP_Q31_HEADROOM);
         }
+        dsp_prof_record(&prof[DSP_STAGE_INTERLEAVE], dsp_prof_now() - t, samples);
+        return;
+    }
 
-        cf->w_l[0] = wl0; cf->w_l[1] = wl1;
-        cf->w_r[0] = wr0; cf->w_r[1] = wr1;
+    //----------------------------------------------------------------
+    // Step 2.5: FIR convolution (partitioned overlap-save, PSRAM)
+    //----------------------------------------------------------------
+    if (chain->conv_live) {
+        dsp_conv_process(chain->conv_live, buf_L, buf_R, frames);
+        now = dsp_prof_now();
+        dsp_prof_record(&prof[DSP_STAGE_FIR], now - t, samples);
+        t = now;
+    }
+
+    //----------------------------------------------------------------
+    // Step 2.75: Look-ahead limiter (delays the signal, leaves it below
+    // the ceiling — the hard clip below then never engages)
+    //----------------------------------------------------------------
+    if (chain->limiter_live >= DSP_LIMITER_LOOKAHEAD) {
+        dsp_limiter_process(&chain->limiter, buf_L, buf_R, frames);
+        now = dsp_prof_now();
+        dsp_prof_record(&prof[DSP_STAGE_LIMITER], now - t, samples);
+        t = now;
     }
 
     //----------------------------------------------------------------
@@ -313,11 +944,23 @@ void dsp_chain_process(dsp_chain_t *restrict chain, int32_t *restrict buffer_i32
     // Note: 2147483647.0f rounds to 2147483648.0f in float32 (ULP=128),
     // so we clamp to INT32_MAX_FLOAT (2^31 − 128) to avoid UB in the
     // float→int32 cast.  Loss = 127 values at full scale — inaudible.
+    //
+    // With volume or a shorter output word the gain goes first and the
+    // saturation to the output word is the clip: overs up to
+    // DSP_Q31_HEADROOM bits (loudness boost, EQ) survive an attenuation.
     //----------------------------------------------------------------
-    if (chain->limiter_mode == DSP_LIMITER_SOFT) {
+    if (dsp_volume_active(vol)) {
+        if (chain->limiter_live == DSP_LIMITER_SOFT) {
+            for (uint32_t i = 0; i < frames; i++) {
+                buf_L[i] = soft_limit(buf_L[i]);
+                buf_R[i] = soft_limit(buf_R[i]);
+            }
+        }
+        dsp_volume_interleave_float(vol, buf_L, buf_R, buffer_i32, frames, DSP_Q31_HEADROOM);
+    } else if (chain->limiter_live == DSP_LIMITER_SOFT) {
         for (uint32_t i = 0; i < frames; i++) {
-            float left  = soft_limit(s_buf_L[i]);
-            float right = soft_limit(s_buf_R[i]);
+            float left  = soft_limit(buf_L[i]);
+            float right = soft_limit(buf_R[i]);
 
             float left_scaled  = left  * FLOAT_TO_INT32_SCALE;
             float right_scaled = right * FLOAT_TO_INT32_SCALE;
@@ -333,8 +976,8 @@ void dsp_chain_process(dsp_chain_t *restrict chain, int32_t *restrict buffer_i32
         }
     } else {
         for (uint32_t i = 0; i < frames; i++) {
-            float left  = hard_clip(s_buf_L[i]);
-            float right = hard_clip(s_buf_R[i]);
+            float left  = hard_clip(buf_L[i]);
+            float right = hard_clip(buf_R[i]);
 
             float left_scaled  = left  * FLOAT_TO_INT32_SCALE;
             float right_scaled = right * FLOAT_TO_INT32_SCALE;
@@ -349,6 +992,137 @@ void dsp_chain_process(dsp_chain_t *restrict chain, int32_t *restrict buffer_i32
             buffer_i32[i * 2 + 1] = (int32_t)right_scaled;
         }
     }
+    dsp_prof_record(&prof[DSP_STAGE_INTERLEAVE], dsp_prof_now() - t, samples);
+}
+
+/**
+ * @brief Account one block's measured cost and pick the level to ask for
+ *
+ * The cycle counter runs through interrupts and preemption, so the load
+ * is what the block really took on this core, not what the model says.
+ * Step down at once when a block overruns or the average passes the
+ * safety margin; step up after restore_frames of blocks that would still
+ * fit at the level above. No decisions while a ramp runs (both sets are
+ * live, the load is transiently higher).
+ */
+static void dsp_chain_account(dsp_chain_t *chain, uint32_t cycles, uint32_t frames)
+{
+    const dsp_coef_set_t *set = &chain->coef_sets[chain->coef_front];
+    const uint32_t deadline = frames * set->cycles_per_frame;
+    if (deadline == 0) {
+        return;
+    }
+
+    // Q16 fraction of the deadline; a block stalled for ages counts as 4x
+    uint64_t load64 = ((uint64_t)cycles << 16) / deadline;
+    const uint32_t load = (load64 > (4u << 16)) ? (4u << 16) : (uint32_t)load64;
+    dsp_prof_record(&chain->prof[set->rate_row][DSP_STAGE_TOTAL], cycles, frames * 2);
+    chain->load_avg = (uint32_t)((int32_t)chain->load_avg +
+                                 (((int32_t)load - (int32_t)chain->load_avg) >> 3));
+
+    chain->stats.cycles_used = cycles;
+    chain->stats.cycles_available = deadline;
+    chain->stats.cpu_usage_percent = (float)chain->load_avg * (100.0f / 65536.0f);
+    const bool overrun = load > 65536u;
+    if (overrun) {
+        chain->stats.buffer_underruns++;
+    }
+
+    if (chain->ramp_pos < DSP_RAMP_FRAMES) {
+        return;
+    }
+
+    dsp_quality_t level = set->quality;
+    if (overrun || chain->load_avg > (uint32_t)(DSP_SAFETY_MARGIN * 65536.0f)) {
+        chain->calm_frames = 0;
+        if (level + 1 < DSP_QUALITY_COUNT) {
+            __atomic_store_n(&chain->quality_want, (uint32_t)(level + 1), __ATOMIC_RELEASE);
+        }
+    } else if (level > DSP_QUALITY_FULL && load < set->restore_load) {
+        chain->calm_frames += frames;
+        if (chain->calm_frames >= set->restore_frames) {
+            chain->calm_frames = 0;
+            __atomic_store_n(&chain->quality_want, (uint32_t)(level - 1), __ATOMIC_RELEASE);
+        }
+    } else {
+        chain->calm_frames = 0;
+    }
+}
+
+/**
+ * @brief Nothing to run on the samples?
+ *
+ * No filters, no crossfeed, no FIR, no ramp in flight, no loudness (nor
+ * one to slew to) and no look-ahead limiter (its delay must not come and
+ * go).
+ */
+static bool dsp_chain_idle(const dsp_chain_t *chain)
+{
+    return chain->bypass ||
+           (chain->live_biquads == 0 && chain->live_fixed == 0 &&
+            chain->crossfeed.feed == 0.0f && !chain->conv_live &&
+            chain->ramp_pos >= DSP_RAMP_FRAMES &&
+            chain->loud_q8 == 0 && dsp_chain_loudness_target(chain) == 0 &&
+            chain->limiter_live < DSP_LIMITER_LOOKAHEAD);
+}
+
+/**
+ * @brief Process audio buffer through DSP chain
+ *
+ * Accepts any frame count: the buffer is walked in DSP_CHUNK_FRAMES
+ * slices through the per-chain scratch buffers, so callers no longer
+ * need to know the internal batch size. Every call is timed for the
+ * load-adaptive quality (see dsp_chain_account()) and the profile; the
+ * stages are timed per chunk in dsp_chain_process_chunk().
+ */
+__attribute__((hot))
+void dsp_chain_process(dsp_chain_t *restrict chain, int32_t *restrict buffer_i32, uint32_t frames)
+{
+#ifdef DSP_DEBUG_LOGGING
+    static uint32_t process_count = 0;
+    if (++process_count % 1000 == 0) {
+        ESP_LOGI(TAG, "DSP processing: %lu calls, %d filters active, preset=%d",
+                 process_count, chain->num_biquads, chain->current_preset);
+    }
+#endif
+
+    const uint32_t t0 = dsp_prof_now();
+
+    if (__atomic_load_n(&chain->prof_reset, __ATOMIC_ACQUIRE)) {
+        memset(chain->prof, 0, sizeof(chain->prof));
+        __atomic_store_n(&chain->prof_reset, 0, __ATOMIC_RELEASE);
+    }
+
+    // Block boundary: pick up coefficients published by control tasks
+    dsp_chain_consume(chain);
+    dsp_chain_volume_step(chain);
+
+    // Idle is checked again before every chunk: a ramp or a loudness slew
+    // that ends inside the block hands the rest of it to the idle path at
+    // the same frame however the stream was split into blocks
+    int32_t *buf = buffer_i32;
+    uint32_t left = frames;
+    while (left > 0 && !dsp_chain_idle(chain)) {
+        uint32_t n = (left > DSP_CHUNK_FRAMES) ? DSP_CHUNK_FRAMES : left;
+        if (chain->ramp_pos < DSP_RAMP_FRAMES && n > DSP_RAMP_FRAMES - chain->ramp_pos) {
+            n = DSP_RAMP_FRAMES - chain->ramp_pos;
+        }
+        n = dsp_chain_loudness_step(chain, n);
+        dsp_chain_process_chunk(chain, buf, n);
+        buf += n * 2;
+        left -= n;
+    }
+
+    if (left > 0 && dsp_volume_has_gain(&chain->volume)) {
+        // Nothing else to do: gain in place (unity passes untouched, so a
+        // 16-bit stream is not dithered again)
+        const uint32_t t = dsp_prof_now();
+        dsp_volume_process(&chain->volume, buf, left);
+        dsp_prof_record(&chain->prof[chain->coef_sets[chain->coef_front].rate_row]
+                                    [DSP_STAGE_INTERLEAVE], dsp_prof_now() - t, left * 2);
+    }
+
+    dsp_chain_account(chain, dsp_prof_now() - t0, frames);
 }
 
 //--------------------------------------------------------------------+
@@ -363,9 +1137,10 @@ void dsp_chain_set_bypass(dsp_chain_t *chain, bool bypass)
 
 void dsp_chain_set_limiter_mode(dsp_chain_t *chain, dsp_limiter_mode_t mode)
 {
+    if (mode >= DSP_LIMITER_MODE_COUNT) mode = DSP_LIMITER_HARD_CLIP;
     chain->limiter_mode = mode;
-    ESP_LOGI(TAG, "Limiter mode: %s",
-             mode == DSP_LIMITER_SOFT ? "SOFT (Padé tanh)" : "HARD CLIP");
+    dsp_chain_publish(chain, false);
+    ESP_LOGI(TAG, "Limiter mode: %s", dsp_chain_limiter_name(mode));
 }
 
 dsp_limiter_mode_t dsp_chain_get_limiter_mode(const dsp_chain_t *chain)
@@ -373,12 +1148,100 @@ dsp_limiter_mode_t dsp_chain_get_limiter_mode(const dsp_chain_t *chain)
     return chain->limiter_mode;
 }
 
-void dsp_chain_set_crossfeed(dsp_chain_t *chain, bool enabled)
+const char *dsp_chain_limiter_name(dsp_limiter_mode_t mode)
+{
+    static const char *const names[DSP_LIMITER_MODE_COUNT] = {
+        "hard", "soft", "lookahead", "truepeak",
+    };
+    return (mode < DSP_LIMITER_MODE_COUNT) ? names[mode] : "?";
+}
+
+void dsp_chain_set_kernel_mode(dsp_chain_t *chain, dsp_kernel_mode_t mode)
+{
+    if (mode >= DSP_KERNEL_MODE_COUNT) mode = DSP_KERNEL_AUTO;
+    chain->kernel_mode = mode;
+    dsp_chain_publish(chain, false);
+    ESP_LOGI(TAG, "Biquad kernel: %s (%d of %d sections on Q31)", dsp_chain_kernel_name(mode),
+             __builtin_popcount(chain->fixed_mask), chain->num_biquads);
+}
+
+dsp_kernel_mode_t dsp_chain_get_kernel_mode(const dsp_chain_t *chain)
 {
-    if (enabled && !chain->crossfeed_enabled) {
-        crossfeed_init(&chain->crossfeed, chain->format.sample_rate);
+    return chain->kernel_mode;
+}
+
+const char *dsp_chain_kernel_name(dsp_kernel_mode_t mode)
+{
+    static const char *const names[DSP_KERNEL_MODE_COUNT] = {
+        "auto", "float", "fixed",
+    };
+    return (mode < DSP_KERNEL_MODE_COUNT) ? names[mode] : "?";
+}
+
+bool dsp_chain_update_quality(dsp_chain_t *chain)
+{
+    if (!chain->quality_adaptive) {
+        return false;
     }
+
+    // Only single steps from the applied level count: a request raised
+    // against a set that has since been replaced is stale
+    uint32_t want = __atomic_load_n(&chain->quality_want, __ATOMIC_ACQUIRE);
+    if (want >= DSP_QUALITY_COUNT ||
+        (want != (uint32_t)chain->quality + 1 && want + 1 != (uint32_t)chain->quality)) {
+        return false;
+    }
+
+    dsp_quality_t from = chain->quality;
+    chain->quality = (dsp_quality_t)want;
+    dsp_chain_publish(chain, false);
+
+    const dsp_stats_t *st = &chain->stats;
+    if (chain->quality > from) {
+        ESP_LOGW(TAG, "DSP load %.0f%% of block deadline: quality %s -> %s",
+                 st->cpu_usage_percent, dsp_chain_quality_name(from),
+                 dsp_chain_quality_name(chain->quality));
+    } else {
+        ESP_LOGI(TAG, "DSP load back to %.0f%%: quality %s -> %s",
+                 st->cpu_usage_percent, dsp_chain_quality_name(from),
+                 dsp_chain_quality_name(chain->quality));
+    }
+    return true;
+}
+
+void dsp_chain_set_quality_adaptive(dsp_chain_t *chain, bool enabled)
+{
+    chain->quality_adaptive = enabled;
+    __atomic_store_n(&chain->quality_want, (uint32_t)chain->quality, __ATOMIC_RELEASE);
+    if (!enabled && chain->quality != DSP_QUALITY_FULL) {
+        chain->quality = DSP_QUALITY_FULL;
+        dsp_chain_publish(chain, false);
+    }
+    ESP_LOGI(TAG, "Adaptive quality: %s", enabled ? "ON" : "OFF");
+}
+
+bool dsp_chain_get_quality_adaptive(const dsp_chain_t *chain)
+{
+    return chain->quality_adaptive;
+}
+
+dsp_quality_t dsp_chain_get_quality(const dsp_chain_t *chain)
+{
+    return chain->quality;
+}
+
+const char *dsp_chain_quality_name(dsp_quality_t quality)
+{
+    static const char *const names[DSP_QUALITY_COUNT] = {
+        "full", "float", "merged", "minimal",
+    };
+    return (quality < DSP_QUALITY_COUNT) ? names[quality] : "?";
+}
+
+void dsp_chain_set_crossfeed(dsp_chain_t *chain, bool enabled)
+{
     chain->crossfeed_enabled = enabled;
+    dsp_chain_publish(chain, false);
     ESP_LOGI(TAG, "Crossfeed: %s", enabled ? "ON" : "OFF");
 }
 
@@ -387,6 +1250,78 @@ bool dsp_chain_get_crossfeed(const dsp_chain_t *chain)
     return chain->crossfeed_enabled;
 }
 
+void dsp_chain_set_loudness(dsp_chain_t *chain, bool enabled)
+{
+    chain->loudness_enabled = enabled;
+    dsp_chain_publish(chain, false);
+    ESP_LOGI(TAG, "Loudness: %s", enabled ? "ON" : "OFF");
+}
+
+bool dsp_chain_get_loudness(const dsp_chain_t *chain)
+{
+    return chain->loudness_enabled;
+}
+
+void dsp_chain_set_listening_level(dsp_chain_t *chain, float volume_db)
+{
+    if (volume_db > 0.0f) volume_db = 0.0f;
+    if (volume_db < -120.0f) volume_db = -120.0f;
+    __atomic_store_n(&chain->listen_q8, (int32_t)lrintf(volume_db * 256.0f), __ATOMIC_RELAXED);
+}
+
+float dsp_chain_get_listening_level(const dsp_chain_t *chain)
+{
+    return (float)__atomic_load_n(&chain->listen_q8, __ATOMIC_RELAXED) / 256.0f;
+}
+
+void dsp_chain_set_volume(dsp_chain_t *chain, float volume_db)
+{
+    __atomic_store_n(&chain->volume_gain, dsp_volume_gain_from_db(volume_db), __ATOMIC_RELAXED);
+}
+
+float dsp_chain_get_volume(const dsp_chain_t *chain)
+{
+    const uint32_t gain = __atomic_load_n(&chain->volume_gain, __ATOMIC_RELAXED);
+    if (gain == 0) {
+        return DSP_VOLUME_MIN_DB;
+    }
+    return 20.0f * log10f((float)gain / (float)DSP_VOLUME_UNITY);
+}
+
+void dsp_chain_set_mute(dsp_chain_t *chain, bool muted)
+{
+    __atomic_store_n(&chain->muted, muted ? 1u : 0u, __ATOMIC_RELAXED);
+}
+
+bool dsp_chain_get_mute(const dsp_chain_t *chain)
+{
+    return __atomic_load_n(&chain->muted, __ATOMIC_RELAXED) != 0;
+}
+
+void dsp_chain_set_dither(dsp_chain_t *chain, dsp_dither_t dither)
+{
+    if (dither >= DSP_DITHER_COUNT) {
+        return;
+    }
+    chain->dither = dither;
+    dsp_chain_publish(chain, false);
+    ESP_LOGI(TAG, "Dither: %s", dsp_dither_name(dither));
+}
+
+dsp_dither_t dsp_chain_get_dither(const dsp_chain_t *chain)
+{
+    return chain->dither;
+}
+
+void dsp_chain_set_oversampling(dsp_chain_t *chain, uint8_t factor, uint16_t cycles)
+{
+    chain->os_factor = factor;
+    chain->os_cycles = (factor > 1) ? cycles : 0;
+    dsp_chain_publish(chain, false);
+    ESP_LOGI(TAG, "Oversampling after chain: %ux (%u cycles/sample reserved)",
+             factor, chain->os_cycles);
+}
+
 bool dsp_chain_set_user_band(dsp_chain_t *chain, uint8_t band,
                               const biquad_params_t *params)
 {
@@ -428,25 +1363,19 @@ void dsp_chain_update_format(dsp_chain_t *chain, const audio_format_t *format)
     // Store new format
     chain->format = *format;
 
-    // Reload current preset with new sample rate
-    dsp_chain_load_preset(chain, chain->current_preset);
+    // Different rate, different load: start again from full quality
+    chain->quality = DSP_QUALITY_FULL;
+    __atomic_store_n(&chain->quality_want, DSP_QUALITY_FULL, __ATOMIC_RELEASE);
 
-    // Reset filter state to prevent transients from previous format
+    // Select the precomputed row for the new rate and reset filter state
+    // to prevent transients from previous format
     dsp_chain_reset(chain);
 }
 
 void dsp_chain_reset(dsp_chain_t *chain)
 {
-    // Reset all biquad state variables
-    for (uint8_t i = 0; i < chain->num_biquads; i++) {
-        biquad_reset(&chain->biquads[i]);
-    }
-
-    // Reset crossfeed state
-    if (chain->crossfeed_enabled) {
-        chain->crossfeed.w_l[0] = chain->crossfeed.w_l[1] = 0.0f;
-        chain->crossfeed.w_r[0] = chain->crossfeed.w_r[1] = 0.0f;
-    }
+    // Applied by the audio task at its next block boundary
+    dsp_chain_publish(chain, true);
 
     ESP_LOGI(TAG, "DSP chain state reset");
 }
@@ -460,6 +1389,39 @@ const dsp_stats_t *dsp_chain_get_stats(const dsp_chain_t *chain)
     return &chain->stats;
 }
 
+// Profile row of a rate, -1 if it has none
+static int dsp_chain_prof_row(const dsp_chain_t *chain, uint32_t sample_rate)
+{
+    int r = dsp_rate_index(sample_rate);
+    if (r >= 0) return r;
+    return (sample_rate == chain->prof_unlisted_rate) ? DSP_NUM_RATES : -1;
+}
+
+bool dsp_chain_get_stage_stats(const dsp_chain_t *chain, uint32_t sample_rate,
+                               dsp_stage_t stage, dsp_prof_stats_t *out)
+{
+    int r = dsp_chain_prof_row(chain, sample_rate);
+    if (r < 0 || stage >= DSP_STAGE_COUNT) {
+        memset(out, 0, sizeof(*out));
+        return false;
+    }
+    dsp_prof_get(&chain->prof[r][stage], out);
+    return true;
+}
+
+void dsp_chain_reset_profile(dsp_chain_t *chain)
+{
+    __atomic_store_n(&chain->prof_reset, 1, __ATOMIC_RELEASE);
+}
+
+const char *dsp_chain_stage_name(dsp_stage_t stage)
+{
+    static const char *const names[DSP_STAGE_COUNT] = {
+        "deint", "q31", "loud", "biquad", "xfeed", "fir", "limiter", "reint", "total",
+    };
+    return (stage < DSP_STAGE_COUNT) ? names[stage] : "?";
+}
+
 eq_preset_t dsp_chain_get_preset(const dsp_chain_t *chain)
 {
     return chain->current_preset;
@@ -469,38 +1431,100 @@ eq_preset_t dsp_chain_get_preset(const dsp_chain_t *chain)
 // CPU Budget Management
 //--------------------------------------------------------------------+
 
-// CPU configuration
-#define ESP32P4_CPU_FREQ_MHZ 400
-
-// Cycle costs (estimated for DFII-T batch + fast limiter)
-#define CYCLES_BASE_OVERHEAD  20    // Deinterleave + fast limiter + reinterleave
-#define CYCLES_PER_FILTER     14    // DFII-T inline biquad (compiler-optimized)
+// Cycle costs per sample. The float figures are the per-section DFII-T
+// ones (a stereo section is ~10 FMAs on the P4's single FPU); the fused
+// cascade has not been measured on the board yet, so they stay until
+// `dsp bench` gives target numbers.
+#define CYCLES_BASE_OVERHEAD  34    // Deinterleave + fast limiter + reinterleave
+#define CYCLES_PER_FILTER     18    // DFII-T biquad, per section
+#define CYCLES_PER_FILTER_Q31 36    // Q31 DF-I: 5 × (mul + mulh) + 64-bit adds + error feedback
 #define CYCLES_CROSSFEED     100    // Crossfeed effect (future)
 #define CYCLES_DRC            80    // Dynamic range compression (future)
 
-void dsp_chain_get_budget(const dsp_chain_t *chain, dsp_budget_t *budget)
+// DSP_MAX_BIQUADS is what the model fits up to 192 kHz inside the 85 %
+// DSP_SAFETY_MARGIN; above that the budget check caps it (24 sections at
+// 352.8 kHz, 22 at 384 kHz)
+_Static_assert(((ESP32P4_CPU_FREQ_MHZ * 1000000u / (192000u * 2u)) * 85u / 100u -
+                CYCLES_BASE_OVERHEAD) / CYCLES_PER_FILTER >= DSP_MAX_BIQUADS,
+               "DSP_MAX_BIQUADS does not fit the 192 kHz budget");
+
+// Loudness shelves (Q31, never degraded by the quality levels)
+static uint16_t dsp_chain_loudness_cycles(const dsp_chain_t *chain)
+{
+    return chain->loudness_enabled ? DSP_LOUDNESS_SECTIONS * CYCLES_PER_FILTER_Q31 : 0;
+}
+
+// Output gain + requantisation on top of the plain reinterleave
+static uint16_t dsp_chain_volume_cycles(const dsp_chain_t *chain)
+{
+    return dsp_volume_cycles_per_sample(chain->dither,
+                                        (chain->format.bits_per_sample <= 16) ? 16 : 32);
+}
+
+// Look-ahead limiter on top of the base overhead (hard / soft are in it)
+static uint16_t dsp_chain_limiter_cycles(dsp_limiter_mode_t mode)
+{
+    if (mode < DSP_LIMITER_LOOKAHEAD) return 0;
+    return dsp_limiter_cycles_per_sample(mode == DSP_LIMITER_TRUE_PEAK);
+}
+
+// Sections a quality level folds away
+static uint8_t dsp_chain_merged_count(const dsp_chain_t *chain, dsp_quality_t level)
+{
+    if (level < DSP_QUALITY_MERGED) return 0;
+    return (uint8_t)__builtin_popcount(chain->low_mask & ((1u << chain->num_biquads) - 1u));
+}
+
+static bool dsp_chain_crossfeed_on(const dsp_chain_t *chain, dsp_quality_t level)
+{
+    return chain->crossfeed_enabled && level < DSP_QUALITY_MINIMAL;
+}
+
+// Modelled cost per sample of the configuration at a quality level
+static uint16_t dsp_chain_model_cycles(const dsp_chain_t *chain, dsp_quality_t level,
+                                       uint8_t on_q31)
+{
+    uint8_t sections = chain->num_biquads - dsp_chain_merged_count(chain, level);
+    uint16_t cycles = CYCLES_BASE_OVERHEAD +
+                      ((sections - on_q31) * CYCLES_PER_FILTER) +
+                      (on_q31 * CYCLES_PER_FILTER_Q31);
+
+    if (dsp_chain_crossfeed_on(chain, level)) {
+        cycles += CYCLES_CROSSFEED;
+    }
+    cycles += dsp_chain_conv_cycles(chain);
+    cycles += dsp_chain_limiter_cycles(chain->limiter_mode);
+    cycles += dsp_chain_loudness_cycles(chain);
+    cycles += dsp_chain_volume_cycles(chain);
+    return cycles;
+}
+
+// Budget from the cost model alone: what the planning checks use
+static void dsp_chain_model_budget(const dsp_chain_t *chain, dsp_budget_t *budget)
 {
     // Calculate cycles available per sample
     // Budget = CPU_freq / (sample_rate × channels)
     uint32_t cycles_per_sample = (ESP32P4_CPU_FREQ_MHZ * 1000000) /
                                   (chain->format.sample_rate * chain->format.channels);
 
-    // Apply safety margin (use only 85% of budget)
+    // Apply safety margin (use only 85% of budget), minus the oversampler
+    // that follows the chain on the same core
     uint16_t cycles_safe = (uint16_t)(cycles_per_sample * DSP_SAFETY_MARGIN);
+    cycles_safe = (cycles_safe > chain->os_cycles) ? cycles_safe - chain->os_cycles : 0;
 
-    // Calculate cycles used
-    uint16_t cycles_used = CYCLES_BASE_OVERHEAD +
-                           (chain->num_biquads * CYCLES_PER_FILTER);
-
-    if (chain->crossfeed_enabled) {
-        cycles_used += CYCLES_CROSSFEED;
-    }
+    // Calculate cycles used at the current quality level
+    uint8_t on_q31 = (uint8_t)__builtin_popcount(chain->fixed_mask);
+    uint16_t cycles_used = dsp_chain_model_cycles(chain, chain->quality, on_q31);
+    uint16_t conv_cycles = dsp_chain_conv_cycles(chain);
+    uint16_t limiter_cycles = dsp_chain_limiter_cycles(chain->limiter_mode);
+    uint16_t loudness_cycles = dsp_chain_loudness_cycles(chain);
+    uint16_t volume_cycles = dsp_chain_volume_cycles(chain);
 
     // Calculate max filters that fit in budget
-    uint16_t cycles_for_filters = cycles_safe - CYCLES_BASE_OVERHEAD;
-    if (chain->crossfeed_enabled) {
-        cycles_for_filters -= CYCLES_CROSSFEED;
-    }
+    uint16_t fixed = CYCLES_BASE_OVERHEAD + conv_cycles + limiter_cycles + loudness_cycles +
+                     volume_cycles +
+                     (dsp_chain_crossfeed_on(chain, chain->quality) ? CYCLES_CROSSFEED : 0);
+    uint16_t cycles_for_filters = (cycles_safe > fixed) ? cycles_safe - fixed : 0;
 
     uint8_t filters_max = (uint8_t)(cycles_for_filters / CYCLES_PER_FILTER);
 
@@ -518,29 +1542,112 @@ void dsp_chain_get_budget(const dsp_chain_t *chain, dsp_budget_t *budget)
     budget->cycles_per_sample = (uint16_t)cycles_per_sample;
     budget->cycles_used = cycles_used;
     budget->cycles_available = cycles_safe;
-    budget->filters_active = chain->num_biquads;
+    budget->filters_merged = dsp_chain_merged_count(chain, chain->quality);
+    budget->filters_active = chain->num_biquads - budget->filters_merged;
     budget->filters_max = filters_max;
     budget->cpu_usage_percent = (float)cycles_used / cycles_per_sample * 100.0f;
+    budget->conv_cycles = conv_cycles;
+    budget->conv_taps = chain->conv ? dsp_conv_get_taps(chain->conv) : 0;
+    budget->limiter_cycles = limiter_cycles;
+    budget->loudness_cycles = loudness_cycles;
+    budget->volume_cycles = volume_cycles;
+    budget->filters_fixed = on_q31;
+    budget->quality = chain->quality;
+    budget->load_percent = chain->stats.cpu_usage_percent;
+    budget->measured = false;
+    budget->cycles_model = cycles_used;
+    budget->cycles_p50 = 0;
+    budget->cycles_max = 0;
+    budget->os_factor = chain->os_factor;
+    budget->os_cycles = chain->os_cycles;
+}
+
+void dsp_chain_get_budget(const dsp_chain_t *chain, dsp_budget_t *budget)
+{
+    dsp_chain_model_budget(chain, budget);
+
+    // Measured whole-chain cost at this rate, once there is enough of it
+    dsp_prof_stats_t total;
+    dsp_chain_get_stage_stats(chain, chain->format.sample_rate, DSP_STAGE_TOTAL, &total);
+    if (total.count >= DSP_PROF_MIN_RECORDS) {
+        budget->measured = true;
+        budget->cycles_used = (uint16_t)(total.p99 + 0.5f);
+        budget->cycles_p50 = (uint16_t)(total.p50 + 0.5f);
+        budget->cycles_max = (uint16_t)(total.max + 0.5f);
+        budget->cpu_usage_percent = total.p99 / budget->cycles_per_sample * 100.0f;
+    }
+}
+
+/**
+ * @brief Sections to run on the Q31 kernel at the current rate (bit i = section i)
+ *
+ * AUTO takes the sections with the smallest pole margin first, as long
+ * as the extra cost of each fits the headroom left with all-float.
+ *
+ * Costs come from the model, not from dsp_prof: the choice is made when
+ * a preset is published and must not depend on what ran before, and the
+ * stage histograms hold whole-stage costs for whatever section count was
+ * live. Check CYCLES_PER_FILTER[_Q31] against `dsp bench` instead.
+ */
+static uint32_t dsp_chain_select_kernels(dsp_chain_t *chain, const float (*coef)[5],
+                                         uint32_t q_ok)
+{
+    const uint32_t eligible = q_ok & ((1u << chain->num_biquads) - 1u);
+
+    if (chain->kernel_mode == DSP_KERNEL_FLOAT) return 0;
+    if (chain->kernel_mode == DSP_KERNEL_FIXED) return eligible;
+
+    dsp_budget_t budget;
+    chain->fixed_mask = 0;
+    dsp_chain_model_budget(chain, &budget);
+    int32_t headroom = (int32_t)budget.cycles_available - (int32_t)budget.cycles_used;
+
+    uint32_t mask = 0;
+    while (headroom >= CYCLES_PER_FILTER_Q31 - CYCLES_PER_FILTER) {
+        int best = -1;
+        float best_margin = DSP_Q31_POLE_MARGIN;
+        for (uint8_t i = 0; i < chain->num_biquads; i++) {
+            if (!(eligible & ~mask & (1u << i))) continue;
+            float m = biquad_pole_margin(coef[i]);
+            if (m < best_margin) {
+                best = i;
+                best_margin = m;
+            }
+        }
+        if (best < 0) break;
+        mask |= 1u << best;
+        headroom -= CYCLES_PER_FILTER_Q31 - CYCLES_PER_FILTER;
+    }
+    return mask;
 }
 
 bool dsp_chain_can_add_filters(const dsp_chain_t *chain, uint8_t additional_filters)
 {
     dsp_budget_t budget;
-    dsp_chain_get_budget(chain, &budget);
+    dsp_chain_model_budget(chain, &budget);
+
+    // Adaptive quality: the configuration only has to fit at the lowest
+    // level (new filters are assumed not to be low-impact)
+    uint8_t limit = budget.filters_max;
+    uint16_t cycles_used = budget.cycles_used;
+    if (chain->quality_adaptive) {
+        limit = DSP_MAX_BIQUADS;
+        cycles_used = dsp_chain_model_cycles(chain, DSP_QUALITY_MINIMAL, 0);
+    }
 
     // Check if adding filters would exceed max allowed
     uint8_t total_filters = chain->num_biquads + additional_filters;
-    if (total_filters > budget.filters_max) {
+    if (total_filters > limit) {
         ESP_LOGW(TAG, "Cannot add %d filters: would exceed limit (%d + %d > %d)",
-                 additional_filters, chain->num_biquads, additional_filters, budget.filters_max);
+                 additional_filters, chain->num_biquads, additional_filters, limit);
         return false;
     }
 
     // Check if adding filters would exceed budget
-    uint16_t cycles_needed = budget.cycles_used + (additional_filters * CYCLES_PER_FILTER);
+    uint16_t cycles_needed = cycles_used + (additional_filters * CYCLES_PER_FILTER);
     if (cycles_needed > budget.cycles_available) {
         ESP_LOGW(TAG, "Cannot add %d filters: would exceed CPU budget (%d + %d > %d cycles)",
-                 additional_filters, budget.cycles_used, additional_filters * CYCLES_PER_FILTER,
+                 additional_filters, cycles_used, additional_filters * CYCLES_PER_FILTER,
                  budget.cycles_available);
         return false;
     }
@@ -582,13 +1689,31 @@ bool dsp_chain_validate_preset(const dsp_chain_t *chain, eq_preset_t preset)
 
     // Get current budget
     dsp_budget_t budget;
-    dsp_chain_get_budget(chain, &budget);
+    dsp_chain_model_budget(chain, &budget);
+
+    // Adaptive quality: the preset only has to fit at the lowest level,
+    // with its low-impact sections folded away and crossfeed off
+    uint8_t filters = config->num_filters;
+    bool crossfeed = config->enable_crossfeed;
+    uint8_t limit = budget.filters_max;
+    if (chain->quality_adaptive) {
+        for (uint8_t i = 0; i < config->num_filters; i++) {
+            if (dsp_low_impact(&config->filters[i])) {
+                filters--;
+            }
+        }
+        crossfeed = false;
+        limit = DSP_MAX_BIQUADS;
+    }
 
     // Calculate cycles needed for this preset
     uint16_t cycles_needed = CYCLES_BASE_OVERHEAD +
-                             (config->num_filters * CYCLES_PER_FILTER);
+                             (filters * CYCLES_PER_FILTER) +
+                             dsp_chain_limiter_cycles(chain->limiter_mode) +
+                             dsp_chain_loudness_cycles(chain) +
+                             dsp_chain_volume_cycles(chain);
 
-    if (config->enable_crossfeed) {
+    if (crossfeed) {
         cycles_needed += CYCLES_CROSSFEED;
     }
 
@@ -600,11 +1725,111 @@ bool dsp_chain_validate_preset(const dsp_chain_t *chain, eq_preset_t preset)
     }
 
     // Check filter count
-    if (config->num_filters > budget.filters_max) {
+    if (filters > limit) {
         ESP_LOGW(TAG, "Preset '%s' has too many filters: %d filters, max %d @ %lu Hz",
-                 config->name, config->num_filters, budget.filters_max, chain->format.sample_rate);
+                 config->name, filters, limit, chain->format.sample_rate);
         return false;
     }
 
     return true;
 }
+
+//--------------------------------------------------------------------+
+// FIR Convolution
+//--------------------------------------------------------------------+
+
+// FIR convolver cost at the current rate (0 if none or rate mismatch)
+static uint16_t dsp_chain_conv_cycles(const dsp_chain_t *chain)
+{
+    const dsp_conv_t *c = chain->conv;
+    if (!c || dsp_conv_get_sample_rate(c) != chain->format.sample_rate) {
+        return 0;
+    }
+    return dsp_conv_cycles_per_sample(dsp_conv_get_block(c), dsp_conv_get_taps(c));
+}
+
+static bool dsp_chain_conv_fits(const dsp_chain_t *chain)
+{
+    dsp_budget_t budget;
+    dsp_chain_model_budget(chain, &budget);
+    return budget.cycles_used <= budget.cycles_available;
+}
+
+// Free replaced convolvers the audio task no longer references. Besides
+// conv_live, the two slots control does not own (front and shared) are
+// checked: the audio task may have swapped a set in without having
+// stored conv_live yet.
+static void dsp_chain_conv_collect(dsp_chain_t *chain)
+{
+    dsp_conv_t *live = __atomic_load_n(&chain->conv_live, __ATOMIC_ACQUIRE);
+
+    for (int i = 0; i < DSP_CONV_RETIRED_MAX; i++) {
+        dsp_conv_t *c = chain->conv_retired[i];
+        if (!c || c == live) continue;
+
+        bool referenced = false;
+        for (uint8_t slot = 0; slot < 3; slot++) {
+            if (slot != chain->coef_back && chain->coef_sets[slot].conv == c) {
+                referenced = true;
+            }
+        }
+        if (!referenced) {
+            dsp_conv_destroy(c);
+            chain->conv_retired[i] = NULL;
+        }
+    }
+}
+
+bool dsp_chain_set_convolver(dsp_chain_t *chain, dsp_conv_t *conv)
+{
+    dsp_chain_conv_collect(chain);
+
+    if (chain->conv) {
+        int slot = -1;
+        for (int i = 0; i < DSP_CONV_RETIRED_MAX; i++) {
+            if (!chain->conv_retired[i]) { slot = i; break; }
+        }
+        if (slot < 0) {
+            ESP_LOGW(TAG, "FIR change refused: previous convolvers still in use");
+            return false;
+        }
+        chain->conv_retired[slot] = chain->conv;
+    }
+
+    chain->conv = conv;
+    dsp_chain_publish(chain, false);
+
+    if (conv) {
+        ESP_LOGI(TAG, "FIR: %lu taps, block %u, %lu Hz",
+                 (unsigned long)dsp_conv_get_taps(conv), dsp_conv_get_block(conv),
+                 (unsigned long)dsp_conv_get_sample_rate(conv));
+    } else {
+        ESP_LOGI(TAG, "FIR: off");
+    }
+    return true;
+}
+
+const dsp_conv_t *dsp_chain_get_convolver(const dsp_chain_t *chain)
+{
+    return chain->conv;
+}
+
+uint32_t dsp_chain_get_max_fir_taps(const dsp_chain_t *chain, uint16_t block)
+{
+    dsp_budget_t budget;
+    dsp_chain_model_budget(chain, &budget);
+
+    // Headroom left once everything except the FIR is accounted for
+    uint16_t used = budget.cycles_used - budget.conv_cycles;
+    if (budget.cycles_available <= used) {
+        return 0;
+    }
+    uint16_t avail = budget.cycles_available - used;
+
+    uint32_t best = 0;
+    for (uint32_t taps = block; taps <= DSP_CONV_MAX_TAPS; taps += block) {
+        if (dsp_conv_cycles_per_sample(block, taps) > avail) break;
+        best = taps;
+    }
+    return best;
+}
@@ -0,0 +1,367 @@
+#include "dsp_conv.h"
+#include "dsp_fft.h"
+#include "audio_codecs.h"
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+
+static const char *TAG = "dsp_conv";
+
+// int32 left-justified → float
+#define INT32_TO_FLOAT_SCALE  (1.0f / 2147483648.0f)
+
+// Frames read per codec_decode() call while loading an impulse response
+#define LOAD_CHUNK_FRAMES 512
+
+// Cost model (cycles, ESP32-P4 @ 400 MHz — check with `dsp bench conv`)
+#define CONV_CYCLES_BUTTERFLY  14   // radix-2 complex butterfly, internal RAM
+#define CONV_CYCLES_SPLIT      10   // per bin: pack/split L/R spectra
+#define CONV_CYCLES_CMAC       10   // per bin per channel: complex MAC, PSRAM operands
+
+struct dsp_conv_s {
+    uint32_t taps;
+    uint32_t sample_rate;
+    uint16_t block;         // B — frames per partition / latency
+    uint16_t parts;         // P — partitions
+    uint16_t bins;          // B + 1 — half spectrum of the 2B-point FFT
+
+    dsp_fft_plan_t plan;    // 2B points
+
+    // PSRAM: [P][2 ch][bins] complex
+    float *H;               // partition spectra, pre-scaled by 1/(2·2B)
+    float *X;               // frequency-domain delay line (ring)
+    uint16_t fdl_pos;
+
+    // Internal RAM
+    float *work;            // 2B complex
+    float *acc;             // [2 ch][bins] complex
+    float *prev_L, *prev_R; // previous input block (overlap half)
+    float *in_L, *in_R;     // input staging
+    float *out_L, *out_R;   // output of last block
+    uint16_t fill;          // frames staged in current block
+};
+
+//--------------------------------------------------------------------+
+// Helpers
+//--------------------------------------------------------------------+
+
+static void *conv_alloc_psram(size_t bytes)
+{
+    void *p = heap_caps_calloc(1, bytes, MALLOC_CAP_SPIRAM);
+    if (!p) {
+        p = calloc(1, bytes);
+    }
+    return p;
+}
+
+static inline float *conv_spec(float *base, const dsp_conv_t *c, uint16_t part, int ch)
+{
+    return base + ((size_t)part * 2 + ch) * c->bins * 2;
+}
+
+/**
+ * @brief Split a packed spectrum Z = FFT(l + j·r) into 2·L and 2·R (bins 0..B)
+ *
+ *   2·L[k] = Z[k] + conj(Z[N−k])
+ *   2·R[k] = −j · (Z[k] − conj(Z[N−k]))
+ */
+static void conv_split(const float *Z, uint16_t n, uint16_t bins, float *L, float *R)
+{
+    for (uint16_t k = 0; k < bins; k++) {
+        const uint16_t m = (k == 0) ? 0 : (uint16_t)(n - k);
+        const float ar = Z[2 * k], ai = Z[2 * k + 1];
+        const float br = Z[2 * m], bi = -Z[2 * m + 1];
+        L[2 * k]     = ar + br;
+        L[2 * k + 1] = ai + bi;
+        R[2 * k]     = ai - bi;
+        R[2 * k + 1] = -(ar - br);
+    }
+}
+
+//--------------------------------------------------------------------+
+// Create / Destroy
+//--------------------------------------------------------------------+
+
+dsp_conv_t *dsp_conv_create(const float *ir_L, const float *ir_R, uint32_t taps,
+                            uint16_t block, uint32_t sample_rate)
+{
+    if (!ir_L || !ir_R || taps == 0 || taps > DSP_CONV_MAX_TAPS ||
+        block < DSP_CONV_BLOCK_MIN || block > DSP_CONV_BLOCK_MAX ||
+        (block & (block - 1)) != 0) {
+        ESP_LOGE(TAG, "Invalid convolver config: %lu taps, block %u",
+                 (unsigned long)taps, block);
+        return NULL;
+    }
+
+    dsp_conv_t *c = calloc(1, sizeof(dsp_conv_t));
+    if (!c) return NULL;
+
+    c->taps = taps;
+    c->sample_rate = sample_rate;
+    c->block = block;
+    c->parts = (uint16_t)((taps + block - 1) / block);
+    c->bins = block + 1;
+
+    const uint16_t n = 2 * block;
+    const size_t spec_bytes = (size_t)c->parts * 2 * c->bins * 2 * sizeof(float);
+
+    bool ok = dsp_fft_plan_init(&c->plan, n);
+    c->H      = conv_alloc_psram(spec_bytes);
+    c->X      = conv_alloc_psram(spec_bytes);
+    c->work   = calloc((size_t)n * 2, sizeof(float));
+    c->acc    = calloc((size_t)2 * c->bins * 2, sizeof(float));
+    c->prev_L = calloc(block, sizeof(float));
+    c->prev_R = calloc(block, sizeof(float));
+    c->in_L   = calloc(block, sizeof(float));
+    c->in_R   = calloc(block, sizeof(float));
+    c->out_L  = calloc(block, sizeof(float));
+    c->out_R  = calloc(block, sizeof(float));
+
+    if (!ok || !c->H || !c->X || !c->work || !c->acc || !c->prev_L || !c->prev_R ||
+        !c->in_L || !c->in_R || !c->out_L || !c->out_R) {
+        ESP_LOGE(TAG, "Out of memory (%u partitions, %lu bytes spectra)",
+                 c->parts, (unsigned long)(2 * spec_bytes));
+        dsp_conv_destroy(c);
+        return NULL;
+    }
+
+    // Partition spectra: zero-padded 2B-point FFT of each B-tap slice.
+    // Scaled by 1/(2·N): ×2 from the unnormalised split, ×N from the
+    // unscaled inverse FFT.
+    const float scale = 1.0f / (2.0f * (float)n);
+    for (uint16_t p = 0; p < c->parts; p++) {
+        memset(c->work, 0, (size_t)n * 2 * sizeof(float));
+        for (uint16_t k = 0; k < block; k++) {
+            uint32_t t = (uint32_t)p * block + k;
+            if (t >= taps) break;
+            c->work[2 * k]     = ir_L[t];
+            c->work[2 * k + 1] = ir_R[t];
+        }
+        dsp_fft_forward(&c->plan, c->work);
+
+        float *HL = conv_spec(c->H, c, p, 0);
+        float *HR = conv_spec(c->H, c, p, 1);
+        conv_split(c->work, n, c->bins, HL, HR);
+        for (uint16_t k = 0; k < c->bins * 2; k++) {
+            HL[k] *= scale * 0.5f;
+            HR[k] *= scale * 0.5f;
+        }
+    }
+
+    ESP_LOGI(TAG, "Convolver: %lu taps @ %lu Hz, %u × %u partitions, ~%u cyc/sample",
+             (unsigned long)taps, (unsigned long)sample_rate, c->parts, block,
+             dsp_conv_cycles_per_sample(block, taps));
+    return c;
+}
+
+void dsp_conv_destroy(dsp_conv_t *conv)
+{
+    if (!conv) return;
+    dsp_fft_plan_free(&conv->plan);
+    free(conv->H);
+    free(conv->X);
+    free(conv->work);
+    free(conv->acc);
+    free(conv->prev_L);
+    free(conv->prev_R);
+    free(conv->in_L);
+    free(conv->in_R);
+    free(conv->out_L);
+    free(conv->out_R);
+    free(conv);
+}
+
+dsp_conv_t *dsp_conv_load_file(const char *path, uint16_t block)
+{
+    codec_handle_t *h = codec_open(path);
+    if (!h) {
+        ESP_LOGE(TAG, "Cannot open impulse response: %s", path);
+        return NULL;
+    }
+
+    const codec_info_t *info = codec_get_info(h);
+    if (info->is_dsd) {
+        ESP_LOGE(TAG, "DSD impulse responses not supported: %s", path);
+        codec_close(h);
+        return NULL;
+    }
+
+    uint32_t cap = DSP_CONV_MAX_TAPS;
+    if (info->total_frames > 0 && info->total_frames < cap) {
+        cap = (uint32_t)info->total_frames;
+    }
+
+    float *ir_L = conv_alloc_psram(cap * sizeof(float));
+    float *ir_R = conv_alloc_psram(cap * sizeof(float));
+    int32_t *pcm = malloc(LOAD_CHUNK_FRAMES * 2 * sizeof(int32_t));
+    if (!ir_L || !ir_R || !pcm) {
+        ESP_LOGE(TAG, "Out of memory loading %s", path);
+        free(ir_L); free(ir_R); free(pcm);
+        codec_close(h);
+        return NULL;
+    }
+
+    uint32_t taps = 0;
+    while (taps < cap) {
+        uint32_t want = cap - taps;
+        if (want > LOAD_CHUNK_FRAMES) want = LOAD_CHUNK_FRAMES;
+        int32_t got = codec_decode(h, pcm, want);
+        if (got <= 0) break;
+        for (int32_t i = 0; i < got; i++) {
+            ir_L[taps + i] = (float)pcm[i * 2]     * INT32_TO_FLOAT_SCALE;
+            ir_R[taps + i] = (float)pcm[i * 2 + 1] * INT32_TO_FLOAT_SCALE;
+        }
+        taps += (uint32_t)got;
+    }
+
+    if (info->total_frames > DSP_CONV_MAX_TAPS) {
+        ESP_LOGW(TAG, "%s: %llu taps, truncated to %d",
+                 path, (unsigned long long)info->total_frames, DSP_CONV_MAX_TAPS);
+    }
+
+    uint32_t rate = info->sample_rate;
+    codec_close(h);
+    free(pcm);
+
+    dsp_conv_t *c = (taps > 0) ? dsp_conv_create(ir_L, ir_R, taps, block, rate) : NULL;
+    free(ir_L);
+    free(ir_R);
+    return c;
+}
+
+//--------------------------------------------------------------------+
+// Processing
+//--------------------------------------------------------------------+
+
+/**
+ * @brief One partition step: B staged frames in → B frames out
+ */
+__attribute__((hot))
+static void conv_block(dsp_conv_t *c)
+{
+    const uint16_t B = c->block;
+    const uint16_t n = 2 * B;
+    float *w = c->work;
+
+    // Overlap-save input: [previous block | current block], L→re, R→im
+    for (uint16_t k = 0; k < B; k++) {
+        w[2 * k]           = c->prev_L[k];
+        w[2 * k + 1]       = c->prev_R[k];
+        w[2 * (B + k)]     = c->in_L[k];
+        w[2 * (B + k) + 1] = c->in_R[k];
+    }
+    memcpy(c->prev_L, c->in_L, B * sizeof(float));
+    memcpy(c->prev_R, c->in_R, B * sizeof(float));
+
+    dsp_fft_forward(&c->plan, w);
+
+    // Newest spectrum into the delay line
+    conv_split(w, n, c->bins, conv_spec(c->X, c, c->fdl_pos, 0),
+               conv_spec(c->X, c, c->fdl_pos, 1));
+
+    // Y = Σ_p X[now − p] · H[p]
+    float *accL = c->acc;
+    float *accR = c->acc + c->bins * 2;
+    memset(c->acc, 0, (size_t)2 * c->bins * 2 * sizeof(float));
+
+    uint16_t slot = c->fdl_pos;
+    for (uint16_t p = 0; p < c->parts; p++) {
+        for (int ch = 0; ch < 2; ch++) {
+            const float *x = conv_spec(c->X, c, slot, ch);
+            const float *h = conv_spec(c->H, c, p, ch);
+            float *y = ch ? accR : accL;
+            for (uint16_t k = 0; k < c->bins; k++) {
+                const float xr = x[2 * k], xi = x[2 * k + 1];
+                const float hr = h[2 * k], hi = h[2 * k + 1];
+                y[2 * k]     += xr * hr - xi * hi;
+                y[2 * k + 1] += xr * hi + xi * hr;
+            }
+        }
+        slot = (slot == 0) ? (uint16_t)(c->parts - 1) : (uint16_t)(slot - 1);
+    }
+
+    // Repack Y = YL + j·YR over the full circle (Hermitian halves)
+    for (uint16_t k = 0; k < c->bins; k++) {
+        w[2 * k]     = accL[2 * k]     - accR[2 * k + 1];
+        w[2 * k + 1] = accL[2 * k + 1] + accR[2 * k];
+    }
+    for (uint16_t k = c->bins; k < n; k++) {
+        const uint16_t m = n - k;
+        w[2 * k]     = accL[2 * m]      + accR[2 * m + 1];
+        w[2 * k + 1] = -accL[2 * m + 1] + accR[2 * m];
+    }
+
+    dsp_fft_inverse(&c->plan, w);
+
+    // Valid half of the circular result
+    for (uint16_t k = 0; k < B; k++) {
+        c->out_L[k] = w[2 * (B + k)];
+        c->out_R[k] = w[2 * (B + k) + 1];
+    }
+
+    c->fdl_pos = (uint16_t)((c->fdl_pos + 1) % c->parts);
+}
+
+__attribute__((hot))
+void dsp_conv_process(dsp_conv_t *conv, float *buf_L, float *buf_R, uint32_t frames)
+{
+    while (frames > 0) {
+        uint32_t k = conv->block - conv->fill;
+        if (k > frames) k = frames;
+
+        memcpy(&conv->in_L[conv->fill], buf_L, k * sizeof(float));
+        memcpy(&conv->in_R[conv->fill], buf_R, k * sizeof(float));
+        memcpy(buf_L, &conv->out_L[conv->fill], k * sizeof(float));
+        memcpy(buf_R, &conv->out_R[conv->fill], k * sizeof(float));
+
+        conv->fill += (uint16_t)k;
+        buf_L += k;
+        buf_R += k;
+        frames -= k;
+
+        if (conv->fill == conv->block) {
+            conv_block(conv);
+            conv->fill = 0;
+        }
+    }
+}
+
+void dsp_conv_reset(dsp_conv_t *conv)
+{
+    const size_t spec_bytes = (size_t)conv->parts * 2 * conv->bins * 2 * sizeof(float);
+    memset(conv->X, 0, spec_bytes);
+    memset(conv->prev_L, 0, conv->block * sizeof(float));
+    memset(conv->prev_R, 0, conv->block * sizeof(float));
+    memset(conv->out_L, 0, conv->block * sizeof(float));
+    memset(conv->out_R, 0, conv->block * sizeof(float));
+    conv->fill = 0;
+    conv->fdl_pos = 0;
+}
+
+//--------------------------------------------------------------------+
+// Queries / Cost Model
+//--------------------------------------------------------------------+
+
+uint32_t dsp_conv_get_taps(const dsp_conv_t *conv)        { return conv->taps; }
+uint16_t dsp_conv_get_block(const dsp_conv_t *conv)       { return conv->block; }
+uint32_t dsp_conv_get_sample_rate(const dsp_conv_t *conv) { return conv->sample_rate; }
+
+uint16_t dsp_conv_cycles_per_sample(uint16_t block, uint32_t taps)
+{
+    if (block == 0) return 0;
+
+    uint32_t n = 2u * block;
+    uint32_t log2n = 0;
+    while ((1u << log2n) < n) log2n++;
+    uint32_t parts = (taps + block - 1) / block;
+
+    // Per block: forward + inverse FFT, split + repack, P·(B+1)·2 CMACs
+    uint32_t per_block = 2u * (n / 2) * log2n * CONV_CYCLES_BUTTERFLY +
+                         2u * (block + 1) * CONV_CYCLES_SPLIT +
+                         parts * (block + 1) * 2u * CONV_CYCLES_CMAC;
+
+    // Budget unit is one sample of one channel
+    uint32_t cps = per_block / (2u * block);
+    return (cps > UINT16_MAX) ? UINT16_MAX : (uint16_t)cps;
+}
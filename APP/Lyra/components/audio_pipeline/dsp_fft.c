@@ -0,0 +1,107 @@
+#include "dsp_fft.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// M_PI not always defined in math.h
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+//--------------------------------------------------------------------+
+// Plan Management
+//--------------------------------------------------------------------+
+
+bool dsp_fft_plan_init(dsp_fft_plan_t *plan, uint16_t n)
+{
+    memset(plan, 0, sizeof(*plan));
+
+    if (n < 4 || n > DSP_FFT_MAX_SIZE || (n & (n - 1)) != 0) {
+        return false;
+    }
+
+    uint8_t log2n = 0;
+    while ((1u << log2n) < n) log2n++;
+
+    plan->twiddle = malloc((n / 2) * 2 * sizeof(float));
+    plan->bitrev  = malloc(n * sizeof(uint16_t));
+    if (!plan->twiddle || !plan->bitrev) {
+        dsp_fft_plan_free(plan);
+        return false;
+    }
+
+    // Twiddles in double precision — tables are built once, off the audio task
+    for (uint16_t k = 0; k < n / 2; k++) {
+        double a = 2.0 * M_PI * (double)k / (double)n;
+        plan->twiddle[2 * k]     = (float)cos(a);
+        plan->twiddle[2 * k + 1] = (float)-sin(a);
+    }
+
+    for (uint16_t i = 0; i < n; i++) {
+        uint16_t r = 0;
+        for (uint8_t b = 0; b < log2n; b++) {
+            r |= ((i >> b) & 1u) << (log2n - 1 - b);
+        }
+        plan->bitrev[i] = r;
+    }
+
+    plan->n = n;
+    plan->log2n = log2n;
+    return true;
+}
+
+void dsp_fft_plan_free(dsp_fft_plan_t *plan)
+{
+    free(plan->twiddle);
+    free(plan->bitrev);
+    memset(plan, 0, sizeof(*plan));
+}
+
+//--------------------------------------------------------------------+
+// Transform — iterative decimation-in-time, bit-reversed input
+//--------------------------------------------------------------------+
+
+__attribute__((hot))
+static void fft_core(const dsp_fft_plan_t *plan, float *data, float sign)
+{
+    const uint16_t n = plan->n;
+
+    for (uint16_t i = 0; i < n; i++) {
+        uint16_t j = plan->bitrev[i];
+        if (j > i) {
+            float tr = data[2 * i], ti = data[2 * i + 1];
+            data[2 * i]     = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j]     = tr;
+            data[2 * j + 1] = ti;
+        }
+    }
+
+    // sign = +1 forward (w = e^-j), -1 inverse (conjugate twiddles)
+    for (uint16_t half = 1, stride = n / 2; half < n; half <<= 1, stride >>= 1) {
+        for (uint16_t base = 0; base < n; base += 2 * half) {
+            for (uint16_t k = 0; k < half; k++) {
+                const float wr = plan->twiddle[2 * k * stride];
+                const float wi = plan->twiddle[2 * k * stride + 1] * sign;
+                float *a = &data[2 * (base + k)];
+                float *b = &data[2 * (base + k + half)];
+                const float br = b[0] * wr - b[1] * wi;
+                const float bi = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - br;
+                b[1] = a[1] - bi;
+                a[0] += br;
+                a[1] += bi;
+            }
+        }
+    }
+}
+
+void dsp_fft_forward(const dsp_fft_plan_t *plan, float *data)
+{
+    fft_core(plan, data, 1.0f);
+}
+
+void dsp_fft_inverse(const dsp_fft_plan_t *plan, float *data)
+{
+    fft_core(plan, data, -1.0f);
+}
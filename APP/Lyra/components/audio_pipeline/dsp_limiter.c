@@ -0,0 +1,219 @@
+#include "dsp_limiter.h"
+#include <string.h>
+#include <math.h>
+
+#define RING_MASK  (DSP_LIMITER_RING - 1)
+#define TP_TAPS    DSP_LIMITER_TP_TAPS
+
+// Interpolator centre: phases k = 0..3 estimate x at n − 6 + (2k+1)/8
+#define TP_CENTRE  6
+
+// Cost model (budget units: per sample of one channel). Detector, deque,
+// envelope and delay line ~14 cycles; the true-peak FIR adds 4 phases ×
+// 12 taps per channel plus the abs/max.
+#define CYCLES_LIMITER      14
+#define CYCLES_LIMITER_TP   70
+
+// ITU-R BS.1770-4 Annex 2 true-peak interpolator: y_k[n] = Σ c[k][j] x[n-j]
+static const float s_tp_coef[DSP_LIMITER_TP_PHASES][TP_TAPS] = {
+    {  0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f,
+      -0.0594482421875f,  0.1373291015625f,  0.9721679687500f, -0.1022949218750f,
+       0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f },
+    { -0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f,
+      -0.1665039062500f,  0.4650878906250f,  0.7797851562500f, -0.2003173828125f,
+       0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f },
+    { -0.0189208984375f,  0.0330810546875f, -0.0582275390625f,  0.1015625000000f,
+      -0.2003173828125f,  0.7797851562500f,  0.4650878906250f, -0.1665039062500f,
+       0.0891113281250f, -0.0517578125000f,  0.0292968750000f, -0.0291748046875f },
+    { -0.0083007812500f,  0.0148925781250f, -0.0266113281250f,  0.0476074218750f,
+      -0.1022949218750f,  0.9721679687500f,  0.1373291015625f, -0.0594482421875f,
+       0.0332031250000f, -0.0196533203125f,  0.0109863281250f,  0.0017089843750f },
+};
+
+//--------------------------------------------------------------------+
+// Configuration
+//--------------------------------------------------------------------+
+
+void dsp_limiter_config(dsp_limiter_config_t *cfg, uint32_t sample_rate)
+{
+    uint32_t la = (uint32_t)((float)sample_rate * (DSP_LIMITER_LOOKAHEAD_MS / 1000.0f) + 0.5f);
+    if (la < 1) la = 1;
+    // Leave room for the true-peak alignment in the delay line
+    if (la > DSP_LIMITER_RING - 2 * TP_TAPS) la = DSP_LIMITER_RING - 2 * TP_TAPS;
+    cfg->lookahead = (uint16_t)la;
+
+    float rate = sample_rate ? (float)sample_rate : 48000.0f;
+    cfg->release = 1.0f - expf(-1000.0f / (DSP_LIMITER_RELEASE_MS * rate));
+}
+
+void dsp_limiter_reset(dsp_limiter_t *lim, const dsp_limiter_config_t *cfg, bool true_peak)
+{
+    const uint16_t la = cfg->lookahead ? cfg->lookahead : 1;
+
+    lim->true_peak = true_peak;
+    lim->lookahead = la;
+    lim->inv_lookahead = 1.0f / (float)la;
+    lim->release = cfg->release;
+    lim->ceiling = true_peak ? DSP_LIMITER_CEILING_TP : DSP_LIMITER_CEILING;
+
+    // A gain drop detected at frame n is held for `window` frames and
+    // ramped in over `lookahead`; the delay lines the detected sample up
+    // with the end of the ramp. A true-peak detection covers samples
+    // n−6 and n−5, hence one more frame of hold and 6 of delay.
+    lim->window = true_peak ? la + 1 : la;
+    lim->delay  = true_peak ? la - 1 + TP_CENTRE : la - 1;
+
+    lim->dq_head = lim->dq_tail = 0;
+    lim->frame = 0;
+
+    lim->env = 1.0f;
+    for (uint16_t i = 0; i < la; i++) lim->avg[i] = 1.0f;
+    lim->avg_sum = (float)la;
+    lim->avg_pos = 0;
+
+    memset(lim->dl_L, 0, sizeof(lim->dl_L));
+    memset(lim->dl_R, 0, sizeof(lim->dl_R));
+    lim->dl_pos = 0;
+}
+
+uint16_t dsp_limiter_latency(const dsp_limiter_t *lim)
+{
+    return lim->delay;
+}
+
+uint16_t dsp_limiter_cycles_per_sample(bool true_peak)
+{
+    return true_peak ? CYCLES_LIMITER_TP : CYCLES_LIMITER;
+}
+
+//--------------------------------------------------------------------+
+// Processing
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Largest |y| of the four interpolated points before x[0]
+ *
+ * x points at the newest sample; x[-11] .. x[0] must be readable.
+ */
+__attribute__((hot, always_inline))
+static inline float tp_peak(const float *x)
+{
+    float peak = 0.0f;
+    for (int k = 0; k < DSP_LIMITER_TP_PHASES; k++) {
+        const float *c = s_tp_coef[k];
+        // Two accumulators: the taps are independent
+        float a0 = 0.0f, a1 = 0.0f;
+        for (int j = 0; j < TP_TAPS; j += 2) {
+            a0 += c[j]     * x[-j];
+            a1 += c[j + 1] * x[-j - 1];
+        }
+        float y = fabsf(a0 + a1);
+        if (y > peak) peak = y;
+    }
+    return peak;
+}
+
+float dsp_limiter_true_peak(const float *x, uint32_t n)
+{
+    float peak = 0.0f;
+    for (uint32_t i = TP_TAPS - 1; i < n; i++) {
+        float p = tp_peak(&x[i]);
+        if (p > peak) peak = p;
+    }
+    return peak;
+}
+
+__attribute__((hot))
+void dsp_limiter_process(dsp_limiter_t *lim, float *buf_L, float *buf_R, uint32_t frames)
+{
+    const float ceiling = lim->ceiling;
+    const float release = lim->release;
+    const float inv_la  = lim->inv_lookahead;
+    const uint16_t la     = lim->lookahead;
+    const uint16_t window = lim->window;
+    const uint16_t delay  = lim->delay;
+    const bool true_peak  = lim->true_peak;
+
+    float   *dq_gain  = lim->dq_gain;
+    uint16_t *dq_frame = lim->dq_frame;
+    uint16_t head = lim->dq_head, tail = lim->dq_tail, frame = lim->frame;
+    float    env = lim->env, avg_sum = lim->avg_sum;
+    uint16_t avg_pos = lim->avg_pos, pos = lim->dl_pos;
+
+    for (uint32_t i = 0; i < frames; i++) {
+        const float xl = buf_L[i], xr = buf_R[i];
+
+        // Delay line write (+ mirror for the contiguous FIR window)
+        lim->dl_L[pos] = xl;
+        lim->dl_R[pos] = xr;
+        if (pos < TP_TAPS - 1) {
+            lim->dl_L[pos + DSP_LIMITER_RING] = xl;
+            lim->dl_R[pos + DSP_LIMITER_RING] = xr;
+        }
+
+        // Peak of the newest frame
+        float peak;
+        if (true_peak) {
+            const uint16_t end = (pos >= TP_TAPS - 1) ? pos : pos + DSP_LIMITER_RING;
+            const float *wl = &lim->dl_L[end];
+            const float *wr = &lim->dl_R[end];
+            peak = fabsf(wl[-TP_CENTRE]);
+            float p = fabsf(wr[-TP_CENTRE]);
+            if (p > peak) peak = p;
+            p = tp_peak(wl);
+            if (p > peak) peak = p;
+            p = tp_peak(wr);
+            if (p > peak) peak = p;
+        } else {
+            peak = fabsf(xl);
+            float p = fabsf(xr);
+            if (p > peak) peak = p;
+        }
+        const float g = (peak > ceiling) ? ceiling / peak : 1.0f;
+
+        // Sliding minimum: drop entries that can never be the minimum
+        // again, append, expire the front once it leaves the window
+        while (tail != head && dq_gain[(uint16_t)(tail - 1) & RING_MASK] >= g) tail--;
+        dq_gain[tail & RING_MASK] = g;
+        dq_frame[tail & RING_MASK] = frame;
+        tail++;
+        if ((uint16_t)(frame - dq_frame[head & RING_MASK]) >= window) head++;
+        const float hold = dq_gain[head & RING_MASK];
+        frame++;
+
+        // Instant attack on the held value (the average below ramps it),
+        // exponential release
+        env = (hold < env) ? hold : env + (hold - env) * release;
+
+        // Moving average over the look-ahead; re-summed once per lap so
+        // float rounding cannot accumulate
+        avg_sum += env - lim->avg[avg_pos];
+        lim->avg[avg_pos] = env;
+        if (++avg_pos == la) {
+            avg_pos = 0;
+            float s = 0.0f;
+            for (uint16_t k = 0; k < la; k++) s += lim->avg[k];
+            avg_sum = s;
+        }
+        const float gain = avg_sum * inv_la;
+
+        // Delayed output. The clamp only catches the last few ULPs the
+        // running sum can leave above the target gain.
+        const uint16_t rd = (uint16_t)(pos - delay) & RING_MASK;
+        float yl = lim->dl_L[rd] * gain;
+        float yr = lim->dl_R[rd] * gain;
+        if (yl > ceiling) yl = ceiling; else if (yl < -ceiling) yl = -ceiling;
+        if (yr > ceiling) yr = ceiling; else if (yr < -ceiling) yr = -ceiling;
+        buf_L[i] = yl;
+        buf_R[i] = yr;
+        pos = (pos + 1) & RING_MASK;
+    }
+
+    lim->dq_head = head;
+    lim->dq_tail = tail;
+    lim->frame = frame;
+    lim->env = env;
+    lim->avg_sum = avg_sum;
+    lim->avg_pos = avg_pos;
+    lim->dl_pos = pos;
+}
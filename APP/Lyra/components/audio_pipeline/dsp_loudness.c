@@ -0,0 +1,215 @@
+#include "dsp_loudness.h"
+#include "dsp_biquad.h"
+#include <string.h>
+#include <math.h>
+#include <esp_log.h>
+
+static const char *TAG = "dsp_loudness";
+
+// ISO 226:2003 Table 1: frequency, exponent αf, magnitude Lu, threshold Tf
+#define ISO_POINTS  29
+
+static const float s_iso_f[ISO_POINTS] = {
+    20, 25, 31.5f, 40, 50, 63, 80, 100, 125, 160, 200, 250, 315, 400, 500,
+    630, 800, 1000, 1250, 1600, 2000, 2500, 3150, 4000, 5000, 6300, 8000, 10000, 12500,
+};
+static const float s_iso_af[ISO_POINTS] = {
+    0.532f, 0.506f, 0.480f, 0.455f, 0.432f, 0.409f, 0.387f, 0.367f, 0.349f, 0.330f,
+    0.315f, 0.301f, 0.288f, 0.276f, 0.267f, 0.259f, 0.253f, 0.250f, 0.246f, 0.244f,
+    0.243f, 0.243f, 0.243f, 0.242f, 0.242f, 0.245f, 0.254f, 0.271f, 0.301f,
+};
+static const float s_iso_lu[ISO_POINTS] = {
+    -31.6f, -27.2f, -23.0f, -19.1f, -15.9f, -13.0f, -10.3f, -8.1f, -6.2f, -4.5f,
+    -3.1f, -2.0f, -1.1f, -0.4f, 0.0f, 0.3f, 0.5f, 0.0f, -2.7f, -4.1f,
+    -1.0f, 1.7f, 2.5f, 1.2f, -2.1f, -7.1f, -11.2f, -10.7f, -3.1f,
+};
+static const float s_iso_tf[ISO_POINTS] = {
+    78.5f, 68.7f, 59.5f, 51.1f, 44.0f, 37.5f, 31.5f, 26.5f, 22.1f, 17.9f,
+    14.4f, 11.4f, 8.6f, 6.2f, 4.4f, 3.0f, 2.2f, 2.4f, 3.5f, 1.7f,
+    -1.3f, -4.2f, -6.0f, -5.4f, -1.5f, 6.0f, 12.6f, 13.9f, 12.3f,
+};
+
+// Points each shelf is fitted on: 31.5 Hz – 1 kHz, 5 – 12.5 kHz
+#define FIT_BASS_FIRST    2
+#define FIT_BASS_LAST     17
+#define FIT_TREBLE_FIRST  24
+#define FIT_TREBLE_LAST   28
+
+// Shelf shapes are evaluated at this rate (the fit is rate-independent)
+#define FIT_RATE  48000
+
+static float s_gains[DSP_LOUDNESS_STEPS][DSP_LOUDNESS_SECTIONS];
+static bool  s_gains_ready = false;
+
+//--------------------------------------------------------------------+
+// ISO 226 contours
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Sound pressure level of the `phon` contour at ISO point i (ISO 226 eq. 1)
+ */
+static double iso_spl(double phon, int i)
+{
+    const double af = s_iso_af[i];
+    const double a = 4.47e-3 * (pow(10.0, 0.025 * phon) - 1.15) +
+                     pow(0.4 * pow(10.0, (s_iso_tf[i] + s_iso_lu[i]) / 10.0 - 9.0), af);
+    return 10.0 / af * log10(a) - s_iso_lu[i] + 94.0;
+}
+
+/**
+ * @brief Boost at ISO point i that restores the reference balance
+ *        at `atten` dB below the reference level
+ */
+static double iso_compensation(double atten, int i)
+{
+    const double phon = DSP_LOUDNESS_REF_PHON - atten;
+    return (iso_spl(phon, i) - phon) - (iso_spl(DSP_LOUDNESS_REF_PHON, i) - DSP_LOUDNESS_REF_PHON);
+}
+
+//--------------------------------------------------------------------+
+// Shelf fit
+//--------------------------------------------------------------------+
+
+static void loud_params(biquad_params_t *p, int section, float gain, uint32_t sample_rate)
+{
+    p->type = section ? BIQUAD_HIGHSHELF : BIQUAD_LOWSHELF;
+    p->freq = section ? DSP_LOUDNESS_TREBLE_HZ : DSP_LOUDNESS_BASS_HZ;
+    p->q = section ? DSP_LOUDNESS_TREBLE_Q : DSP_LOUDNESS_BASS_Q;
+    p->gain = gain;
+    p->sample_rate = sample_rate;
+}
+
+// Magnitude of one shelf at ISO point i, dB
+static double shelf_db(int section, float gain, int i)
+{
+    biquad_filter_t f;
+    biquad_params_t p;
+    loud_params(&p, section, gain, FIT_RATE);
+    biquad_calculate_coeffs(&f, &p);
+
+    const double w = 2.0 * M_PI * s_iso_f[i] / FIT_RATE;
+    const double c1 = cos(w), s1 = sin(w), c2 = cos(2.0 * w), s2 = sin(2.0 * w);
+    const double nr = f.coef[0] + f.coef[1] * c1 + f.coef[2] * c2;
+    const double ni = -(f.coef[1] * s1 + f.coef[2] * s2);
+    const double dr = 1.0 + f.coef[3] * c1 + f.coef[4] * c2;
+    const double di = -(f.coef[3] * s1 + f.coef[4] * s2);
+    return 10.0 * log10((nr * nr + ni * ni) / (dr * dr + di * di));
+}
+
+/**
+ * @brief Least-squares shelf gain over ISO points [first, last]
+ *
+ * A shelf's dB response is close to gain × a fixed shape; one
+ * refinement with the shape at the first estimate absorbs the rest.
+ */
+static float fit_shelf(int section, double atten, int first, int last)
+{
+    // The shelf plateau continues past the last point: never above the
+    // target there (the treble shelf would lift the whole top octave)
+    double edge = iso_compensation(atten, section ? last : first);
+    if (edge > DSP_LOUDNESS_MAX_DB) edge = DSP_LOUDNESS_MAX_DB;
+
+    float gain = 6.0f;
+    for (int pass = 0; pass < 2; pass++) {
+        double ss = 0.0, sc = 0.0;
+        for (int i = first; i <= last; i++) {
+            double target = iso_compensation(atten, i);
+            if (target > DSP_LOUDNESS_MAX_DB) target = DSP_LOUDNESS_MAX_DB;
+            const double shape = shelf_db(section, gain, i) / gain;
+            ss += shape * shape;
+            sc += shape * target;
+        }
+        float g = (ss > 0.0) ? (float)(sc / ss) : 0.0f;
+        if (g > edge) g = (float)edge;
+        if (g < -DSP_LOUDNESS_MAX_DB) g = -DSP_LOUDNESS_MAX_DB;
+        if (fabsf(g) < 0.05f) return 0.0f;
+        gain = g;
+    }
+    return gain;
+}
+
+static void loud_fit_gains(void)
+{
+    for (int k = 0; k < DSP_LOUDNESS_STEPS; k++) {
+        s_gains[k][0] = fit_shelf(0, k, FIT_BASS_FIRST, FIT_BASS_LAST);
+        s_gains[k][1] = fit_shelf(1, k, FIT_TREBLE_FIRST, FIT_TREBLE_LAST);
+    }
+    s_gains_ready = true;
+    ESP_LOGI(TAG, "ISO 226 fit: %.0f phon reference, at -20/-40/-60 dB bass +%.1f/+%.1f/+%.1f dB, "
+             "treble %+.1f/%+.1f/%+.1f dB", DSP_LOUDNESS_REF_PHON,
+             s_gains[20][0], s_gains[40][0], s_gains[60][0],
+             s_gains[20][1], s_gains[40][1], s_gains[60][1]);
+}
+
+//--------------------------------------------------------------------+
+// Tables
+//--------------------------------------------------------------------+
+
+bool dsp_loudness_build(dsp_loudness_row_t row, uint32_t sample_rate)
+{
+    if (!s_gains_ready) {
+        loud_fit_gains();
+    }
+
+    bool ok = true;
+    for (int k = 0; k < DSP_LOUDNESS_STEPS; k++) {
+        for (int s = 0; s < DSP_LOUDNESS_SECTIONS; s++) {
+            biquad_params_t p;
+            loud_params(&p, s, s_gains[k][s], sample_rate);
+            if (s_gains[k][s] == 0.0f || !biquad_calculate_coeffs_q31(row[k][s], &p)) {
+                if (s_gains[k][s] != 0.0f) ok = false;
+                row[k][s][0] = 1 << BIQUAD_Q31_FRAC;
+                row[k][s][1] = row[k][s][2] = row[k][s][3] = row[k][s][4] = 0;
+            }
+        }
+    }
+    if (!ok) {
+        ESP_LOGW(TAG, "Some steps do not fit Q3.28 at %lu Hz — left flat",
+                 (unsigned long)sample_rate);
+    }
+    return ok;
+}
+
+void dsp_loudness_lookup(const dsp_loudness_row_t row, uint32_t atten_q8,
+                         int32_t coef[DSP_LOUDNESS_SECTIONS][5])
+{
+    uint32_t k = atten_q8 >> 8;
+    if (k >= DSP_LOUDNESS_STEPS - 1) {
+        memcpy(coef, row[DSP_LOUDNESS_STEPS - 1], sizeof(row[0]));
+        return;
+    }
+
+    const int64_t frac = atten_q8 & 0xFF;
+    for (int s = 0; s < DSP_LOUDNESS_SECTIONS; s++) {
+        for (int c = 0; c < 5; c++) {
+            const int32_t a = row[k][s][c], b = row[k + 1][s][c];
+            coef[s][c] = a + (int32_t)((((int64_t)b - a) * frac) >> 8);
+        }
+    }
+}
+
+void dsp_loudness_get_gains(float volume_db, float *bass_db, float *treble_db)
+{
+    if (!s_gains_ready) {
+        loud_fit_gains();
+    }
+
+    float atten = (volume_db < 0.0f) ? -volume_db : 0.0f;
+    if (atten > DSP_LOUDNESS_STEPS - 1) atten = DSP_LOUDNESS_STEPS - 1;
+    int k = (int)atten;
+    if (k > DSP_LOUDNESS_STEPS - 2) k = DSP_LOUDNESS_STEPS - 2;
+    const float t = atten - (float)k;
+    if (bass_db) *bass_db = s_gains[k][0] + (s_gains[k + 1][0] - s_gains[k][0]) * t;
+    if (treble_db) *treble_db = s_gains[k][1] + (s_gains[k + 1][1] - s_gains[k][1]) * t;
+}
+
+float dsp_loudness_target_db(float volume_db, float freq)
+{
+    int best = 0;
+    for (int i = 1; i < ISO_POINTS; i++) {
+        if (fabsf(logf(s_iso_f[i] / freq)) < fabsf(logf(s_iso_f[best] / freq))) best = i;
+    }
+    float atten = (volume_db < 0.0f) ? -volume_db : 0.0f;
+    if (atten > DSP_LOUDNESS_STEPS - 1) atten = DSP_LOUDNESS_STEPS - 1;
+    return (float)iso_compensation(atten, best);
+}
@@ -0,0 +1,464 @@
+#include "dsp_os.h"
+#include "dsp_fft.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <esp_log.h>
+
+static const char *TAG = "dsp_os";
+
+#define INT32_TO_FLOAT_SCALE  (1.0f / 2147483648.0f)   // 1 / 2^31
+#define FLOAT_TO_INT32_SCALE  (2147483648.0f)           // 2^31
+#define INT32_MAX_FLOAT       ( 2147483520.0f)          // 2^31 - 128
+#define INT32_MIN_FLOAT       (-2147483648.0f)
+
+// Input frames per pass through the cascade (the last stage writes
+// OS_CHUNK × factor frames)
+#define OS_CHUNK  64
+
+// Minimum-phase design: cepstrum length and log-magnitude floor (well
+// under the stopband, so the floor does not set the rejection)
+#define OS_CEPSTRUM_N     DSP_FFT_MAX_SIZE
+#define OS_LOG_FLOOR_DB   (-(DSP_OS_ATTEN_DB + 40.0f))
+
+// Cost model (cycles, ESP32-P4 — check with `dsp bench os`)
+#define OS_CYCLES_PER_PAIR   5   // 4 history + 1 coef loads, 2 pre-adds, 2 FMA (stereo)
+#define OS_CYCLES_PER_PTAP   6   // 2 history + 2 coef loads, 4 FMA (both branches, stereo)
+#define OS_CYCLES_PER_STEP  10   // per stage input frame: stores, loop, history shift
+#define OS_CYCLES_IN         8   // int32 → float, per input frame
+#define OS_CYCLES_OUT       12   // float → int32 + clamp, per output frame
+
+typedef struct {
+    bool     minimum;       // two full branches instead of symmetric pairs
+    uint16_t pairs;         // P: linear half-band of 4P − 1 taps
+    uint16_t span;          // history frames kept between passes (2P − 1)
+    float   *coef;          // linear: c[P]; minimum: {even, odd} × 2P, reversed
+    float   *hist;          // stereo interleaved: span + input frames of one pass
+} os_stage_t;
+
+struct dsp_os_s {
+    uint8_t        factor;
+    uint8_t        stages;
+    dsp_os_phase_t phase;
+    float          latency;     // input frames
+    os_stage_t     st[DSP_OS_MAX_STAGES];
+    float         *tail;        // last stage output, OS_CHUNK × factor frames
+};
+
+static const char *s_phase_names[DSP_OS_PHASE_COUNT] = {
+    [DSP_OS_PHASE_LINEAR]  = "linear",
+    [DSP_OS_PHASE_MINIMUM] = "minimum",
+};
+
+//--------------------------------------------------------------------+
+// Filter design (control task)
+//--------------------------------------------------------------------+
+
+// Zeroth-order modified Bessel function of the first kind
+static double os_bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 64; k++) {
+        term *= q / ((double)k * (double)k);
+        sum += term;
+        if (term < sum * 1e-17) break;
+    }
+    return sum;
+}
+
+static double os_kaiser_beta(double atten_db)
+{
+    if (atten_db > 50.0) return 0.1102 * (atten_db - 8.7);
+    if (atten_db >= 21.0) return 0.5842 * pow(atten_db - 21.0, 0.4) + 0.07886 * (atten_db - 21.0);
+    return 0.0;
+}
+
+/**
+ * @brief Symmetric pairs P of stage s (prototype of 4P − 1 taps)
+ *
+ * Stage s runs from 2^s·fs to 2^(s+1)·fs. The first stage keeps
+ * DSP_OS_PASSBAND·fs and its first image starts at fs minus that; later
+ * stages keep the whole input band (fs/2), so nothing the first stage
+ * let through is shaped again. Either way the transition band is
+ * centred on a quarter of the output rate — a half-band. Kaiser length
+ * for that width, P rounded up to even for the two-way unrolled kernel.
+ */
+static uint16_t os_pairs(uint8_t stage)
+{
+    const double edge = (stage == 0) ? DSP_OS_PASSBAND : 0.5;       // of fs
+    const double pass = edge / (double)(2u << stage);               // of the output rate
+    const double dw = 2.0 * M_PI * (0.5 - 2.0 * pass);
+    // Kaiser's length estimate, plus four taps: it runs short when the
+    // filter is as short as the last stages
+    const double n = (DSP_OS_ATTEN_DB - 7.95) / (2.285 * dw) + 1.0 + 4.0;
+    uint32_t p = (uint32_t)ceil((n + 1.0) / 4.0);
+    p = (p + 1) & ~1u;
+    return (uint16_t)(p < 2 ? 2 : p);
+}
+
+/**
+ * @brief Half-band prototype h[t], t = −(2P−1)..(2P−1), stored at t + 2P − 1
+ *
+ * h = ½·sinc(t/2)·kaiser: zero at every even t except the centre (½).
+ * Scaled so each polyphase branch has unity DC gain (the odd taps sum
+ * to ½, like the centre).
+ */
+static void os_halfband(double *h, uint16_t pairs)
+{
+    const int half = 2 * pairs - 1;
+    const double beta = os_kaiser_beta(DSP_OS_ATTEN_DB);
+    const double i0_beta = os_bessel_i0(beta);
+    double odd = 0.0;
+
+    for (int t = -half; t <= half; t++) {
+        double v = 0.0;
+        if (t == 0) {
+            v = 0.5;
+        } else if (t & 1) {
+            const double x = 0.5 * M_PI * t;
+            const double r = (double)t / half;
+            v = 0.5 * sin(x) / x * os_bessel_i0(beta * sqrt(fmax(0.0, 1.0 - r * r))) / i0_beta;
+            odd += v;
+        }
+        h[t + half] = v;
+    }
+    for (int t = 1; t <= half; t += 2) {
+        h[half + t] *= 0.5 / odd;
+        h[half - t] *= 0.5 / odd;
+    }
+}
+
+/**
+ * @brief Minimum-phase filter with the magnitude of h (in place)
+ *
+ * Homomorphic method: the real cepstrum of log|H| folded onto positive
+ * quefrencies is the cepstrum of the minimum-phase filter with the
+ * same magnitude; exp + inverse FFT gives it back. The cepstrum is
+ * OS_CEPSTRUM_N long, far beyond the filter, so its aliasing stays
+ * below the stopband.
+ */
+static bool os_minimum_phase(double *h, uint16_t taps)
+{
+    const uint32_t n = OS_CEPSTRUM_N;
+    dsp_fft_plan_t plan;
+    float *buf = calloc(2 * n, sizeof(float));
+    if (!buf || !dsp_fft_plan_init(&plan, (uint16_t)n)) {
+        free(buf);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < taps; i++) {
+        buf[2 * i] = (float)h[i];
+    }
+    dsp_fft_forward(&plan, buf);
+
+    const float floor_log = OS_LOG_FLOOR_DB * (float)(M_LN10 / 20.0);
+    for (uint32_t k = 0; k < n; k++) {
+        const float re = buf[2 * k], im = buf[2 * k + 1];
+        const float mag2 = re * re + im * im;
+        float l = (mag2 > 0.0f) ? 0.5f * logf(mag2) : floor_log;
+        buf[2 * k] = (l > floor_log) ? l : floor_log;
+        buf[2 * k + 1] = 0.0f;
+    }
+    dsp_fft_inverse(&plan, buf);
+
+    // Fold: c[0], c[n/2] kept, positive quefrencies doubled, negative cleared
+    const float inv_n = 1.0f / (float)n;
+    for (uint32_t i = 0; i < n; i++) {
+        float w = (i == 0 || i == n / 2) ? inv_n : (i < n / 2 ? 2.0f * inv_n : 0.0f);
+        buf[2 * i] *= w;
+        buf[2 * i + 1] = 0.0f;
+    }
+    dsp_fft_forward(&plan, buf);
+
+    for (uint32_t k = 0; k < n; k++) {
+        const float a = expf(buf[2 * k]);
+        const float b = buf[2 * k + 1];
+        buf[2 * k] = a * cosf(b);
+        buf[2 * k + 1] = a * sinf(b);
+    }
+    dsp_fft_inverse(&plan, buf);
+
+    for (uint32_t i = 0; i < taps; i++) {
+        h[i] = buf[2 * i] * inv_n;
+    }
+    dsp_fft_plan_free(&plan);
+    free(buf);
+    return true;
+}
+
+/**
+ * @brief Build stage s: coefficients, history; returns its delay in
+ *        input frames of that stage (0 on failure)
+ */
+static float os_stage_init(os_stage_t *st, uint8_t stage, bool minimum)
+{
+    const uint16_t P = os_pairs(stage);
+    const uint16_t taps = 4 * P - 1;
+    const uint32_t frames = (uint32_t)OS_CHUNK << stage;
+    st->minimum = minimum;
+    st->pairs = P;
+    st->span = 2 * P - 1;
+    st->hist = calloc((size_t)(st->span + frames) * 2, sizeof(float));
+    st->coef = calloc(minimum ? 4 * P : P, sizeof(float));
+    double *h = calloc(taps, sizeof(double));
+    if (!st->hist || !st->coef || !h) {
+        free(h);
+        return 0.0f;
+    }
+    os_halfband(h, P);
+
+    float delay;
+    if (!minimum) {
+        // c[i] pairs x[m − i] with x[m + 1 + i]: prototype taps ±(2i + 1),
+        // ×2 for the interpolation gain
+        for (uint16_t i = 0; i < P; i++) {
+            st->coef[i] = (float)(2.0 * h[2 * P - 1 + 2 * i + 1]);
+        }
+        delay = (float)P;
+    } else {
+        if (!os_minimum_phase(h, taps)) {
+            free(h);
+            return 0.0f;
+        }
+        // Branches of 2P taps (the odd one is one short, padded), each
+        // scaled to unity DC gain so no image is left at 0 Hz; stored
+        // reversed and interleaved {even, odd} for the kernel
+        double se = 0.0, so = 0.0, moment = 0.0, sum = 0.0;
+        for (uint16_t n = 0; n < taps; n++) {
+            if (n & 1) so += h[n]; else se += h[n];
+            moment += n * h[n];
+            sum += h[n];
+        }
+        const uint16_t L = 2 * P;
+        for (uint16_t j = 0; j < L; j++) {
+            const uint16_t ne = 2 * j, no = 2 * j + 1;
+            st->coef[2 * (L - 1 - j)]     = (float)(h[ne] / se);
+            st->coef[2 * (L - 1 - j) + 1] = (no < taps) ? (float)(h[no] / so) : 0.0f;
+        }
+        // DC group delay, output samples → input frames
+        delay = (float)(0.5 * moment / sum);
+    }
+    free(h);
+    return delay;
+}
+
+//--------------------------------------------------------------------+
+// Create / Destroy
+//--------------------------------------------------------------------+
+
+static uint8_t os_stages_for(uint8_t factor)
+{
+    switch (factor) {
+        case 2: return 1;
+        case 4: return 2;
+        case 8: return 3;
+        default: return 0;
+    }
+}
+
+dsp_os_t *dsp_os_create(uint8_t factor, dsp_os_phase_t phase)
+{
+    const uint8_t stages = os_stages_for(factor);
+    if (stages == 0 || phase >= DSP_OS_PHASE_COUNT) return NULL;
+
+    dsp_os_t *os = calloc(1, sizeof(dsp_os_t));
+    if (!os) return NULL;
+    os->factor = factor;
+    os->stages = stages;
+    os->phase = phase;
+    os->tail = calloc((size_t)OS_CHUNK * factor * 2, sizeof(float));
+    bool ok = os->tail != NULL;
+
+    for (uint8_t s = 0; s < stages && ok; s++) {
+        const bool minimum = (phase == DSP_OS_PHASE_MINIMUM) && s == 0;
+        const float delay = os_stage_init(&os->st[s], s, minimum);
+        ok = delay > 0.0f;
+        os->latency += delay / (float)(1u << s);
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "Out of memory (%ux %s)", factor, s_phase_names[phase]);
+        dsp_os_destroy(os);
+        return NULL;
+    }
+
+    ESP_LOGI(TAG, "Oversampler %ux %s: taps %u/%u/%u, latency %.1f frames, ~%u cyc/frame",
+             factor, s_phase_names[phase], dsp_os_get_taps(os, 0), dsp_os_get_taps(os, 1),
+             dsp_os_get_taps(os, 2), os->latency, dsp_os_cycles_per_frame(factor, phase));
+    return os;
+}
+
+void dsp_os_destroy(dsp_os_t *os)
+{
+    if (!os) return;
+    for (uint8_t s = 0; s < DSP_OS_MAX_STAGES; s++) {
+        free(os->st[s].coef);
+        free(os->st[s].hist);
+    }
+    free(os->tail);
+    free(os);
+}
+
+void dsp_os_reset(dsp_os_t *os)
+{
+    for (uint8_t s = 0; s < os->stages; s++) {
+        memset(os->st[s].hist, 0, (size_t)os->st[s].span * 2 * sizeof(float));
+    }
+}
+
+//--------------------------------------------------------------------+
+// Processing (audio task)
+//--------------------------------------------------------------------+
+//
+// Each stage reads its history (span old frames + this pass's input)
+// and writes two output frames per input frame straight into the next
+// stage's history, the last stage into tail. Every coefficient load
+// serves L and R; two accumulators per channel break the FMA chain. As
+// with the SRC, PIE has no float lanes on the P4: the unrolled scalar
+// kernel is the vector path.
+//--------------------------------------------------------------------+
+
+// Linear phase: even output = centre tap (delayed input), odd output =
+// Σ c[i]·(x[m − i] + x[m + 1 + i])
+__attribute__((hot))
+static void os_run_halfband(const os_stage_t *st, uint32_t frames, float *restrict out)
+{
+    const uint32_t P = st->pairs;
+    const float *restrict c = st->coef;
+
+    for (uint32_t k = 0; k < frames; k++) {
+        const float *lo = st->hist + 2 * (k + P - 1);   // x[m], walking back
+        const float *hi = lo + 2;                       // x[m + 1], walking forward
+        float l0 = 0.0f, l1 = 0.0f, r0 = 0.0f, r1 = 0.0f;
+
+        for (uint32_t i = 0; i < P; i += 2) {
+            const float c0 = c[i], c1 = c[i + 1];
+            const float *a = lo - 2 * i;
+            const float *b = hi + 2 * i;
+            l0 += c0 * (a[0] + b[0]);
+            r0 += c0 * (a[1] + b[1]);
+            l1 += c1 * (a[-2] + b[2]);
+            r1 += c1 * (a[-1] + b[3]);
+        }
+
+        out[4 * k]     = lo[0];
+        out[4 * k + 1] = lo[1];
+        out[4 * k + 2] = l0 + l1;
+        out[4 * k + 3] = r0 + r1;
+    }
+}
+
+// Minimum phase: two branches of 2P taps over the same window
+__attribute__((hot))
+static void os_run_polyphase(const os_stage_t *st, uint32_t frames, float *restrict out)
+{
+    const uint32_t L = 2u * st->pairs;
+    const float *restrict c = st->coef;
+
+    for (uint32_t k = 0; k < frames; k++) {
+        const float *x = st->hist + 2 * k;
+        float el0 = 0.0f, er0 = 0.0f, ol0 = 0.0f, or0 = 0.0f;
+        float el1 = 0.0f, er1 = 0.0f, ol1 = 0.0f, or1 = 0.0f;
+
+        for (uint32_t j = 0; j < L; j += 2) {
+            const float *p = x + 2 * j;
+            const float *q = c + 2 * j;
+            el0 += q[0] * p[0]; er0 += q[0] * p[1];
+            ol0 += q[1] * p[0]; or0 += q[1] * p[1];
+            el1 += q[2] * p[2]; er1 += q[2] * p[3];
+            ol1 += q[3] * p[2]; or1 += q[3] * p[3];
+        }
+
+        out[4 * k]     = el0 + el1;
+        out[4 * k + 1] = er0 + er1;
+        out[4 * k + 2] = ol0 + ol1;
+        out[4 * k + 3] = or0 + or1;
+    }
+}
+
+static inline int32_t os_to_int32(float v)
+{
+    v *= FLOAT_TO_INT32_SCALE;
+    if (v > INT32_MAX_FLOAT) v = INT32_MAX_FLOAT;
+    if (v < INT32_MIN_FLOAT) v = INT32_MIN_FLOAT;
+    return (int32_t)v;
+}
+
+__attribute__((hot))
+uint32_t dsp_os_process(dsp_os_t *os, const int32_t *in, uint32_t frames, int32_t *out)
+{
+    for (uint32_t off = 0; off < frames; off += OS_CHUNK) {
+        uint32_t n = frames - off;
+        if (n > OS_CHUNK) n = OS_CHUNK;
+
+        float *h0 = os->st[0].hist + 2 * os->st[0].span;
+        const int32_t *src = in + 2 * off;
+        for (uint32_t i = 0; i < 2 * n; i++) {
+            h0[i] = (float)src[i] * INT32_TO_FLOAT_SCALE;
+        }
+
+        uint32_t m = n;
+        for (uint8_t s = 0; s < os->stages; s++) {
+            os_stage_t *st = &os->st[s];
+            float *dst = (s + 1 < os->stages) ? os->st[s + 1].hist + 2 * os->st[s + 1].span
+                                              : os->tail;
+            if (st->minimum) {
+                os_run_polyphase(st, m, dst);
+            } else {
+                os_run_halfband(st, m, dst);
+            }
+            memmove(st->hist, st->hist + 2 * m, (size_t)st->span * 2 * sizeof(float));
+            m *= 2;
+        }
+
+        int32_t *o = out + 2 * off * os->factor;
+        for (uint32_t i = 0; i < 2 * m; i++) {
+            o[i] = os_to_int32(os->tail[i]);
+        }
+    }
+    return frames * os->factor;
+}
+
+//--------------------------------------------------------------------+
+// Queries
+//--------------------------------------------------------------------+
+
+uint8_t dsp_os_get_factor(const dsp_os_t *os)       { return os->factor; }
+dsp_os_phase_t dsp_os_get_phase(const dsp_os_t *os) { return os->phase; }
+float dsp_os_get_latency(const dsp_os_t *os)        { return os->latency; }
+
+uint16_t dsp_os_get_taps(const dsp_os_t *os, uint8_t stage)
+{
+    return (stage < os->stages) ? (uint16_t)(4 * os->st[stage].pairs - 1) : 0;
+}
+
+uint8_t dsp_os_factor_for(uint32_t in_rate, uint8_t max_factor)
+{
+    uint8_t f = 1;
+    while (f < max_factor && f < DSP_OS_MAX_FACTOR && in_rate * 2u * f <= DSP_OS_MAX_RATE) {
+        f *= 2;
+    }
+    return f;
+}
+
+const char *dsp_os_phase_name(dsp_os_phase_t phase)
+{
+    return (phase < DSP_OS_PHASE_COUNT) ? s_phase_names[phase] : "?";
+}
+
+uint16_t dsp_os_cycles_per_frame(uint8_t factor, dsp_os_phase_t phase)
+{
+    const uint8_t stages = os_stages_for(factor);
+    if (stages == 0 || phase >= DSP_OS_PHASE_COUNT) return 0;
+
+    uint32_t cycles = OS_CYCLES_IN + (uint32_t)factor * OS_CYCLES_OUT;
+    for (uint8_t s = 0; s < stages; s++) {
+        const uint32_t P = os_pairs(s);
+        const uint32_t per = (phase == DSP_OS_PHASE_MINIMUM && s == 0)
+                           ? 2 * P * OS_CYCLES_PER_PTAP
+                           : P * OS_CYCLES_PER_PAIR;
+        cycles += (per + OS_CYCLES_PER_STEP) << s;
+    }
+    return (uint16_t)(cycles > UINT16_MAX ? UINT16_MAX : cycles);
+}
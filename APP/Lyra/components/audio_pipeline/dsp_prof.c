@@ -0,0 +1,82 @@
+#include "dsp_prof.h"
+#include <string.h>
+
+// Values are quarter cycles per sample; bins 0..15 are exact, then four
+// bins per octave (top bin open-ended)
+#define PROF_EXACT  16
+
+static unsigned prof_bin(uint32_t v)
+{
+    if (v < PROF_EXACT) return v;
+    unsigned e = 31u - (unsigned)__builtin_clz(v);      // ≥ 4
+    unsigned b = PROF_EXACT + (e - 4u) * 4u + ((v >> (e - 2u)) & 3u);
+    return (b < DSP_PROF_BINS) ? b : DSP_PROF_BINS - 1;
+}
+
+// Centre of a bin, in quarter cycles
+static float prof_bin_centre(unsigned b)
+{
+    if (b < PROF_EXACT) return (float)b;
+    unsigned e = 4u + (b - PROF_EXACT) / 4u;
+    unsigned sub = (b - PROF_EXACT) % 4u;
+    uint32_t lo = (4u + sub) << (e - 2u);
+    return (float)lo + (float)(1u << (e - 2u)) * 0.5f;
+}
+
+void dsp_prof_record(dsp_prof_hist_t *h, uint32_t cycles, uint32_t samples)
+{
+    if (samples == 0) return;
+
+    uint32_t v = (uint32_t)(((uint64_t)cycles * 4u) / samples);
+    if (v > UINT16_MAX) v = UINT16_MAX;
+
+    if (h->count >= DSP_PROF_WINDOW) {
+        uint32_t sum = 0;
+        for (unsigned i = 0; i < DSP_PROF_BINS; i++) {
+            h->bin[i] >>= 1;
+            sum += h->bin[i];
+        }
+        h->count = (uint16_t)sum;
+        h->max_prev = h->max_cur;
+        h->max_cur = 0;
+    }
+
+    h->bin[prof_bin(v)]++;
+    h->count++;
+    if (v > h->max_cur) h->max_cur = (uint16_t)v;
+}
+
+void dsp_prof_get(const dsp_prof_hist_t *h, dsp_prof_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    uint32_t count = h->count;
+    if (count == 0) return;
+
+    // First bin whose cumulative count reaches the rank
+    const uint32_t rank50 = (count + 1) / 2;
+    const uint32_t rank99 = count - count / 100;
+    uint32_t cum = 0;
+    bool got50 = false;
+    for (unsigned i = 0; i < DSP_PROF_BINS; i++) {
+        cum += h->bin[i];
+        if (!got50 && cum >= rank50) {
+            out->p50 = prof_bin_centre(i) * 0.25f;
+            got50 = true;
+        }
+        if (cum >= rank99) {
+            out->p99 = prof_bin_centre(i) * 0.25f;
+            break;
+        }
+    }
+
+    uint16_t max = (h->max_cur > h->max_prev) ? h->max_cur : h->max_prev;
+    out->max = (float)max * 0.25f;
+    if (out->p99 > out->max) out->p99 = out->max;
+    if (out->p50 > out->max) out->p50 = out->max;
+    out->count = count;
+}
+
+void dsp_prof_reset(dsp_prof_hist_t *h)
+{
+    memset(h, 0, sizeof(*h));
+}
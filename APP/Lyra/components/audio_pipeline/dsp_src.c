@@ -0,0 +1,386 @@
+#include "dsp_src.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+
+static const char *TAG = "dsp_src";
+
+#define INT32_TO_FLOAT_SCALE  (1.0f / 2147483648.0f)   // 1 / 2^31
+#define FLOAT_TO_INT32_SCALE  (2147483648.0f)           // 2^31
+#define INT32_MAX_FLOAT       ( 2147483520.0f)          // 2^31 - 128
+#define INT32_MIN_FLOAT       (-2147483648.0f)
+
+// Input frames converted into the history per refill
+#define SRC_LOAD_FRAMES  512
+
+// Phase tables up to this size stay in internal RAM (44.1k ↔ 48k MEDIUM)
+#define SRC_TABLE_INTERNAL_MAX  (48 * 1024)
+
+// Cost model (cycles, ESP32-P4 — check with `dsp bench src`)
+#define SRC_CYCLES_PER_TAP    3     // 1 coef + 2 history loads, 2 FMA, unrolled ×4
+#define SRC_CYCLES_PER_FRAME  40    // phase step, int32 ↔ float, clamp, history copy
+
+typedef struct {
+    uint16_t taps;          // T per phase (before the downsampling stretch)
+    float    atten_db;      // Kaiser design stopband
+} src_profile_t;
+
+static const src_profile_t s_profiles[DSP_SRC_QUALITY_COUNT] = {
+    [DSP_SRC_QUALITY_LOW]    = {  32,  80.0f },
+    [DSP_SRC_QUALITY_MEDIUM] = {  64, 100.0f },
+    [DSP_SRC_QUALITY_HIGH]   = { 128, 130.0f },
+};
+
+static const char *s_quality_names[DSP_SRC_QUALITY_COUNT] = {
+    [DSP_SRC_QUALITY_LOW]    = "low",
+    [DSP_SRC_QUALITY_MEDIUM] = "medium",
+    [DSP_SRC_QUALITY_HIGH]   = "high",
+};
+
+struct dsp_src_s {
+    uint32_t in_rate;
+    uint32_t out_rate;
+    dsp_src_quality_t quality;
+    uint16_t L;             // phases (interpolation factor)
+    uint16_t M;             // decimation factor
+    uint16_t step_q;        // M / L
+    uint16_t step_r;        // M % L
+    uint16_t taps;          // T — taps per phase
+    float    passband;      // Hz
+
+    float   *coef;          // [L][T], reversed per phase (see src_design)
+
+    // Stereo interleaved float history: [hist_cap] frames
+    float   *hist;
+    uint32_t hist_cap;
+    uint32_t hist_len;      // frames valid
+    uint32_t base;          // first frame of the next output's window
+    uint16_t phase;         // 0..L-1
+};
+
+//--------------------------------------------------------------------+
+// Filter design (control task)
+//--------------------------------------------------------------------+
+
+static uint32_t src_gcd(uint32_t a, uint32_t b)
+{
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth-order modified Bessel function of the first kind
+static double src_bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 64; k++) {
+        term *= q / ((double)k * (double)k);
+        sum += term;
+        if (term < sum * 1e-17) break;
+    }
+    return sum;
+}
+
+static double src_kaiser_beta(double atten_db)
+{
+    if (atten_db > 50.0) return 0.1102 * (atten_db - 8.7);
+    if (atten_db >= 21.0) return 0.5842 * pow(atten_db - 21.0, 0.4) + 0.07886 * (atten_db - 21.0);
+    return 0.0;
+}
+
+static void *src_alloc(size_t bytes)
+{
+    void *p = NULL;
+    if (bytes > SRC_TABLE_INTERNAL_MAX) {
+        p = heap_caps_calloc(1, bytes, MALLOC_CAP_SPIRAM);
+    }
+    if (!p) {
+        p = calloc(1, bytes);
+    }
+    return p;
+}
+
+/**
+ * @brief Design the prototype and scatter it into the phase table
+ *
+ * Prototype h[n], n = 0..N−1 with N = T·L, runs at the upsampled rate
+ * in_rate·L. Output y[m] at upsampled time t = m·M, with p = t mod L and
+ * n = ⌊t / L⌋, is
+ *
+ *   y[m] = Σ_j h[p + j·L] · x[n − j],   j = 0..T−1
+ *
+ * Stored reversed so the kernel walks history and coefficients forward:
+ * coef[p][i] = L · h[p + (T−1−i)·L] applied to x[n − T + 1 + i].
+ */
+static void src_design(dsp_src_t *s, double atten_db)
+{
+    const uint32_t L = s->L;
+    const uint32_t T = s->taps;
+    const uint32_t N = T * L;
+    const double fu = (double)s->in_rate * L;
+    const double fmin = (s->in_rate < s->out_rate) ? s->in_rate : s->out_rate;
+    const double fc = 0.5 * fmin / fu;              // cycles per upsampled sample
+    const double beta = src_kaiser_beta(atten_db);
+    const double i0_beta = src_bessel_i0(beta);
+    const double centre = 0.5 * (double)(N - 1);
+
+    // Symmetric prototype: compute half, mirror into both table slots
+    double sum = 0.0;
+    for (uint32_t n = 0; n <= (N - 1) / 2; n++) {
+        const double t = (double)n - centre;
+        const double x = 2.0 * fc * t;
+        const double sinc = (fabs(x) < 1e-12) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+        const double r = t / centre;
+        const double w = src_bessel_i0(beta * sqrt(fmax(0.0, 1.0 - r * r))) / i0_beta;
+        const double h = 2.0 * fc * sinc * w;
+
+        const uint32_t m = N - 1 - n;
+        s->coef[(n % L) * T + (T - 1 - n / L)] = (float)h;
+        s->coef[(m % L) * T + (T - 1 - m / L)] = (float)h;
+        sum += (n == m) ? h : 2.0 * h;
+    }
+
+    // Exact unity DC gain on average: each phase sums to ≈ 1
+    const float g = (float)((double)L / sum);
+    for (uint32_t k = 0; k < N; k++) {
+        s->coef[k] *= g;
+    }
+
+    // Kaiser transition width → passband edge (cutoff at the band centre)
+    const double dw = (atten_db - 7.95) / (2.285 * (double)(N - 1));
+    s->passband = (float)(0.5 * fmin - 0.5 * dw / (2.0 * M_PI) * fu);
+}
+
+//--------------------------------------------------------------------+
+// Create / Destroy
+//--------------------------------------------------------------------+
+
+static uint16_t src_taps_for(uint32_t L, uint32_t M, dsp_src_quality_t quality)
+{
+    uint32_t t = s_profiles[quality].taps;
+    // Downsampling: stretch the prototype by the ratio so the transition
+    // width stays the same at the (lower) output rate
+    if (M > L) t = (uint32_t)(((uint64_t)t * M + L - 1) / L);
+    return (uint16_t)((t + 3) & ~3u);
+}
+
+bool dsp_src_supported(uint32_t in_rate, uint32_t out_rate)
+{
+    if (in_rate == 0 || out_rate == 0) return false;
+    const uint32_t g = src_gcd(in_rate, out_rate);
+    const uint32_t L = out_rate / g;
+    const uint32_t M = in_rate / g;
+    return L <= DSP_SRC_MAX_PHASES && M <= (uint32_t)DSP_SRC_MAX_DOWN * L;
+}
+
+dsp_src_t *dsp_src_create(uint32_t in_rate, uint32_t out_rate, dsp_src_quality_t quality)
+{
+    if (in_rate == 0 || out_rate == 0 || quality >= DSP_SRC_QUALITY_COUNT) return NULL;
+
+    const uint32_t g = src_gcd(in_rate, out_rate);
+    const uint32_t L = out_rate / g;
+    const uint32_t M = in_rate / g;
+    if (!dsp_src_supported(in_rate, out_rate)) {
+        ESP_LOGE(TAG, "Unsupported ratio %lu → %lu Hz (L=%lu M=%lu)",
+                 (unsigned long)in_rate, (unsigned long)out_rate,
+                 (unsigned long)L, (unsigned long)M);
+        return NULL;
+    }
+
+    dsp_src_t *s = calloc(1, sizeof(dsp_src_t));
+    if (!s) return NULL;
+
+    s->in_rate  = in_rate;
+    s->out_rate = out_rate;
+    s->quality  = quality;
+    s->L = (uint16_t)L;
+    s->M = (uint16_t)M;
+    s->step_q = (uint16_t)(M / L);
+    s->step_r = (uint16_t)(M % L);
+    s->taps = src_taps_for(L, M, quality);
+    s->hist_cap = s->taps + SRC_LOAD_FRAMES;
+
+    const size_t table_bytes = (size_t)L * s->taps * sizeof(float);
+    s->coef = src_alloc(table_bytes);
+    s->hist = calloc((size_t)s->hist_cap * 2, sizeof(float));
+    if (!s->coef || !s->hist) {
+        ESP_LOGE(TAG, "Out of memory (%lu bytes phase table)", (unsigned long)table_bytes);
+        dsp_src_destroy(s);
+        return NULL;
+    }
+
+    src_design(s, s_profiles[quality].atten_db);
+    dsp_src_reset(s);
+
+    ESP_LOGI(TAG, "SRC %lu → %lu Hz (%s): L=%u M=%u, %u taps, passband %.0f Hz, "
+             "%lu KB table, ~%u cyc/frame",
+             (unsigned long)in_rate, (unsigned long)out_rate, s_quality_names[quality],
+             s->L, s->M, s->taps, s->passband, (unsigned long)(table_bytes / 1024),
+             dsp_src_cycles_per_frame(in_rate, out_rate, quality));
+    return s;
+}
+
+void dsp_src_destroy(dsp_src_t *src)
+{
+    if (!src) return;
+    free(src->coef);
+    free(src->hist);
+    free(src);
+}
+
+void dsp_src_reset(dsp_src_t *src)
+{
+    // Pre-roll cancels the group delay ((T·L − 1) / 2 upsampled samples):
+    // with T/2 − 1 zeros the first output's window is centred on input
+    // frame 0, give or take half an upsampled sample
+    const uint32_t pre = src->taps / 2 - 1;
+    memset(src->hist, 0, (size_t)pre * 2 * sizeof(float));
+    src->hist_len = pre;
+    src->base = 0;
+    src->phase = 0;
+}
+
+//--------------------------------------------------------------------+
+// Processing (audio task)
+//--------------------------------------------------------------------+
+//
+// One stereo dot product per output frame. Every coefficient is loaded
+// once and used for both channels; four accumulators per channel break
+// the FMA dependency chain so the in-order FPU can overlap them. T is a
+// multiple of 4. As with the biquad cascade, PIE has no float lanes on
+// the P4, so the unrolled scalar kernel is the vector path here.
+//--------------------------------------------------------------------+
+
+__attribute__((hot))
+static inline void src_dot(const float *restrict c, const float *restrict x, uint32_t taps,
+                           float *out_l, float *out_r)
+{
+    float l0 = 0.0f, l1 = 0.0f, l2 = 0.0f, l3 = 0.0f;
+    float r0 = 0.0f, r1 = 0.0f, r2 = 0.0f, r3 = 0.0f;
+
+    for (uint32_t i = 0; i < taps; i += 4) {
+        const float c0 = c[i], c1 = c[i + 1], c2 = c[i + 2], c3 = c[i + 3];
+        const float *p = x + 2 * i;
+        l0 += c0 * p[0]; r0 += c0 * p[1];
+        l1 += c1 * p[2]; r1 += c1 * p[3];
+        l2 += c2 * p[4]; r2 += c2 * p[5];
+        l3 += c3 * p[6]; r3 += c3 * p[7];
+    }
+
+    *out_l = (l0 + l1) + (l2 + l3);
+    *out_r = (r0 + r1) + (r2 + r3);
+}
+
+static inline int32_t src_to_int32(float v)
+{
+    v *= FLOAT_TO_INT32_SCALE;
+    if (v > INT32_MAX_FLOAT) v = INT32_MAX_FLOAT;
+    if (v < INT32_MIN_FLOAT) v = INT32_MIN_FLOAT;
+    return (int32_t)v;
+}
+
+// Append up to `frames` input frames to the history (compacting first)
+static uint32_t src_load(dsp_src_t *s, const int32_t *in, uint32_t frames)
+{
+    if (s->hist_len == s->hist_cap && s->base > 0) {
+        const uint32_t keep = s->hist_len - s->base;
+        memmove(s->hist, s->hist + 2 * s->base, (size_t)keep * 2 * sizeof(float));
+        s->hist_len = keep;
+        s->base = 0;
+    }
+
+    uint32_t room = s->hist_cap - s->hist_len;
+    if (frames > room) frames = room;
+
+    float *h = s->hist + 2 * s->hist_len;
+    for (uint32_t i = 0; i < frames * 2; i++) {
+        h[i] = (float)in[i] * INT32_TO_FLOAT_SCALE;
+    }
+    s->hist_len += frames;
+    return frames;
+}
+
+__attribute__((hot))
+uint32_t dsp_src_process(dsp_src_t *src, const int32_t *in, uint32_t in_frames,
+                         int32_t *out, uint32_t out_max, uint32_t *in_used)
+{
+    dsp_src_t *s = src;
+    const uint32_t T = s->taps;
+    const uint32_t L = s->L;
+    uint32_t used = 0;
+    uint32_t produced = 0;
+
+    while (produced < out_max) {
+        // Window incomplete: pull more input into the history
+        if (s->base + T > s->hist_len) {
+            if (used == in_frames) break;
+            used += src_load(s, in + 2 * used, in_frames - used);
+            continue;
+        }
+
+        uint32_t base = s->base;
+        uint32_t phase = s->phase;
+        const uint32_t limit = s->hist_len;
+
+        while (produced < out_max && base + T <= limit) {
+            float l, r;
+            src_dot(s->coef + (size_t)phase * T, s->hist + 2 * base, T, &l, &r);
+            out[2 * produced]     = src_to_int32(l);
+            out[2 * produced + 1] = src_to_int32(r);
+            produced++;
+
+            phase += s->step_r;
+            base  += s->step_q;
+            if (phase >= L) {
+                phase -= L;
+                base++;
+            }
+        }
+        s->base = base;
+        s->phase = (uint16_t)phase;
+    }
+
+    *in_used = used;
+    return produced;
+}
+
+uint32_t dsp_src_input_needed(const dsp_src_t *src, uint32_t out_frames)
+{
+    if (out_frames == 0) return 0;
+    // Window of the last requested output: base + ⌊(phase + (n−1)·M) / L⌋
+    const uint64_t t = (uint64_t)src->phase + (uint64_t)(out_frames - 1) * src->M;
+    const uint64_t end = (uint64_t)src->base + t / src->L + src->taps;
+    return (end > src->hist_len) ? (uint32_t)(end - src->hist_len) : 0;
+}
+
+//--------------------------------------------------------------------+
+// Queries
+//--------------------------------------------------------------------+
+
+uint32_t dsp_src_get_in_rate(const dsp_src_t *src)          { return src->in_rate; }
+uint32_t dsp_src_get_out_rate(const dsp_src_t *src)         { return src->out_rate; }
+dsp_src_quality_t dsp_src_get_quality(const dsp_src_t *src) { return src->quality; }
+uint16_t dsp_src_get_taps(const dsp_src_t *src)             { return src->taps; }
+float    dsp_src_get_passband(const dsp_src_t *src)         { return src->passband; }
+
+const char *dsp_src_quality_name(dsp_src_quality_t quality)
+{
+    return (quality < DSP_SRC_QUALITY_COUNT) ? s_quality_names[quality] : "?";
+}
+
+uint16_t dsp_src_cycles_per_frame(uint32_t in_rate, uint32_t out_rate, dsp_src_quality_t quality)
+{
+    if (in_rate == 0 || out_rate == 0 || quality >= DSP_SRC_QUALITY_COUNT) return 0;
+    const uint32_t g = src_gcd(in_rate, out_rate);
+    const uint32_t taps = src_taps_for(out_rate / g, in_rate / g, quality);
+    // Input conversion is amortised at in/out frames per output frame
+    uint32_t cycles = taps * SRC_CYCLES_PER_TAP + SRC_CYCLES_PER_FRAME
+                    + (uint32_t)((uint64_t)8 * in_rate / out_rate);
+    return (uint16_t)(cycles > UINT16_MAX ? UINT16_MAX : cycles);
+}
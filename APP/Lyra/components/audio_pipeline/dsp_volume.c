@@ -0,0 +1,249 @@
+#include "dsp_volume.h"
+#include <string.h>
+#include <math.h>
+
+// Fraction bits kept below the output LSB through dither and shaping
+#define VOL_FRAC        16
+#define VOL_HALF        (1 << (VOL_FRAC - 1))
+
+// Error feedback coefficients are Q12; the error is clamped so that the
+// three products and their sum stay inside int32 (|e| ≤ 2 LSB)
+#define SHAPE_FRAC      12
+#define SHAPE_ERR_MAX   (2 << VOL_FRAC)
+
+// Noise transfer functions 1 − (h1 z⁻¹ + h2 z⁻² + h3 z⁻³)
+static const int32_t s_shape_fweighted[3] = { 6648, -4022, 446 };   // 1.623, −0.982, 0.109
+static const int32_t s_shape_highpass[3]  = { 8192, -4096, 0 };     // (1 − z⁻¹)²
+
+// Sources the fused loop reads from
+typedef enum {
+    VOL_SRC_INTERLEAVED = 0,
+    VOL_SRC_Q31,
+    VOL_SRC_FLOAT,
+} vol_src_t;
+
+//--------------------------------------------------------------------+
+// Configuration
+//--------------------------------------------------------------------+
+
+void dsp_volume_init(dsp_volume_t *vol)
+{
+    memset(vol, 0, sizeof(*vol));
+    vol->gain = (int64_t)DSP_VOLUME_UNITY << 31;
+    vol->target = DSP_VOLUME_UNITY;
+    vol->out_bits = 32;
+    vol->dither = DSP_DITHER_OFF;
+    vol->seed = 0x2545F491u;
+}
+
+void dsp_volume_config(dsp_volume_t *vol, uint32_t sample_rate, uint8_t out_bits,
+                       dsp_dither_t dither)
+{
+    if (out_bits < 16) out_bits = 16;
+    if (out_bits > 32) out_bits = 32;
+    vol->out_bits = out_bits;
+    vol->dither = (dither < DSP_DITHER_COUNT) ? dither : DSP_DITHER_TPDF;
+    memcpy(vol->shape, (sample_rate <= 50000) ? s_shape_fweighted : s_shape_highpass,
+           sizeof(vol->shape));
+    memset(vol->err, 0, sizeof(vol->err));
+}
+
+void dsp_volume_set_target(dsp_volume_t *vol, uint32_t gain, uint32_t ramp_frames)
+{
+    if (gain > DSP_VOLUME_UNITY) gain = DSP_VOLUME_UNITY;
+    vol->target = gain;
+
+    const int64_t to = (int64_t)gain << 31;
+    if (ramp_frames == 0 || to == vol->gain) {
+        vol->gain = to;
+        vol->step = 0;
+        vol->ramp_left = 0;
+        return;
+    }
+    vol->step = (to - vol->gain) / (int64_t)ramp_frames;
+    vol->ramp_left = ramp_frames;
+}
+
+uint32_t dsp_volume_gain_from_db(float volume_db)
+{
+    if (volume_db >= 0.0f) return DSP_VOLUME_UNITY;
+    if (volume_db < DSP_VOLUME_MIN_DB) return 0;
+    return (uint32_t)lrint(pow(10.0, volume_db / 20.0) * (double)DSP_VOLUME_UNITY);
+}
+
+const char *dsp_dither_name(dsp_dither_t dither)
+{
+    static const char *const names[DSP_DITHER_COUNT] = {
+        "off", "tpdf", "shaped",
+    };
+    return (dither < DSP_DITHER_COUNT) ? names[dither] : "?";
+}
+
+uint16_t dsp_volume_cycles_per_sample(dsp_dither_t dither, uint8_t out_bits)
+{
+    // 32x32 → 64 multiply, rounding shift and saturation; TPDF adds one
+    // xorshift, the shaper three multiplies and the error update
+    uint16_t cycles = 4;
+    if (out_bits < 32 && dither == DSP_DITHER_TPDF) cycles += 6;
+    if (out_bits < 32 && dither == DSP_DITHER_SHAPED) cycles += 14;
+    return cycles;
+}
+
+//--------------------------------------------------------------------+
+// Fused gain + requantise
+//--------------------------------------------------------------------+
+
+__attribute__((always_inline))
+static inline uint32_t vol_rand(uint32_t *seed)
+{
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+/**
+ * @brief One sample: p = x × gain, requantised to the output word
+ *
+ * @param p     Product in Q(62 − headroom)
+ * @param sh    63 − headroom − out_bits: shift from p to output LSBs
+ * @param lim   Largest output value (2^(out_bits−1) − 1)
+ * @return Output value in LSBs (not yet left-justified)
+ */
+__attribute__((always_inline))
+static inline int32_t vol_requantise(int64_t p, uint32_t sh, int32_t lim, dsp_dither_t mode,
+                                     const int32_t *h, int32_t *e, uint32_t *seed)
+{
+    int64_t v = p >> (sh - VOL_FRAC);
+
+    if (mode == DSP_DITHER_SHAPED) {
+        v -= (h[0] * e[0] + h[1] * e[1] + h[2] * e[2]) >> SHAPE_FRAC;
+    }
+    int64_t q = v + VOL_HALF;
+    if (mode != DSP_DITHER_OFF) {
+        // Difference of two uniform 16-bit values: triangular, ±1 LSB
+        const uint32_t r = vol_rand(seed);
+        q += (int32_t)(r & 0xFFFFu) - (int32_t)(r >> 16);
+    }
+    int64_t y = q >> VOL_FRAC;
+    if (y > lim) y = lim;
+    else if (y < -lim - 1) y = -lim - 1;
+
+    if (mode == DSP_DITHER_SHAPED) {
+        int64_t err = (y << VOL_FRAC) - v;
+        if (err > SHAPE_ERR_MAX) err = SHAPE_ERR_MAX;
+        else if (err < -SHAPE_ERR_MAX) err = -SHAPE_ERR_MAX;
+        e[2] = e[1];
+        e[1] = e[0];
+        e[0] = (int32_t)err;
+    }
+    return (int32_t)y;
+}
+
+/**
+ * @brief Gain + requantise over frames, reading from src and writing
+ *        interleaved int32
+ *
+ * src and mode are constants at every call site, so each combination
+ * compiles to its own branch-free loop.
+ */
+__attribute__((always_inline))
+static inline void vol_run(dsp_volume_t *vol, vol_src_t src, dsp_dither_t mode,
+                           const void *in_a, const void *in_b, int32_t *out,
+                           uint32_t frames, uint8_t headroom)
+{
+    const uint32_t sh = 63u - headroom - vol->out_bits;
+    const uint32_t justify = 32u - vol->out_bits;
+    const int32_t lim = (int32_t)(0x7FFFFFFFu >> justify);
+    const float scale = (float)(1u << (31 - headroom));
+    const float fmax = 2147483520.0f;   // 2^31 − 128, largest float below 2^31
+
+    const int32_t *h = vol->shape;
+    int32_t *eL = vol->err[0], *eR = vol->err[1];
+    uint32_t seed = vol->seed;
+    int64_t gain = vol->gain;
+    uint32_t done = 0;
+
+    // Ramp segment (per-frame step), then the constant segment
+    while (done < frames) {
+        uint32_t n = frames - done;
+        int64_t step = 0;
+        if (vol->ramp_left > 0) {
+            if (n > vol->ramp_left) n = vol->ramp_left;
+            step = vol->step;
+        }
+
+        for (uint32_t i = done; i < done + n; i++) {
+            int32_t xl, xr;
+            if (src == VOL_SRC_INTERLEAVED) {
+                xl = out[i * 2];
+                xr = out[i * 2 + 1];
+            } else if (src == VOL_SRC_Q31) {
+                xl = ((const int32_t *)in_a)[i];
+                xr = ((const int32_t *)in_b)[i];
+            } else {
+                float fl = ((const float *)in_a)[i] * scale;
+                float fr = ((const float *)in_b)[i] * scale;
+                if (fl > fmax) fl = fmax; else if (fl < -2147483648.0f) fl = -2147483648.0f;
+                if (fr > fmax) fr = fmax; else if (fr < -2147483648.0f) fr = -2147483648.0f;
+                xl = (int32_t)fl;
+                xr = (int32_t)fr;
+            }
+
+            const int64_t g = gain >> 31;
+            gain += step;
+
+            const int32_t yl = vol_requantise((int64_t)xl * g, sh, lim, mode, h, eL, &seed);
+            const int32_t yr = vol_requantise((int64_t)xr * g, sh, lim, mode, h, eR, &seed);
+            out[i * 2]     = (int32_t)((uint32_t)yl << justify);
+            out[i * 2 + 1] = (int32_t)((uint32_t)yr << justify);
+        }
+
+        if (step != 0) {
+            vol->ramp_left -= n;
+            if (vol->ramp_left == 0) {
+                // Land exactly on the target (the step was rounded)
+                gain = (int64_t)vol->target << 31;
+            }
+        }
+        done += n;
+    }
+
+    vol->gain = gain;
+    vol->seed = seed;
+}
+
+// Dither is only worth its noise when the word gets shorter
+static inline dsp_dither_t vol_mode(const dsp_volume_t *vol)
+{
+    return (vol->out_bits < 32) ? vol->dither : DSP_DITHER_OFF;
+}
+
+#define VOL_DISPATCH(vol, src, a, b, out, frames, headroom)                          \
+    switch (vol_mode(vol)) {                                                         \
+    case DSP_DITHER_TPDF:                                                            \
+        vol_run(vol, src, DSP_DITHER_TPDF, a, b, out, frames, headroom); break;      \
+    case DSP_DITHER_SHAPED:                                                          \
+        vol_run(vol, src, DSP_DITHER_SHAPED, a, b, out, frames, headroom); break;    \
+    default:                                                                         \
+        vol_run(vol, src, DSP_DITHER_OFF, a, b, out, frames, headroom); break;       \
+    }
+
+void dsp_volume_process(dsp_volume_t *vol, int32_t *buf, uint32_t frames)
+{
+    VOL_DISPATCH(vol, VOL_SRC_INTERLEAVED, NULL, NULL, buf, frames, 0);
+}
+
+void dsp_volume_interleave_q31(dsp_volume_t *vol, const int32_t *buf_L, const int32_t *buf_R,
+                               int32_t *out, uint32_t frames, uint8_t headroom)
+{
+    VOL_DISPATCH(vol, VOL_SRC_Q31, buf_L, buf_R, out, frames, headroom);
+}
+
+void dsp_volume_interleave_float(dsp_volume_t *vol, const float *buf_L, const float *buf_R,
+                                 int32_t *out, uint32_t frames, uint8_t headroom)
+{
+    VOL_DISPATCH(vol, VOL_SRC_FLOAT, buf_L, buf_R, out, frames, headroom);
+}
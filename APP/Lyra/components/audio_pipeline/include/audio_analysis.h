@@ -0,0 +1,134 @@
+#ifndef AUDIO_ANALYSIS_H
+#define AUDIO_ANALYSIS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Post-DSP Analysis (spectrum and level meters)
+//--------------------------------------------------------------------+
+//
+// Looks at what leaves the DSP chain, without ever making the audio
+// core wait:
+//
+//   audio task (core 1)                 analysis task (core 0, prio 1)
+//   ───────────────────                 ──────────────────────────────
+//   dsp_chain_process()                 arm the tap
+//   audio_analysis_tap():               ... sleep one period ...
+//     not armed → return                window ready?
+//     armed → copy frames into the        peak / RMS / true-peak per channel
+//       window, at most one block         CIC decimation → Hann → FFT → bands
+//     window full → mark ready            ballistics, publish (seqlock)
+//                                         re-arm
+//
+// The tap is one atomic load when nobody has armed it and a memcpy of at
+// most one block when it is armed; it never waits and never allocates.
+// Windows are a snapshot, not the whole stream: one window of
+// AUDIO_ANALYSIS_FFT_SIZE frames (× the decimation factor, ~43 ms) per
+// period, so at 30 updates/s the meters see most of the signal up to
+// 48 kHz and a fraction of it at higher rates. A short peak between two
+// windows can be missed; the meters are for the eye, not for mastering.
+//
+// Rates above 48 kHz are decimated to 44.1/48 kHz before the FFT (third-
+// order CIC, droop corrected per band), so the spectrum always covers
+// 20 Hz - 20 kHz with the same resolution (~23 Hz bins). True peak uses
+// the BS.1770 interpolator of the limiter up to 96 kHz; above that the
+// samples are dense enough and the sample peak is reported.
+//
+// Nothing is computed for nobody: the FFT only runs while someone has
+// called audio_analysis_get() within AUDIO_ANALYSIS_STALE_MS (the UI
+// polls it only while the now-playing screen is shown and the display is
+// unlocked). Otherwise the task drops to AUDIO_ANALYSIS_IDLE_MS and
+// keeps the level meters alone.
+//--------------------------------------------------------------------+
+
+/**
+ * @brief FFT length after decimation (points)
+ */
+#define AUDIO_ANALYSIS_FFT_SIZE     2048
+
+/**
+ * @brief Spectrum bands, log-spaced 20 Hz - 20 kHz (~0.4 octave each)
+ */
+#define AUDIO_ANALYSIS_BANDS        24
+
+/**
+ * @brief Largest decimation factor before the FFT (384 kHz → 48 kHz)
+ */
+#define AUDIO_ANALYSIS_MAX_DECIM    8
+
+/**
+ * @brief Update period while read, and while nobody reads
+ */
+#define AUDIO_ANALYSIS_PERIOD_MS    33
+#define AUDIO_ANALYSIS_IDLE_MS      500
+
+/**
+ * @brief A reader counts as gone after this long without a call
+ */
+#define AUDIO_ANALYSIS_STALE_MS     1000
+
+/**
+ * @brief Meter floor, peak hold time and fall-back rate
+ */
+#define AUDIO_ANALYSIS_FLOOR_DB     (-120.0f)
+#define AUDIO_ANALYSIS_HOLD_MS      1500
+#define AUDIO_ANALYSIS_FALL_DB_S    24.0f
+
+/**
+ * @brief One analysis result, levels in dB relative to full scale
+ */
+typedef struct {
+    uint32_t seq;                           ///< Bumped on every update (0 = none yet)
+    uint32_t sample_rate;                   ///< Rate of the analysed signal (0 = no audio yet)
+    float    peak_db[2];                    ///< Sample peak L/R, dBFS (falls at FALL_DB_S)
+    float    rms_db[2];                     ///< RMS over the window L/R, dBFS (full-scale sine = -3)
+    float    true_peak_db[2];               ///< Inter-sample peak L/R, dBTP (sample peak above 96 kHz)
+    float    hold_db[2];                    ///< Highest true peak over the hold time
+    bool     clip;                          ///< Full scale reached within the hold time
+    bool     spectrum_valid;                ///< band_db is live (FFT runs only while read)
+    float    band_db[AUDIO_ANALYSIS_BANDS]; ///< Band level, L+R mean, dBFS (full-scale sine = 0)
+} audio_analysis_t;
+
+/**
+ * @brief Allocate the window and start the analysis task on core 0
+ *
+ * @return true on success (false: no memory, meters stay at the floor)
+ */
+bool audio_analysis_start(void);
+
+/**
+ * @brief Offer a processed block to the tap (audio task only)
+ *
+ * Wait-free: returns at once unless the analysis task armed the tap,
+ * then copies at most @p frames frames. One producer at a time (the
+ * active source).
+ *
+ * @param buf         Interleaved int32 stereo, as it leaves the chain
+ * @param frames      Frames in buf
+ * @param sample_rate Rate of buf (a change restarts the window)
+ */
+void audio_analysis_tap(const int32_t *buf, uint32_t frames, uint32_t sample_rate);
+
+/**
+ * @brief Latest result (any task); keeps the analysis at full rate
+ *
+ * @return false if nothing was published yet or the writer was busy
+ *         (out is left untouched, retry on the next frame)
+ */
+bool audio_analysis_get(audio_analysis_t *out);
+
+/**
+ * @brief Centre frequency of a spectrum band (for labels)
+ */
+float audio_analysis_band_hz(uint8_t band);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_ANALYSIS_H */
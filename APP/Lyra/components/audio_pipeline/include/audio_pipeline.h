@@ -4,6 +4,8 @@
 #include "dsp_types.h"
 #include "dsp_chain.h"
 #include "dsp_presets.h"
+#include "dsp_src.h"
+#include "dsp_os.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -12,6 +14,11 @@ extern "C" {
 //--------------------------------------------------------------------+
 // Audio Pipeline - Integration Layer
 //--------------------------------------------------------------------+
+//
+// Setters may be called from any task: they take one lock, so the chain
+// sees a single writer. A setter can block while another one designs
+// coefficients (a preset load), never for a whole audio block.
+// audio_pipeline_process() takes no lock.
 
 /**
  * @brief Initialize audio pipeline with DSP processing
@@ -60,8 +67,10 @@ bool audio_pipeline_is_enabled(void);
  *
  * Hard clip (default): clamp at ±1.0 — transparent, no compression artifacts.
  * Soft limiter: Padé tanh compression — smooth but compresses dynamics.
+ * Look-ahead: gain rides down ahead of peaks (1.5 ms delay), no clipping.
+ * True-peak: look-ahead on 4x-interpolated peaks, -1 dBTP ceiling.
  *
- * @param mode DSP_LIMITER_HARD_CLIP or DSP_LIMITER_SOFT
+ * @param mode DSP_LIMITER_HARD_CLIP, SOFT, LOOKAHEAD or TRUE_PEAK
  */
 void audio_pipeline_set_limiter_mode(dsp_limiter_mode_t mode);
 
@@ -72,6 +81,49 @@ void audio_pipeline_set_limiter_mode(dsp_limiter_mode_t mode);
  */
 dsp_limiter_mode_t audio_pipeline_get_limiter_mode(void);
 
+/**
+ * @brief Set the biquad kernel policy
+ *
+ * Auto (default): sections with poles close to the unit circle run on
+ * the Q31 kernel while the budget allows. Float / fixed force one kernel
+ * (fixed: every section that fits Q3.28).
+ *
+ * @param mode DSP_KERNEL_AUTO, FLOAT or FIXED
+ */
+void audio_pipeline_set_kernel_mode(dsp_kernel_mode_t mode);
+
+/**
+ * @brief Get the biquad kernel policy
+ */
+dsp_kernel_mode_t audio_pipeline_get_kernel_mode(void);
+
+/**
+ * @brief Apply a quality change requested by the audio task (call periodically)
+ *
+ * The chain measures its cost per block and asks for a lower quality
+ * level when it runs late, a higher one when headroom returns; this
+ * publishes the change from the calling task, under the same lock as
+ * every other setter.
+ *
+ * @return true if the level changed
+ */
+bool audio_pipeline_update_quality(void);
+
+/**
+ * @brief Enable/disable load-adaptive quality (enabled by default)
+ */
+void audio_pipeline_set_quality_adaptive(bool enabled);
+
+/**
+ * @brief Whether load-adaptive quality is enabled
+ */
+bool audio_pipeline_get_quality_adaptive(void);
+
+/**
+ * @brief Current quality level (DSP_QUALITY_FULL unless degraded under load)
+ */
+dsp_quality_t audio_pipeline_get_quality(void);
+
 /**
  * @brief Enable/disable crossfeed
  */
@@ -82,6 +134,65 @@ void audio_pipeline_set_crossfeed(bool enabled);
  */
 bool audio_pipeline_get_crossfeed(void);
 
+/**
+ * @brief Enable/disable loudness compensation (ISO 226, follows the listening level)
+ */
+void audio_pipeline_set_loudness(bool enabled);
+
+/**
+ * @brief Get loudness compensation state
+ */
+bool audio_pipeline_get_loudness(void);
+
+/**
+ * @brief Set the listening level the loudness compensation follows
+ *
+ * Safe from any task, no publish (see dsp_chain_set_listening_level()).
+ *
+ * @param volume_db Volume relative to full scale, dB (≤ 0)
+ */
+void audio_pipeline_set_listening_level(float volume_db);
+
+/**
+ * @brief Get the listening level, dB
+ */
+float audio_pipeline_get_listening_level(void);
+
+/**
+ * @brief Set the output volume (64-bit gain at the end of the chain)
+ *
+ * Also the listening level the loudness compensation follows. Safe from
+ * any task, no publish; the gain ramps over DSP_VOLUME_RAMP_MS.
+ *
+ * @param volume_db Volume, dB (≤ 0)
+ */
+void audio_pipeline_set_volume(float volume_db);
+
+/**
+ * @brief Get the output volume, dB
+ */
+float audio_pipeline_get_volume(void);
+
+/**
+ * @brief Mute/unmute the output (ramped)
+ */
+void audio_pipeline_set_mute(bool muted);
+
+/**
+ * @brief Get mute state
+ */
+bool audio_pipeline_get_mute(void);
+
+/**
+ * @brief Set the dither used when requantising to a 16-bit output
+ */
+void audio_pipeline_set_dither(dsp_dither_t dither);
+
+/**
+ * @brief Get the requantisation dither
+ */
+dsp_dither_t audio_pipeline_get_dither(void);
+
 /**
  * @brief Set a user-defined EQ band (for PRESET_USER)
  */
@@ -100,11 +211,27 @@ const biquad_params_t *audio_pipeline_get_user_band(uint8_t band);
 /**
  * @brief Update audio format (called when USB format changes)
  *
- * @param sample_rate New sample rate (Hz)
+ * With oversampling active the chain runs at sample_rate / factor.
+ *
+ * @param sample_rate New sample rate (Hz), as programmed into I2S
  * @param bits_per_sample New bit depth
  */
 void audio_pipeline_update_format(uint32_t sample_rate, uint8_t bits_per_sample);
 
+/**
+ * @brief Set the oversampling factor that follows the chain
+ *
+ * The producer engine calls this as it starts a stream; the chain then
+ * runs at the I2S rate / factor and its budget loses the oversampler's
+ * cost (dsp_os_cycles_per_frame()). 1 = off (USB, DoP, bypass).
+ */
+void audio_pipeline_set_oversampling(uint8_t factor, dsp_os_phase_t phase);
+
+/**
+ * @brief Current oversampling factor (1 = off)
+ */
+uint8_t audio_pipeline_get_oversampling(void);
+
 /**
  * @brief Process audio buffer (called from audio_task)
  *
@@ -119,7 +246,7 @@ void audio_pipeline_process(int32_t *buffer, uint32_t frames);
 /**
  * @brief Get current audio format
  *
- * @param sample_rate Output: current sample rate (Hz)
+ * @param sample_rate Output: current sample rate (Hz), I2S side
  * @param bits_per_sample Output: current bit depth
  */
 void audio_pipeline_get_format(uint32_t *sample_rate, uint8_t *bits_per_sample);
@@ -136,6 +263,194 @@ const dsp_stats_t *audio_pipeline_get_stats(void);
  */
 void audio_pipeline_print_stats(void);
 
+/**
+ * @brief Get CPU budget of the DSP chain at the current format
+ */
+void audio_pipeline_get_budget(dsp_budget_t *budget);
+
+/**
+ * @brief Measured cost of one DSP stage at a sample rate
+ *
+ * Rolling p50 / p99 / max in cycles per sample (see dsp_prof.h).
+ *
+ * @return false if the rate has no profile row
+ */
+bool audio_pipeline_get_stage_stats(uint32_t sample_rate, dsp_stage_t stage,
+                                    dsp_prof_stats_t *out);
+
+/**
+ * @brief Clear the DSP cycle histograms
+ */
+void audio_pipeline_reset_profile(void);
+
+//--------------------------------------------------------------------+
+// FIR Convolution
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Load a FIR impulse response file and install it in the chain
+ *
+ * Blocking (reads the file and transforms all partitions) — call from a
+ * control task.
+ *
+ * @param path  Full path (e.g. "/sdcard/fir/room.wav")
+ * @param block Partition size (0 = DSP_CONV_BLOCK_DEFAULT)
+ * @return true if loaded and installed
+ */
+bool audio_pipeline_load_fir(const char *path, uint16_t block);
+
+/**
+ * @brief Remove the FIR convolver
+ */
+void audio_pipeline_clear_fir(void);
+
+//--------------------------------------------------------------------+
+// Benchmarks
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Biquad kernel benchmark result
+ */
+typedef struct {
+    uint8_t  num_filters;            ///< Sections in the test cascade
+    uint32_t frames;                 ///< Frames per timed pass
+    float    ref_cycles_per_frame;   ///< biquad_process_mono() per section/channel
+    float    cascade_cycles_per_frame; ///< biquad_cascade_process()
+    bool     identical;              ///< Outputs bit-identical
+    float    q31_cycles_per_frame;   ///< biquad_cascade_process_q31()
+    uint8_t  q31_sections;           ///< Sections that fit Q3.28 (timed and compared)
+    float    float_snr_db;           ///< Float cascade vs double-precision reference (0 = n/a)
+    float    q31_snr_db;             ///< Q31 cascade vs the same reference (0 = n/a)
+} audio_pipeline_bench_t;
+
+/**
+ * @brief Time the reference, cascade and Q31 biquad kernels on the calling core
+ *
+ * Uses a private filter bank and buffers (does not touch the live chain).
+ * Takes the best of several passes to filter out interrupt noise. The
+ * SNRs compare both kernels with a double-precision run of the same
+ * cascade (left channel, all passes).
+ *
+ * @param num_filters Sections to run (clamped to DSP_MAX_BIQUADS)
+ * @param out         Result
+ */
+void audio_pipeline_bench_biquads(uint8_t num_filters, audio_pipeline_bench_t *out);
+
+/**
+ * @brief FIR convolution benchmark result
+ */
+typedef struct {
+    uint16_t block;                  ///< Partition size
+    uint32_t taps;                   ///< Impulse response length
+    float    cycles_per_sample;      ///< Measured (per channel, budget units)
+    uint16_t model_cycles;           ///< dsp_conv_cycles_per_sample() estimate
+    bool     ok;                     ///< false if the convolver could not be created
+} audio_pipeline_conv_bench_t;
+
+/**
+ * @brief Time the partitioned convolver for one partition size
+ *
+ * Builds a throwaway convolver with a synthetic response.
+ */
+void audio_pipeline_bench_conv(uint16_t block, uint32_t taps, audio_pipeline_conv_bench_t *out);
+
+/**
+ * @brief Sample-rate converter benchmark result
+ */
+typedef struct {
+    uint32_t in_rate;
+    uint32_t out_rate;
+    dsp_src_quality_t quality;
+    uint16_t taps;                   ///< Taps per output frame
+    float    passband_hz;            ///< Passband edge
+    float    cycles_per_frame;       ///< Measured, per stereo output frame
+    uint16_t model_cycles;           ///< dsp_src_cycles_per_frame() estimate
+    float    ripple_db;              ///< Peak-to-peak gain across the passband
+    float    rejection_db;           ///< Worst image / alias below the test tone
+    bool     ok;                     ///< false if the converter could not be created
+} audio_pipeline_src_bench_t;
+
+/**
+ * @brief Measure a converter: cost, passband ripple, image/alias rejection
+ *
+ * Runs sine tones through a throwaway converter and least-squares fits
+ * each output. Ripple comes from the fitted gains of tones spread over
+ * the passband; rejection is the worst fit residual (images, aliases,
+ * noise) and, when downsampling, the worst output of tones that would
+ * alias into the passband. Takes a few hundred ms.
+ */
+void audio_pipeline_bench_src(uint32_t in_rate, uint32_t out_rate, dsp_src_quality_t quality,
+                              audio_pipeline_src_bench_t *out);
+
+/**
+ * @brief Oversampler benchmark result
+ */
+typedef struct {
+    uint8_t  factor;
+    dsp_os_phase_t phase;
+    uint8_t  stages;
+    uint16_t taps[DSP_OS_MAX_STAGES];  ///< Prototype length of each stage
+    float    latency_frames;         ///< Delay, input frames
+    float    cycles_per_frame;       ///< Measured, per stereo input frame
+    uint16_t model_cycles;           ///< dsp_os_cycles_per_frame() estimate
+    float    ripple_db;              ///< Peak-to-peak gain across the passband
+    float    rejection_db;           ///< Worst image below the test tone
+    bool     ok;                     ///< false if out of memory / bad factor
+} audio_pipeline_os_bench_t;
+
+/**
+ * @brief Measure a throwaway oversampler: cost, ripple, image rejection
+ *
+ * Same tone-fit method as audio_pipeline_bench_src(), on tones over
+ * DSP_OS_PASSBAND of the input rate; the results are rate-independent.
+ */
+void audio_pipeline_bench_os(uint8_t factor, dsp_os_phase_t phase,
+                             audio_pipeline_os_bench_t *out);
+
+/**
+ * @brief Look-ahead limiter benchmark result
+ */
+typedef struct {
+    dsp_limiter_mode_t mode;
+    uint32_t sample_rate;
+    uint16_t lookahead;              ///< Attack ramp, frames
+    uint16_t latency;                ///< Delay, frames
+    float    cycles_per_sample;      ///< Measured (per channel, budget units)
+    uint16_t model_cycles;           ///< dsp_limiter_cycles_per_sample() estimate
+    float    peak_db;                ///< Highest output sample, dBFS (input peaks ~+9 dBFS)
+    bool     ok;                     ///< false if out of memory / not a look-ahead mode
+} audio_pipeline_limiter_bench_t;
+
+/**
+ * @brief Time a throwaway look-ahead limiter at a given rate
+ *
+ * Drives it with noise peaking ~10 dB above the ceiling, so the
+ * detector, deque and envelope work on every frame.
+ */
+void audio_pipeline_bench_limiter(dsp_limiter_mode_t mode, uint32_t sample_rate,
+                                  audio_pipeline_limiter_bench_t *out);
+
+/**
+ * @brief DSD→PCM decimator benchmark result
+ */
+typedef struct {
+    uint32_t dsd_rate;
+    uint32_t pcm_rate;
+    float    cycles_per_frame;       ///< Measured, per PCM output frame (stereo)
+    uint32_t model_cycles;           ///< dsd2pcm_cycles_per_frame() estimate
+    float    mcycles_per_sec;        ///< Measured load on the decoder core, Mcycles/s
+    bool     ok;                     ///< false if unsupported / out of memory
+} audio_pipeline_dsd_bench_t;
+
+/**
+ * @brief Time a throwaway DSD→PCM decimator on random DSD bytes
+ *
+ * The decimator runs in the decoder (codec_decode), not in the DSP
+ * chain: its load adds to the chain's, on the same core.
+ */
+void audio_pipeline_bench_dsd(uint32_t dsd_rate, uint32_t pcm_rate,
+                              audio_pipeline_dsd_bench_t *out);
+
 #ifdef __cplusplus
 }
 #endif
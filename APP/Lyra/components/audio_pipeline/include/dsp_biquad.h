@@ -44,6 +44,27 @@ typedef struct {
     float w[2][2];      ///< DFII-T state: w[channel][0..1], channel 0=L, 1=R
 } biquad_filter_t;
 
+/**
+ * @brief Fractional bits of the Q31 kernel's coefficients (Q3.28: |coef| < 8)
+ *
+ * Three integer bits cover a1 (±2) and the b coefficients of peaks and
+ * shelves up to about +18 dB; sections outside that stay on the float kernel.
+ */
+#define BIQUAD_Q31_FRAC 28
+
+/**
+ * @brief Biquad section for the Q31 kernel
+ *
+ * Direct Form I on int32 samples with a 64-bit accumulator; the
+ * truncation residue of each output is fed back into the next one.
+ */
+typedef struct {
+    int32_t  coef[5];   ///< {b0, b1, b2, a1, a2} in Q3.28
+    int32_t  x[2][2];   ///< Input history x[n-1], x[n-2] per channel
+    int32_t  y[2][2];   ///< Output history y[n-1], y[n-2] per channel
+    uint32_t err[2];    ///< Truncation residue per channel (error feedback)
+} biquad_q31_t;
+
 /**
  * @brief Biquad filter parameters (user-friendly)
  */
@@ -76,6 +97,88 @@ void biquad_calculate_coeffs(biquad_filter_t *filter, const biquad_params_t *par
  */
 void biquad_reset(biquad_filter_t *filter);
 
+/**
+ * @brief Calculate Q3.28 coefficients for the Q31 kernel
+ *
+ * Same RBJ design as biquad_calculate_coeffs(), rounded from double.
+ *
+ * @param coef   Output {b0, b1, b2, a1, a2}
+ * @param params Filter parameters
+ * @return false if a coefficient does not fit Q3.28 (use the float kernel)
+ */
+bool biquad_calculate_coeffs_q31(int32_t coef[5], const biquad_params_t *params);
+
+/**
+ * @brief Distance of the section's outermost pole from the unit circle
+ *
+ * 1 − max|pole|. Small margins (low frequency at a high rate, high Q)
+ * are where the float DFII-T recurrence loses precision.
+ */
+float biquad_pole_margin(const float coef[5]);
+
+/**
+ * @brief Reset Q31 section state (history and error feedback)
+ */
+void biquad_q31_reset(biquad_q31_t *filter);
+
+//--------------------------------------------------------------------+
+// Processing Kernels
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Run one DFII-T section over one channel, in place (reference kernel)
+ *
+ * Plain per-section, per-channel loop. Kept as the golden reference for
+ * biquad_cascade_process() and as the baseline for `dsp bench`.
+ *
+ * @param buf  Mono float buffer (in/out)
+ * @param len  Number of samples
+ * @param coef {b0, b1, b2, a1, a2}
+ * @param w    DFII-T state for this channel (2 floats)
+ */
+void biquad_process_mono(float *buf, uint32_t len, const float *coef, float *w);
+
+/**
+ * @brief Run a whole biquad cascade over both channels, in place
+ *
+ * Sections are fused in pairs and L/R are processed in the same loop, so
+ * each pass over the buffers advances four independent DFII-T recurrences
+ * with coefficients and state held in FP registers. Per channel the
+ * arithmetic order is unchanged, so the output is bit-identical to
+ * calling biquad_process_mono() per section and channel.
+ *
+ * @param filters Array of sections (state in filters[i].w[0] / w[1])
+ * @param count   Number of sections
+ * @param buf_L   Left channel (in/out)
+ * @param buf_R   Right channel (in/out)
+ * @param len     Number of frames
+ */
+void biquad_cascade_process(biquad_filter_t *filters, uint8_t count,
+                            float *buf_L, float *buf_R, uint32_t len);
+
+/**
+ * @brief Run a cascade of Q31 sections over both channels, in place
+ *
+ * int32 samples in and out (saturating per section); one 64-bit
+ * accumulation per output, truncation error fed back.
+ *
+ * With @p headroom the first section takes full-scale input and leaves
+ * its output that many bits down, without truncating the input: its
+ * input history holds the unshifted samples. The rest of the cascade
+ * runs at the reduced scale. With no sections the buffers are untouched
+ * (still full scale).
+ *
+ * @param filters  Array of sections
+ * @param count    Number of sections
+ * @param buf_L    Left channel (in/out)
+ * @param buf_R    Right channel (in/out)
+ * @param len      Number of frames
+ * @param headroom Bits the first section scales down by (0: none)
+ */
+void biquad_cascade_process_q31(biquad_q31_t *filters, uint8_t count,
+                                int32_t *buf_L, int32_t *buf_R, uint32_t len,
+                                unsigned headroom);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,6 +4,11 @@
 #include "dsp_types.h"
 #include "dsp_biquad.h"
 #include "dsp_presets.h"
+#include "dsp_conv.h"
+#include "dsp_limiter.h"
+#include "dsp_loudness.h"
+#include "dsp_volume.h"
+#include "dsp_prof.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,18 +24,153 @@ extern "C" {
 typedef enum {
     DSP_LIMITER_HARD_CLIP = 0,   ///< Clamp at ±1.0 — transparent, no compression (default)
     DSP_LIMITER_SOFT,            ///< Padé tanh compression above threshold — smooth but compresses dynamics
+    DSP_LIMITER_LOOKAHEAD,       ///< Look-ahead gain riding to -0.3 dBFS (sample peak), adds ~1.5 ms latency
+    DSP_LIMITER_TRUE_PEAK,       ///< Look-ahead with 4x true-peak detection to -1 dBTP
+    DSP_LIMITER_MODE_COUNT
 } dsp_limiter_mode_t;
 
+/**
+ * @brief Biquad kernel selection
+ *
+ * The float DFII-T kernel is the cheap default. Sections whose poles sit
+ * close to the unit circle (bass EQ at 88.2k+, high-Q low bands) lose
+ * 40-100 dB of SNR to float rounding; those run on the Q31 kernel
+ * (int32 samples, 64-bit accumulator, error feedback) instead.
+ */
+typedef enum {
+    DSP_KERNEL_AUTO = 0,         ///< Q31 for sensitive sections while the budget allows (default)
+    DSP_KERNEL_FLOAT,            ///< Every section on the float kernel
+    DSP_KERNEL_FIXED,            ///< Every section that fits Q3.28 on the Q31 kernel
+    DSP_KERNEL_MODE_COUNT
+} dsp_kernel_mode_t;
+
+/**
+ * @brief Pole margin below which AUTO prefers the Q31 kernel
+ *
+ * 1 − |pole| < 1/64: from there down the float kernel's SNR falls below
+ * ~100 dB (e.g. 200 Hz peak at 96 kHz: 82 dB float, 142 dB Q31).
+ */
+#define DSP_Q31_POLE_MARGIN (1.0f / 64.0f)
+
+/**
+ * @brief Headroom of the Q31 path in bits
+ *
+ * The first Q31 section scales its output down by this much, so boosts
+ * up to +24 dB pass the cascade unclipped (like float, which clips only
+ * at the output). It takes the full input word (the shift is applied to
+ * its 64-bit products), so 32-bit sources lose nothing on the way in.
+ */
+#define DSP_Q31_HEADROOM 4
+
+/**
+ * @brief Processing quality under CPU load
+ *
+ * The chain measures its own cost per block against the block deadline
+ * and steps down one level at a time when it runs late (SD bursts, WiFi
+ * interrupts on the audio core), then back up once the measured load
+ * leaves room for the level above. Levels are cumulative; every step is
+ * a regular coefficient publish, so it ramps like a preset change.
+ */
+typedef enum {
+    DSP_QUALITY_FULL = 0,        ///< As configured
+    DSP_QUALITY_FLOAT,           ///< Q31 sections moved to the cheaper float kernel
+    DSP_QUALITY_MERGED,          ///< + low-impact sections folded into pass-through
+    DSP_QUALITY_MINIMAL,         ///< + crossfeed off
+    DSP_QUALITY_COUNT
+} dsp_quality_t;
+
+/**
+ * @brief Peak/shelf sections under this gain (dB) count as low-impact
+ */
+#define DSP_QUALITY_MERGE_DB 1.5f
+
+/**
+ * @brief Restore a level once its predicted load stays below this
+ *        fraction of the block deadline for DSP_QUALITY_HOLD_MS
+ *
+ * Degrading happens as soon as the average load passes DSP_SAFETY_MARGIN
+ * or a single block overruns its deadline; the gap between the two
+ * thresholds plus the hold time keeps the level from flapping.
+ */
+#define DSP_QUALITY_RESTORE  0.60f
+#define DSP_QUALITY_HOLD_MS  2000
+
+/**
+ * @brief Stages timed by dsp_chain_process()
+ *
+ * The biquad cascade fuses sections in pairs, so sections are timed
+ * together; divide by the live section count for a per-section figure.
+ */
+typedef enum {
+    DSP_STAGE_DEINTERLEAVE = 0,  ///< int32 stereo → float (or int32 with headroom) mono
+    DSP_STAGE_Q31,               ///< Q31 cascade (+ conversion to float when needed)
+    DSP_STAGE_LOUDNESS,          ///< Loudness shelves (Q31)
+    DSP_STAGE_BIQUAD,            ///< Float DFII-T cascade
+    DSP_STAGE_CROSSFEED,         ///< Crossfeed
+    DSP_STAGE_FIR,               ///< FIR convolution
+    DSP_STAGE_LIMITER,           ///< Look-ahead limiter
+    DSP_STAGE_INTERLEAVE,        ///< Clip / soft limit + volume + requantise → int32 stereo
+    DSP_STAGE_TOTAL,             ///< Whole dsp_chain_process() call, per block
+    DSP_STAGE_COUNT
+} dsp_stage_t;
+
+/**
+ * @brief Records needed before the budget reports measured figures
+ */
+#define DSP_PROF_MIN_RECORDS 64
+
 /**
  * @brief Maximum number of biquad filters in chain (hardware limit)
+ *
+ * The UI limit: the cost model fits 30 sections up to 192 kHz (checked
+ * in dsp_chain.c). At 352.8 / 384 kHz the budget check allows fewer, see
+ * dsp_chain_get_max_filters_for_rate().
  */
-#define DSP_MAX_BIQUADS 10
+#define DSP_MAX_BIQUADS 30
 
 /**
  * @brief Maximum filters configurable by user (UI limit)
  */
 #define DSP_MAX_USER_FILTERS 30
 
+/**
+ * @brief Frames processed per internal pass of dsp_chain_process()
+ *
+ * Callers may hand the chain any block size (USB: ≤392, SD: 1024,
+ * NET: 1152); longer blocks are streamed through in chunks of this size
+ * using the per-chain scratch buffers. Filter state carries across chunk
+ * boundaries, so output does not depend on how the input is split.
+ */
+#define DSP_CHUNK_FRAMES 256
+
+/**
+ * @brief Coefficient ramp applied when a new coefficient set is adopted
+ *
+ * Coefficients are linearly interpolated from the running set to the
+ * new one in steps of DSP_RAMP_STEP frames. The (a1, a2) stability
+ * region of a biquad is convex, so every intermediate filter is stable.
+ */
+#define DSP_RAMP_FRAMES 512
+#define DSP_RAMP_STEP    32
+
+/**
+ * @brief Slew of the loudness compensation, dB of listening level per second
+ *
+ * The shelves follow the listening level at block boundaries at most this
+ * fast: a 1 dB volume step lands in ~25 ms, in chunk-sized steps of a
+ * fraction of a dB.
+ */
+#define DSP_LOUDNESS_SLEW_DB 40.0f
+
+/**
+ * @brief Sample rates with precomputed coefficients
+ *
+ * 44.1k, 48k, 88.2k, 96k, 176.4k, 192k, 352.8k, 384k. Format changes to
+ * any of these only select a table row; other rates fall back to
+ * computing coefficients on the calling (control) task.
+ */
+#define DSP_NUM_RATES 8
+
 /**
  * @brief CPU safety margin (use only 85% of budget, reserve 15% headroom)
  */
@@ -38,16 +178,35 @@ typedef enum {
 
 /**
  * @brief CPU budget information
+ *
+ * cycles_used and cpu_usage_percent are measured (p99 of the whole
+ * chain at this rate) once DSP_PROF_MIN_RECORDS blocks have run at the
+ * current rate, the model estimate before that.
  */
 typedef struct {
     uint32_t cpu_freq_mhz;          ///< CPU frequency in MHz
     uint32_t sample_rate;           ///< Current sample rate
     uint16_t cycles_per_sample;     ///< Available cycles per sample
-    uint16_t cycles_used;           ///< Cycles currently used
+    uint16_t cycles_used;           ///< Cycles currently used (measured p99 or model)
     uint16_t cycles_available;      ///< Cycles available (with safety margin)
     uint8_t  filters_active;        ///< Number of active filters
     uint8_t  filters_max;           ///< Max filters allowed at current sample rate
     float    cpu_usage_percent;     ///< CPU usage percentage
+    uint16_t conv_cycles;           ///< FIR convolution cost (0 = none / inactive)
+    uint32_t conv_taps;             ///< Loaded FIR length per channel (0 = none)
+    uint16_t limiter_cycles;        ///< Look-ahead limiter cost (0 = hard / soft, in base overhead)
+    uint16_t loudness_cycles;       ///< Loudness shelves cost (0 = off)
+    uint16_t volume_cycles;         ///< Output gain + requantisation cost
+    uint8_t  filters_fixed;         ///< Active filters on the Q31 kernel
+    uint8_t  filters_merged;        ///< Configured filters folded away by the quality level
+    dsp_quality_t quality;          ///< Current quality level
+    float    load_percent;          ///< Measured cost, % of the block deadline (average)
+    bool     measured;              ///< cycles_used / cpu_usage_percent come from measurement
+    uint16_t cycles_model;          ///< Model estimate (constants), always filled
+    uint16_t cycles_p50;            ///< Measured median (0 = no data)
+    uint16_t cycles_max;            ///< Measured worst block (0 = no data)
+    uint8_t  os_factor;             ///< Output oversampling after the chain (1 = none)
+    uint16_t os_cycles;             ///< Its cost, reserved out of cycles_available
 } dsp_budget_t;
 
 /**
@@ -63,17 +222,85 @@ typedef struct {
     float feed;       ///< Cross-feed gain (-4.5dB = 0.5957)
 } crossfeed_state_t;
 
+/**
+ * @brief Coefficient set published by control tasks, consumed by the audio task
+ */
+typedef struct {
+    float   coef[DSP_MAX_BIQUADS][5];   ///< {b0, b1, b2, a1, a2} per float section
+    uint8_t num_biquads;                ///< Float sections in this set
+    int32_t coef_q[DSP_MAX_BIQUADS][5]; ///< Q3.28 coefficients per Q31 section
+    uint8_t num_fixed;                  ///< Q31 sections in this set (run first)
+    bool    crossfeed_enabled;          ///< Crossfeed on/off (feed ramps)
+    bool    loudness_enabled;           ///< Loudness on/off (slews with the level)
+    const int32_t (*loud_row)[DSP_LOUDNESS_SECTIONS][5]; ///< Loudness table for this rate (NULL = none)
+    dsp_dither_t dither;                ///< Requantisation dither
+    uint8_t out_bits;                   ///< Output word length (16 or 32)
+    float   cf_coef[5];                 ///< Crossfeed lowpass for this rate
+    dsp_conv_t *conv;                   ///< FIR convolver (NULL = off / rate mismatch)
+    dsp_limiter_mode_t limiter_mode;    ///< Output stage
+    dsp_limiter_config_t limiter;       ///< Look-ahead settings for this rate
+    bool    reset;                      ///< Format change: clear state, no ramp
+    dsp_quality_t quality;              ///< Quality level this set was built for
+    uint16_t model_cycles;              ///< Budget-model cost per sample of this set
+    uint16_t cycles_per_frame;          ///< Block deadline per frame at this rate
+    uint32_t restore_load;              ///< Q16 load under which the level above fits (0 = none)
+    uint32_t restore_frames;            ///< Frames below restore_load before asking for it
+    uint8_t  rate_row;                  ///< Profile row for this rate (DSP_NUM_RATES = unlisted)
+    uint32_t sample_rate;               ///< Rate this set was built for
+} dsp_coef_set_t;
+
 /**
  * @brief DSP chain state
  */
 typedef struct {
-    // Biquad filters
-    biquad_filter_t biquads[DSP_MAX_BIQUADS];
+    //----------------------------------------------------------------
+    // Control side — written by the setters, never read by the audio task.
+    // The setters run on several tasks: callers serialize them (the
+    // audio_pipeline lock), the chain itself does no locking.
+    //----------------------------------------------------------------
+
+    // Configured filters (rate-independent) and their per-rate coefficients
+    // (float and Q3.28). The extra row holds the current rate when it is
+    // not one of the DSP_NUM_RATES.
+    biquad_params_t filter_params[DSP_MAX_BIQUADS];
+    float rate_coefs[DSP_NUM_RATES + 1][DSP_MAX_BIQUADS][5];
+    int32_t rate_coefs_q[DSP_NUM_RATES + 1][DSP_MAX_BIQUADS][5];
+    uint32_t rate_q_ok[DSP_NUM_RATES + 1];  ///< Bit i: section i fits Q3.28 at that rate
     uint8_t num_biquads;
 
+    // Kernel policy, the sections it picks for Q31 at the current rate
+    // and the ones actually on Q31 at the current quality level
+    dsp_kernel_mode_t kernel_mode;
+    uint32_t kernel_mask;
+    uint32_t fixed_mask;
+
+    // Load-adaptive quality: applied level and low-impact sections
+    bool quality_adaptive;
+    dsp_quality_t quality;
+    uint32_t low_mask;              ///< Bit i: section i is dropped from DSP_QUALITY_MERGED on
+
     // Crossfeed (optional, for headphones)
     bool crossfeed_enabled;
-    crossfeed_state_t crossfeed;
+
+    // Loudness compensation and its table for an unlisted rate, one per
+    // coef_sets slot: publish only rebuilds the row of coef_back, which
+    // no set the audio task holds points to.
+    bool loudness_enabled;
+    dsp_loudness_row_t loud_unlisted[3];
+    uint32_t loud_unlisted_rate[3];     ///< Rate each row was built for (0 = none)
+
+    // Requantisation dither of the output stage
+    dsp_dither_t dither;
+
+    // Oversampler after the chain (runs in the producer, same core): its
+    // cost per sample at the chain rate is reserved out of the budget
+    uint8_t  os_factor;
+    uint16_t os_cycles;
+
+    // FIR convolver (owned) and replaced ones awaiting release
+    #define DSP_CONV_RETIRED_MAX 4
+    dsp_conv_t *conv;
+    dsp_conv_t *conv_retired[DSP_CONV_RETIRED_MAX];
 
     // User-defined parametric EQ bands (for PRESET_USER)
     #define DSP_MAX_USER_BANDS 5
@@ -92,8 +319,69 @@ typedef struct {
     // Limiter mode
     dsp_limiter_mode_t limiter_mode;
 
-    // Statistics
+    //----------------------------------------------------------------
+    // Publish/consume — lock-free triple buffer
+    //
+    // Control fills coef_sets[coef_back] and swaps it into coef_mid with
+    // the FRESH bit set. The audio task swaps coef_front with coef_mid at
+    // block boundaries when FRESH is seen. The audio task never blocks;
+    // on the control side there must be one publisher at a time.
+    //----------------------------------------------------------------
+    dsp_coef_set_t coef_sets[3];
+    uint8_t  coef_back;             ///< Slot owned by control
+    uint32_t coef_mid;              ///< Shared slot index | DSP_COEF_FRESH
+    uint8_t  coef_front;            ///< Slot owned by audio
+
+    // Listening level, 1/256 dB (≤ 0): written by control at any time,
+    // followed by the audio task without a publish
+    int32_t  listen_q8;
+
+    // Output volume (Q1.31 gain) and mute: same, the audio task ramps to
+    // them over DSP_VOLUME_RAMP_MS
+    uint32_t volume_gain;
+    uint32_t muted;
+
+    //----------------------------------------------------------------
+    // Audio side — running filters, only touched by dsp_chain_process()
+    //----------------------------------------------------------------
+    biquad_filter_t biquads[DSP_MAX_BIQUADS];
+    uint8_t live_biquads;           ///< Sections currently run (max of old/new while ramping)
+    biquad_q31_t biquads_q[DSP_MAX_BIQUADS];
+    uint8_t live_fixed;             ///< Q31 sections currently run, ahead of the float ones
+    crossfeed_state_t crossfeed;    ///< feed == 0 → crossfeed skipped
+    biquad_q31_t loudness[DSP_LOUDNESS_SECTIONS]; ///< Loudness shelves, after the Q31 sections
+    uint32_t loud_q8;               ///< Attenuation they are set for, 1/256 dB (0 → skipped)
+    uint16_t loud_phase;            ///< Frames into the current slew step (DSP_CHUNK_FRAMES grid)
+    dsp_volume_t volume;            ///< Output gain + requantiser, fused into the reinterleave
+    dsp_conv_t *conv_live;          ///< Convolver in use (read by control to free safely)
+    dsp_limiter_mode_t limiter_live; ///< Output stage in use
+    dsp_limiter_t limiter;          ///< Look-ahead limiter (LOOKAHEAD / TRUE_PEAK)
+
+    // Ramp from the previous set to coef_sets[coef_front]
+    float    ramp_from[DSP_MAX_BIQUADS][5];
+    int32_t  ramp_from_q[DSP_MAX_BIQUADS][5];
+    float    ramp_feed_from;
+    uint16_t ramp_pos;              ///< Frames into ramp, DSP_RAMP_FRAMES = done
+
+    // Measured cost per block (read by control) and the level it asks for
     dsp_stats_t stats;
+    uint32_t load_avg;              ///< Q16 fraction of the block deadline, EWMA over 8 blocks
+    uint32_t calm_frames;           ///< Frames in a row below the front set's restore_load
+    dsp_quality_t quality_live;     ///< Level of the front set
+    uint16_t model_live;            ///< model_cycles of the front set
+    uint32_t quality_want;          ///< Level requested from control (dsp_quality_t)
+
+    // Per-stage cycle histograms per rate (last row: the unlisted rate
+    // in prof_unlisted_rate). Written here, read by control.
+    dsp_prof_hist_t prof[DSP_NUM_RATES + 1][DSP_STAGE_COUNT];
+    uint32_t prof_unlisted_rate;
+    uint32_t prof_reset;            ///< Set by control, histograms cleared at the next block
+
+    // Deinterleave scratch (mono, contiguous) — one chunk per pass
+    float scratch_L[DSP_CHUNK_FRAMES] __attribute__((aligned(16)));
+    float scratch_R[DSP_CHUNK_FRAMES] __attribute__((aligned(16)));
+    int32_t scratch_qL[DSP_CHUNK_FRAMES] __attribute__((aligned(16)));
+    int32_t scratch_qR[DSP_CHUNK_FRAMES] __attribute__((aligned(16)));
 } dsp_chain_t;
 
 //--------------------------------------------------------------------+
@@ -111,6 +399,10 @@ void dsp_chain_init(dsp_chain_t *chain, const audio_format_t *format);
 /**
  * @brief Load EQ preset into DSP chain
  *
+ * Computes coefficients for every supported rate on the calling task and
+ * publishes the set; the audio task ramps to it at its next block
+ * boundary with filter state preserved (no click, no torn reads).
+ *
  * @param chain Pointer to DSP chain
  * @param preset Preset to load
  * @return true if successful, false if preset invalid
@@ -121,7 +413,13 @@ bool dsp_chain_load_preset(dsp_chain_t *chain, eq_preset_t preset);
  * @brief Process audio buffer through DSP chain
  *
  * Converts int32 I2S data to float, processes through DSP chain,
- * converts back to int32 for I2S output.
+ * converts back to int32 for I2S output. Q31 sections run first on the
+ * int32 samples; when nothing else is active the float conversion is
+ * skipped altogether. The output volume and the requantisation to the
+ * output word (format.bits_per_sample) are part of the reinterleave;
+ * with every stage idle they run in place, and not at all at unity
+ * gain. Any frame count is accepted; blocks longer than
+ * DSP_CHUNK_FRAMES are processed in several passes.
  *
  * @param chain Pointer to DSP chain
  * @param buffer_i32 Input/output buffer (int32, interleaved stereo)
@@ -132,7 +430,8 @@ void dsp_chain_process(dsp_chain_t *chain, int32_t *buffer_i32, uint32_t frames)
 /**
  * @brief Enable/disable bypass mode
  *
- * In bypass mode, audio passes through unprocessed
+ * In bypass mode, audio passes through unprocessed (only the output
+ * volume still applies)
  *
  * @param chain Pointer to DSP chain
  * @param bypass true to bypass, false to enable processing
@@ -142,7 +441,8 @@ void dsp_chain_set_bypass(dsp_chain_t *chain, bool bypass);
 /**
  * @brief Update audio format (e.g., sample rate change)
  *
- * Recalculates all filter coefficients for new sample rate
+ * Selects the precomputed coefficients for the new rate (no trig unless
+ * the rate is not one of the DSP_NUM_RATES) and clears filter state.
  *
  * @param chain Pointer to DSP chain
  * @param format New audio format
@@ -152,6 +452,8 @@ void dsp_chain_update_format(dsp_chain_t *chain, const audio_format_t *format);
 /**
  * @brief Reset DSP chain state (clear all filter histories)
  *
+ * Takes effect at the audio task's next block boundary.
+ *
  * @param chain Pointer to DSP chain
  */
 void dsp_chain_reset(dsp_chain_t *chain);
@@ -159,11 +461,38 @@ void dsp_chain_reset(dsp_chain_t *chain);
 /**
  * @brief Get DSP processing statistics
  *
+ * Measured on the audio task: cycles of the last block against its
+ * deadline, average load in cpu_usage_percent, and in buffer_underruns
+ * the blocks whose DSP alone took longer than the block lasts.
+ *
  * @param chain Pointer to DSP chain
  * @return Pointer to statistics structure
  */
 const dsp_stats_t *dsp_chain_get_stats(const dsp_chain_t *chain);
 
+/**
+ * @brief Measured cost of one stage at a sample rate
+ *
+ * @param chain Pointer to DSP chain
+ * @param sample_rate Rate to report (one of the DSP_NUM_RATES, or the
+ *                    current unlisted rate)
+ * @param stage Stage
+ * @param out Output: p50 / p99 / max in cycles per sample (count 0 = no data)
+ * @return false if the rate has no profile row
+ */
+bool dsp_chain_get_stage_stats(const dsp_chain_t *chain, uint32_t sample_rate,
+                               dsp_stage_t stage, dsp_prof_stats_t *out);
+
+/**
+ * @brief Clear all cycle histograms (applied at the next block)
+ */
+void dsp_chain_reset_profile(dsp_chain_t *chain);
+
+/**
+ * @brief Short name of a stage ("deint", "q31", "biquad", ...)
+ */
+const char *dsp_chain_stage_name(dsp_stage_t stage);
+
 /**
  * @brief Get current preset
  *
@@ -175,8 +504,12 @@ eq_preset_t dsp_chain_get_preset(const dsp_chain_t *chain);
 /**
  * @brief Set limiter mode
  *
+ * Published like coefficients: the audio task switches at its next
+ * block boundary. The look-ahead modes keep the chain running even with
+ * no filters (constant latency across presets).
+ *
  * @param chain Pointer to DSP chain
- * @param mode DSP_LIMITER_HARD_CLIP (default) or DSP_LIMITER_SOFT
+ * @param mode DSP_LIMITER_HARD_CLIP (default), SOFT, LOOKAHEAD or TRUE_PEAK
  */
 void dsp_chain_set_limiter_mode(dsp_chain_t *chain, dsp_limiter_mode_t mode);
 
@@ -188,6 +521,67 @@ void dsp_chain_set_limiter_mode(dsp_chain_t *chain, dsp_limiter_mode_t mode);
  */
 dsp_limiter_mode_t dsp_chain_get_limiter_mode(const dsp_chain_t *chain);
 
+/**
+ * @brief Short name of a limiter mode ("hard", "soft", "lookahead", "truepeak")
+ */
+const char *dsp_chain_limiter_name(dsp_limiter_mode_t mode);
+
+/**
+ * @brief Set the biquad kernel policy
+ *
+ * Re-evaluated whenever coefficients are published (preset, rate,
+ * limiter, FIR changes). Sections switching kernel ramp like any other
+ * coefficient change.
+ *
+ * @param chain Pointer to DSP chain
+ * @param mode DSP_KERNEL_AUTO (default), FLOAT or FIXED
+ */
+void dsp_chain_set_kernel_mode(dsp_chain_t *chain, dsp_kernel_mode_t mode);
+
+/**
+ * @brief Get the biquad kernel policy
+ */
+dsp_kernel_mode_t dsp_chain_get_kernel_mode(const dsp_chain_t *chain);
+
+/**
+ * @brief Short name of a kernel policy ("auto", "float", "fixed")
+ */
+const char *dsp_chain_kernel_name(dsp_kernel_mode_t mode);
+
+/**
+ * @brief Apply the quality level requested by the audio task, if any
+ *
+ * Call periodically from a control task, serialized with the other
+ * setters like any of them (audio_pipeline_update_quality() takes the
+ * pipeline lock). Cheap when nothing changed.
+ *
+ * @param chain Pointer to DSP chain
+ * @return true if the level changed
+ */
+bool dsp_chain_update_quality(dsp_chain_t *chain);
+
+/**
+ * @brief Enable/disable load-adaptive quality (enabled by default)
+ *
+ * Disabled, the chain stays at DSP_QUALITY_FULL whatever the load.
+ */
+void dsp_chain_set_quality_adaptive(dsp_chain_t *chain, bool enabled);
+
+/**
+ * @brief Whether load-adaptive quality is enabled
+ */
+bool dsp_chain_get_quality_adaptive(const dsp_chain_t *chain);
+
+/**
+ * @brief Current quality level
+ */
+dsp_quality_t dsp_chain_get_quality(const dsp_chain_t *chain);
+
+/**
+ * @brief Short name of a quality level ("full", "float", "merged", "minimal")
+ */
+const char *dsp_chain_quality_name(dsp_quality_t quality);
+
 /**
  * @brief Enable/disable crossfeed
  *
@@ -204,6 +598,94 @@ void dsp_chain_set_crossfeed(dsp_chain_t *chain, bool enabled);
  */
 bool dsp_chain_get_crossfeed(const dsp_chain_t *chain);
 
+/**
+ * @brief Enable/disable loudness compensation
+ *
+ * Two Q31 shelves that restore the ISO 226 balance at the listening
+ * level (see dsp_loudness.h). Not degraded by the quality levels. Off,
+ * or at 0 dB, the sections are skipped.
+ *
+ * @param chain Pointer to DSP chain
+ * @param enabled true to enable, false to disable
+ */
+void dsp_chain_set_loudness(dsp_chain_t *chain, bool enabled);
+
+/**
+ * @brief Get loudness compensation state
+ */
+bool dsp_chain_get_loudness(const dsp_chain_t *chain);
+
+/**
+ * @brief Set the listening level the loudness compensation follows
+ *
+ * Cheap and safe to call at any rate (e.g. on every host volume
+ * request): a single store, the audio task slews the shelves towards the
+ * new level (DSP_LOUDNESS_SLEW_DB) by interpolating precomputed tables.
+ *
+ * @param chain Pointer to DSP chain
+ * @param volume_db Volume relative to full scale, dB (≤ 0; 0 = reference level)
+ */
+void dsp_chain_set_listening_level(dsp_chain_t *chain, float volume_db);
+
+/**
+ * @brief Get the listening level, dB
+ */
+float dsp_chain_get_listening_level(const dsp_chain_t *chain);
+
+/**
+ * @brief Set the output volume
+ *
+ * 64-bit gain at the very end of the chain, ramped over
+ * DSP_VOLUME_RAMP_MS and fused with the requantisation to the output
+ * word. Applied in bypass too. Cheap and safe to call at any rate: a
+ * single store.
+ *
+ * @param chain Pointer to DSP chain
+ * @param volume_db Volume, dB (≤ 0; below DSP_VOLUME_MIN_DB = silence)
+ */
+void dsp_chain_set_volume(dsp_chain_t *chain, float volume_db);
+
+/**
+ * @brief Get the output volume, dB
+ */
+float dsp_chain_get_volume(const dsp_chain_t *chain);
+
+/**
+ * @brief Mute/unmute the output (ramped like a volume change)
+ */
+void dsp_chain_set_mute(dsp_chain_t *chain, bool muted);
+
+/**
+ * @brief Get mute state
+ */
+bool dsp_chain_get_mute(const dsp_chain_t *chain);
+
+/**
+ * @brief Set the dither used when the output word is shorter than 32 bits
+ *
+ * @param chain Pointer to DSP chain
+ * @param dither DSP_DITHER_TPDF (default), DSP_DITHER_SHAPED or DSP_DITHER_OFF
+ */
+void dsp_chain_set_dither(dsp_chain_t *chain, dsp_dither_t dither);
+
+/**
+ * @brief Get the requantisation dither
+ */
+dsp_dither_t dsp_chain_get_dither(const dsp_chain_t *chain);
+
+/**
+ * @brief Declare the output oversampler that follows the chain
+ *
+ * The chain itself runs at format.sample_rate either way; this only
+ * reserves the oversampler's cost out of the budget (planning limits
+ * and the block deadline the adaptive quality measures against).
+ *
+ * @param chain Pointer to DSP chain
+ * @param factor Oversampling factor (1 = none)
+ * @param cycles Its cost per sample per channel at the chain rate
+ */
+void dsp_chain_set_oversampling(dsp_chain_t *chain, uint8_t factor, uint16_t cycles);
+
 /**
  * @brief Set a user-defined EQ band
  *
@@ -233,7 +715,10 @@ const biquad_params_t *dsp_chain_get_user_band(const dsp_chain_t *chain, uint8_t
  * @brief Calculate CPU budget for current audio format
  *
  * Determines how many cycles are available per sample and how many
- * filters can be safely enabled at the current sample rate.
+ * filters can be safely enabled at the current sample rate. Usage is
+ * the measured figure when there is one (see dsp_budget_t); the limits
+ * (filters_max, the checks below) stay on the model so that they do not
+ * move with the load.
  *
  * @param chain Pointer to DSP chain
  * @param budget Output: budget information structure
@@ -244,7 +729,9 @@ void dsp_chain_get_budget(const dsp_chain_t *chain, dsp_budget_t *budget);
  * @brief Check if adding N filters would exceed budget
  *
  * Validates if the current configuration plus N additional filters
- * would stay within the safe CPU budget.
+ * would stay within the safe CPU budget. With adaptive quality on, the
+ * check is against the lowest quality level: anything the chain can
+ * degrade into is accepted.
  *
  * @param chain Pointer to DSP chain
  * @param additional_filters Number of filters to add
@@ -268,6 +755,8 @@ uint8_t dsp_chain_get_max_filters_for_rate(uint32_t sample_rate);
  *
  * Checks if loading a preset would exceed the CPU budget at the
  * current sample rate. Useful for UI validation before switching.
+ * With adaptive quality on, only the preset's lowest quality level has
+ * to fit.
  *
  * @param chain Pointer to DSP chain
  * @param preset Preset to validate
@@ -275,6 +764,38 @@ uint8_t dsp_chain_get_max_filters_for_rate(uint32_t sample_rate);
  */
 bool dsp_chain_validate_preset(const dsp_chain_t *chain, eq_preset_t preset);
 
+//--------------------------------------------------------------------+
+// FIR Convolution
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Install a FIR convolver (takes ownership; NULL removes it)
+ *
+ * The convolver runs after the biquads and crossfeed, only while the
+ * stream rate matches the rate of its impulse response and its cost fits
+ * the budget. The previous convolver is freed once the audio task has
+ * stopped using it.
+ *
+ * @return false if too many replaced convolvers are still in use
+ */
+bool dsp_chain_set_convolver(dsp_chain_t *chain, dsp_conv_t *conv);
+
+/**
+ * @brief Current convolver (NULL if none)
+ */
+const dsp_conv_t *dsp_chain_get_convolver(const dsp_chain_t *chain);
+
+/**
+ * @brief Longest FIR that fits the current budget for a partition size
+ *
+ * Accounts for the active biquads and crossfeed.
+ *
+ * @param chain Pointer to DSP chain
+ * @param block Partition size
+ * @return Taps per channel (0 if none fit)
+ */
+uint32_t dsp_chain_get_max_fir_taps(const dsp_chain_t *chain, uint16_t block);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,101 @@
+#ifndef DSP_CONV_H
+#define DSP_CONV_H
+
+#include "dsp_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Partitioned FFT Convolution (uniformly partitioned overlap-save)
+//--------------------------------------------------------------------+
+//
+// Long FIR filters (headphone / room correction) split into P partitions
+// of B taps. Each block of B frames costs one 2B-point complex FFT, one
+// inverse FFT and P spectral multiply-accumulates per channel. L and R
+// share the FFTs (packed as re/im) while keeping separate impulse
+// responses. Latency is B frames.
+//
+// Partition spectra and the frequency-domain delay line live in PSRAM;
+// the FFT work buffer stays in internal RAM.
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Longest impulse response accepted (taps per channel)
+ */
+#define DSP_CONV_MAX_TAPS 16384
+
+/**
+ * @brief Partition sizes (frames per block, = latency)
+ */
+#define DSP_CONV_BLOCK_MIN      64
+#define DSP_CONV_BLOCK_MAX    1024
+#define DSP_CONV_BLOCK_DEFAULT 256
+
+/**
+ * @brief Opaque convolver
+ */
+typedef struct dsp_conv_s dsp_conv_t;
+
+/**
+ * @brief Create a convolver from float impulse responses
+ *
+ * Runs on a control task (allocates, runs FFTs of every partition).
+ *
+ * @param ir_L        Left impulse response
+ * @param ir_R        Right impulse response (may equal ir_L)
+ * @param taps        Length of each response (≤ DSP_CONV_MAX_TAPS)
+ * @param block       Partition size, power of two in [MIN, MAX]
+ * @param sample_rate Rate the responses were designed for
+ * @return Convolver or NULL on invalid arguments / out of memory
+ */
+dsp_conv_t *dsp_conv_create(const float *ir_L, const float *ir_R, uint32_t taps,
+                            uint16_t block, uint32_t sample_rate);
+
+/**
+ * @brief Load impulse responses from an audio file (WAV, FLAC, ...)
+ *
+ * Stereo files give separate L/R responses; mono files are applied to
+ * both channels. Uses the audio_codecs decoders.
+ *
+ * @param path  Full path (e.g. "/sdcard/fir/hd650.wav")
+ * @param block Partition size
+ * @return Convolver or NULL
+ */
+dsp_conv_t *dsp_conv_load_file(const char *path, uint16_t block);
+
+/**
+ * @brief Free a convolver (must no longer be referenced by the audio task)
+ */
+void dsp_conv_destroy(dsp_conv_t *conv);
+
+/**
+ * @brief Convolve L/R in place (audio task)
+ *
+ * Any frame count; output is delayed by the block size.
+ */
+void dsp_conv_process(dsp_conv_t *conv, float *buf_L, float *buf_R, uint32_t frames);
+
+/**
+ * @brief Clear delay line and staging buffers
+ */
+void dsp_conv_reset(dsp_conv_t *conv);
+
+uint32_t dsp_conv_get_taps(const dsp_conv_t *conv);
+uint16_t dsp_conv_get_block(const dsp_conv_t *conv);
+uint32_t dsp_conv_get_sample_rate(const dsp_conv_t *conv);
+
+/**
+ * @brief Estimated cost in cycles per sample (per channel, budget units)
+ *
+ * Model: two 2B-point FFTs + split/combine + P complex MACs per bin,
+ * amortised over B frames × 2 channels. Verify with `dsp bench conv`.
+ */
+uint16_t dsp_conv_cycles_per_sample(uint16_t block, uint32_t taps);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_CONV_H */
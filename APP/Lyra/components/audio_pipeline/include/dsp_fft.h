@@ -0,0 +1,62 @@
+#ifndef DSP_FFT_H
+#define DSP_FFT_H
+
+#include "dsp_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Radix-2 complex FFT
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Largest supported FFT size (points)
+ */
+#define DSP_FFT_MAX_SIZE 4096
+
+/**
+ * @brief FFT plan — per-size twiddle and bit-reversal tables
+ *
+ * Each plan owns its tables, so several sizes can be live at once
+ * (convolution partitions, spectrum analyser) without sharing a global
+ * table the way esp-dsp's dsps_fft2r_init_fc32() does.
+ */
+typedef struct {
+    uint16_t  n;            ///< Points (power of two)
+    uint8_t   log2n;        ///< log2(n)
+    float    *twiddle;      ///< n/2 complex: cos, -sin of 2πk/n
+    uint16_t *bitrev;       ///< n bit-reversed indices
+} dsp_fft_plan_t;
+
+/**
+ * @brief Build tables for an n-point FFT (n = 2^k, 4 ≤ n ≤ DSP_FFT_MAX_SIZE)
+ *
+ * Allocates from internal RAM. Call from a control task, never from
+ * the audio task.
+ *
+ * @return true on success
+ */
+bool dsp_fft_plan_init(dsp_fft_plan_t *plan, uint16_t n);
+
+/**
+ * @brief Release plan tables
+ */
+void dsp_fft_plan_free(dsp_fft_plan_t *plan);
+
+/**
+ * @brief In-place forward FFT, interleaved complex {re, im} × n
+ */
+void dsp_fft_forward(const dsp_fft_plan_t *plan, float *data);
+
+/**
+ * @brief In-place inverse FFT (unscaled — result is n × the true inverse)
+ */
+void dsp_fft_inverse(const dsp_fft_plan_t *plan, float *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_FFT_H */
@@ -0,0 +1,158 @@
+#ifndef DSP_LIMITER_H
+#define DSP_LIMITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Look-ahead Peak Limiter
+//--------------------------------------------------------------------+
+//
+// Stereo-linked brickwall limiter for the DSP output stage. The signal
+// runs through a short delay line while the detector looks at what is
+// about to come out:
+//
+//   peak (sample or 4x true-peak) → gain needed to stay at the ceiling
+//   → sliding minimum over the look-ahead window (monotonic deque,
+//     O(1) amortised per frame)
+//   → release (one-pole, only when the gain rises)
+//   → moving average over the look-ahead window (attack ramp)
+//   → applied to the delayed samples
+//
+// The moving average turns every gain drop into a linear ramp lasting
+// the whole look-ahead. It only averages values at or below the hold
+// value, so the gain has reached its target when the peak leaves the
+// delay line: no clipping and no instantaneous waveshaping below the
+// ceiling.
+//
+// True-peak mode estimates inter-sample peaks with the 4x interpolator
+// of ITU-R BS.1770-4 (48 taps, 4 phases), so the reconstructed output
+// stays below the ceiling too, not only the samples. Like any BS.1770
+// meter it under-reads by up to ~0.2 dB on program material (more for
+// content right at Nyquist); the -1 dBTP ceiling leaves room for that.
+//
+// Latency: look-ahead − 1 frames (+6 with true-peak, the interpolator
+// centre).
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Look-ahead time and release constant
+ */
+#define DSP_LIMITER_LOOKAHEAD_MS  1.5f
+#define DSP_LIMITER_RELEASE_MS    100.0f
+
+/**
+ * @brief Output ceiling: -0.3 dBFS (sample peak), -1.0 dBTP (true-peak)
+ */
+#define DSP_LIMITER_CEILING       0.9661f
+#define DSP_LIMITER_CEILING_TP    0.8913f
+
+/**
+ * @brief Delay line / detector ring size (power of two)
+ *
+ * Holds the 1.5 ms look-ahead up to 384 kHz (576 frames + true-peak
+ * alignment).
+ */
+#define DSP_LIMITER_RING          1024
+
+/**
+ * @brief True-peak interpolator: taps per phase, phases
+ */
+#define DSP_LIMITER_TP_TAPS       12
+#define DSP_LIMITER_TP_PHASES     4
+
+/**
+ * @brief Per-rate settings, computed on the control task
+ */
+typedef struct {
+    uint16_t lookahead;     ///< Look-ahead in frames (attack ramp length)
+    float    release;       ///< One-pole release coefficient per frame
+} dsp_limiter_config_t;
+
+/**
+ * @brief Limiter state (audio task only)
+ */
+typedef struct {
+    // Settings in use
+    bool     true_peak;
+    uint16_t lookahead;     ///< Moving-average length B
+    uint16_t window;        ///< Sliding-minimum window W
+    uint16_t delay;         ///< Delay line length Δ
+    float    release;
+    float    ceiling;
+    float    inv_lookahead;
+
+    // Detector: monotonic deque of (gain, frame) — front is the window minimum
+    float    dq_gain[DSP_LIMITER_RING];
+    uint16_t dq_frame[DSP_LIMITER_RING];
+    uint16_t dq_head;
+    uint16_t dq_tail;
+    uint16_t frame;         ///< Frame counter (wraps, only ages are used)
+
+    // Envelope
+    float    env;           ///< Released gain
+    float    avg[DSP_LIMITER_RING];
+    float    avg_sum;
+    uint16_t avg_pos;
+
+    // Delay line, with the last TP_TAPS frames mirrored past the end so
+    // the true-peak FIR always reads a contiguous window
+    float    dl_L[DSP_LIMITER_RING + DSP_LIMITER_TP_TAPS];
+    float    dl_R[DSP_LIMITER_RING + DSP_LIMITER_TP_TAPS];
+    uint16_t dl_pos;
+} dsp_limiter_t;
+
+/**
+ * @brief Settings for a sample rate (control task, uses expf)
+ */
+void dsp_limiter_config(dsp_limiter_config_t *cfg, uint32_t sample_rate);
+
+/**
+ * @brief Clear state and adopt new settings (audio task, no libm)
+ *
+ * @param lim       Limiter
+ * @param cfg       Settings from dsp_limiter_config()
+ * @param true_peak Detect 4x-interpolated peaks instead of sample peaks
+ */
+void dsp_limiter_reset(dsp_limiter_t *lim, const dsp_limiter_config_t *cfg, bool true_peak);
+
+/**
+ * @brief Limit L/R in place (audio task)
+ *
+ * Any frame count; output is delayed by dsp_limiter_latency() frames.
+ * Output samples never exceed the ceiling.
+ */
+void dsp_limiter_process(dsp_limiter_t *lim, float *buf_L, float *buf_R, uint32_t frames);
+
+/**
+ * @brief Delay added to the signal, in frames
+ */
+uint16_t dsp_limiter_latency(const dsp_limiter_t *lim);
+
+/**
+ * @brief Estimated cost in cycles per sample (per channel, budget units)
+ *
+ * Verify with `dsp bench limiter`.
+ */
+uint16_t dsp_limiter_cycles_per_sample(bool true_peak);
+
+/**
+ * @brief Largest true-peak over a block (same interpolator, for meters)
+ *
+ * Reads x[0] .. x[n-1]; the first DSP_LIMITER_TP_TAPS − 1 samples only
+ * prime the interpolator, pass them again at the start of the next
+ * block to meter a continuous stream.
+ *
+ * @return Largest |y| of the 4x-interpolated points (linear, 1.0 = 0 dBTP)
+ */
+float dsp_limiter_true_peak(const float *x, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_LIMITER_H */
@@ -0,0 +1,121 @@
+#ifndef DSP_LOUDNESS_H
+#define DSP_LOUDNESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Loudness Compensation (ISO 226:2003)
+//--------------------------------------------------------------------+
+//
+// Turning the volume down lowers the bass (and the top octave) faster
+// than the midrange, because the ear's equal-loudness contours spread
+// apart at low levels. The compensation at a given volume is the
+// difference between the contour at the listening level and the contour
+// at the reference level (0 dB volume = DSP_LOUDNESS_REF_PHON), both
+// normalised at 1 kHz.
+//
+// That curve is fitted with a low shelf and a high shelf per 1 dB volume
+// step (least squares on the ISO 226 frequencies, 31.5 Hz – 1 kHz and
+// 5 – 12.5 kHz), and each step is designed into Q3.28 coefficients for
+// every sample rate when the chain is created. At run time the audio
+// task only interpolates two rows of the table: a volume change never
+// costs any trigonometry there.
+//
+// The boost is bounded by DSP_LOUDNESS_MAX_DB and never exceeds the
+// volume attenuation that goes with it (~half of it in the deep bass),
+// so a volume stage after the chain absorbs it.
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Listening level at 0 dB volume, phon
+ *
+ * Upper end of the range where ISO 226 is valid at every frequency.
+ */
+#define DSP_LOUDNESS_REF_PHON  80.0f
+
+/**
+ * @brief Volume steps in the table: 0 … −60 dB, 1 dB apart
+ *
+ * Same range and resolution as the USB feature-unit volume. Below
+ * −60 dB (20 phon, the bottom of ISO 226) the last step holds.
+ */
+#define DSP_LOUDNESS_STEPS     61
+
+/**
+ * @brief Sections per step: low shelf, high shelf
+ */
+#define DSP_LOUDNESS_SECTIONS  2
+
+/**
+ * @brief Largest boost of either shelf
+ *
+ * Keeps the Q31 sections inside their Q3.28 coefficient range and the
+ * DSP_Q31_HEADROOM.
+ */
+#define DSP_LOUDNESS_MAX_DB    18.0f
+
+/**
+ * @brief Shelf corners and Q (searched once against the contours, see above)
+ */
+#define DSP_LOUDNESS_BASS_HZ   180.0f
+#define DSP_LOUDNESS_BASS_Q    0.6f
+#define DSP_LOUDNESS_TREBLE_HZ 10000.0f
+#define DSP_LOUDNESS_TREBLE_Q  1.0f
+
+/**
+ * @brief Coefficients of every volume step at one sample rate
+ *
+ * {b0, b1, b2, a1, a2} in Q3.28 per section, as used by the Q31 kernel.
+ */
+typedef int32_t dsp_loudness_row_t[DSP_LOUDNESS_STEPS][DSP_LOUDNESS_SECTIONS][5];
+
+/**
+ * @brief Design every volume step for one sample rate
+ *
+ * Not real-time (trig per section); call from a control task. The first
+ * call also fits the shelf gains against ISO 226.
+ *
+ * @return false if a step did not fit Q3.28 (that step is left flat)
+ */
+bool dsp_loudness_build(dsp_loudness_row_t row, uint32_t sample_rate);
+
+/**
+ * @brief Coefficients for a volume, interpolated between two steps
+ *
+ * Integer only, audio-task safe. Adjacent steps differ by a fraction of
+ * a dB of shelf gain, so the interpolated section stays stable (convex
+ * (a1, a2) region, like the coefficient ramps).
+ *
+ * @param row     Table of the current rate
+ * @param atten_q8 Attenuation below 0 dB volume in 1/256 dB (≥ 0)
+ * @param coef    Output {b0, b1, b2, a1, a2} per section, Q3.28
+ */
+void dsp_loudness_lookup(const dsp_loudness_row_t row, uint32_t atten_q8,
+                         int32_t coef[DSP_LOUDNESS_SECTIONS][5]);
+
+/**
+ * @brief Fitted shelf gains at a volume (for display)
+ *
+ * @param volume_db Volume, dB (≤ 0)
+ */
+void dsp_loudness_get_gains(float volume_db, float *bass_db, float *treble_db);
+
+/**
+ * @brief ISO 226 compensation target at one of its frequencies (for display)
+ *
+ * @param volume_db Volume, dB (≤ 0)
+ * @param freq      Frequency, Hz (nearest ISO 226 frequency is used)
+ * @return Boost needed relative to 1 kHz, dB (uncapped)
+ */
+float dsp_loudness_target_db(float volume_db, float freq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_LOUDNESS_H */
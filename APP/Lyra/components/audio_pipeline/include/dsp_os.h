@@ -0,0 +1,138 @@
+#ifndef DSP_OS_H
+#define DSP_OS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Half-band Oversampler (2x / 4x / 8x)
+//--------------------------------------------------------------------+
+//
+// Cascade of 2x interpolating half-band FIRs, so the DAC receives
+// 352.8 / 384 kHz and its own (shorter) interpolator only has to clean
+// up above 176 kHz. Every stage keeps the band up to DSP_OS_PASSBAND of
+// the input rate (20 kHz at 44.1k) and rejects its images by
+// DSP_OS_ATTEN_DB; only the first stage is steep, the later ones have
+// transition bands tens of kHz wide and need a handful of taps.
+//
+// Linear phase: each stage is a symmetric half-band in polyphase form.
+// The even outputs are the input delayed (centre tap), the odd outputs
+// one dot product over symmetric pairs, pre-added — ¼ of the taps cost a
+// multiply.
+//
+// Minimum phase: the first stage is replaced by the minimum-phase
+// filter with the same magnitude (homomorphic design at create time)
+// and runs as two full polyphase branches, about twice the cost. No
+// pre-ringing, ~1 ms less latency at 44.1k. Later stages stay linear:
+// their group delay is a few input samples and their ringing sits above
+// 50 kHz.
+//
+// Frame count is exact (out = in × factor); the filter delay is not
+// compensated (dsp_os_get_latency()).
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Highest output rate (ES9039Q2M I2S input limit)
+ */
+#define DSP_OS_MAX_RATE      384000
+
+#define DSP_OS_MAX_FACTOR    8
+#define DSP_OS_MAX_STAGES    3
+
+/**
+ * @brief Passband edge, fraction of the input rate (20 kHz at 44.1k)
+ */
+#define DSP_OS_PASSBAND      0.4535f
+
+/**
+ * @brief Image rejection of every stage (Kaiser design)
+ */
+#define DSP_OS_ATTEN_DB      120.0f
+
+/**
+ * @brief Phase response of the first (steep) stage
+ */
+typedef enum {
+    DSP_OS_PHASE_LINEAR = 0,    ///< Symmetric half-band: constant delay, pre-ringing
+    DSP_OS_PHASE_MINIMUM,       ///< Same magnitude, no pre-ringing, ~2x cost
+    DSP_OS_PHASE_COUNT
+} dsp_os_phase_t;
+
+/**
+ * @brief Opaque oversampler
+ */
+typedef struct dsp_os_s dsp_os_t;
+
+/**
+ * @brief Create an oversampler
+ *
+ * Not real-time: designs the stages (minimum phase runs a 4096-point
+ * cepstrum) and allocates history. Build it once, not per stream: the
+ * filters are relative to the input rate, so one instance serves every
+ * rate.
+ *
+ * @param factor 2, 4 or 8
+ * @return Oversampler, or NULL on a bad factor / out of memory
+ */
+dsp_os_t *dsp_os_create(uint8_t factor, dsp_os_phase_t phase);
+
+/**
+ * @brief Free an oversampler
+ */
+void dsp_os_destroy(dsp_os_t *os);
+
+/**
+ * @brief Clear history (new stream, seek)
+ */
+void dsp_os_reset(dsp_os_t *os);
+
+/**
+ * @brief Oversample int32 stereo frames
+ *
+ * @param in     Interleaved stereo input (left-justified)
+ * @param frames Input frames
+ * @param out    Interleaved stereo output, frames × factor frames
+ * @return Output frames written (frames × factor)
+ */
+uint32_t dsp_os_process(dsp_os_t *os, const int32_t *in, uint32_t frames, int32_t *out);
+
+uint8_t dsp_os_get_factor(const dsp_os_t *os);
+dsp_os_phase_t dsp_os_get_phase(const dsp_os_t *os);
+
+/**
+ * @brief Taps of one stage (full prototype length)
+ */
+uint16_t dsp_os_get_taps(const dsp_os_t *os, uint8_t stage);
+
+/**
+ * @brief Low-frequency delay in input frames
+ */
+float dsp_os_get_latency(const dsp_os_t *os);
+
+/**
+ * @brief Largest factor ≤ max_factor that keeps in_rate × factor ≤ DSP_OS_MAX_RATE
+ *
+ * @return 1, 2, 4 or 8 (1 = no oversampling)
+ */
+uint8_t dsp_os_factor_for(uint32_t in_rate, uint8_t max_factor);
+
+const char *dsp_os_phase_name(dsp_os_phase_t phase);
+
+/**
+ * @brief Estimated cost in cycles per input frame (stereo)
+ *
+ * Model: symmetric pairs (linear) or branch taps (minimum) of every
+ * stage, times the frames that stage runs at, plus the int32 ↔ float
+ * conversions. Verify with `dsp bench os`.
+ */
+uint16_t dsp_os_cycles_per_frame(uint8_t factor, dsp_os_phase_t phase);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_OS_H */
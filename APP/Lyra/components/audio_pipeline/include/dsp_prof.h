@@ -0,0 +1,105 @@
+#ifndef DSP_PROF_H
+#define DSP_PROF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_cpu.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Cycle Profiling
+//--------------------------------------------------------------------+
+//
+// Rolling histograms of measured cost, in the budget's unit: cycles per
+// sample of one channel. Each record is one timed pass (a chunk through
+// one stage, or a whole block) divided by the samples it covered.
+//
+// Values are kept in quarter cycles, binned exactly below 4 cycles and
+// in quarter octaves above (≤ 19% wide, reported at the bin centre, so
+// p50/p99 are within ~9%). The max is exact. After DSP_PROF_WINDOW
+// records every bin is halved, so old behaviour fades out instead of
+// pinning the percentiles forever.
+//
+// One writer (the audio task); readers on other cores may see a record
+// half-applied, which only moves a percentile by one sample.
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Clock the cost model is expressed in (host builds scale to it)
+ */
+#define DSP_PROF_CPU_MHZ 400
+
+#define DSP_PROF_BINS    64
+#define DSP_PROF_WINDOW  4096
+
+/**
+ * @brief Timestamp in CPU cycles
+ *
+ * The cycle counter on target; on the host (simulator, test harnesses)
+ * CLOCK_MONOTONIC converted to cycles of a DSP_PROF_CPU_MHZ core, so
+ * the same accounting runs everywhere.
+ */
+static inline uint32_t dsp_prof_now(void)
+{
+#ifdef ESP_PLATFORM
+    return esp_cpu_get_cycle_count();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * DSP_PROF_CPU_MHZ * 1000000u +
+                      (uint64_t)ts.tv_nsec * DSP_PROF_CPU_MHZ / 1000u);
+#endif
+}
+
+/**
+ * @brief Rolling histogram of cycles per sample
+ */
+typedef struct {
+    uint16_t bin[DSP_PROF_BINS];    ///< Records per bin (decayed)
+    uint16_t count;                 ///< Sum of bin[]
+    uint16_t max_cur;               ///< Max of the current window (quarter cycles)
+    uint16_t max_prev;              ///< Max of the previous window
+} dsp_prof_hist_t;
+
+/**
+ * @brief Summary of a histogram
+ */
+typedef struct {
+    float    p50;                   ///< Median, cycles per sample
+    float    p99;                   ///< 99th percentile, cycles per sample
+    float    max;                   ///< Worst record of the last two windows
+    uint32_t count;                 ///< Records behind the figures (0 = no data)
+} dsp_prof_stats_t;
+
+/**
+ * @brief Add one timed pass
+ *
+ * @param h Histogram
+ * @param cycles Cycles the pass took
+ * @param samples Samples it processed (frames × channels)
+ */
+void dsp_prof_record(dsp_prof_hist_t *h, uint32_t cycles, uint32_t samples);
+
+/**
+ * @brief Percentiles and max of a histogram
+ */
+void dsp_prof_get(const dsp_prof_hist_t *h, dsp_prof_stats_t *out);
+
+/**
+ * @brief Clear a histogram
+ */
+void dsp_prof_reset(dsp_prof_hist_t *h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_PROF_H */
@@ -0,0 +1,137 @@
+#ifndef DSP_SRC_H
+#define DSP_SRC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Polyphase Sample-Rate Converter
+//--------------------------------------------------------------------+
+//
+// Rational L/M resampler (L/M = out/in reduced by their gcd) built on a
+// Kaiser-windowed sinc prototype split into L phases of T taps. Each
+// output frame is one T-tap dot product per channel; L and R share every
+// coefficient load. Covers every pair of the 44.1k / 48k families from
+// 8 kHz to 384 kHz (up to DSP_SRC_MAX_PHASES phases).
+//
+// The cutoff sits at half the lower of the two rates, so aliases and
+// images only land in the transition band above the passband edge.
+// When downsampling the prototype is stretched by the ratio (more taps
+// per output frame) to keep the same transition width at the output.
+//
+// Works on int32 stereo interleaved (left-justified) frames, float
+// internally. Latency is compensated: output sample 0 lines up with
+// input sample 0; about T/2 input frames stay in the history until
+// more input arrives.
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Quality / cost profiles
+ *
+ * Taps per phase, stopband attenuation and the passband edge they give
+ * for 44.1k ↔ 48k (see dsp_src_get_passband()).
+ */
+typedef enum {
+    DSP_SRC_QUALITY_LOW = 0,    ///<  32 taps,  80 dB, passband ≈ 18.5 kHz
+    DSP_SRC_QUALITY_MEDIUM,     ///<  64 taps, 100 dB, passband ≈ 19.8 kHz
+    DSP_SRC_QUALITY_HIGH,       ///< 128 taps, 130 dB, passband ≈ 20.6 kHz
+    DSP_SRC_QUALITY_COUNT
+} dsp_src_quality_t;
+
+/**
+ * @brief Largest L (phases) accepted — 11025 → 48000 needs 640
+ */
+#define DSP_SRC_MAX_PHASES  640
+
+/**
+ * @brief Largest in/out ratio when downsampling (384k → 44.1k ≈ 8.7)
+ */
+#define DSP_SRC_MAX_DOWN    9
+
+/**
+ * @brief Opaque converter
+ */
+typedef struct dsp_src_s dsp_src_t;
+
+/**
+ * @brief Create a converter
+ *
+ * Not real-time: designs the filter and allocates the phase table (PSRAM
+ * when it does not fit comfortably in internal RAM). Build it once per
+ * stream ratio, not per block.
+ *
+ * @return Converter, or NULL if the ratio is unsupported / out of memory
+ */
+dsp_src_t *dsp_src_create(uint32_t in_rate, uint32_t out_rate, dsp_src_quality_t quality);
+
+/**
+ * @brief Whether a ratio is within DSP_SRC_MAX_PHASES / DSP_SRC_MAX_DOWN
+ */
+bool dsp_src_supported(uint32_t in_rate, uint32_t out_rate);
+
+/**
+ * @brief Free a converter
+ */
+void dsp_src_destroy(dsp_src_t *src);
+
+/**
+ * @brief Clear history and phase (new stream, seek)
+ */
+void dsp_src_reset(dsp_src_t *src);
+
+/**
+ * @brief Resample int32 stereo frames
+ *
+ * Consumes input until out_max frames are written or the input runs out.
+ * Input frames not taken (*in_used < in_frames) must be passed again.
+ *
+ * @param in        Interleaved stereo input
+ * @param in_frames Input frames available
+ * @param out       Interleaved stereo output
+ * @param out_max   Output capacity in frames
+ * @param in_used   Input frames consumed
+ * @return Output frames written
+ */
+uint32_t dsp_src_process(dsp_src_t *src, const int32_t *in, uint32_t in_frames,
+                         int32_t *out, uint32_t out_max, uint32_t *in_used);
+
+/**
+ * @brief Input frames still needed to produce out_frames more output
+ *
+ * Accounts for what is already in the history; 0 if it is enough.
+ */
+uint32_t dsp_src_input_needed(const dsp_src_t *src, uint32_t out_frames);
+
+uint32_t dsp_src_get_in_rate(const dsp_src_t *src);
+uint32_t dsp_src_get_out_rate(const dsp_src_t *src);
+dsp_src_quality_t dsp_src_get_quality(const dsp_src_t *src);
+
+/**
+ * @brief Taps per output frame (per channel)
+ */
+uint16_t dsp_src_get_taps(const dsp_src_t *src);
+
+/**
+ * @brief Passband edge in Hz (start of the transition band)
+ */
+float dsp_src_get_passband(const dsp_src_t *src);
+
+const char *dsp_src_quality_name(dsp_src_quality_t quality);
+
+/**
+ * @brief Estimated cost in cycles per output frame (stereo)
+ *
+ * Model: T stereo MACs + int32 ↔ float conversion. Verify with
+ * `dsp bench src`.
+ */
+uint16_t dsp_src_cycles_per_frame(uint32_t in_rate, uint32_t out_rate, dsp_src_quality_t quality);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_SRC_H */
@@ -0,0 +1,153 @@
+#ifndef DSP_VOLUME_H
+#define DSP_VOLUME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Output Gain and Requantiser
+//--------------------------------------------------------------------+
+//
+// Last stage before the samples leave the pipeline: digital volume and
+// the reduction to the output word length, fused into the reinterleave
+// (planar → interleaved) pass of the chain.
+//
+//   x (int32, with or without headroom) × gain (Q1.31)  → 64-bit product
+//   − shaped error (optional)  + TPDF dither (±1 LSB)   → round
+//   → saturate to the output word, left-justified in int32
+//
+// The gain ramps linearly over DSP_VOLUME_RAMP_MS, one step per frame,
+// with a 64-bit accumulator (Q1.62): even a 0.1 dB change spread over
+// 7680 frames at 384 kHz moves every frame, nothing stalls on rounding.
+//
+// Dither is added only when the word gets shorter (16-bit output); at
+// 32 bits the stage rounds, the error sits ~190 dB down. Noise shaping
+// feeds the requantisation error back through a 3-tap filter: the
+// F-weighted curve of Wannamaker up to 48 kHz (noise moved out of
+// 2-6 kHz, +11 dB at Nyquist), a second-order highpass above (no noise
+// left in the audio band to speak of, the excess lands above 20 kHz).
+//--------------------------------------------------------------------+
+
+/**
+ * @brief Unity gain (Q1.31)
+ */
+#define DSP_VOLUME_UNITY     0x80000000u
+
+/**
+ * @brief Gain ramp length on a volume or mute change
+ */
+#define DSP_VOLUME_RAMP_MS   20
+
+/**
+ * @brief Lowest volume; anything below is silence
+ */
+#define DSP_VOLUME_MIN_DB    (-100.0f)
+
+/**
+ * @brief Requantisation dither
+ */
+typedef enum {
+    DSP_DITHER_OFF = 0,          ///< Round to nearest (correlated error on quiet passages)
+    DSP_DITHER_TPDF,             ///< Triangular ±1 LSB, flat (default)
+    DSP_DITHER_SHAPED,           ///< TPDF through an error-feedback noise shaper
+    DSP_DITHER_COUNT
+} dsp_dither_t;
+
+/**
+ * @brief Gain and requantiser state (audio task only)
+ */
+typedef struct {
+    int64_t  gain;          ///< Q1.62; gain >> 31 is the Q1.31 gain applied
+    int64_t  step;          ///< Added per frame while ramping
+    uint32_t ramp_left;     ///< Frames left in the ramp
+    uint32_t target;        ///< Q1.31 gain the ramp ends on
+    uint8_t  out_bits;      ///< Output word length (16..32)
+    dsp_dither_t dither;    ///< Configured mode (applied when out_bits < 32)
+    int32_t  shape[3];      ///< Error feedback taps, Q12
+    int32_t  err[2][3];     ///< Error history per channel, output LSB in Q16
+    uint32_t seed;          ///< Dither generator (xorshift32)
+} dsp_volume_t;
+
+/**
+ * @brief Start at unity gain, 32-bit output, no dither
+ */
+void dsp_volume_init(dsp_volume_t *vol);
+
+/**
+ * @brief Output word length, dither and noise shaper for a rate
+ *
+ * Clears the shaper history; the gain is kept.
+ */
+void dsp_volume_config(dsp_volume_t *vol, uint32_t sample_rate, uint8_t out_bits,
+                       dsp_dither_t dither);
+
+/**
+ * @brief Ramp to a new gain
+ *
+ * @param gain        Q1.31 gain (≤ DSP_VOLUME_UNITY)
+ * @param ramp_frames Ramp length (0 = jump)
+ */
+void dsp_volume_set_target(dsp_volume_t *vol, uint32_t gain, uint32_t ramp_frames);
+
+/**
+ * @brief Gain differs from unity or is still moving
+ */
+static inline bool dsp_volume_has_gain(const dsp_volume_t *vol)
+{
+    return vol->ramp_left > 0 || vol->target != DSP_VOLUME_UNITY;
+}
+
+/**
+ * @brief The stage changes the samples (gain, or a shorter output word)
+ */
+static inline bool dsp_volume_active(const dsp_volume_t *vol)
+{
+    return dsp_volume_has_gain(vol) || vol->out_bits < 32;
+}
+
+/**
+ * @brief Gain and requantise interleaved int32 stereo in place
+ */
+void dsp_volume_process(dsp_volume_t *vol, int32_t *buf, uint32_t frames);
+
+/**
+ * @brief Reinterleave planar int32 (headroom bits below full scale) with
+ *        gain and requantisation, in one pass
+ */
+void dsp_volume_interleave_q31(dsp_volume_t *vol, const int32_t *buf_L, const int32_t *buf_R,
+                               int32_t *out, uint32_t frames, uint8_t headroom);
+
+/**
+ * @brief Reinterleave planar float (±1.0 = full scale) with gain and
+ *        requantisation, in one pass
+ *
+ * Samples up to 2^headroom above full scale survive until after the
+ * gain; the saturation to the output word is the only clip.
+ */
+void dsp_volume_interleave_float(dsp_volume_t *vol, const float *buf_L, const float *buf_R,
+                                 int32_t *out, uint32_t frames, uint8_t headroom);
+
+/**
+ * @brief Q1.31 gain of a volume in dB (≤ 0; below DSP_VOLUME_MIN_DB = 0)
+ */
+uint32_t dsp_volume_gain_from_db(float volume_db);
+
+/**
+ * @brief Short name of a dither mode ("off", "tpdf", "shaped")
+ */
+const char *dsp_dither_name(dsp_dither_t dither);
+
+/**
+ * @brief Estimated cost in cycles per sample on top of a plain reinterleave
+ */
+uint16_t dsp_volume_cycles_per_sample(dsp_dither_t dither, uint8_t out_bits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_VOLUME_H */
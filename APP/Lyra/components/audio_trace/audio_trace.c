@@ -0,0 +1,270 @@
+#include "audio_trace.h"
+#include <stdio.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "audio_trace";
+
+//--------------------------------------------------------------------+
+// Storage
+//--------------------------------------------------------------------+
+//
+// One ring per core, written only by tasks running on that core. Each
+// event reserves its slot with an atomic fetch-add, so a task preempted
+// mid-record never shares a slot with the task that preempted it.
+//
+// Timestamps are raw 32-bit cycle counts (wrap every ~12 s at 360 MHz).
+// Each core drops a SYNC event carrying esp_timer µs at least once a
+// second; the dump converts cycles to µs relative to the latest SYNC,
+// which also aligns the two cores' independent cycle counters.
+
+#define TRACE_CORES         2
+#define TRACE_CPU_MHZ       CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#define TRACE_SYNC_CYCLES   ((uint32_t)TRACE_CPU_MHZ * 1000000u)   // 1 s
+
+typedef struct {
+    uint32_t cycles;
+    uint32_t arg;
+    uint8_t  id;
+    char     ph;
+    uint8_t  task;
+    uint8_t  rsv;
+} trace_ev_t;
+
+typedef struct {
+    trace_ev_t *ev;
+    uint32_t    wr;             // Events reserved (free-running)
+    uint32_t    last_sync;      // Cycle count at last SYNC
+    bool        need_sync;
+} trace_core_t;
+
+volatile bool g_audio_trace_on = false;
+
+static struct {
+    trace_core_t core[TRACE_CORES];
+    TaskHandle_t tasks[AUDIO_TRACE_MAX_TASKS];
+    char         task_names[AUDIO_TRACE_MAX_TASKS][configMAX_TASK_NAME_LEN];
+    uint32_t     start_us;
+    audio_trace_id_t trigger;
+    bool         triggered;
+} s_trace;
+
+static const char *s_names[AUDIO_TRACE_NUM_EVENTS] = {
+    [AUDIO_TRACE_SYNC]          = "sync",
+    [AUDIO_TRACE_USB_READ]      = "usb_read",
+    [AUDIO_TRACE_DECODE]        = "decode",
+    [AUDIO_TRACE_DSP]           = "dsp",
+    [AUDIO_TRACE_RING_COMMIT]   = "ring_commit",
+    [AUDIO_TRACE_RING_FULL]     = "ring_full",
+    [AUDIO_TRACE_RING_PEEK]     = "ring_peek",
+    [AUDIO_TRACE_I2S_WRITE]     = "i2s_write",
+    [AUDIO_TRACE_UNDERRUN]      = "UNDERRUN",
+    [AUDIO_TRACE_SOURCE_SWITCH] = "source_switch",
+    [AUDIO_TRACE_FORMAT]        = "format",
+    [AUDIO_TRACE_SEEK]          = "seek",
+};
+
+const char *audio_trace_name(audio_trace_id_t id)
+{
+    return (id < AUDIO_TRACE_NUM_EVENTS) ? s_names[id] : "?";
+}
+
+//--------------------------------------------------------------------+
+// Recording
+//--------------------------------------------------------------------+
+
+// Task slot for the calling task (registers it on first use)
+static uint8_t task_slot(void)
+{
+    TaskHandle_t me = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < AUDIO_TRACE_MAX_TASKS; i++) {
+        TaskHandle_t t = __atomic_load_n(&s_trace.tasks[i], __ATOMIC_ACQUIRE);
+        if (t == me) return (uint8_t)i;
+        if (t == NULL) {
+            TaskHandle_t expected = NULL;
+            if (__atomic_compare_exchange_n(&s_trace.tasks[i], &expected, me, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                strncpy(s_trace.task_names[i], pcTaskGetName(NULL), configMAX_TASK_NAME_LEN - 1);
+                return (uint8_t)i;
+            }
+            if (expected == me) return (uint8_t)i;
+        }
+    }
+    return AUDIO_TRACE_MAX_TASKS - 1;   // Table full: lump extras together
+}
+
+static inline void put(trace_core_t *c, uint8_t id, char ph, uint8_t task,
+                       uint32_t cycles, uint32_t arg)
+{
+    uint32_t idx = __atomic_fetch_add(&c->wr, 1, __ATOMIC_RELAXED) % AUDIO_TRACE_EVENTS_PER_CORE;
+    trace_ev_t *e = &c->ev[idx];
+    e->cycles = cycles;
+    e->arg    = arg;
+    e->id     = id;
+    e->ph     = ph;
+    e->task   = task;
+}
+
+void audio_trace_record(audio_trace_id_t id, char ph, uint32_t arg)
+{
+    // Core and cycle counter must come from the same CPU: retry if the
+    // task migrated in between
+    int core;
+    uint32_t now;
+    do {
+        core = esp_cpu_get_core_id();
+        now  = esp_cpu_get_cycle_count();
+    } while (core != esp_cpu_get_core_id());
+
+    trace_core_t *c = &s_trace.core[core];
+    if (!c->ev) return;
+    uint8_t task = task_slot();
+
+    if (c->need_sync || now - c->last_sync >= TRACE_SYNC_CYCLES) {
+        c->need_sync = false;
+        c->last_sync = now;
+        put(c, AUDIO_TRACE_SYNC, 'S', task, now, (uint32_t)esp_timer_get_time());
+    }
+
+    put(c, (uint8_t)id, ph, task, now, arg);
+
+    if (id == s_trace.trigger && id != AUDIO_TRACE_SYNC) {
+        g_audio_trace_on = false;
+        s_trace.triggered = true;
+    }
+}
+
+//--------------------------------------------------------------------+
+// Control
+//--------------------------------------------------------------------+
+
+bool audio_trace_start(audio_trace_id_t trigger)
+{
+    g_audio_trace_on = false;
+    vTaskDelay(pdMS_TO_TICKS(2));   // let in-flight records land
+
+    for (int i = 0; i < TRACE_CORES; i++) {
+        trace_core_t *c = &s_trace.core[i];
+        if (!c->ev) {
+            size_t sz = AUDIO_TRACE_EVENTS_PER_CORE * sizeof(trace_ev_t);
+            c->ev = heap_caps_malloc(sz, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (!c->ev) c->ev = heap_caps_malloc(sz, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            if (!c->ev) {
+                ESP_LOGE(TAG, "No memory for %u byte trace ring", (unsigned)sz);
+                return false;
+            }
+        }
+        c->wr = 0;
+        c->need_sync = true;
+    }
+
+    memset(s_trace.tasks, 0, sizeof(s_trace.tasks));
+    memset(s_trace.task_names, 0, sizeof(s_trace.task_names));
+    s_trace.start_us  = (uint32_t)esp_timer_get_time();
+    s_trace.trigger   = trigger;
+    s_trace.triggered = false;
+
+    g_audio_trace_on = true;
+    ESP_LOGI(TAG, "Tracing started (%u events/core%s%s)",
+             (unsigned)AUDIO_TRACE_EVENTS_PER_CORE,
+             trigger != AUDIO_TRACE_SYNC ? ", freeze on " : "",
+             trigger != AUDIO_TRACE_SYNC ? audio_trace_name(trigger) : "");
+    return true;
+}
+
+void audio_trace_stop(void)
+{
+    g_audio_trace_on = false;
+}
+
+void audio_trace_get_status(audio_trace_status_t *out)
+{
+    out->running   = g_audio_trace_on;
+    out->armed     = g_audio_trace_on && s_trace.trigger != AUDIO_TRACE_SYNC;
+    out->triggered = s_trace.triggered;
+    out->events[0] = s_trace.core[0].wr;
+    out->events[1] = s_trace.core[1].wr;
+    out->capacity  = AUDIO_TRACE_EVENTS_PER_CORE;
+}
+
+//--------------------------------------------------------------------+
+// Chrome trace export
+//--------------------------------------------------------------------+
+
+uint32_t audio_trace_dump(audio_trace_write_fn write)
+{
+    char line[192];
+    int n;
+    uint32_t written = 0;
+
+    g_audio_trace_on = false;
+    vTaskDelay(pdMS_TO_TICKS(2));
+
+    static const char head[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    write(head, sizeof(head) - 1);
+
+    n = snprintf(line, sizeof(line),
+                 "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"Lyra audio\"}}");
+    write(line, n);
+
+    for (int i = 0; i < AUDIO_TRACE_MAX_TASKS; i++) {
+        if (!s_trace.tasks[i]) continue;
+        n = snprintf(line, sizeof(line),
+                     ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+                     i, s_trace.task_names[i]);
+        write(line, n);
+    }
+
+    for (int core = 0; core < TRACE_CORES; core++) {
+        const trace_core_t *c = &s_trace.core[core];
+        if (!c->ev) continue;
+
+        uint32_t total = c->wr;
+        uint32_t count = (total < AUDIO_TRACE_EVENTS_PER_CORE) ? total : AUDIO_TRACE_EVENTS_PER_CORE;
+        uint32_t first = total - count;
+
+        // Events older than the first surviving SYNC (ring wrapped) are
+        // anchored backwards to it — at most one sync period away
+        uint32_t k;
+        for (k = first; k != total; k++) {
+            if (c->ev[k % AUDIO_TRACE_EVENTS_PER_CORE].id == AUDIO_TRACE_SYNC) break;
+        }
+        if (k == total) continue;
+        uint32_t sync_us     = c->ev[k % AUDIO_TRACE_EVENTS_PER_CORE].arg - s_trace.start_us;
+        uint32_t sync_cycles = c->ev[k % AUDIO_TRACE_EVENTS_PER_CORE].cycles;
+
+        for (k = first; k != total; k++) {
+            const trace_ev_t *e = &c->ev[k % AUDIO_TRACE_EVENTS_PER_CORE];
+
+            if (e->id == AUDIO_TRACE_SYNC) {
+                sync_us = e->arg - s_trace.start_us;
+                sync_cycles = e->cycles;
+                continue;
+            }
+            if (e->id >= AUDIO_TRACE_NUM_EVENTS) continue;
+
+            int32_t  dc = (int32_t)(e->cycles - sync_cycles);
+            int64_t  ts_ns = (int64_t)sync_us * 1000 + (int64_t)dc * 1000 / TRACE_CPU_MHZ;
+            if (ts_ns < 0) ts_ns = 0;
+
+            n = snprintf(line, sizeof(line),
+                         ",\n{\"name\":\"%s\",\"cat\":\"audio\",\"ph\":\"%c\",%s"
+                         "\"ts\":%lu.%03lu,\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%lu,\"core\":%d}}",
+                         s_names[e->id], e->ph, (e->ph == 'i') ? "\"s\":\"t\"," : "",
+                         (unsigned long)(ts_ns / 1000), (unsigned long)(ts_ns % 1000),
+                         (unsigned)e->task, (unsigned long)e->arg, core);
+            write(line, n);
+            written++;
+        }
+    }
+
+    static const char tail[] = "\n]}\n";
+    write(tail, sizeof(tail) - 1);
+    return written;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file    audio_trace.h
+ * @brief   Real-time audio path tracing — per-core event rings, Chrome trace export
+ *
+ * Producers, the DSP chain, the output ring and the I2S feeder record
+ * begin/end/instant events with CPU cycle timestamps into one ring per
+ * core. Recording is lock-free (one atomic fetch-add per event) and costs
+ * a single load + branch while tracing is stopped.
+ *
+ * The rings can be frozen automatically on an underrun, then dumped as
+ * Chrome / Perfetto trace JSON (chrome://tracing, ui.perfetto.dev).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Events per core ring (12 bytes each, allocated on first start)
+ */
+#define AUDIO_TRACE_EVENTS_PER_CORE  8192
+
+/**
+ * @brief Distinct tasks that can appear in one trace
+ */
+#define AUDIO_TRACE_MAX_TASKS        16
+
+/**
+ * @brief Traced stages
+ */
+typedef enum {
+    AUDIO_TRACE_SYNC = 0,        ///< Internal: cycle ↔ µs anchor
+    AUDIO_TRACE_USB_READ,        ///< audio_task: tud_audio_read()
+    AUDIO_TRACE_DECODE,          ///< Producer: codec decode (arg = frames)
+    AUDIO_TRACE_DSP,             ///< audio_pipeline_process() (arg = frames)
+    AUDIO_TRACE_RING_COMMIT,     ///< Producer queued a block (arg = queued blocks)
+    AUDIO_TRACE_RING_FULL,       ///< Producer found no free block
+    AUDIO_TRACE_RING_PEEK,       ///< Feeder took a block (arg = queued blocks)
+    AUDIO_TRACE_I2S_WRITE,       ///< Feeder: i2s_channel_write() (arg = bytes)
+    AUDIO_TRACE_UNDERRUN,        ///< Feeder ran dry while producer active
+    AUDIO_TRACE_SOURCE_SWITCH,   ///< audio_source_switch() (arg = new source)
+    AUDIO_TRACE_FORMAT,          ///< I2S / DSP reconfiguration (arg = rate)
+    AUDIO_TRACE_SEEK,            ///< Player seek / flush
+    AUDIO_TRACE_NUM_EVENTS
+} audio_trace_id_t;
+
+/**
+ * @brief Trace status snapshot
+ */
+typedef struct {
+    bool     running;            ///< Recording
+    bool     armed;              ///< Will freeze on the trigger event
+    bool     triggered;          ///< Frozen by the trigger
+    uint32_t events[2];          ///< Events recorded per core (incl. overwritten)
+    uint32_t capacity;           ///< Ring size per core
+} audio_trace_status_t;
+
+/**
+ * @brief Output sink for audio_trace_dump()
+ */
+typedef void (*audio_trace_write_fn)(const char *data, size_t len);
+
+/** @brief Recording flag — read inline so stopped tracing costs one branch */
+extern volatile bool g_audio_trace_on;
+
+/**
+ * @brief Record one event (use the macros below)
+ *
+ * @param id  Stage
+ * @param ph  'B' begin, 'E' end, 'i' instant
+ * @param arg Stage-specific value shown in the trace args
+ */
+void audio_trace_record(audio_trace_id_t id, char ph, uint32_t arg);
+
+#define AUDIO_TRACE_BEGIN(id)         do { if (g_audio_trace_on) audio_trace_record((id), 'B', 0); } while (0)
+#define AUDIO_TRACE_END(id, arg)      do { if (g_audio_trace_on) audio_trace_record((id), 'E', (arg)); } while (0)
+#define AUDIO_TRACE_INSTANT(id, arg)  do { if (g_audio_trace_on) audio_trace_record((id), 'i', (arg)); } while (0)
+
+/**
+ * @brief Clear the rings and start recording
+ *
+ * Allocates the rings on first use (PSRAM, falls back to internal RAM).
+ *
+ * @param trigger Freeze recording when this event is recorded
+ *                (e.g. AUDIO_TRACE_UNDERRUN), or AUDIO_TRACE_SYNC for none
+ * @return false if the rings could not be allocated
+ */
+bool audio_trace_start(audio_trace_id_t trigger);
+
+/**
+ * @brief Stop recording (rings are kept for dumping)
+ */
+void audio_trace_stop(void);
+
+void audio_trace_get_status(audio_trace_status_t *out);
+
+/**
+ * @brief Write the recorded events as Chrome trace JSON
+ *
+ * Stops recording first. The sink is called with short chunks (one event
+ * per call); it may block.
+ *
+ * @return Number of events written
+ */
+uint32_t audio_trace_dump(audio_trace_write_fn write);
+
+/**
+ * @brief Stage name as shown in the trace
+ */
+const char *audio_trace_name(audio_trace_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
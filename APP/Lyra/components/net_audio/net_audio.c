@@ -1,5 +1,6 @@
 #include "net_audio.h"
 #include "http_stream.h"
+#include "audio_engine.h"
 
 // NOTE: DO NOT define DR_*_IMPLEMENTATION — already compiled in audio_codecs component.
 // Including headers here for declarations only (callback function signatures).
@@ -15,7 +16,6 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
-#include "freertos/stream_buffer.h"
 
 static const char *TAG = "net_audio";
 
@@ -85,14 +85,12 @@ typedef struct {
     mp3_stream_ctx_t *mp3_ctx;
     drwav           *wav;
 
+    // Decode → DSP → output ring (owns timing / backpressure diagnostics)
+    audio_engine_t engine;
+
     // Diagnostics
     struct {
-        uint32_t decode_max_us;
-        uint32_t dsp_max_us;
-        uint32_t backpressure_count;
-        uint32_t stream_partial;
         uint32_t error_count;
-        uint64_t total_frames;
         uint64_t last_log_time_us;
     } diag;
 } net_audio_t;
@@ -407,6 +405,14 @@ static int32_t decode_block(int32_t *buf, uint32_t max_frames)
     return -1;  // No active decoder
 }
 
+// audio_engine pull callback
+static int32_t net_pull(void *ctx, int32_t *out, uint32_t max_frames)
+{
+    (void)ctx;
+    if (max_frames > NET_AUDIO_DECODE_FRAMES) max_frames = NET_AUDIO_DECODE_FRAMES;
+    return decode_block(out, max_frames);
+}
+
 //--------------------------------------------------------------------+
 // Diagnostics logging
 //--------------------------------------------------------------------+
@@ -417,22 +423,20 @@ static void log_diag(void)
     if (now - s_net.diag.last_log_time_us < 5000000) return;  // every 5s
     s_net.diag.last_log_time_us = now;
 
-    StreamBufferHandle_t stream = s_net.audio.get_stream_buffer();
-    size_t buf_used = stream ? (16 * 1024 - xStreamBufferSpacesAvailable(stream)) : 0;
+    size_t buf_used = s_net.audio.ring_used ? s_net.audio.ring_used() : 0;
+    audio_engine_diag_t d;
+    audio_engine_take_diag(&s_net.engine, &d);
 
     ESP_LOGI(TAG, "[diag] state=%d frames=%llu dec_max=%luus dsp_max=%luus "
-             "backpressure=%lu partial=%lu err=%lu streambuf=%uB",
+             "backpressure=%lu starved=%lu err=%lu ring=%uB",
              (int)s_net.state,
-             s_net.diag.total_frames,
-             (unsigned long)s_net.diag.decode_max_us,
-             (unsigned long)s_net.diag.dsp_max_us,
-             (unsigned long)s_net.diag.backpressure_count,
-             (unsigned long)s_net.diag.stream_partial,
+             d.total_frames,
+             (unsigned long)d.decode_max_us,
+             (unsigned long)d.dsp_max_us,
+             (unsigned long)d.backpressure,
+             (unsigned long)d.starved,
              (unsigned long)s_net.diag.error_count,
              (unsigned)buf_used);
-
-    s_net.diag.decode_max_us = 0;
-    s_net.diag.dsp_max_us    = 0;
 }
 
 //--------------------------------------------------------------------+
@@ -477,13 +481,14 @@ static bool start_stream(const char *url, const char *codec_hint, const char *re
     }
 
     // Switch audio source to NET and reconfigure I2S for this stream's format
+    // Engine first: it decides the output rate (fixed rate mode resamples)
+    audio_engine_start(&s_net.engine, s_net.info.sample_rate, 0);
     s_net.audio.set_producer_handle(s_task_handle);
     s_net.audio.switch_source(s_net.audio.audio_source_net,
-                               s_net.info.sample_rate,
+                               s_net.engine.out_rate,
                                s_net.info.bits_per_sample);
 
     s_net.state = NET_AUDIO_PLAYING;
-    s_net.diag.total_frames = 0;
     s_net.diag.last_log_time_us = esp_timer_get_time();
 
     ESP_LOGI(TAG, "Stream started: %s %luHz %d-bit %dch",
@@ -527,9 +532,6 @@ static void net_resume_cb(void)
 // Main decode loop (runs while state == NET_AUDIO_PLAYING)
 //--------------------------------------------------------------------+
 
-// Decode buffer: 1024 stereo frames × 2ch × 4 bytes = 8KB
-static int32_t s_decode_buf[NET_AUDIO_DECODE_FRAMES * 2];
-
 static void run_decode_loop(void)
 {
     uint64_t start_ms = esp_timer_get_time() / 1000;
@@ -548,6 +550,7 @@ static void run_decode_loop(void)
 
                 case NET_CMD_PAUSE:
                     s_net.state = NET_AUDIO_PAUSED;
+                    s_net.audio.ring_hold(true);
                     ESP_LOGI(TAG, "Paused");
                     return;  // exit decode loop; task will re-enter when resumed
 
@@ -565,26 +568,9 @@ static void run_decode_loop(void)
             }
         }
 
-        // Backpressure: wait if stream buffer is almost full
-        StreamBufferHandle_t stream = s_net.audio.get_stream_buffer();
-        size_t frame_bytes = NET_AUDIO_DECODE_FRAMES * 2 * sizeof(int32_t);
-        size_t space = xStreamBufferSpacesAvailable(stream);
-        if (space < frame_bytes) {
-            s_net.diag.backpressure_count++;
-            // Wait for consumer (feeder task) to drain some bytes
-            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
-            continue;
-        }
-
-        // Decode one block
-        uint64_t t0 = esp_timer_get_time();
-        uint32_t max_frames = NET_AUDIO_DECODE_FRAMES;
-
-        int32_t frames = decode_block(s_decode_buf, max_frames);
-        uint64_t t1 = esp_timer_get_time();
-
-        uint32_t dec_us = (uint32_t)(t1 - t0);
-        if (dec_us > s_net.diag.decode_max_us) s_net.diag.decode_max_us = dec_us;
+        // Decode → DSP → ring, waits here while the ring is full
+        int32_t frames = audio_engine_run(&s_net.engine, 10);
+        if (frames == AUDIO_ENGINE_FULL) continue;
 
         if (frames <= 0) {
             bool was_error = (frames < 0);
@@ -592,7 +578,7 @@ static void run_decode_loop(void)
                 ESP_LOGE(TAG, "Decode error: %ld", (long)frames);
                 s_net.diag.error_count++;
             } else {
-                ESP_LOGI(TAG, "Stream EOF after %llu frames", s_net.diag.total_frames);
+                ESP_LOGI(TAG, "Stream EOF after %llu frames", s_net.engine.diag.total_frames);
             }
             cleanup_stream();
             s_net.audio.switch_source(s_net.audio.audio_source_usb, 0, 0);
@@ -601,26 +587,10 @@ static void run_decode_loop(void)
             return;
         }
 
-        s_net.diag.total_frames += frames;
-
-        // Apply DSP chain
-        t0 = esp_timer_get_time();
-        s_net.audio.process_audio(s_decode_buf, (uint32_t)frames);
-        t1 = esp_timer_get_time();
-        uint32_t dsp_us = (uint32_t)(t1 - t0);
-        if (dsp_us > s_net.diag.dsp_max_us) s_net.diag.dsp_max_us = dsp_us;
-
-        // Write to StreamBuffer
-        size_t byte_count = (size_t)frames * 2 * sizeof(int32_t);
-        size_t sent = xStreamBufferSend(stream, s_decode_buf, byte_count, 0);
-        if (sent < byte_count) {
-            s_net.diag.stream_partial++;
-        }
-
-        // Update elapsed time
-        uint32_t sr = s_net.info.sample_rate;
+        // Update elapsed time (committed frames run at the output rate)
+        uint32_t sr = s_net.engine.out_rate;
         if (sr > 0) {
-            s_net.info.elapsed_ms = (uint32_t)((s_net.diag.total_frames * 1000ULL) / sr);
+            s_net.info.elapsed_ms = (uint32_t)((s_net.engine.diag.total_frames * 1000ULL) / sr);
         }
 
         // Copy ICY title from HTTP stream (radio track changes)
@@ -678,10 +648,13 @@ static void net_audio_task(void *arg)
                         // re-configure I2S to the stream's format.
                         // If paused internally (NET_CMD_PAUSE, source already NET),
                         // audio_source_switch hits the same-source early-return → no-op.
+                        // The other source left the chain at its own rate
+                        audio_engine_sync_pipeline(&s_net.engine);
                         s_net.audio.set_producer_handle(s_task_handle);
                         s_net.audio.switch_source(s_net.audio.audio_source_net,
-                                                   s_net.info.sample_rate,
+                                                   s_net.engine.out_rate,
                                                    s_net.info.bits_per_sample);
+                        s_net.audio.ring_hold(false);
                         s_net.state = NET_AUDIO_PLAYING;
                         run_decode_loop();
                     } else if (cmd.type == NET_CMD_START) {
@@ -708,6 +681,14 @@ void net_audio_init(const net_audio_audio_cbs_t *cbs)
 {
     memcpy(&s_net.audio, cbs, sizeof(s_net.audio));
 
+    audio_engine_output_t out = {
+        .ring_acquire  = cbs->ring_acquire,
+        .ring_commit   = cbs->ring_commit,
+        .ring_used     = cbs->ring_used,
+        .process_audio = cbs->process_audio,
+    };
+    audio_engine_init(&s_net.engine, net_pull, NULL, &out);
+
     s_net.cmd_queue = xQueueCreate(4, sizeof(net_cmd_t));
     assert(s_net.cmd_queue);
 
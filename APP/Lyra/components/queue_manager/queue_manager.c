@@ -118,6 +118,20 @@ static bool advance_queue(bool forward)
     return true;
 }
 
+// Track advance_queue(true) would select, without changing state
+// (-1: queue ends, or a shuffle wrap that reshuffles first)
+static int peek_next_index(void)
+{
+    if (s_q.count == 0 || s_q.current < 0) return -1;
+    if (s_q.repeat_mode == QM_REPEAT_ONE) return s_q.current;
+
+    if (s_q.shuffle) {
+        return (s_q.shuffle_pos + 1 < s_q.count) ? s_q.shuffle_map[s_q.shuffle_pos + 1] : -1;
+    }
+    if (s_q.current + 1 < s_q.count) return s_q.current + 1;
+    return (s_q.repeat_mode == QM_REPEAT_ALL) ? 0 : -1;
+}
+
 //--------------------------------------------------------------------+
 // Play current track (dispatch to appropriate audio source)
 //--------------------------------------------------------------------+
@@ -198,6 +212,28 @@ static void on_sd_player_eof(bool error)
     }
 }
 
+// Gapless: sd_player pre-opens the next entry when it is an SD file
+static bool on_sd_player_next(char *path, size_t path_size)
+{
+    if (!s_q.active) return false;
+    int idx = peek_next_index();
+    if (idx < 0 || s_q.tracks[idx].source != QM_SOURCE_SD) return false;
+    snprintf(path, path_size, "%s", s_q.tracks[idx].file_path);
+    return true;
+}
+
+// sd_player already continued with the pre-opened entry — only advance
+static void on_sd_player_handover(void)
+{
+    if (!s_q.active) return;
+    advance_queue(true);
+    s_q.consecutive_errors = 0;
+    if (s_q.current >= 0 && s_q.current < s_q.count) {
+        ESP_LOGI(TAG, "Gapless → [%d/%d] \"%s\"",
+                 s_q.current + 1, s_q.count, s_q.tracks[s_q.current].title);
+    }
+}
+
 //--------------------------------------------------------------------+
 // Public API: Init
 //--------------------------------------------------------------------+
@@ -210,6 +246,7 @@ void qm_init(void)
     // Register EOF callbacks
     net_audio_set_eof_callback(on_net_audio_eof);
     sd_player_set_eof_callback(on_sd_player_eof);
+    sd_player_set_gapless_callbacks(on_sd_player_next, on_sd_player_handover);
 
     ESP_LOGI(TAG, "Queue manager initialized (max %d tracks)", QM_MAX_TRACKS);
 }
@@ -2,10 +2,10 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "audio_codecs.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/stream_buffer.h"
 
 //--------------------------------------------------------------------+
 // Player states
@@ -44,8 +44,16 @@ typedef struct {
     void (*switch_source)(int new_source, uint32_t sample_rate, uint8_t bits);
     // Register the active producer task handle for feeder notifications
     void (*set_producer_handle)(TaskHandle_t handle);
-    // Get the shared stream buffer
-    StreamBufferHandle_t (*get_stream_buffer)(void);
+    // Output ring: acquire a free block to decode into (NULL when full),
+    // then commit the frames written. Zero-copy into the I2S feeder.
+    int32_t *(*ring_acquire)(uint32_t *max_frames);
+    void (*ring_commit)(uint32_t frames);
+    // Drop queued audio (seek / track change)
+    void (*ring_reset)(void);
+    // Hold queued audio while paused (true) / resume draining (false)
+    void (*ring_hold)(bool hold);
+    // Bytes queued for I2S (diagnostics)
+    size_t (*ring_used)(void);
     // Process audio through DSP chain (int32_t stereo interleaved)
     void (*process_audio)(int32_t *buffer, uint32_t frames);
 } sd_player_audio_cbs_t;
@@ -109,6 +117,17 @@ void sd_player_set_eof_callback(sd_player_eof_cb_t cb);
 // Used by queue_manager to control track sequencing externally.
 void sd_player_set_single_track_mode(bool enabled);
 
+// Gapless handover in single-track mode. Shortly before EOF the player asks
+// next_cb for the next queue entry (without advancing the queue), opens and
+// pre-decodes it. If its format matches, the file is spliced directly after
+// the last frame of the current one and handover_cb is called instead of
+// eof_cb — the queue must then advance without calling sd_player_cmd_play().
+// next_cb returns false when the next entry is not an SD file.
+typedef bool (*sd_player_next_cb_t)(char *path, size_t path_size);
+typedef void (*sd_player_handover_cb_t)(void);
+void sd_player_set_gapless_callbacks(sd_player_next_cb_t next_cb,
+                                     sd_player_handover_cb_t handover_cb);
+
 //--------------------------------------------------------------------+
 // Status queries (thread-safe)
 //--------------------------------------------------------------------+
@@ -2,26 +2,27 @@
 #include "audio_codecs.h"
 #include "cue_parser.h"
 #include "storage.h"
+#include "audio_engine.h"
+#include "audio_trace.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <math.h>
 #include <esp_log.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
-#include "freertos/stream_buffer.h"
 #include "esp_timer.h"
 #include "esp_random.h"
 
 static const char *TAG = "sd_player";
 
-/* Returns a human-readable format name, e.g. "FLAC", "DSD64", "DSD128", "DSD256" */
+/* Returns a human-readable format name, e.g. "FLAC", "DSD64", "DSD128", "DSD256"
+ * (DSD keeps its name when decimated to PCM — sample_rate tells the mode) */
 static const char *format_name(const codec_info_t *info)
 {
-    if (info->is_dsd) {
-        if (info->sample_rate <= 176400) return "DSD64";
-        if (info->sample_rate <= 352800) return "DSD128";
+    if (info->dsd_rate) {
+        if (info->dsd_rate <= 2822400) return "DSD64";
+        if (info->dsd_rate <= 5644800) return "DSD128";
         return "DSD256";
     }
     switch (info->format) {
@@ -62,22 +63,6 @@ typedef struct {
     };
 } player_cmd_t;
 
-//--------------------------------------------------------------------+
-// Diagnostics (mirrors USB audio diag style)
-//--------------------------------------------------------------------+
-
-static volatile struct {
-    uint32_t decode_max_us;
-    uint32_t dsp_max_us;
-    uint32_t loop_max_us;
-    uint32_t decode_count;
-    uint32_t backpressure_count;  // times stream buffer was full
-    uint32_t stream_min;
-    uint32_t stream_max;
-    uint32_t stream_partial;     // partial writes to stream buffer
-    uint32_t active_us;          // total time in decode+dsp+write
-} s_sd_diag;
-
 //--------------------------------------------------------------------+
 // Player state
 //--------------------------------------------------------------------+
@@ -113,17 +98,52 @@ static struct {
     player_output_fn output;
     sd_player_audio_cbs_t audio;
 
+    // Decode → ReplayGain → DSP → output ring (owns diagnostics)
+    audio_engine_t  engine;
+
+    // Gapless: next track opened and pre-decoded before EOF
+    struct {
+        codec_handle_t *codec;
+        codec_info_t    info;
+        char            path[320];
+        int             track_index;   // playlist index (-1: from queue_manager)
+        int             shuffle_pos;
+        uint32_t        head_frames;   // pre-decoded frames in head[]
+        bool            tried;         // pre-open attempted for the current track
+    } next;
+    int32_t        *head;              // first block of the next track (int32 stereo)
+    uint32_t        head_pos;          // unplayed part of head[] after handover
+    uint32_t        head_len;
+    bool            handover;          // set by player_pull() when the next track took over
+    uint32_t        handover_frames;   // new track's frames pulled since the handover
+
     // External control (queue_manager)
     bool               single_track_mode;
     sd_player_eof_cb_t eof_cb;
+    sd_player_next_cb_t     next_cb;
+    sd_player_handover_cb_t handover_cb;
 } s_player;
 
+// Pre-open the next track once the current one has this much left (also
+// right away when the length is unknown)
+#define PLAYER_PREOPEN_SECONDS  5
+
 //--------------------------------------------------------------------+
 // Internal helpers
 //--------------------------------------------------------------------+
 
 static void generate_shuffle_map(void);  // forward declaration
 
+static void player_drop_next(void)
+{
+    if (s_player.next.codec) {
+        codec_close(s_player.next.codec);
+        s_player.next.codec = NULL;
+    }
+    s_player.next.head_frames = 0;
+    s_player.next.tried = false;
+}
+
 static void player_close_current(void)
 {
     if (s_player.codec) {
@@ -134,12 +154,195 @@ static void player_close_current(void)
         free(s_player.cue);
         s_player.cue = NULL;
     }
+    player_drop_next();
+    s_player.head_pos = s_player.head_len = 0;
     s_player.cue_track_index = 0;
     s_player.frames_decoded = 0;
 }
 
+// Arm the producer engine for the current file (also resets diagnostics)
+static void player_engine_start(void)
+{
+    const codec_info_t *info = &s_player.current_info;
+    audio_engine_start(&s_player.engine, info->sample_rate, 0);
+    // ReplayGain and DSP are PCM only — DoP frames must reach the DAC untouched
+    audio_engine_set_dsp_bypass(&s_player.engine, info->is_dsd);
+    audio_engine_set_gain_db(&s_player.engine, info->gain_db);
+}
+
+// Make the pre-opened track current: its pre-decoded head plays first
+static void player_promote_next(void)
+{
+    if (s_player.codec) codec_close(s_player.codec);
+    if (s_player.cue) {
+        free(s_player.cue);
+        s_player.cue = NULL;
+    }
+    s_player.cue_track_index = 0;
+
+    s_player.codec        = s_player.next.codec;
+    s_player.current_info = s_player.next.info;
+    strncpy(s_player.current_file, s_player.next.path, sizeof(s_player.current_file) - 1);
+    s_player.current_file[sizeof(s_player.current_file) - 1] = '\0';
+    s_player.frames_decoded = 0;
+    s_player.head_pos = 0;
+    s_player.head_len = s_player.next.head_frames;
+
+    s_player.next.codec = NULL;
+    s_player.next.head_frames = 0;
+    s_player.next.tried = false;
+}
+
+// Next playlist entry without advancing (-1: none / not predictable)
+static int player_peek_next_index(int *shuffle_pos)
+{
+    *shuffle_pos = s_player.shuffle_pos;
+    if (s_player.track_count == 0 || s_player.repeat_mode == REPEAT_ONE) return -1;
+
+    if (s_player.shuffle_enabled) {
+        // Wrapping reshuffles (REPEAT_ALL): the next track is not known yet
+        if (s_player.shuffle_pos + 1 >= s_player.track_count) return -1;
+        *shuffle_pos = s_player.shuffle_pos + 1;
+        return s_player.shuffle_map[*shuffle_pos];
+    }
+    int idx = s_player.track_index + 1;
+    if (idx >= s_player.track_count) {
+        if (s_player.repeat_mode != REPEAT_ALL) return -1;
+        idx = 0;
+    }
+    return idx;
+}
+
+static void player_build_track_path(int index, char *out, size_t out_size);
+
+// Path of the track that follows the current one (queue_manager or playlist)
+static bool player_next_path(char *path, size_t size, int *index, int *shuffle_pos)
+{
+    *index = -1;
+    *shuffle_pos = s_player.shuffle_pos;
+    if (s_player.cue) return false;   // CUE tracks are already gapless
+
+    if (s_player.single_track_mode) {
+        char raw[256];
+        if (!s_player.next_cb || !s_player.next_cb(raw, sizeof(raw))) return false;
+        if (raw[0] == '/') {
+            snprintf(path, size, "%s", raw);
+        } else {
+            snprintf(path, size, "%s/%s", STORAGE_MOUNT_POINT, raw);
+        }
+        return true;
+    }
+
+    *index = player_peek_next_index(shuffle_pos);
+    if (*index < 0) return false;
+    player_build_track_path(*index, path, size);
+    return true;
+}
+
+// Open and pre-decode the next track in the background (called while the
+// output ring is full, so the file open and first decode never starve I2S)
+static void player_preopen_next(void)
+{
+    if (s_player.next.tried || s_player.head_pos < s_player.head_len) return;
+
+    const codec_info_t *info = &s_player.current_info;
+    if (info->total_frames > 0 &&
+        s_player.frames_decoded + (uint64_t)info->sample_rate * PLAYER_PREOPEN_SECONDS
+            < info->total_frames) {
+        return;
+    }
+    s_player.next.tried = true;
+
+    if (!player_next_path(s_player.next.path, sizeof(s_player.next.path),
+                          &s_player.next.track_index, &s_player.next.shuffle_pos)) {
+        return;
+    }
+    if (!s_player.head) {
+        s_player.head = malloc(AUDIO_ENGINE_MAX_FRAMES * 2 * sizeof(int32_t));
+        if (!s_player.head) return;
+    }
+
+    codec_handle_t *c = codec_open(s_player.next.path);
+    if (!c) return;   // Normal advance will report the error
+
+    int32_t n = codec_decode(c, s_player.head, s_player.engine.block_frames);
+    s_player.next.codec = c;
+    s_player.next.info  = *codec_get_info(c);
+    s_player.next.head_frames = (n > 0) ? (uint32_t)n : 0;
+    ESP_LOGI(TAG, "[GAPLESS] Pre-opened next: %s (%lu frames ready)",
+             s_player.next.path, (unsigned long)s_player.next.head_frames);
+}
+
+// At EOF: can the pre-opened track continue the stream without touching
+// I2S or the DSP bypass, and is it still what comes next?
+static bool player_can_splice(void)
+{
+    if (!s_player.next.codec) return false;
+    if (s_player.next.info.sample_rate != s_player.current_info.sample_rate ||
+        s_player.next.info.is_dsd != s_player.current_info.is_dsd) {
+        return false;
+    }
+    if (!s_player.single_track_mode && s_player.repeat_mode == REPEAT_ONE) return false;
+
+    // Queue / shuffle / repeat may have changed since the pre-open
+    char path[320];
+    int index, shuffle_pos;
+    if (!player_next_path(path, sizeof(path), &index, &shuffle_pos) ||
+        strcmp(path, s_player.next.path) != 0) {
+        player_drop_next();
+        return false;
+    }
+    s_player.next.shuffle_pos = shuffle_pos;
+    return true;
+}
+
+// Decoded frames of the current track: pre-decoded head first
+static int32_t player_read(int32_t *out, uint32_t max_frames)
+{
+    if (s_player.head_pos < s_player.head_len) {
+        uint32_t n = s_player.head_len - s_player.head_pos;
+        if (n > max_frames) n = max_frames;
+        memcpy(out, s_player.head + (size_t)s_player.head_pos * 2, (size_t)n * 2 * sizeof(int32_t));
+        s_player.head_pos += n;
+        return (int32_t)n;
+    }
+    return codec_decode(s_player.codec, out, max_frames);
+}
+
+static int32_t player_pull(void *ctx, int32_t *out, uint32_t max_frames)
+{
+    (void)ctx;
+    int32_t n = player_read(out, max_frames);
+    // With the SRC one run pulls several times: count the new track's own
+    if (s_player.handover && n > 0) s_player.handover_frames += (uint32_t)n;
+    if (n != 0 || !player_can_splice()) return n;
+
+    // Sample-accurate handover: the next block starts with the first frame
+    // of the next track, nothing is flushed or reconfigured
+    int track_index = s_player.next.track_index;
+    int shuffle_pos = s_player.next.shuffle_pos;
+    player_promote_next();
+    if (track_index >= 0) {
+        s_player.track_index = track_index;
+        s_player.shuffle_pos = shuffle_pos;
+    }
+    // engine_process() runs after this pull: the new track's first block
+    // already gets its own ReplayGain
+    audio_engine_set_gain_db(&s_player.engine, s_player.current_info.gain_db);
+    s_player.handover = true;
+    n = player_read(out, max_frames);
+    s_player.handover_frames = (n > 0) ? (uint32_t)n : 0;
+    return n;
+}
+
 static bool player_open_file(const char *filepath)
 {
+    // Already opened (and pre-decoded) in the background
+    if (s_player.next.codec && strcmp(s_player.next.path, filepath) == 0) {
+        player_promote_next();
+        return true;
+    }
+
     player_close_current();
 
     s_player.codec = codec_open(filepath);
@@ -308,16 +511,13 @@ static void player_start_playback(const char *filepath)
     ESP_LOGI(TAG, "[PLAY] Starting: %luHz %d-bit %dch → switch to SD source",
              s_player.current_info.sample_rate, s_player.current_info.bits_per_sample,
              s_player.current_info.channels);
+    // Engine first: it decides the output rate (fixed rate mode resamples)
+    player_engine_start();
     s_player.audio.set_producer_handle(s_player.task_handle);
-    s_player.audio.switch_source(SD_AUDIO_SOURCE_SD,
-                                 s_player.current_info.sample_rate, 32);
+    s_player.audio.switch_source(SD_AUDIO_SOURCE_SD, s_player.engine.out_rate, 32);
 
     s_player.state = PLAYER_STATE_PLAYING;
 
-    // Reset diagnostics on new track
-    memset((void *)&s_sd_diag, 0, sizeof(s_sd_diag));
-    s_sd_diag.stream_min = UINT32_MAX;
-
     if (s_player.output) {
         if (cue_mode) {
             cue_track_t *t = &s_player.cue->tracks[0];
@@ -374,8 +574,9 @@ static void player_advance_track(bool forward)
                 uint64_t target = s_player.cue->tracks[s_player.cue_track_index].start_frame;
                 if (codec_seek(s_player.codec, target)) {
                     s_player.frames_decoded = target;
-                    StreamBufferHandle_t stream = s_player.audio.get_stream_buffer();
-                    if (stream) xStreamBufferReset(stream);
+                    s_player.audio.ring_reset();
+                    audio_engine_flush(&s_player.engine);
+                    AUDIO_TRACE_INSTANT(AUDIO_TRACE_SEEK, (uint32_t)target);
                 }
                 return;
             }
@@ -402,15 +603,12 @@ static void player_advance_track(bool forward)
         uint64_t target = s_player.cue->tracks[s_player.cue_track_index].start_frame;
         if (codec_seek(s_player.codec, target)) {
             s_player.frames_decoded = target;
-            StreamBufferHandle_t stream = s_player.audio.get_stream_buffer();
-            if (stream) xStreamBufferReset(stream);
+            s_player.audio.ring_reset();
+            audio_engine_flush(&s_player.engine);
+            AUDIO_TRACE_INSTANT(AUDIO_TRACE_SEEK, (uint32_t)target);
         }
         s_player.track_index = s_player.cue_track_index;
 
-        // Reset diagnostics on track change
-        memset((void *)&s_sd_diag, 0, sizeof(s_sd_diag));
-        s_sd_diag.stream_min = UINT32_MAX;
-
         cue_track_t *t = &s_player.cue->tracks[s_player.cue_track_index];
         if (s_player.output) {
             s_player.output("Track %d/%d: %s\r\n",
@@ -459,6 +657,7 @@ static void player_advance_track(bool forward)
         }
         if (elapsed_ms > 3000 && s_player.track_index >= 0) {
             codec_seek(s_player.codec, 0);
+            audio_engine_flush(&s_player.engine);
             s_player.frames_decoded = 0;
             if (s_player.output) {
                 s_player.output("Restarting track\r\n");
@@ -479,8 +678,6 @@ static void player_advance_track(bool forward)
         }
     }
 
-    player_close_current();
-
     char path[320];
     player_build_track_path(s_player.track_index, path, sizeof(path));
 
@@ -493,15 +690,11 @@ static void player_advance_track(bool forward)
     ESP_LOGI(TAG, "[TRACK] New format: %luHz %d-bit %dch → requesting I2S reconfig",
              s_player.current_info.sample_rate, s_player.current_info.bits_per_sample,
              s_player.current_info.channels);
-    s_player.audio.switch_source(SD_AUDIO_SOURCE_SD,
-                                 s_player.current_info.sample_rate, 32);
+    player_engine_start();
+    s_player.audio.switch_source(SD_AUDIO_SOURCE_SD, s_player.engine.out_rate, 32);
 
     s_player.state = PLAYER_STATE_PLAYING;
 
-    // Reset diagnostics on track change
-    memset((void *)&s_sd_diag, 0, sizeof(s_sd_diag));
-    s_sd_diag.stream_min = UINT32_MAX;
-
     if (s_player.output) {
         s_player.output("Track %d/%d: %s\r\n",
             s_player.track_index + 1, s_player.track_count,
@@ -519,12 +712,15 @@ static void player_process_commands(void)
     while (xQueueReceive(s_player.cmd_queue, &cmd, 0) == pdTRUE) {
         switch (cmd.type) {
             case PLAYER_CMD_PLAY:
+                // Don't let the buffered tail of the previous track play first
+                s_player.audio.ring_reset();
                 player_start_playback(cmd.filepath);
                 break;
 
             case PLAYER_CMD_PAUSE:
                 if (s_player.state == PLAYER_STATE_PLAYING) {
                     s_player.state = PLAYER_STATE_PAUSED;
+                    s_player.audio.ring_hold(true);
                     if (s_player.output) s_player.output("Paused\r\n");
                 }
                 break;
@@ -532,6 +728,7 @@ static void player_process_commands(void)
             case PLAYER_CMD_RESUME:
                 if (s_player.state == PLAYER_STATE_PAUSED) {
                     s_player.state = PLAYER_STATE_PLAYING;
+                    s_player.audio.ring_hold(false);
                     if (s_player.output) s_player.output("Resumed\r\n");
                 }
                 break;
@@ -541,14 +738,17 @@ static void player_process_commands(void)
                 break;
 
             case PLAYER_CMD_NEXT:
+                s_player.audio.ring_reset();
                 player_advance_track(true);
                 break;
 
             case PLAYER_CMD_PREV:
+                s_player.audio.ring_reset();
                 player_advance_track(false);
                 break;
 
             case PLAYER_CMD_SET_SHUFFLE: {
+                player_drop_next();   // next track may change
                 s_player.shuffle_enabled = cmd.shuffle_enabled;
                 if (s_player.shuffle_enabled && s_player.track_count > 0) {
                     generate_shuffle_map();
@@ -559,6 +759,7 @@ static void player_process_commands(void)
             }
 
             case PLAYER_CMD_SET_REPEAT: {
+                player_drop_next();
                 s_player.repeat_mode = (repeat_mode_t)cmd.repeat_mode;
                 const char *rpt_names[] = {"OFF", "ONE", "ALL"};
                 const char *rpt = (cmd.repeat_mode <= 2) ? rpt_names[cmd.repeat_mode] : "?";
@@ -589,8 +790,9 @@ static void player_process_commands(void)
                 }
                 if (codec_seek(s_player.codec, target_frame)) {
                     s_player.frames_decoded = target_frame;
-                    StreamBufferHandle_t stream = s_player.audio.get_stream_buffer();
-                    if (stream) xStreamBufferReset(stream);
+                    s_player.audio.ring_reset();
+                    audio_engine_flush(&s_player.engine);
+                    AUDIO_TRACE_INSTANT(AUDIO_TRACE_SEEK, (uint32_t)target_frame);
                     if (s_player.output) {
                         s_player.output("Seek to %lus\r\n", cmd.seek_seconds);
                     }
@@ -610,7 +812,6 @@ static void player_process_commands(void)
 static void sd_player_task(void *arg)
 {
     (void)arg;
-    static int32_t decode_buf[1024 * 2];  // 1024 stereo frames = 8192 bytes (static to save stack)
     uint32_t last_diag_us = 0;
 
     while (1) {
@@ -629,24 +830,16 @@ static void sd_player_task(void *arg)
             continue;
         }
 
-        // Check stream buffer space before decoding
-        StreamBufferHandle_t stream = s_player.audio.get_stream_buffer();
-        size_t space = xStreamBufferSpacesAvailable(stream);
-        if (space < sizeof(decode_buf)) {
-            s_sd_diag.backpressure_count++;
-            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+        // Decode → ReplayGain → DSP → ring, waits here while the ring is full
+        int32_t frames = audio_engine_run(&s_player.engine, 10);
+        if (frames == AUDIO_ENGINE_FULL) {
+            // Ring is full: good moment to open the next track
+            player_preopen_next();
             continue;
         }
 
-        uint32_t t_loop = (uint32_t)esp_timer_get_time();
-
-        // Decode
-        uint32_t t_decode = t_loop;
-        int32_t frames = codec_decode(s_player.codec, decode_buf, 1024);
-        uint32_t decode_us = (uint32_t)esp_timer_get_time() - t_decode;
-
         if (frames <= 0) {
-            if (frames == 0) {
+            if (frames == AUDIO_ENGINE_EOF) {
                 if (s_player.cue) {
                     // In CUE mode, EOF = end of the entire audio file
                     if (s_player.repeat_mode == REPEAT_ALL) {
@@ -681,59 +874,24 @@ static void sd_player_task(void *arg)
             continue;
         }
 
-        /* Apply ReplayGain (PCM only, not DSD/DoP) */
-        if (!s_player.current_info.is_dsd && s_player.current_info.gain_db != 0.0f) {
-            /*
-             * Fixed-point Q16 gain: precompute once per gain_db value.
-             * gain_q16 = 10^(gain_db/20) * 65536
-             * Multiply each sample by gain_q16 using 64-bit intermediate.
-             */
-            static float   s_last_gain_db = 0.0f;
-            static int32_t s_gain_q16     = 65536;   /* 1.0 in Q16 */
-            if (s_player.current_info.gain_db != s_last_gain_db) {
-                s_last_gain_db = s_player.current_info.gain_db;
-                s_gain_q16 = (int32_t)(powf(10.0f, s_last_gain_db / 20.0f) * 65536.0f);
-            }
-            int32_t *p = decode_buf;
-            int32_t  gq = s_gain_q16;
-            for (int32_t i = 0; i < frames * 2; i++) {
-                int64_t s = ((int64_t)p[i] * gq) >> 16;
-                if      (s >  INT32_MAX) s =  INT32_MAX;
-                else if (s <  INT32_MIN) s =  INT32_MIN;
-                p[i] = (int32_t)s;
+        if (s_player.handover) {
+            // player_pull() spliced the pre-opened track into this block.
+            // in_frames also holds the old track's tail when the SRC ran.
+            s_player.handover = false;
+            s_player.frames_decoded = s_player.handover_frames;
+            ESP_LOGI(TAG, "[GAPLESS] → %s", s_player.current_file);
+
+            if (s_player.single_track_mode) {
+                if (s_player.handover_cb) s_player.handover_cb();
+            } else if (s_player.output) {
+                s_player.output("Track %d/%d: %s\r\n",
+                    s_player.track_index + 1, s_player.track_count,
+                    s_player.track_names[s_player.track_index]);
             }
+        } else {
+            s_player.frames_decoded += s_player.engine.in_frames;
         }
 
-        /* Apply DSP — bypassed for DSD (DoP frames cannot be processed by biquad EQ) */
-        uint32_t t_dsp = (uint32_t)esp_timer_get_time();
-        if (!s_player.current_info.is_dsd) {
-            s_player.audio.process_audio(decode_buf, (uint32_t)frames);
-        }
-        uint32_t dsp_us = (uint32_t)esp_timer_get_time() - t_dsp;
-
-        // Write to stream buffer
-        uint32_t bytes = (uint32_t)frames * 2 * sizeof(int32_t);
-        size_t sent = xStreamBufferSend(stream, decode_buf, bytes, 0);
-        if (sent < bytes) {
-            s_sd_diag.stream_partial++;
-        }
-
-        uint32_t loop_us = (uint32_t)esp_timer_get_time() - t_loop;
-
-        // Update diagnostics
-        if (decode_us > s_sd_diag.decode_max_us) s_sd_diag.decode_max_us = decode_us;
-        if (dsp_us > s_sd_diag.dsp_max_us) s_sd_diag.dsp_max_us = dsp_us;
-        if (loop_us > s_sd_diag.loop_max_us) s_sd_diag.loop_max_us = loop_us;
-        s_sd_diag.decode_count++;
-        s_sd_diag.active_us += loop_us;
-
-        // Track stream buffer fill level
-        size_t stream_used = xStreamBufferBytesAvailable(stream);
-        if (stream_used < s_sd_diag.stream_min) s_sd_diag.stream_min = (uint32_t)stream_used;
-        if (stream_used > s_sd_diag.stream_max) s_sd_diag.stream_max = (uint32_t)stream_used;
-
-        s_player.frames_decoded += frames;
-
         // CUE: gapless track boundary detection (audio keeps flowing!)
         if (s_player.cue) {
             int ci = s_player.cue_track_index;
@@ -765,9 +923,11 @@ static void sd_player_task(void *arg)
         // Diagnostics log every 2 seconds
         uint32_t now_us = (uint32_t)esp_timer_get_time();
         if (now_us - last_diag_us >= 2000000) {
-            if (s_sd_diag.decode_count > 0) {
+            audio_engine_diag_t d;
+            audio_engine_take_diag(&s_player.engine, &d);
+            if (d.blocks > 0) {
                 // Calculate CPU load: active_us / 2000000 * 100
-                uint32_t cpu_pct = s_sd_diag.active_us / 20000;  // /2000000*100
+                uint32_t cpu_pct = d.active_us / 20000;  // /2000000*100
 
                 // Position info
                 uint32_t elapsed_s = 0;
@@ -777,29 +937,13 @@ static void sd_player_task(void *arg)
                 }
 
                 ESP_LOGI(TAG, "[SD DIAG] dec=%luus dsp=%luus loop=%luus | "
-                              "stream min=%lu max=%lu bp=%lu part=%lu | "
+                              "stream min=%lu max=%lu bp=%lu | "
                               "blocks=%lu cpu=%lu%% | pos=%lu/%lus",
-                         s_sd_diag.decode_max_us,
-                         s_sd_diag.dsp_max_us,
-                         s_sd_diag.loop_max_us,
-                         (s_sd_diag.stream_min == UINT32_MAX) ? 0 : s_sd_diag.stream_min,
-                         s_sd_diag.stream_max,
-                         s_sd_diag.backpressure_count,
-                         s_sd_diag.stream_partial,
-                         s_sd_diag.decode_count,
-                         cpu_pct,
+                         d.decode_max_us, d.dsp_max_us, d.loop_max_us,
+                         d.ring_min, d.ring_max, d.backpressure,
+                         d.blocks, cpu_pct,
                          elapsed_s, duration_s);
             }
-            // Reset counters
-            s_sd_diag.decode_max_us = 0;
-            s_sd_diag.dsp_max_us = 0;
-            s_sd_diag.loop_max_us = 0;
-            s_sd_diag.decode_count = 0;
-            s_sd_diag.backpressure_count = 0;
-            s_sd_diag.stream_partial = 0;
-            s_sd_diag.stream_min = UINT32_MAX;
-            s_sd_diag.stream_max = 0;
-            s_sd_diag.active_us = 0;
             last_diag_us = now_us;
         }
     }
@@ -816,6 +960,14 @@ void sd_player_init(player_output_fn output_fn, const sd_player_audio_cbs_t *aud
     s_player.track_index = -1;
     s_player.output = output_fn;
     s_player.audio = *audio_cbs;
+
+    audio_engine_output_t out = {
+        .ring_acquire  = audio_cbs->ring_acquire,
+        .ring_commit   = audio_cbs->ring_commit,
+        .ring_used     = audio_cbs->ring_used,
+        .process_audio = audio_cbs->process_audio,
+    };
+    audio_engine_init(&s_player.engine, player_pull, NULL, &out);
     s_player.cmd_queue = xQueueCreate(4, sizeof(player_cmd_t));
     assert(s_player.cmd_queue);
 
@@ -882,6 +1034,13 @@ repeat_mode_t sd_player_get_repeat(void) { return s_player.repeat_mode; }
 void sd_player_set_eof_callback(sd_player_eof_cb_t cb) { s_player.eof_cb = cb; }
 void sd_player_set_single_track_mode(bool enabled) { s_player.single_track_mode = enabled; }
 
+void sd_player_set_gapless_callbacks(sd_player_next_cb_t next_cb,
+                                     sd_player_handover_cb_t handover_cb)
+{
+    s_player.next_cb = next_cb;
+    s_player.handover_cb = handover_cb;
+}
+
 //--------------------------------------------------------------------+
 // Public API: status queries
 //--------------------------------------------------------------------+
@@ -18,7 +18,7 @@ extern "C" {
 
 typedef struct {
     uint8_t  preset;         ///< eq_preset_t enum value
-    uint8_t  limiter_mode;   ///< dsp_limiter_mode_t: 0=hard_clip, 1=soft
+    uint8_t  limiter_mode;   ///< dsp_limiter_mode_t: 0=hard_clip, 1=soft, 2=lookahead, 3=truepeak
     uint8_t  dsp_enabled;    ///< 0=bypass, 1=enabled
     uint8_t  volume;         ///< 0-100
     uint8_t  shuffle;        ///< 0=off, 1=on
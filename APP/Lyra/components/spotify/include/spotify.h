@@ -5,7 +5,6 @@
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/stream_buffer.h"
 
 //--------------------------------------------------------------------+
 // Spotify Connect via cspot library
@@ -31,7 +30,10 @@ typedef struct {
     int  (*get_source)(void);
     void (*switch_source)(int new_source, uint32_t sample_rate, uint8_t bits);
     void (*set_producer_handle)(TaskHandle_t handle);
-    StreamBufferHandle_t (*get_stream_buffer)(void);
+    int32_t *(*ring_acquire)(uint32_t *max_frames);  // free output block or NULL
+    void (*ring_commit)(uint32_t frames);            // queue it for I2S
+    void (*ring_reset)(void);                        // drop queued audio (seek)
+    void (*ring_hold)(bool hold);                    // keep queued audio while paused
     void (*process_audio)(int32_t *buffer, uint32_t frames);
 } spotify_audio_cbs_t;
 
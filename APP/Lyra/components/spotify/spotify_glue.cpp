@@ -4,7 +4,8 @@
  * Architecture:
  *   Zeroconf: esp_http_server on port 8080, mDNS _spotify-connect._tcp
  *   Session:  cspot LoginBlob → Context → SpircHandler → TrackPlayer
- *   Audio:    int16 PCM 44100 Hz stereo → int32 left-justified → process_audio()
+ *   Audio:    int16 PCM 44100 Hz stereo → int32 left-justified → audio_engine
+ *             (DSP, volume, output ring)
  *
  * All extern "C" API functions for spotify.h are defined here.
  */
@@ -34,8 +35,8 @@ extern "C" {
 #include "mdns.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/stream_buffer.h"
 #include "spotify.h"
+#include "audio_engine.h"
 }
 
 static const char *TAG = "spotify";
@@ -44,6 +45,9 @@ static const char *TAG = "spotify";
 #define AUDIO_SRC_NONE 0
 #define AUDIO_SRC_NET  3
 
+/* cspot always decodes to 44.1 kHz int16 stereo */
+#define SPOTIFY_SAMPLE_RATE 44100
+
 /* ---- Shared state ---- */
 static spotify_audio_cbs_t s_cbs     = {};
 static std::string         s_devname;
@@ -156,6 +160,7 @@ public:
     std::shared_ptr<cspot::SpircHandler> handler;
     std::unique_ptr<bell::CircularBuffer> circ;
     std::atomic<bool> paused{true};
+    std::atomic<bool> restart_engine{false};
 
     LyraSpotifyPlayer(std::shared_ptr<cspot::SpircHandler> h)
         : bell::Task("sp_player", 8 * 1024, -1, 1), handler(h)
@@ -195,21 +200,31 @@ public:
         case ET::PLAY_PAUSE:
             paused   = std::get<bool>(ev->data); /* true=paused */
             s_playing = !paused;
+            /* Freeze the output ring too, otherwise its depth keeps playing */
+            if (s_cbs.ring_hold) s_cbs.ring_hold(paused);
             break;
         case ET::FLUSH:
         case ET::SEEK:
             circ->emptyBuffer();
+            if (s_cbs.ring_reset) s_cbs.ring_reset();
             break;
         case ET::PLAYBACK_START:
             circ->emptyBuffer();
+            if (s_cbs.ring_reset) s_cbs.ring_reset();
+            if (s_cbs.ring_hold)  s_cbs.ring_hold(false);
             paused    = false;
             s_playing = true;
             s_active  = true;
             /* TODO(source-priority): unconditionally takes the source — see net_audio_cb_switch_source
              * in app_main.c for the full TODO on a proper priority/handoff system. */
-            ESP_LOGI(TAG, "PLAYBACK_START — switching to NET source (44100 Hz 32-bit)");
+            /* Re-arm the engine for the current output rate policy; the
+             * task restarts it before the next block */
+            restart_engine = true;
+            ESP_LOGI(TAG, "PLAYBACK_START — switching to NET source (%lu Hz 32-bit)",
+                     (unsigned long)audio_engine_output_rate(SPOTIFY_SAMPLE_RATE, false));
             if (s_cbs.switch_source)
-                s_cbs.switch_source(AUDIO_SRC_NET, 44100, 32);
+                s_cbs.switch_source(AUDIO_SRC_NET,
+                                    audio_engine_output_rate(SPOTIFY_SAMPLE_RATE, false), 32);
             ESP_LOGI(TAG, "Playback started, source = NET");
             break;
         case ET::VOLUME: {
@@ -234,6 +249,25 @@ public:
         }
     }
 
+    /* audio_engine pull callback: int16 PCM from cspot → int32 block */
+    static int32_t pull(void *ctx, int32_t *out, uint32_t max_frames)
+    {
+        auto *self = static_cast<LyraSpotifyPlayer *>(ctx);
+        if (max_frames > IN_FRAMES) max_frames = IN_FRAMES;
+
+        size_t got = self->circ->read(self->in_buf.data(), (size_t)max_frames * 4);
+        size_t stereo_frames = got / 4;
+        if (stereo_frames == 0) return AUDIO_ENGINE_STARVED;
+
+        /* Convert int16 little-endian → int32 left-justified, in the block */
+        const uint8_t *in = self->in_buf.data();
+        for (size_t i = 0; i < stereo_frames * 2; i++) {
+            int16_t s = (int16_t)((uint16_t)in[i * 2] | ((uint16_t)in[i * 2 + 1] << 8));
+            out[i] = (int32_t)s << 16;
+        }
+        return (int32_t)stereo_frames;
+    }
+
     void runTask() override
     {
         /* Register as audio producer so the I2S task can notify us */
@@ -241,65 +275,50 @@ public:
             s_cbs.set_producer_handle(xTaskGetCurrentTaskHandle());
 
         /*
-         * Process in 256-frame chunks (1024 bytes int16 → 2048 bytes int32).
+         * Decode straight into output ring blocks (up to 1152 frames each).
          * Spotify streams: 44100 Hz, 16-bit, stereo.
          * We expand int16 → int32 left-justified (upper 16 bits = sample).
          */
-        constexpr size_t IN_BYTES    = 1024; /* bytes of int16 per chunk    */
-        constexpr size_t OUT_SAMPLES = 512;  /* int32 samples (256 L + 256 R) */
+        in_buf.resize(IN_BYTES);
 
-        std::vector<uint8_t>  in_buf(IN_BYTES);
-        std::vector<int32_t>  out_buf(OUT_SAMPLES);
+        audio_engine_output_t out = {};
+        out.ring_acquire  = s_cbs.ring_acquire;
+        out.ring_commit   = s_cbs.ring_commit;
+        out.process_audio = s_cbs.process_audio;
+        audio_engine_init(&engine, pull, this, &out);
+        audio_engine_start(&engine, SPOTIFY_SAMPLE_RATE, 0);
+
+        bool have_output = s_cbs.ring_acquire && s_cbs.ring_commit && s_cbs.process_audio;
 
         while (true) {
-            if (paused || !s_active) {
+            if (paused || !s_active || !have_output) {
                 vTaskDelay(pdMS_TO_TICKS(50));
                 continue;
             }
 
-            size_t got = circ->read(in_buf.data(), IN_BYTES);
-            if (got == 0) {
-                vTaskDelay(pdMS_TO_TICKS(10));
-                continue;
-            }
-
-            /* Convert int16 little-endian → int32 left-justified */
-            size_t samples = got / 2;
-            for (size_t i = 0; i < samples; i++) {
-                int16_t s = (int16_t)((uint16_t)in_buf[i * 2] |
-                                      ((uint16_t)in_buf[i * 2 + 1] << 8));
-                out_buf[i] = (int32_t)s << 16;
-            }
-
-            size_t stereo_frames = samples / 2;
-            if (stereo_frames == 0) continue;
+            if (restart_engine.exchange(false))
+                audio_engine_start(&engine, SPOTIFY_SAMPLE_RATE, 0);
 
-            /* DSP (EQ etc.) — in-place */
-            if (s_cbs.process_audio)
-                s_cbs.process_audio(out_buf.data(), (uint32_t)stereo_frames);
-
-            /* Software volume scaling (0-65535, 65535 = unity gain).
-             * Integer mul-shift: (sample × vol) >> 16.  Applied after DSP so
-             * EQ filters operate at full precision regardless of volume setting. */
-            int vol = s_volume.load();
-            if (vol < 65535) {
-                for (size_t i = 0; i < samples; i++)
-                    out_buf[i] = (int32_t)(((int64_t)out_buf[i] * vol) >> 16);
-            }
+            /* Software volume (0-65535, 65535 = unity) — the engine applies
+             * it after DSP so EQ filters operate at full precision */
+            audio_engine_set_volume(&engine, (uint16_t)s_volume.load());
 
-            /* Write to StreamBuffer — consumed by i2s_feeder_task.
-             * portMAX_DELAY: block until space is available instead of spinning.
-             * This is the natural yield point: when the StreamBuffer is full the
-             * task suspends, allowing IDLE and lower-priority tasks to run. */
-            if (s_cbs.get_stream_buffer) {
-                StreamBufferHandle_t sb = s_cbs.get_stream_buffer();
-                if (sb) {
-                    size_t byte_count = stereo_frames * 2 * sizeof(int32_t);
-                    xStreamBufferSend(sb, out_buf.data(), byte_count, portMAX_DELAY);
-                }
+            /* Waiting for a free block is the natural yield point: when the
+             * ring is full the task suspends, allowing IDLE and lower-priority
+             * tasks to run. */
+            int32_t frames = audio_engine_run(&engine, 10);
+            if (frames == AUDIO_ENGINE_STARVED) {
+                vTaskDelay(pdMS_TO_TICKS(10));
             }
         }
     }
+
+private:
+    static constexpr size_t IN_FRAMES = 1152;          /* int16 stereo frames per chunk */
+    static constexpr size_t IN_BYTES  = IN_FRAMES * 4;
+
+    std::vector<uint8_t> in_buf;
+    audio_engine_t       engine = {};
 };
 
 /* ==================================================================
@@ -43,6 +43,9 @@ typedef struct {
     bool     is_dsd;                /* true if DSD/DoP (affects display) */
     ui_playback_state_t state;
     ui_audio_source_t   source;
+    uint8_t  buffer_pct;            /* Jitter buffer fill, % of depth */
+    uint16_t buffer_ms;             /* Jitter buffer fill in ms */
+    bool     buffering;             /* Prefilling before playback starts */
 } ui_now_playing_t;
 
 /* -----------------------------------------------------------------------
@@ -78,6 +81,7 @@ typedef struct {
     bool     bt_connected;
     const char *dsp_preset;         /* "Rock", "Flat", "Jazz", etc. */
     bool     dsp_enabled;
+    uint8_t  dsp_quality;           /* 0 = full; 1–3 = reduced under CPU load */
     int8_t   eq_bands[UI_EQ_BANDS]; /* Per-band gain: -12 to +12 dB */
 } ui_system_status_t;
 
@@ -197,6 +201,22 @@ typedef struct {
     float    level_db_r;        /* Right channel dBFS */
 } ui_usb_dac_data_t;
 
+/* -----------------------------------------------------------------------
+ * Output Meters (spectrum and levels after the DSP)
+ * ----------------------------------------------------------------------- */
+
+#define UI_METER_BANDS  24      /* Log-spaced, 20 Hz - 20 kHz */
+
+typedef struct {
+    bool     valid;                     /* false until audio has been analysed */
+    bool     spectrum_valid;            /* band_db is live */
+    bool     clip;                      /* Full scale reached in the last 1.5 s */
+    float    peak_db[2];                /* L/R sample peak, dBFS */
+    float    rms_db[2];                 /* L/R RMS, dBFS */
+    float    true_peak_db[2];           /* L/R inter-sample peak, dBTP */
+    float    band_db[UI_METER_BANDS];   /* Band level, dBFS */
+} ui_meters_data_t;
+
 /* -----------------------------------------------------------------------
  * Playback Queue
  * ----------------------------------------------------------------------- */
@@ -249,6 +269,8 @@ typedef struct {
     /* System */
     uint32_t uptime_seconds;
     int8_t   cpu_temp_c;            /* -128 if unavailable */
+    uint8_t  dsp_load_pct;          /* Measured DSP p99, % of the per-sample budget */
+    uint8_t  dsp_load_max_pct;      /* Measured DSP worst block, same scale */
     char     audio_source[16];      /* "SD Card" etc. */
 } ui_device_info_t;
 
@@ -396,6 +418,7 @@ ui_browser_data_t   ui_data_get_browser(void);
 ui_wifi_scan_data_t ui_data_get_wifi_scan(void);
 ui_net_audio_data_t ui_data_get_net_audio(void);
 ui_usb_dac_data_t    ui_data_get_usb_dac(void);
+ui_meters_data_t     ui_data_get_meters(void);   /* Polling keeps the FFT running: only while shown */
 ui_eq_presets_data_t ui_data_get_eq_presets(void);
 ui_queue_data_t      ui_data_get_queue(void);
 ui_device_info_t     ui_data_get_device_info(void);
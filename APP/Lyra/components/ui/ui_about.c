@@ -41,6 +41,7 @@ static lv_obj_t *lbl_current_file;
 static lv_obj_t *lbl_ip_address;
 static lv_obj_t *lbl_uptime;
 static lv_obj_t *lbl_cpu_temp;
+static lv_obj_t *lbl_dsp_load;
 static lv_obj_t *lbl_audio_source;
 
 /* -----------------------------------------------------------------------
@@ -227,6 +228,7 @@ lv_obj_t *ui_about_create(void)
     create_divider(content);
     lbl_uptime       = create_info_row(content, "Uptime", "0h 0m 0s");
     lbl_cpu_temp     = create_info_row(content, "Temperature", "47 C");
+    lbl_dsp_load     = create_info_row(content, "DSP Load", "---");
     lbl_audio_source = create_info_row(content, "Audio Source", "SD Card");
 
     return scr_about;
@@ -277,6 +279,11 @@ void ui_about_update(const ui_device_info_t *info)
         lv_snprintf(buf, sizeof(buf), "N/A");
     lv_label_set_text(lbl_cpu_temp, buf);
 
+    /* DSP load (measured p99 / worst block) */
+    lv_snprintf(buf, sizeof(buf), "%d%% (peak %d%%)",
+                info->dsp_load_pct, info->dsp_load_max_pct);
+    lv_label_set_text(lbl_dsp_load, buf);
+
     /* Audio source */
     lv_label_set_text(lbl_audio_source, info->audio_source);
 }
@@ -111,9 +111,14 @@ void ui_update(void)
     ui_system_status_t sys = ui_data_get_system_status();
 
     switch (s_current) {
-        case UI_SCREEN_NOW_PLAYING:
+        case UI_SCREEN_NOW_PLAYING: {
+            /* Only read here: while locked or on another screen the
+             * analysis drops the FFT and slows down */
+            ui_meters_data_t meters = ui_data_get_meters();
             ui_now_playing_update(&np, &sys);
+            ui_now_playing_update_meters(&meters);
             break;
+        }
         case UI_SCREEN_BROWSER: {
             ui_browser_data_t br = ui_data_get_browser();
             ui_browser_update(&br);
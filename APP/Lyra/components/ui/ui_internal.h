@@ -59,6 +59,7 @@ lv_color_t  ui_theme_color_dsd_badge(void);
 lv_obj_t *ui_now_playing_create(void);
 void      ui_now_playing_update(const ui_now_playing_t *np,
                                  const ui_system_status_t *sys);
+void      ui_now_playing_update_meters(const ui_meters_data_t *meters);
 
 /* -----------------------------------------------------------------------
  * File Browser screen (ui_browser.c)
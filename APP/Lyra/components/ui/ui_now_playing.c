@@ -82,6 +82,12 @@ static lv_obj_t *lbl_dsp_status;
 /* Queue button */
 static lv_obj_t *btn_queue;
 
+/* Output meters: spectrum after the DSP + L/R peak */
+#define METER_H         64      /* Height of the spectrum and level bars */
+#define METER_RANGE_DB  60      /* Bottom of the scale, dBFS */
+static lv_obj_t *spectrum_bars[UI_METER_BANDS];
+static lv_obj_t *level_bars[2];
+
 /* EQ visualizer */
 static lv_obj_t *eq_bars[UI_EQ_BANDS];
 
@@ -719,6 +725,46 @@ lv_obj_t *ui_now_playing_create(void)
     lv_label_set_text(lbl_vol_value, "75%");
     lv_obj_set_width(lbl_vol_value, 48);
 
+    /* ==================================================================
+     * OUTPUT METERS (spectrum bars + L/R peak, refreshed by ui_update)
+     * ================================================================== */
+    lv_obj_t *meter_row = create_row(main, CONTENT_W, METER_H);
+    lv_obj_set_style_margin_top(meter_row, 16, 0);
+    lv_obj_set_style_pad_gap(meter_row, 12, 0);
+    lv_obj_clear_flag(meter_row, LV_OBJ_FLAG_CLICKABLE);
+
+    lv_obj_t *spectrum = lv_obj_create(meter_row);
+    lv_obj_remove_style_all(spectrum);
+    lv_obj_set_height(spectrum, METER_H);
+    lv_obj_set_flex_grow(spectrum, 1);
+    lv_obj_set_flex_flow(spectrum, LV_FLEX_FLOW_ROW);
+    lv_obj_set_flex_align(spectrum, LV_FLEX_ALIGN_SPACE_BETWEEN,
+                          LV_FLEX_ALIGN_END, LV_FLEX_ALIGN_END);
+    lv_obj_set_scrollbar_mode(spectrum, LV_SCROLLBAR_MODE_OFF);
+    lv_obj_clear_flag(spectrum, LV_OBJ_FLAG_CLICKABLE);
+
+    /* One bar per band, bottom-aligned by the flex row */
+    for (int i = 0; i < UI_METER_BANDS; i++) {
+        spectrum_bars[i] = lv_obj_create(spectrum);
+        lv_obj_remove_style_all(spectrum_bars[i]);
+        lv_obj_add_style(spectrum_bars[i], ui_theme_style_eq_bar(), 0);
+        lv_obj_set_size(spectrum_bars[i], 14, 2);
+        lv_obj_clear_flag(spectrum_bars[i], LV_OBJ_FLAG_CLICKABLE);
+    }
+
+    for (int ch = 0; ch < 2; ch++) {
+        level_bars[ch] = lv_bar_create(meter_row);
+        lv_obj_set_size(level_bars[ch], 10, METER_H);
+        lv_bar_set_range(level_bars[ch], -METER_RANGE_DB, 0);
+        lv_bar_set_value(level_bars[ch], -METER_RANGE_DB, LV_ANIM_OFF);
+        lv_obj_set_style_bg_color(level_bars[ch], ui_theme_color_slider_track(), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(level_bars[ch], LV_OPA_COVER, LV_PART_MAIN);
+        lv_obj_set_style_radius(level_bars[ch], 3, LV_PART_MAIN);
+        lv_obj_set_style_bg_color(level_bars[ch], lv_color_hex(0x4CAF50), LV_PART_INDICATOR);
+        lv_obj_set_style_bg_opa(level_bars[ch], LV_OPA_COVER, LV_PART_INDICATOR);
+        lv_obj_set_style_radius(level_bars[ch], 3, LV_PART_INDICATOR);
+    }
+
     /* ==================================================================
      * EQ CARD (tappable card: header + bars + presets → opens EQ screen)
      * ================================================================== */
@@ -1026,7 +1072,9 @@ void ui_now_playing_update(const ui_now_playing_t *np,
 
     /* -- DSP -- */
     char dsp_buf[48];
-    if (sys->dsp_enabled && sys->dsp_preset)
+    if (sys->dsp_enabled && sys->dsp_preset && sys->dsp_quality)
+        lv_snprintf(dsp_buf, sizeof(dsp_buf), "DSP: %s (reduced)", sys->dsp_preset);
+    else if (sys->dsp_enabled && sys->dsp_preset)
         lv_snprintf(dsp_buf, sizeof(dsp_buf), "DSP: %s", sys->dsp_preset);
     else
         lv_snprintf(dsp_buf, sizeof(dsp_buf), "DSP: Off");
@@ -1074,3 +1122,32 @@ void ui_now_playing_update(const ui_now_playing_t *np,
             lv_obj_clear_state(preset_btns[i], LV_STATE_CHECKED);
     }
 }
+
+void ui_now_playing_update_meters(const ui_meters_data_t *meters)
+{
+    if (!scr_now_playing) return;
+
+    /* -- Spectrum: flat at the bottom until the FFT is live -- */
+    for (int i = 0; i < UI_METER_BANDS; i++) {
+        float db = (meters->valid && meters->spectrum_valid) ? meters->band_db[i]
+                                                             : -METER_RANGE_DB;
+        if (db < -METER_RANGE_DB) db = -METER_RANGE_DB;
+        if (db > 0) db = 0;
+        int32_t h = (int32_t)((db + METER_RANGE_DB) * METER_H / METER_RANGE_DB);
+        if (h < 2) h = 2;
+        lv_obj_set_height(spectrum_bars[i], h);
+    }
+
+    /* -- Peak bars: green, amber > -12, red > -3 or on a clip -- */
+    for (int ch = 0; ch < 2; ch++) {
+        int32_t val = meters->valid ? (int32_t)meters->peak_db[ch] : -METER_RANGE_DB;
+        if (val < -METER_RANGE_DB) val = -METER_RANGE_DB;
+        if (val > 0) val = 0;
+        lv_bar_set_value(level_bars[ch], val, LV_ANIM_OFF);
+
+        lv_color_t col = lv_color_hex(0x4CAF50);
+        if (val > -3 || meters->clip) col = lv_color_hex(0xFF5252);
+        else if (val > -12) col = lv_color_hex(0xFFA726);
+        lv_obj_set_style_bg_color(level_bars[ch], col, LV_PART_INDICATOR);
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ * codec_stubs.c — decoder entry points for the host DSP library.
+ *
+ * dsp_conv.c loads impulse responses through codec_open(); the host
+ * tests hand the convolver coefficients directly, so no file opens.
+ */
+
+#include "audio_codecs.h"
+#include <stddef.h>
+
+codec_handle_t *codec_open(const char *filepath)
+{
+    (void)filepath;
+    return NULL;
+}
+
+int32_t codec_decode(codec_handle_t *handle, int32_t *buffer, uint32_t max_frames)
+{
+    (void)handle;
+    (void)buffer;
+    (void)max_frames;
+    return -1;
+}
+
+const codec_info_t *codec_get_info(const codec_handle_t *handle)
+{
+    (void)handle;
+    return NULL;
+}
+
+void codec_close(codec_handle_t *handle)
+{
+    (void)handle;
+}
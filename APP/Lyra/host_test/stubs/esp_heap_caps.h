@@ -0,0 +1,38 @@
+/*
+ * esp_heap_caps.h — host stub: every capability is plain malloc.
+ */
+
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_SPIRAM   (1u << 10)
+#define MALLOC_CAP_INTERNAL (1u << 11)
+#define MALLOC_CAP_8BIT     (1u << 2)
+#define MALLOC_CAP_DMA      (1u << 3)
+
+static inline void *heap_caps_malloc(size_t size, unsigned caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+static inline void *heap_caps_calloc(size_t n, size_t size, unsigned caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+static inline void *heap_caps_aligned_alloc(size_t align, size_t size, unsigned caps)
+{
+    (void)caps;
+    return aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+static inline void heap_caps_free(void *p)
+{
+    free(p);
+}
+
+#endif // HOST_ESP_HEAP_CAPS_H
@@ -0,0 +1,30 @@
+/*
+ * esp_log.h — host stub for the DSP test harnesses.
+ *
+ * Warnings and errors go to stderr, info and below are dropped so the
+ * test output stays readable.
+ */
+
+#ifndef HOST_ESP_LOG_H
+#define HOST_ESP_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "[E][%s] " fmt "\n", (tag), ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "[W][%s] " fmt "\n", (tag), ##__VA_ARGS__)
+#define ESP_LOG_DROP(tag, fmt, ...) \
+    do { if (0) fprintf(stderr, "%s" fmt, (tag), ##__VA_ARGS__); } while (0)
+#define ESP_LOGI(tag, fmt, ...) ESP_LOG_DROP(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_LOG_DROP(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) ESP_LOG_DROP(tag, fmt, ##__VA_ARGS__)
+
+static inline uint32_t esp_log_timestamp(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+}
+
+#endif // HOST_ESP_LOG_H
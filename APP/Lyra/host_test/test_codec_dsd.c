@@ -0,0 +1,389 @@
+/*
+ * test_codec_dsd.c — DoP output of codec_dsd against the reference packer.
+ *
+ * The reference is the decoder as it was before word-at-a-time packing:
+ * fread() of each [L block][R block] pair into its own buffers (DSF) or
+ * of 512-byte batches (DFF), one byte pair per DoP word, marker toggled
+ * per frame. It stops at the end of the data chunk (the old one also
+ * played a trailing DSF metadata chunk as audio).
+ *
+ * Synthetic DSF and DFF files at DSD64 and DSD256, including a DSF with
+ * a partial last block and metadata after the data, are decoded by both
+ * with random decode sizes and random seeks; every call must return the
+ * same frames, bit for bit. A timing run then decodes each file whole.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "audio_codecs_internal.h"
+#include "dsp_prof.h"
+#include "test_util.h"
+
+#define DSF_BLOCK     4096u
+#define MAX_DECODE    5000u
+#define RANDOM_OPS    4000u
+#define DOP_MARKER_A  0x05u
+#define DOP_MARKER_B  0xFAu
+
+typedef struct {
+    const char *name;
+    bool        dff;
+    uint32_t    dsd_rate;
+    uint32_t    ms;             // length
+    uint32_t    cut;            // DSF: bytes missing from the last block pair
+    uint32_t    meta;           // DSF: metadata bytes after the data chunk
+} dsd_case_t;
+
+static const dsd_case_t s_cases[] = {
+    { "DSF DSD64",          false,  2822400, 1500, 0,     0    },
+    { "DSF DSD64 cut+meta", false,  2822400, 1500, 5000,  1200 },
+    { "DSF DSD256",         false, 11289600, 1000, 0,     300  },
+    { "DFF DSD64",          true,   2822400, 1500, 0,     0    },
+    { "DFF DSD256 odd end", true,  11289600, 1000, 2,     0    },
+};
+
+//--------------------------------------------------------------------+
+// File writers
+//--------------------------------------------------------------------+
+
+static void put_le(FILE *f, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++) fputc((int)((v >> (8 * i)) & 0xFF), f);
+}
+
+static void put_be(FILE *f, uint64_t v, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; i--) fputc((int)((v >> (8 * i)) & 0xFF), f);
+}
+
+static void put_random(FILE *f, uint64_t bytes, uint32_t *seed)
+{
+    for (uint64_t i = 0; i < bytes; i++) fputc((int)(test_rand(seed) >> 24), f);
+}
+
+static bool write_dsf(const char *path, const dsd_case_t *c, uint32_t seed)
+{
+    const uint64_t samples = (uint64_t)c->dsd_rate * c->ms / 1000;
+    const uint64_t pairs = (samples / 8 + DSF_BLOCK - 1) / DSF_BLOCK;
+    const uint64_t data = pairs * 2 * DSF_BLOCK - c->cut;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    fwrite("DSD ", 1, 4, f);
+    put_le(f, 28, 8);
+    put_le(f, 28 + 52 + 12 + data + c->meta, 8);
+    put_le(f, c->meta ? 28 + 52 + 12 + data : 0, 8);
+    fwrite("fmt ", 1, 4, f);
+    put_le(f, 52, 8);
+    put_le(f, 1, 4);                // version
+    put_le(f, 0, 4);                // DSD raw
+    put_le(f, 2, 4);                // stereo
+    put_le(f, 2, 4);
+    put_le(f, c->dsd_rate, 4);
+    put_le(f, 1, 4);                // LSB first
+    put_le(f, samples, 8);
+    put_le(f, DSF_BLOCK, 4);
+    put_le(f, 0, 4);
+    fwrite("data", 1, 4, f);
+    put_le(f, 12 + data, 8);
+    put_random(f, data, &seed);
+    if (c->meta) {
+        fwrite("ID3", 1, 3, f);
+        for (uint32_t i = 3; i < c->meta; i++) fputc(0xEE, f);
+    }
+    return fclose(f) == 0;
+}
+
+static bool write_dff(const char *path, const dsd_case_t *c, uint32_t seed)
+{
+    const uint64_t data = (uint64_t)c->dsd_rate * c->ms / 1000 / 8 * 2 + c->cut;
+    const uint64_t prop = 4 + (12 + 4) + (12 + 2 + 8);
+    const uint64_t body = 4 + (12 + 4) + (12 + prop) + (12 + data);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    fwrite("FRM8", 1, 4, f);
+    put_be(f, body, 8);
+    fwrite("DSD ", 1, 4, f);
+    fwrite("FVER", 1, 4, f);
+    put_be(f, 4, 8);
+    put_be(f, 0x01050000, 4);
+    fwrite("PROP", 1, 4, f);
+    put_be(f, prop, 8);
+    fwrite("SND ", 1, 4, f);
+    fwrite("FS  ", 1, 4, f);
+    put_be(f, 4, 8);
+    put_be(f, c->dsd_rate, 4);
+    fwrite("CHNL", 1, 4, f);
+    put_be(f, 2 + 8, 8);
+    put_be(f, 2, 2);
+    fwrite("SLFTSRGT", 1, 8, f);
+    fwrite("DSD ", 1, 4, f);
+    put_be(f, data, 8);
+    put_random(f, data, &seed);
+    return fclose(f) == 0;
+}
+
+//--------------------------------------------------------------------+
+// Reference decoder (byte-at-a-time packer)
+//--------------------------------------------------------------------+
+
+typedef struct {
+    FILE    *f;
+    bool     dff;
+    uint64_t data_offset, data_end, pos;
+    uint32_t block_size;
+    uint8_t *blk_l, *blk_r;
+    uint32_t blk_frames, blk_frame_pos;
+    uint8_t  marker;
+} ref_dsd_t;
+
+static size_t ref_read(ref_dsd_t *r, void *dst, size_t size, size_t count)
+{
+    const uint64_t left = (r->data_end > r->pos) ? r->data_end - r->pos : 0;
+    if ((uint64_t)size * count > left) count = (size_t)(left / size);
+    const size_t n = fread(dst, size, count, r->f);
+    r->pos += (uint64_t)n * size;
+    return n;
+}
+
+static bool ref_load_next_block(ref_dsd_t *r)
+{
+    size_t n_l = ref_read(r, r->blk_l, 1, r->block_size);
+    if (n_l == 0) return false;
+    size_t n_r = ref_read(r, r->blk_r, 1, r->block_size);
+    if (n_l < r->block_size) memset(r->blk_l + n_l, 0x69, r->block_size - n_l);
+    if (n_r < r->block_size) memset(r->blk_r + n_r, 0x69, r->block_size - n_r);
+    r->blk_frames = (uint32_t)(n_l / 2);
+    r->blk_frame_pos = 0;
+    return r->blk_frames > 0;
+}
+
+static int32_t ref_decode(ref_dsd_t *r, int32_t *buf, uint32_t max_frames)
+{
+    uint32_t out = 0;
+
+    if (r->dff) {
+        uint8_t raw[512];
+        while (out < max_frames) {
+            uint32_t batch = max_frames - out;
+            if (batch > 128) batch = 128;
+            size_t n = ref_read(r, raw, 4, batch);
+            if (n == 0) break;
+            uint8_t mk = r->marker;
+            for (size_t i = 0; i < n; i++) {
+                const uint8_t *p = raw + i * 4;
+                buf[out * 2]     = (int32_t)(((uint32_t)mk << 16) | ((uint32_t)p[2] << 8) | p[0]);
+                buf[out * 2 + 1] = (int32_t)(((uint32_t)mk << 16) | ((uint32_t)p[3] << 8) | p[1]);
+                mk = (mk == DOP_MARKER_A) ? DOP_MARKER_B : DOP_MARKER_A;
+                out++;
+            }
+            r->marker = mk;
+        }
+        return (int32_t)out;
+    }
+
+    while (out < max_frames) {
+        if (r->blk_frame_pos >= r->blk_frames) {
+            if (!ref_load_next_block(r)) break;
+        }
+        uint32_t avail = r->blk_frames - r->blk_frame_pos;
+        uint32_t emit = (avail < max_frames - out) ? avail : max_frames - out;
+        uint32_t pos = r->blk_frame_pos;
+        uint8_t mk = r->marker;
+        for (uint32_t i = 0; i < emit; i++, pos++) {
+            const uint32_t bi = pos * 2;
+            buf[out * 2]     = (int32_t)(((uint32_t)mk << 16) | ((uint32_t)r->blk_l[bi + 1] << 8) |
+                                         r->blk_l[bi]);
+            buf[out * 2 + 1] = (int32_t)(((uint32_t)mk << 16) | ((uint32_t)r->blk_r[bi + 1] << 8) |
+                                         r->blk_r[bi]);
+            mk = (mk == DOP_MARKER_A) ? DOP_MARKER_B : DOP_MARKER_A;
+            out++;
+        }
+        r->blk_frame_pos = pos;
+        r->marker = mk;
+    }
+    return (int32_t)out;
+}
+
+static bool ref_seek(ref_dsd_t *r, uint64_t frame_pos)
+{
+    r->marker = DOP_MARKER_A;
+    if (r->dff) {
+        r->pos = r->data_offset + frame_pos * 4;
+        return fseek(r->f, (long)r->pos, SEEK_SET) == 0;
+    }
+    const uint32_t full = r->block_size / 2;
+    r->pos = r->data_offset + frame_pos / full * (uint64_t)r->block_size * 2;
+    if (fseek(r->f, (long)r->pos, SEEK_SET) != 0) return false;
+    r->blk_frames = 0;
+    if (!ref_load_next_block(r)) return false;
+    r->blk_frame_pos = (uint32_t)(frame_pos % full);
+    return true;
+}
+
+// Data chunk bounds from the container the case wrote
+static bool ref_open(ref_dsd_t *r, const char *path, const dsd_case_t *c)
+{
+    memset(r, 0, sizeof(*r));
+    r->f = fopen(path, "rb");
+    if (!r->f) return false;
+    r->dff = c->dff;
+    r->marker = DOP_MARKER_A;
+    if (c->dff) {
+        r->data_offset = 12 + 4 + (12 + 4) + (12 + 4 + (12 + 4) + (12 + 2 + 8)) + 12;
+        fseek(r->f, (long)r->data_offset - 8, SEEK_SET);
+        uint8_t sz[8];
+        if (fread(sz, 1, 8, r->f) != 8) return false;
+        uint64_t size = 0;
+        for (int i = 0; i < 8; i++) size = (size << 8) | sz[i];
+        r->data_end = r->data_offset + size;
+    } else {
+        r->data_offset = 28 + 52 + 12;
+        fseek(r->f, r->data_offset - 8, SEEK_SET);
+        uint8_t sz[8];
+        if (fread(sz, 1, 8, r->f) != 8) return false;
+        uint64_t size = 0;
+        for (int i = 7; i >= 0; i--) size = (size << 8) | sz[i];
+        r->data_end = r->data_offset + size - 12;
+        r->block_size = DSF_BLOCK;
+        r->blk_l = malloc(DSF_BLOCK);
+        r->blk_r = malloc(DSF_BLOCK);
+        r->blk_frames = r->blk_frame_pos = DSF_BLOCK / 2;
+    }
+    r->pos = r->data_offset;
+    return fseek(r->f, (long)r->data_offset, SEEK_SET) == 0;
+}
+
+static void ref_close(ref_dsd_t *r)
+{
+    if (r->f) fclose(r->f);
+    free(r->blk_l);
+    free(r->blk_r);
+}
+
+//--------------------------------------------------------------------+
+// Codec under test
+//--------------------------------------------------------------------+
+
+static bool dut_open(codec_handle_t *h, const char *path)
+{
+    memset(h, 0, sizeof(*h));
+    h->path = path;
+    h->file = fopen(path, "rb");
+    if (!h->file) return false;
+    if (!codec_dsd_open(h)) {
+        fclose(h->file);
+        return false;
+    }
+    return true;
+}
+
+static void dut_close(codec_handle_t *h)
+{
+    h->vt->close(h);
+    fclose(h->file);
+}
+
+//--------------------------------------------------------------------+
+// Runs
+//--------------------------------------------------------------------+
+
+static void compare(const dsd_case_t *c, const char *path, uint32_t seed)
+{
+    codec_handle_t h;
+    ref_dsd_t r;
+    if (!dut_open(&h, path) || !ref_open(&r, path, c)) {
+        CHECK(false, "%s: open failed", c->name);
+        return;
+    }
+
+    int32_t *got = malloc(sizeof(int32_t) * 2 * MAX_DECODE);
+    int32_t *want = malloc(sizeof(int32_t) * 2 * MAX_DECODE);
+    const uint64_t total = h.info.total_frames;
+    uint64_t frames = 0;
+    uint32_t seeks = 0, bad = 0;
+
+    for (uint32_t op = 0; op < RANDOM_OPS && !bad; op++) {
+        if (test_rand(&seed) % 16 == 0) {
+            const uint64_t to = (uint64_t)test_rand(&seed) % (total + 1);
+            const bool a = h.vt->seek(&h, to);
+            const bool b = ref_seek(&r, to);
+            CHECK(a == b, "%s: seek to %llu: %d vs reference %d", c->name,
+                  (unsigned long long)to, a, b);
+            seeks++;
+            continue;
+        }
+        const uint32_t n = test_rand_range(&seed, 1, MAX_DECODE);
+        const int32_t a = h.vt->decode(&h, got, n);
+        const int32_t b = ref_decode(&r, want, n);
+        if (a != b || (a > 0 && memcmp(got, want, sizeof(int32_t) * 2 * (size_t)a) != 0)) {
+            CHECK(false, "%s: decode of %u after %llu frames: %d frames vs reference %d%s",
+                  c->name, n, (unsigned long long)frames, a, b, a == b ? ", words differ" : "");
+            bad++;
+        }
+        if (a > 0) frames += (uint64_t)a;
+    }
+    printf("  %-20s %8llu frames, %3u seeks: %s\n", c->name, (unsigned long long)frames, seeks,
+           bad ? "DIFFERENT" : "identical");
+
+    free(got);
+    free(want);
+    dut_close(&h);
+    ref_close(&r);
+}
+
+static void bench(const dsd_case_t *c, const char *path)
+{
+    enum { CALL = 4096 };
+    int32_t *buf = malloc(sizeof(int32_t) * 2 * CALL);
+    codec_handle_t h;
+    ref_dsd_t r;
+    if (!buf || !dut_open(&h, path) || !ref_open(&r, path, c)) {
+        free(buf);
+        return;
+    }
+
+    uint64_t frames = 0;
+    int32_t n;
+    uint32_t t = dsp_prof_now();
+    while ((n = h.vt->decode(&h, buf, CALL)) > 0) frames += (uint64_t)n;
+    const uint32_t new_cyc = dsp_prof_now() - t;
+
+    t = dsp_prof_now();
+    while (ref_decode(&r, buf, CALL) > 0) {}
+    const uint32_t old_cyc = dsp_prof_now() - t;
+
+    printf("  %-20s reference %6.2f ms  codec %6.2f ms  (%.1f -> %.1f cyc/frame)\n", c->name,
+           old_cyc / (DSP_PROF_CPU_MHZ * 1000.0), new_cyc / (DSP_PROF_CPU_MHZ * 1000.0),
+           (double)old_cyc / frames, (double)new_cyc / frames);
+
+    dut_close(&h);
+    ref_close(&r);
+    free(buf);
+}
+
+int main(void)
+{
+    char paths[sizeof(s_cases) / sizeof(s_cases[0])][64];
+
+    for (size_t i = 0; i < sizeof(s_cases) / sizeof(s_cases[0]); i++) {
+        const dsd_case_t *c = &s_cases[i];
+        snprintf(paths[i], sizeof(paths[i]), "test_codec_dsd_%d_%zu.%s", (int)getpid(), i,
+                 c->dff ? "dff" : "dsf");
+        const bool ok = c->dff ? write_dff(paths[i], c, 0xD5D0u + (uint32_t)i)
+                               : write_dsf(paths[i], c, 0xD5D0u + (uint32_t)i);
+        CHECK(ok, "%s: cannot write %s", c->name, paths[i]);
+        if (ok) compare(c, paths[i], 0x5EEDu + (uint32_t)i);
+    }
+
+    printf("Timing, whole file in %u-frame calls (host, %u MHz equivalent):\n", 4096u,
+           DSP_PROF_CPU_MHZ);
+    for (size_t i = 0; i < sizeof(s_cases) / sizeof(s_cases[0]); i++) {
+        bench(&s_cases[i], paths[i]);
+        remove(paths[i]);
+    }
+
+    return test_result("codec_dsd");
+}
@@ -0,0 +1,233 @@
+/*
+ * test_dsp_biquad_q31.c — float vs Q31 biquad kernels: noise and cost.
+ *
+ * Each section runs on both kernels over the same int32 programme and
+ * is compared with a double-precision DF-I using that kernel's own
+ * (rounded) coefficients, so only the arithmetic noise is measured. The
+ * sections span the pole margins the chain hands to the Q31 kernel (low
+ * corners at high rates) and a few where float is already fine.
+ *
+ * The Q31 cascade runs with the chain's DSP_Q31_HEADROOM, taking the
+ * full input word. A quiet pass compares it with the input pre-shifted
+ * by the headroom (x >> headroom): on sections whose own noise gain is
+ * small the dropped bits are a noise source of the same size as the
+ * output rounding, plus a DC offset.
+ *
+ * Then a timing run: cycles per section and sample for both kernels
+ * (host clock scaled to DSP_PROF_CPU_MHZ), next to the budget model in
+ * dsp_chain.c. Target figures come from `dsp bench`.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "dsp_biquad.h"
+#include "dsp_chain.h"
+#include "dsp_prof.h"
+#include "test_util.h"
+
+#define FRAMES        (1u << 16)
+#define SKIP          8192          // settling, excluded from the SNR
+#define CHUNK         256
+#define MIN_SNR_Q31   105.0         // dB, programme at -6 dBFS
+#define MIN_GAIN_DB   20.0          // Q31 over float where the margin is small
+#define QUIET_DBFS    (-100.0)
+#define MIN_QUIET_DB  1.5           // full word over pre-shifted, wide margins
+#define BENCH_FRAMES  (1u << 18)
+
+// Budget model constants in dsp_chain.c (CYCLES_PER_FILTER[_Q31])
+#define MODEL_FLOAT   18
+#define MODEL_Q31     36
+
+typedef struct {
+    const char *name;
+    biquad_params_t p;
+} section_case_t;
+
+static const section_case_t s_cases[] = {
+    { "LS 20 Hz +6 @ 384k",  { BIQUAD_LOWSHELF,  20.0f,  6.0f, 0.707f, 384000 } },
+    { "HP 15 Hz    @ 192k",  { BIQUAD_HIGHPASS,  15.0f,  0.0f, 0.707f, 192000 } },
+    { "PK 30 Hz +9 @ 192k",  { BIQUAD_PEAK,      30.0f,  9.0f, 2.0f,   192000 } },
+    { "LS 40 Hz -6 @ 96k",   { BIQUAD_LOWSHELF,  40.0f, -6.0f, 0.707f,  96000 } },
+    { "PK 1 kHz +6 @ 48k",   { BIQUAD_PEAK,    1000.0f,  6.0f, 1.0f,    48000 } },
+    { "HS 8 kHz -3 @ 48k",   { BIQUAD_HIGHSHELF, 8000.0f, -3.0f, 0.707f, 48000 } },
+};
+
+// Bass-heavy programme at level_db, int32 left-justified, mono
+static void make_input(int32_t *x, uint32_t frames, uint32_t rate, double level_db,
+                       uint32_t seed)
+{
+    const double amp = pow(10.0, level_db / 20.0);
+    for (uint32_t i = 0; i < frames; i++) {
+        const double t = (double)i / rate;
+        double v = 0.5 * sin(2 * M_PI * 31.0 * t) + 0.3 * sin(2 * M_PI * 440.0 * t);
+        v += 0.2 * ((int32_t)test_rand(&seed) / 2147483648.0);
+        x[i] = (int32_t)lrint(v * amp * 2147483647.0);
+    }
+}
+
+// y = DF-I in double, input and output in units of full scale
+static void reference(const double c[5], const int32_t *x, double *y, uint32_t frames)
+{
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    for (uint32_t i = 0; i < frames; i++) {
+        const double in = x[i] / 2147483648.0;
+        const double out = c[0] * in + c[1] * x1 + c[2] * x2 - c[3] * y1 - c[4] * y2;
+        x2 = x1; x1 = in;
+        y2 = y1; y1 = out;
+        y[i] = out;
+    }
+}
+
+static double snr_db(const double *ref, const double *got, uint32_t frames)
+{
+    double sig = 0.0, err = 0.0;
+    for (uint32_t i = SKIP; i < frames; i++) {
+        const double e = got[i] - ref[i];
+        sig += ref[i] * ref[i];
+        err += e * e;
+    }
+    return (err > 0.0) ? 10.0 * log10(sig / err) : 300.0;
+}
+
+static void run_float(const biquad_filter_t *proto, const int32_t *x, double *y)
+{
+    biquad_filter_t f = *proto;
+    float bl[CHUNK], br[CHUNK];
+    biquad_reset(&f);
+    for (uint32_t off = 0; off < FRAMES; off += CHUNK) {
+        for (uint32_t i = 0; i < CHUNK; i++) {
+            bl[i] = br[i] = (float)x[off + i] * (1.0f / 2147483648.0f);
+        }
+        biquad_cascade_process(&f, 1, bl, br, CHUNK);
+        for (uint32_t i = 0; i < CHUNK; i++) y[off + i] = bl[i];
+    }
+}
+
+// pre_shift: input truncated by the headroom before the kernel. Returns
+// the left input history {x[n-1], x[n-2]} after the run.
+static const int32_t *run_q31(const int32_t coef[5], const int32_t *x, double *y, bool pre_shift)
+{
+    static biquad_q31_t f;
+    int32_t ql[CHUNK], qr[CHUNK];
+    memcpy(f.coef, coef, sizeof(f.coef));
+    biquad_q31_reset(&f);
+    for (uint32_t off = 0; off < FRAMES; off += CHUNK) {
+        for (uint32_t i = 0; i < CHUNK; i++) {
+            ql[i] = qr[i] = pre_shift ? x[off + i] >> DSP_Q31_HEADROOM : x[off + i];
+        }
+        biquad_cascade_process_q31(&f, 1, ql, qr, CHUNK, pre_shift ? 0 : DSP_Q31_HEADROOM);
+        for (uint32_t i = 0; i < CHUNK; i++) {
+            y[off + i] = ql[i] / (double)(1u << (31 - DSP_Q31_HEADROOM));
+        }
+    }
+    return f.x[0];
+}
+
+static void check_case(const section_case_t *sc, int32_t *x, double *ref, double *y)
+{
+    biquad_filter_t f;
+    int32_t coef_q[5];
+    double cf[5], cq[5];
+
+    biquad_init(&f, &sc->p);
+    const bool q_ok = biquad_calculate_coeffs_q31(coef_q, &sc->p);
+    CHECK(q_ok, "%s: no Q3.28 coefficients", sc->name);
+    if (!q_ok) return;
+    for (int k = 0; k < 5; k++) {
+        cf[k] = f.coef[k];
+        cq[k] = coef_q[k] / (double)(1 << BIQUAD_Q31_FRAC);
+    }
+    const float margin = biquad_pole_margin(f.coef);
+
+    make_input(x, FRAMES, sc->p.sample_rate, -6.0, 0x5EEDu);
+    reference(cf, x, ref, FRAMES);
+    run_float(&f, x, y);
+    const double snr_f = snr_db(ref, y, FRAMES);
+    reference(cq, x, ref, FRAMES);
+    run_q31(coef_q, x, y, false);
+    const double snr_q = snr_db(ref, y, FRAMES);
+
+    // Quiet programme: what the input word's low bits are worth
+    make_input(x, FRAMES, sc->p.sample_rate, QUIET_DBFS, 0x9017u);
+    reference(cq, x, ref, FRAMES);
+    const int32_t *hist = run_q31(coef_q, x, y, false);
+    const double quiet_q = snr_db(ref, y, FRAMES);
+    CHECK(hist[0] == x[FRAMES - 1] && hist[1] == x[FRAMES - 2],
+          "%s: first section's input history not the full word", sc->name);
+    run_q31(coef_q, x, y, true);
+    const double quiet_old = snr_db(ref, y, FRAMES);
+
+    printf("  %-20s margin %.5f  SNR float %6.1f  Q31 %6.1f dB  "
+           "quiet Q31 %5.1f (pre-shifted %5.1f) dB\n",
+           sc->name, margin, snr_f, snr_q, quiet_q, quiet_old);
+
+    CHECK(snr_q >= MIN_SNR_Q31, "%s: Q31 SNR %.1f dB < %.1f", sc->name, snr_q, MIN_SNR_Q31);
+    if (margin < DSP_Q31_POLE_MARGIN) {
+        CHECK(snr_q >= snr_f + MIN_GAIN_DB, "%s: Q31 %.1f dB not %.0f dB over float %.1f dB",
+              sc->name, snr_q, MIN_GAIN_DB, snr_f);
+    }
+    if (margin >= DSP_Q31_POLE_MARGIN) {
+        CHECK(quiet_q >= quiet_old + MIN_QUIET_DB,
+              "%s: full-word input %.1f dB vs pre-shifted %.1f dB", sc->name, quiet_q, quiet_old);
+    }
+}
+
+static void bench(uint8_t sections)
+{
+    biquad_filter_t f[8];
+    biquad_q31_t q[8];
+    float *bl = malloc(sizeof(float) * CHUNK), *br = malloc(sizeof(float) * CHUNK);
+    int32_t *ql = malloc(sizeof(int32_t) * CHUNK), *qr = malloc(sizeof(int32_t) * CHUNK);
+    uint32_t seed = 0xB1Du;
+
+    for (uint8_t s = 0; s < sections; s++) {
+        const section_case_t *sc = &s_cases[s % (sizeof(s_cases) / sizeof(s_cases[0]))];
+        biquad_init(&f[s], &sc->p);
+        biquad_calculate_coeffs_q31(q[s].coef, &sc->p);
+        biquad_q31_reset(&q[s]);
+    }
+
+    uint64_t cyc_f = 0, cyc_q = 0;
+    for (uint32_t pos = 0; pos < BENCH_FRAMES; pos += CHUNK) {
+        for (uint32_t i = 0; i < CHUNK; i++) {
+            ql[i] = (int32_t)test_rand(&seed) >> 2;
+            qr[i] = (int32_t)test_rand(&seed) >> 2;
+            bl[i] = (float)ql[i] * (1.0f / 2147483648.0f);
+            br[i] = (float)qr[i] * (1.0f / 2147483648.0f);
+        }
+        uint32_t t = dsp_prof_now();
+        biquad_cascade_process(f, sections, bl, br, CHUNK);
+        cyc_f += dsp_prof_now() - t;
+        t = dsp_prof_now();
+        biquad_cascade_process_q31(q, sections, ql, qr, CHUNK, DSP_Q31_HEADROOM);
+        cyc_q += dsp_prof_now() - t;
+    }
+
+    const double per = 2.0 * BENCH_FRAMES * sections;
+    printf("  %u sections  float %5.1f  Q31 %5.1f cyc/section/sample measured  "
+           "(%u / %u model)\n", sections, cyc_f / per, cyc_q / per, MODEL_FLOAT, MODEL_Q31);
+
+    free(bl); free(br);
+    free(ql); free(qr);
+}
+
+int main(void)
+{
+    int32_t *x = malloc(sizeof(int32_t) * FRAMES);
+    double *ref = malloc(sizeof(double) * FRAMES);
+    double *y = malloc(sizeof(double) * FRAMES);
+
+    printf("Noise vs double DF-I (own coefficients):\n");
+    for (size_t c = 0; c < sizeof(s_cases) / sizeof(s_cases[0]); c++) {
+        check_case(&s_cases[c], x, ref, y);
+    }
+
+    printf("Timing (host, %u MHz equivalent):\n", DSP_PROF_CPU_MHZ);
+    bench(2);
+    bench(8);
+
+    free(x);
+    free(ref);
+    free(y);
+    return test_result("dsp_biquad_q31");
+}
@@ -0,0 +1,167 @@
+/*
+ * test_dsp_conv.c — partitioned convolution against direct form.
+ *
+ * For every partition size and a range of response lengths (one tap,
+ * shorter than a block, a block plus a remainder, long), separate L/R
+ * responses are applied to noise fed in random-sized pieces. The output
+ * must equal the direct-form convolution delayed by the block size,
+ * within float FFT rounding.
+ *
+ * Then a timing run per partition size: measured cycles per sample
+ * (host clock scaled to DSP_PROF_CPU_MHZ) next to the budget model,
+ * dsp_conv_cycles_per_sample(). The host is not the P4: read the trend
+ * across partition sizes here, the target figures from `dsp bench conv`.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "dsp_conv.h"
+#include "dsp_prof.h"
+#include "test_util.h"
+
+#define RATE         48000
+#define FRAMES       12000
+#define MAX_ERR_DB   (-110.0)       // worst sample error vs output RMS
+#define BENCH_TAPS   4096
+#define BENCH_FRAMES (RATE * 2)
+
+static const uint16_t s_blocks[] = { 64, 128, 256, 512, 1024 };
+
+// Decaying noise, different per channel (a room response in miniature)
+static void make_ir(float *ir, uint32_t taps, uint32_t seed)
+{
+    for (uint32_t i = 0; i < taps; i++) {
+        const float decay = expf(-6.0f * (float)i / (float)taps);
+        ir[i] = decay * (float)((int32_t)test_rand(&seed) >> 8) / 8388608.0f;
+    }
+}
+
+// y[n] = Σ h[k]·x[n − delay − k], double accumulation
+static void direct_form(const float *h, uint32_t taps, const float *x, double *y,
+                        uint32_t frames, uint32_t delay)
+{
+    for (uint32_t n = 0; n < frames; n++) {
+        double acc = 0.0;
+        for (uint32_t k = 0; k < taps && k + delay <= n; k++) {
+            acc += (double)h[k] * x[n - delay - k];
+        }
+        y[n] = acc;
+    }
+}
+
+static double err_db(const float *got, const double *ref, uint32_t frames)
+{
+    double peak_err = 0.0, power = 0.0;
+    for (uint32_t i = 0; i < frames; i++) {
+        const double e = fabs((double)got[i] - ref[i]);
+        if (e > peak_err) peak_err = e;
+        power += ref[i] * ref[i];
+    }
+    const double rms = sqrt(power / frames);
+    if (peak_err == 0.0) return -300.0;
+    return 20.0 * log10(peak_err / (rms > 0.0 ? rms : 1.0));
+}
+
+static void check_accuracy(uint16_t block, uint32_t taps, uint32_t seed)
+{
+    float *ir_L = malloc(sizeof(float) * taps);
+    float *ir_R = malloc(sizeof(float) * taps);
+    float *x_L = malloc(sizeof(float) * FRAMES);
+    float *x_R = malloc(sizeof(float) * FRAMES);
+    float *y_L = malloc(sizeof(float) * FRAMES);
+    float *y_R = malloc(sizeof(float) * FRAMES);
+    double *ref_L = malloc(sizeof(double) * FRAMES);
+    double *ref_R = malloc(sizeof(double) * FRAMES);
+
+    make_ir(ir_L, taps, seed);
+    make_ir(ir_R, taps, seed ^ 0x5A5A5A5Au);
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        x_L[i] = (float)((int32_t)test_rand(&seed) >> 1) / 2147483648.0f;
+        x_R[i] = (float)((int32_t)test_rand(&seed) >> 1) / 2147483648.0f;
+    }
+    memcpy(y_L, x_L, sizeof(float) * FRAMES);
+    memcpy(y_R, x_R, sizeof(float) * FRAMES);
+
+    dsp_conv_t *conv = dsp_conv_create(ir_L, ir_R, taps, block, RATE);
+    CHECK(conv != NULL, "block %u, %u taps: create failed", block, taps);
+    if (conv) {
+        for (uint32_t pos = 0; pos < FRAMES; ) {
+            uint32_t n = test_rand_range(&seed, 1, 3 * block);
+            if (n > FRAMES - pos) n = FRAMES - pos;
+            dsp_conv_process(conv, y_L + pos, y_R + pos, n);
+            pos += n;
+        }
+        dsp_conv_destroy(conv);
+
+        direct_form(ir_L, taps, x_L, ref_L, FRAMES, block);
+        direct_form(ir_R, taps, x_R, ref_R, FRAMES, block);
+        const double eL = err_db(y_L, ref_L, FRAMES);
+        const double eR = err_db(y_R, ref_R, FRAMES);
+        CHECK(eL < MAX_ERR_DB && eR < MAX_ERR_DB,
+              "block %u, %u taps: error L %.1f dB, R %.1f dB", block, taps, eL, eR);
+        printf("  block %4u  %5u taps  error L %6.1f dB  R %6.1f dB\n", block, taps, eL, eR);
+    }
+
+    free(ir_L); free(ir_R);
+    free(x_L); free(x_R);
+    free(y_L); free(y_R);
+    free(ref_L); free(ref_R);
+}
+
+static void bench(uint16_t block)
+{
+    float *ir = malloc(sizeof(float) * BENCH_TAPS);
+    float *buf_L = calloc(block, sizeof(float));
+    float *buf_R = calloc(block, sizeof(float));
+    uint32_t seed = 0xBE7Cu;
+    make_ir(ir, BENCH_TAPS, seed);
+
+    dsp_conv_t *conv = dsp_conv_create(ir, ir, BENCH_TAPS, block, RATE);
+    if (conv) {
+        uint64_t cycles = 0;
+        for (uint32_t pos = 0; pos < BENCH_FRAMES; pos += block) {
+            for (uint16_t i = 0; i < block; i++) {
+                buf_L[i] = (float)((int32_t)test_rand(&seed) >> 1) / 2147483648.0f;
+                buf_R[i] = buf_L[i];
+            }
+            const uint32_t t = dsp_prof_now();
+            dsp_conv_process(conv, buf_L, buf_R, block);
+            cycles += dsp_prof_now() - t;
+        }
+        dsp_conv_destroy(conv);
+        printf("  block %4u  %5u taps  %7.1f cyc/sample measured  %5u model\n",
+               block, BENCH_TAPS, (double)cycles / (2.0 * BENCH_FRAMES),
+               dsp_conv_cycles_per_sample(block, BENCH_TAPS));
+    }
+
+    free(ir);
+    free(buf_L);
+    free(buf_R);
+}
+
+int main(void)
+{
+    uint32_t seed = 0xF12u;
+    for (size_t b = 0; b < sizeof(s_blocks) / sizeof(s_blocks[0]); b++) {
+        const uint16_t block = s_blocks[b];
+        const uint32_t taps[] = { 1, block / 2 + 3, block, 3u * block + 17, 4096 };
+        for (size_t t = 0; t < sizeof(taps) / sizeof(taps[0]); t++) {
+            check_accuracy(block, taps[t], seed++);
+        }
+    }
+
+    CHECK(dsp_conv_create(NULL, NULL, 16, 256, RATE) == NULL, "NULL response accepted");
+    {
+        float ir[4] = { 1.0f };
+        CHECK(dsp_conv_create(ir, ir, 4, 96, RATE) == NULL, "block not a power of two accepted");
+        CHECK(dsp_conv_create(ir, ir, DSP_CONV_MAX_TAPS + 1, 256, RATE) == NULL,
+              "over-long response accepted");
+    }
+
+    printf("Timing (host, %u MHz equivalent):\n", DSP_PROF_CPU_MHZ);
+    for (size_t b = 0; b < sizeof(s_blocks) / sizeof(s_blocks[0]); b++) {
+        bench(s_blocks[b]);
+    }
+
+    return test_result("dsp_conv");
+}
@@ -0,0 +1,140 @@
+/*
+ * test_dsp_prof.c — cycle histograms and the host clock.
+ *
+ * dsp_prof_now() off target is CLOCK_MONOTONIC scaled to a
+ * DSP_PROF_CPU_MHZ core: it must not run backwards and must tick at that
+ * rate across a sleep. The histogram must report exact values below 4
+ * cycles, percentiles within the quarter-octave bin width above, an
+ * exact max, and forget old records over two windows. Finally a pass
+ * timed with dsp_prof_now() goes through record / get / reset.
+ */
+
+#include <time.h>
+#include "dsp_prof.h"
+#include "test_util.h"
+
+#define SLEEP_MS   20
+#define BIN_TOL    0.10         // quarter-octave bins, reported at the centre
+
+static bool near(float got, float want, double tol)
+{
+    return fabs((double)got - want) <= tol * want;
+}
+
+static void check_clock(void)
+{
+    uint32_t prev = dsp_prof_now();
+    for (int i = 0; i < 100000; i++) {
+        const uint32_t now = dsp_prof_now();
+        CHECK((int32_t)(now - prev) >= 0, "clock ran backwards by %d", (int)(prev - now));
+        prev = now;
+    }
+
+    const struct timespec ts = { 0, SLEEP_MS * 1000000L };
+    const uint32_t t0 = dsp_prof_now();
+    nanosleep(&ts, NULL);
+    const uint32_t cycles = dsp_prof_now() - t0;
+    const double want = (double)SLEEP_MS * DSP_PROF_CPU_MHZ * 1000.0;
+    // The sleep can overrun on a loaded host, never fall short
+    CHECK(cycles >= want && cycles < want * 5.0,
+          "%u ms sleep measured %u cycles, want %.0f at %u MHz",
+          SLEEP_MS, cycles, want, DSP_PROF_CPU_MHZ);
+}
+
+static void check_values(void)
+{
+    dsp_prof_hist_t h;
+    dsp_prof_stats_t st;
+
+    // Exact below 4 cycles: 2.5 cycles/sample
+    dsp_prof_reset(&h);
+    for (int i = 0; i < 100; i++) dsp_prof_record(&h, 640, 256);
+    dsp_prof_get(&h, &st);
+    CHECK(st.count == 100, "count %u", (unsigned)st.count);
+    CHECK(st.p50 == 2.5f && st.p99 == 2.5f && st.max == 2.5f,
+          "2.5 cyc: p50 %.3f p99 %.3f max %.3f", st.p50, st.p99, st.max);
+
+    // No samples: nothing recorded
+    dsp_prof_record(&h, 1000, 0);
+    dsp_prof_get(&h, &st);
+    CHECK(st.count == 100, "zero-sample record counted");
+
+    // Binned values: a single value comes back within the bin width
+    for (uint32_t v = 5; v < 4000; v = v * 3 / 2) {
+        dsp_prof_reset(&h);
+        dsp_prof_record(&h, v * 512, 512);
+        dsp_prof_get(&h, &st);
+        CHECK(near(st.p50, (float)v, BIN_TOL) && st.max == (float)v,
+              "%u cyc: p50 %.2f max %.2f", v, st.p50, st.max);
+    }
+
+    // Percentiles of a mix: 90 % cheap, 10 % expensive
+    dsp_prof_reset(&h);
+    for (int i = 0; i < 900; i++) dsp_prof_record(&h, 3 * 256, 256);
+    for (int i = 0; i < 100; i++) dsp_prof_record(&h, 100 * 256 + 64, 256);
+    dsp_prof_get(&h, &st);
+    CHECK(st.p50 == 3.0f, "mix p50 %.2f", st.p50);
+    CHECK(near(st.p99, 100.25f, BIN_TOL), "mix p99 %.2f", st.p99);
+    CHECK(st.max == 100.25f, "mix max %.2f", st.max);
+
+    // Beyond the 16-bit range: saturates, still ordered
+    dsp_prof_reset(&h);
+    dsp_prof_record(&h, UINT32_MAX, 1);
+    dsp_prof_get(&h, &st);
+    CHECK(st.max == UINT16_MAX * 0.25f && st.p50 <= st.max, "saturated max %.2f", st.max);
+}
+
+static void check_window(void)
+{
+    dsp_prof_hist_t h;
+    dsp_prof_stats_t st;
+
+    dsp_prof_reset(&h);
+    for (int i = 0; i < DSP_PROF_WINDOW; i++) dsp_prof_record(&h, 50, 1);
+
+    // Window full: the next record halves every bin
+    dsp_prof_record(&h, 5, 1);
+    dsp_prof_get(&h, &st);
+    CHECK(st.count == DSP_PROF_WINDOW / 2 + 1, "after decay count %u", (unsigned)st.count);
+    CHECK(st.max == 50.0f, "previous window's max dropped early (%.2f)", st.max);
+
+    // Cheap records take over the percentiles, then the max
+    for (int i = 0; i < 2 * DSP_PROF_WINDOW; i++) dsp_prof_record(&h, 5, 1);
+    dsp_prof_get(&h, &st);
+    CHECK(st.p50 == 5.0f && st.p99 == 5.0f, "old records pin p50 %.2f p99 %.2f", st.p50, st.p99);
+    CHECK(st.max == 5.0f, "old max %.2f survives two windows", st.max);
+    CHECK(st.count <= DSP_PROF_WINDOW, "count %u past the window", (unsigned)st.count);
+}
+
+static void check_timed(void)
+{
+    static float buf[4096];
+    dsp_prof_hist_t h;
+    dsp_prof_stats_t st;
+
+    dsp_prof_reset(&h);
+    for (int pass = 0; pass < 64; pass++) {
+        const uint32_t t = dsp_prof_now();
+        for (int i = 0; i < 4096; i++) buf[i] = sinf(buf[i] + (float)i);
+        dsp_prof_record(&h, dsp_prof_now() - t, 4096);
+    }
+    dsp_prof_get(&h, &st);
+    printf("  timed pass: p50 %.2f p99 %.2f max %.2f cyc/sample (%u records)\n",
+           st.p50, st.p99, st.max, (unsigned)st.count);
+    CHECK(st.count == 64, "timed count %u", (unsigned)st.count);
+    CHECK(st.p50 > 0.0f && st.p50 <= st.p99 && st.p99 <= st.max,
+          "timed p50 %.2f p99 %.2f max %.2f", st.p50, st.p99, st.max);
+
+    dsp_prof_reset(&h);
+    dsp_prof_get(&h, &st);
+    CHECK(st.count == 0 && st.p50 == 0.0f && st.max == 0.0f, "reset left data");
+}
+
+int main(void)
+{
+    check_clock();
+    check_values();
+    check_window();
+    check_timed();
+    return test_result("dsp_prof");
+}
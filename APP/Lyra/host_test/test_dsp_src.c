@@ -0,0 +1,236 @@
+/*
+ * test_dsp_src.c — resampler frequency response, alias rejection, cost.
+ *
+ * For each rate pair and quality profile:
+ *  - passband ripple: tones from 1 kHz up to dsp_src_get_passband(),
+ *    output level by a least-squares sine fit; the spread of the gains
+ *    must stay within the profile's ripple budget;
+ *  - spurious rejection: everything left after removing the fitted tone
+ *    (images when upsampling, aliases when downsampling, rounding) at
+ *    several passband frequencies, and a stopband tone that would alias
+ *    into the passband when downsampling;
+ *  - cycles per output frame on the host clock, next to the model
+ *    (dsp_src_cycles_per_frame()). Read the trend here; target figures
+ *    come from `dsp bench src`.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "dsp_src.h"
+#include "dsp_prof.h"
+#include "test_util.h"
+
+#define TONE_AMP     0.5
+#define OUT_FRAMES   16384          // analysed output
+#define BENCH_MS     1000
+
+typedef struct { uint32_t in, out; } rate_pair_t;
+
+static const rate_pair_t s_pairs[] = {
+    {  44100,  48000 },
+    {  48000,  44100 },
+    {  44100, 192000 },
+    {  96000,  44100 },
+    { 192000,  48000 },
+};
+
+// Ripple (peak to peak, dB) and spurious floor (dB below the tone) per
+// profile; the floors are the stopband figures dsp_src.h gives
+static const double s_max_ripple[DSP_SRC_QUALITY_COUNT] = { 0.005, 0.001, 0.001 };
+static const double s_min_reject[DSP_SRC_QUALITY_COUNT] = { 80.0, 100.0, 130.0 };
+
+typedef struct {
+    double gain_db;                 // fitted tone vs input
+    double spur_db;                 // residual power vs tone power
+} tone_result_t;
+
+// Resample a tone of @p freq; returns want = skip + OUT_FRAMES output frames
+static int32_t *resample_tone(const rate_pair_t *p, dsp_src_quality_t q, double freq,
+                              uint32_t *skip)
+{
+    dsp_src_t *src = dsp_src_create(p->in, p->out, q);
+    if (!src) return NULL;
+
+    *skip = dsp_src_get_taps(src) * 2 + 64;     // settle past the history
+    const uint32_t want = *skip + OUT_FRAMES;
+    int32_t *out = malloc(sizeof(int32_t) * 2 * want);
+    int32_t in[2 * 512];
+    uint64_t n_in = 0;
+    uint32_t got = 0;
+
+    while (out && got < want) {
+        for (uint32_t i = 0; i < 512; i++) {
+            const double v = TONE_AMP * sin(2 * M_PI * freq * (double)(n_in + i) / p->in);
+            in[2 * i] = in[2 * i + 1] = (int32_t)lrint(v * 2147483648.0);
+        }
+        uint32_t pos = 0;
+        while (pos < 512 && got < want) {
+            uint32_t used = 0;
+            got += dsp_src_process(src, in + 2 * pos, 512 - pos, out + 2 * got, want - got, &used);
+            pos += used;
+            if (used == 0) break;
+        }
+        n_in += 512;
+    }
+
+    dsp_src_destroy(src);
+    return out;
+}
+
+// Tone through the converter, fitted at the output (left channel)
+static tone_result_t run_tone(const rate_pair_t *p, dsp_src_quality_t q, double freq)
+{
+    tone_result_t res = { -300.0, 0.0 };
+    uint32_t skip;
+    int32_t *out = resample_tone(p, q, freq, &skip);
+    if (!out) return res;
+    const uint32_t want = skip + OUT_FRAMES;
+
+    // Least squares: y ≈ a·sin + b·cos + c
+    double ss = 0, cc = 0, sc = 0, s1 = 0, c1 = 0, ys = 0, yc = 0, y1 = 0;
+    const double w = 2 * M_PI * freq / p->out;
+    for (uint32_t i = skip; i < want; i++) {
+        const double s = sin(w * i), c = cos(w * i), y = out[2 * i] / 2147483648.0;
+        ss += s * s; cc += c * c; sc += s * c; s1 += s; c1 += c;
+        ys += y * s; yc += y * c; y1 += y;
+    }
+    const double n = OUT_FRAMES;
+    // 3x3 normal equations, Cramer's rule
+    const double m[3][3] = { { ss, sc, s1 }, { sc, cc, c1 }, { s1, c1, n } };
+    const double v[3] = { ys, yc, y1 };
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                 m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                 m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    double x[3];
+    for (int k = 0; k < 3; k++) {
+        double t[3][3];
+        memcpy(t, m, sizeof(t));
+        for (int r = 0; r < 3; r++) t[r][k] = v[r];
+        x[k] = (t[0][0] * (t[1][1] * t[2][2] - t[1][2] * t[2][1]) -
+                t[0][1] * (t[1][0] * t[2][2] - t[1][2] * t[2][0]) +
+                t[0][2] * (t[1][0] * t[2][1] - t[1][1] * t[2][0])) / det;
+    }
+
+    double resid = 0;
+    for (uint32_t i = skip; i < want; i++) {
+        const double e = out[2 * i] / 2147483648.0 - (x[0] * sin(w * i) + x[1] * cos(w * i) + x[2]);
+        resid += e * e;
+    }
+    const double amp = sqrt(x[0] * x[0] + x[1] * x[1]);
+    res.gain_db = 20 * log10(amp / TONE_AMP);
+    res.spur_db = 10 * log10((resid / n) / (TONE_AMP * TONE_AMP / 2) + 1e-30);
+
+    free(out);
+    return res;
+}
+
+// Level at the output of a stopband tone (vs the input tone)
+static double run_stopband(const rate_pair_t *p, dsp_src_quality_t q, double freq)
+{
+    uint32_t skip;
+    int32_t *out = resample_tone(p, q, freq, &skip);
+    if (!out) return 0.0;
+    const uint32_t want = skip + OUT_FRAMES;
+
+    double power = 0;
+    for (uint32_t i = skip; i < want; i++) {
+        const double y = out[2 * i] / 2147483648.0;
+        power += y * y;
+    }
+    free(out);
+    return 10 * log10((power / OUT_FRAMES) / (TONE_AMP * TONE_AMP / 2) + 1e-30);
+}
+
+static void check_pair(const rate_pair_t *p, dsp_src_quality_t q)
+{
+    dsp_src_t *src = dsp_src_create(p->in, p->out, q);
+    CHECK(src != NULL, "%lu -> %lu %s: create failed", (unsigned long)p->in,
+          (unsigned long)p->out, dsp_src_quality_name(q));
+    if (!src) return;
+    const double edge = dsp_src_get_passband(src);
+    dsp_src_destroy(src);
+
+    double lo = 1e9, hi = -1e9, spur = -300.0;
+    for (int k = 0; k <= 10; k++) {
+        const double f = 1000.0 + (edge - 1000.0) * k / 10.0;
+        const tone_result_t r = run_tone(p, q, f);
+        if (r.gain_db < lo) lo = r.gain_db;
+        if (r.gain_db > hi) hi = r.gain_db;
+        if (k < 10 && r.spur_db > spur) spur = r.spur_db;
+    }
+    const double ripple = hi - lo;
+
+    // Downsampling: a tone past the output band that would alias to
+    // mid-passband (none below the input Nyquist for close ratios, whose
+    // aliases only reach the transition band)
+    double stop = -300.0;
+    const bool alias = p->in > p->out && p->out - edge / 2 < p->in / 2;
+    if (alias) {
+        stop = run_stopband(p, q, p->out - edge / 2);
+    }
+
+    CHECK(ripple <= s_max_ripple[q], "%lu -> %lu %s: passband ripple %.4f dB",
+          (unsigned long)p->in, (unsigned long)p->out, dsp_src_quality_name(q), ripple);
+    CHECK(-spur >= s_min_reject[q], "%lu -> %lu %s: spurious %.1f dB",
+          (unsigned long)p->in, (unsigned long)p->out, dsp_src_quality_name(q), spur);
+    CHECK(-stop >= s_min_reject[q], "%lu -> %lu %s: stopband tone at %.1f dB",
+          (unsigned long)p->in, (unsigned long)p->out, dsp_src_quality_name(q), stop);
+
+    printf("  %6lu -> %6lu %-6s edge %7.0f Hz  ripple %.4f dB  spurious %6.1f dB",
+           (unsigned long)p->in, (unsigned long)p->out, dsp_src_quality_name(q), edge, ripple, spur);
+    if (alias) printf("  alias %6.1f dB", stop);
+    printf("\n");
+}
+
+static void bench(const rate_pair_t *p, dsp_src_quality_t q)
+{
+    dsp_src_t *src = dsp_src_create(p->in, p->out, q);
+    if (!src) return;
+
+    enum { BLOCK = 1024 };
+    int32_t *in = malloc(sizeof(int32_t) * 2 * BLOCK * DSP_SRC_MAX_DOWN);
+    int32_t *out = malloc(sizeof(int32_t) * 2 * BLOCK);
+    uint32_t seed = 0x5CC;
+    for (uint32_t i = 0; i < 2 * BLOCK * DSP_SRC_MAX_DOWN; i++) in[i] = (int32_t)test_rand(&seed) >> 2;
+
+    const uint32_t total = p->out * BENCH_MS / 1000;
+    uint64_t cycles = 0;
+    uint32_t done = 0;
+    while (done < total) {
+        uint32_t need = dsp_src_input_needed(src, BLOCK);
+        if (need > BLOCK * DSP_SRC_MAX_DOWN) need = BLOCK * DSP_SRC_MAX_DOWN;
+        uint32_t used = 0;
+        const uint32_t t = dsp_prof_now();
+        const uint32_t n = dsp_src_process(src, in, need, out, BLOCK, &used);
+        cycles += dsp_prof_now() - t;
+        done += n;
+        if (n == 0 && used == 0) break;
+    }
+
+    printf("  %6lu -> %6lu %-6s %3u taps  %7.1f cyc/frame measured  %5u model\n",
+           (unsigned long)p->in, (unsigned long)p->out, dsp_src_quality_name(q),
+           dsp_src_get_taps(src), done ? (double)cycles / done : 0.0,
+           dsp_src_cycles_per_frame(p->in, p->out, q));
+
+    free(in);
+    free(out);
+    dsp_src_destroy(src);
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < sizeof(s_pairs) / sizeof(s_pairs[0]); i++) {
+        for (int q = 0; q < DSP_SRC_QUALITY_COUNT; q++) {
+            check_pair(&s_pairs[i], (dsp_src_quality_t)q);
+        }
+    }
+
+    printf("Timing (host, %u MHz equivalent):\n", DSP_PROF_CPU_MHZ);
+    for (size_t i = 0; i < sizeof(s_pairs) / sizeof(s_pairs[0]); i++) {
+        for (int q = 0; q < DSP_SRC_QUALITY_COUNT; q++) {
+            bench(&s_pairs[i], (dsp_src_quality_t)q);
+        }
+    }
+
+    return test_result("dsp_src");
+}
@@ -0,0 +1,80 @@
+/*
+ * test_util.h — shared helpers for the host DSP tests.
+ *
+ * Deterministic signal generators, a check macro that counts failures
+ * instead of aborting (one run reports every broken case). Timing runs
+ * use dsp_prof_now(), CLOCK_MONOTONIC scaled to a DSP_PROF_CPU_MHZ core.
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static int s_test_failures;
+
+#define CHECK(cond, fmt, ...)                                               \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            s_test_failures++;                                              \
+            fprintf(stderr, "FAIL %s:%d: " fmt "\n", __FILE__, __LINE__,   \
+                    ##__VA_ARGS__);                                         \
+        }                                                                   \
+    } while (0)
+
+// Exit code for main(): 0 when every CHECK passed
+static inline int test_result(const char *name)
+{
+    if (s_test_failures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, s_test_failures);
+        return 1;
+    }
+    printf("%s: OK\n", name);
+    return 0;
+}
+
+// xorshift32: same sequence on every host, seeded per test
+static inline uint32_t test_rand(uint32_t *seed)
+{
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+// Uniform in [lo, hi]
+static inline uint32_t test_rand_range(uint32_t *seed, uint32_t lo, uint32_t hi)
+{
+    return lo + test_rand(seed) % (hi - lo + 1);
+}
+
+// Program-like stereo test signal, int32 left-justified: two tones, white
+// noise and a few bursts past full scale (limiter, clip paths)
+static inline void test_fill_music(int32_t *buf, uint32_t frames, uint32_t rate, uint32_t seed)
+{
+    for (uint32_t i = 0; i < frames; i++) {
+        const double t = (double)i / rate;
+        double l = 0.35 * sin(2 * M_PI * 55.0 * t) + 0.2 * sin(2 * M_PI * 3150.0 * t);
+        double r = 0.35 * sin(2 * M_PI * 82.5 * t) + 0.2 * sin(2 * M_PI * 9700.0 * t);
+        l += ((int32_t)test_rand(&seed) >> 2) / 2147483648.0;
+        r += ((int32_t)test_rand(&seed) >> 2) / 2147483648.0;
+        if ((i / (rate / 8)) % 5 == 3) { l *= 2.5; r *= 2.5; }
+        if (l > 0.9999999) l = 0.9999999;
+        if (l < -1.0) l = -1.0;
+        if (r > 0.9999999) r = 0.9999999;
+        if (r < -1.0) r = -1.0;
+        buf[2 * i]     = (int32_t)(l * 2147483648.0);
+        buf[2 * i + 1] = (int32_t)(r * 2147483648.0);
+    }
+}
+
+#endif // TEST_UTIL_H
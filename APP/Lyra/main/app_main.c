@@ -9,7 +9,6 @@
 #include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/stream_buffer.h"
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_check.h"
@@ -22,11 +21,16 @@
 #include "tusb.h"
 #include "usb_descriptors.h"
 #include "audio_pipeline.h"
+#include "audio_analysis.h"
 #include "storage.h"
 #include "usb_mode.h"
 #include "audio_source.h"
+#include "audio_ring.h"
+#include "audio_trace.h"
+#include "audio_engine.h"
 #include "sd_player.h"
 #include "audio_codecs.h"
+#include "dsd2pcm.h"
 #include "power.h"
 #include "wireless.h"
 #include "net_audio.h"
@@ -50,18 +54,19 @@ static const char *TAG = "lyra";
 static TaskHandle_t s_audio_task_handle = NULL;
 
 //--------------------------------------------------------------------+
-// Decoupled audio pipeline: USB FIFO → DSP → StreamBuffer → I2S DMA
+// Decoupled audio pipeline: USB FIFO → DSP → block ring → I2S DMA
 //--------------------------------------------------------------------+
 
-#define AUDIO_STREAM_BUF_SIZE  (16 * 1024)  // 16KB ring: 5ms@384kHz, 10ms@192kHz
-
-static StreamBufferHandle_t s_audio_stream = NULL;
 static TaskHandle_t s_feeder_task_handle = NULL;
 static volatile bool s_i2s_reconfiguring = false;
 static volatile bool s_feeder_in_write = false;
 
+// USB reads accumulate in one ring block until it is full or has held
+// audio this long, so each of the 4 internal-RAM blocks carries at least
+// a millisecond of audio rather than a single microframe
+#define USB_BLOCK_FILL_US  1000
+
 // Getters for shared pipeline state (used by audio_source.c and sd_player)
-StreamBufferHandle_t audio_get_stream_buffer(void) { return s_audio_stream; }
 bool audio_is_reconfiguring(void) { return s_i2s_reconfiguring; }
 void audio_set_reconfiguring(bool val) { s_i2s_reconfiguring = val; }
 bool audio_is_feeder_writing(void) { return s_feeder_in_write; }
@@ -80,9 +85,9 @@ static volatile struct {
     uint32_t loop_max_us;        // Max time for full cycle (read+dsp+stream_write)
     uint32_t zero_reads;         // Times FIFO was empty (idle cycles)
     uint32_t total_reads;        // Total successful reads
-    uint32_t stream_min;         // Min bytes in stream buffer
-    uint32_t stream_max;         // Max bytes in stream buffer
-    uint32_t stream_overflow;    // Times stream buffer was full
+    uint32_t stream_min;         // Min bytes queued in audio ring
+    uint32_t stream_max;         // Max bytes queued in audio ring
+    uint32_t stream_overflow;    // Times audio ring was full
 } s_diag;
 
 //--------------------------------------------------------------------+
@@ -598,11 +603,17 @@ bool tud_audio_set_req_entity_cb(uint8_t rhport, tusb_control_request_t const *p
             TU_VERIFY(p_request->bRequest == AUDIO20_CS_REQ_CUR);
             current_mute[channelNum] = ((audio20_control_cur_1_t const *)buf)->bCur;
             ESP_LOGI(TAG, "[USB] Host SET MUTE for ch=%d: %d", channelNum, current_mute[channelNum]);
+            audio_pipeline_set_mute(current_mute[0]);
             return true;
         } else if (ctrlSel == AUDIO20_FU_CTRL_VOLUME) {
             TU_VERIFY(p_request->bRequest == AUDIO20_CS_REQ_CUR);
             current_volume[channelNum] = tu_le16toh(((audio20_control_cur_2_t const *)buf)->bCur);
             ESP_LOGI(TAG, "[USB] Host SET VOLUME for ch=%d: %d", channelNum, current_volume[channelNum]);
+            // Master + loudest channel, 1/256 dB: digital volume at the end
+            // of the DSP chain, and the level loudness follows
+            int16_t ch_vol = (int16_t)current_volume[1];
+            if ((int16_t)current_volume[2] > ch_vol) ch_vol = (int16_t)current_volume[2];
+            audio_pipeline_set_volume(((int16_t)current_volume[0] + ch_vol) / 256.0f);
             return true;
         } else {
             ESP_LOGW(TAG, "[USB] Unhandled SET FEATURE_UNIT control: 0x%02x", ctrlSel);
@@ -627,14 +638,12 @@ void tud_audio_feedback_params_cb(uint8_t func_id, uint8_t alt, audio_feedback_p
 //--------------------------------------------------------------------+
 
 //--------------------------------------------------------------------+
-// I2S feeder task: StreamBuffer → I2S DMA (blocks on DMA, not USB)
+// I2S feeder task: audio ring → I2S DMA (blocks on DMA, not USB)
 //--------------------------------------------------------------------+
 
 static void i2s_feeder_task(void *arg)
 {
     (void)arg;
-    // Buffer sized to one DMA descriptor max (480 frames × 4 bytes × 2 ch)
-    uint8_t feed_buf[3840];
 
     while (1) {
         if (s_i2s_reconfiguring || !i2s_tx) {
@@ -642,41 +651,55 @@ static void i2s_feeder_task(void *arg)
             continue;
         }
 
-        // Block until data available (trigger=1 byte), timeout=1 tick safety
-        size_t received = xStreamBufferReceive(s_audio_stream, feed_buf, sizeof(feed_buf), 1);
-        if (received > 0) {
-            s_feeder_in_write = true;
-            uint32_t t0 = esp_timer_get_time();
-            // Retry loop: write ALL bytes to I2S, waiting for DMA space as needed
-            // Timeout=100ms (10 ticks @100Hz) — enough for DMA to free descriptors
-            size_t offset = 0;
-            while (offset < received && !s_i2s_reconfiguring) {
-                size_t bytes_written;
-                i2s_channel_write(i2s_tx, feed_buf + offset, received - offset, &bytes_written, 100);
-                offset += bytes_written;
-                if (bytes_written == 0) break; // real timeout, avoid infinite loop
-            }
-            uint32_t us = esp_timer_get_time() - t0;
-            s_feeder_in_write = false;
-
-            if (us > s_diag.i2s_write_max_us) s_diag.i2s_write_max_us = us;
-            if (offset < received) s_diag.i2s_block_count++;
+        // Producers notify on every commit; timeout=1 tick safety
+        size_t received = 0;
+        const uint8_t *block = audio_ring_peek(&received);
+        if (!block) {
+            ulTaskNotifyTake(pdTRUE, 1);
+            continue;
+        }
 
-            // Notify active producer: stream buffer has space now
-            TaskHandle_t producer = audio_source_get_producer_handle();
-            if (producer) xTaskNotifyGive(producer);
+        s_feeder_in_write = true;
+        AUDIO_TRACE_BEGIN(AUDIO_TRACE_I2S_WRITE);
+        uint32_t t0 = esp_timer_get_time();
+        // Retry loop: write ALL bytes to I2S straight from the ring block,
+        // waiting for DMA space as needed
+        // Timeout=100ms (10 ticks @100Hz) — enough for DMA to free descriptors
+        size_t offset = 0;
+        while (offset < received && !s_i2s_reconfiguring) {
+            size_t bytes_written;
+            i2s_channel_write(i2s_tx, block + offset, received - offset, &bytes_written, 100);
+            offset += bytes_written;
+            if (bytes_written == 0) break; // real timeout, avoid infinite loop
         }
+        uint32_t us = esp_timer_get_time() - t0;
+        AUDIO_TRACE_END(AUDIO_TRACE_I2S_WRITE, offset);
+        audio_ring_release();
+        s_feeder_in_write = false;
+
+        if (us > s_diag.i2s_write_max_us) s_diag.i2s_write_max_us = us;
+        if (offset < received) s_diag.i2s_block_count++;
+
+        // Notify active producer: a ring block is free now
+        TaskHandle_t producer = audio_source_get_producer_handle();
+        if (producer) xTaskNotifyGive(producer);
     }
 }
 
 //--------------------------------------------------------------------+
-// Audio task: USB FIFO → DSP → StreamBuffer (never blocks on I2S)
+// Audio task: USB FIFO → DSP → audio ring (never blocks on I2S)
 //--------------------------------------------------------------------+
 
 static void audio_task(void *arg)
 {
     (void)arg;
-    uint8_t spk_buf[CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX * 8];
+    // USB reads go straight into the ring block; at most this much per pass
+    const size_t spk_max = CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX * 8;
+    // Block being filled across passes (NULL = none acquired)
+    uint8_t *spk_buf = NULL;
+    size_t stream_space = 0;
+    size_t spk_fill = 0;
+    uint32_t spk_t0 = 0;
     uint32_t last_diag_us = 0;
     s_diag.fifo_min = UINT32_MAX;
     s_diag.stream_min = UINT32_MAX;
@@ -684,12 +707,15 @@ static void audio_task(void *arg)
     while (1) {
         // Sleep when not in USB audio source (e.g. storage mode or SD playback)
         if (audio_source_get() != AUDIO_SOURCE_USB) {
+            spk_buf = NULL;   // the switch reconfigured the ring: its slot is gone
             vTaskDelay(pdMS_TO_TICKS(100));
             continue;
         }
 
         // Handle sample rate OR format change from host
         if (rate_changed || format_changed) {
+            // A part-filled block holds the old format; configure drops it
+            spk_buf = NULL;
             if (rate_changed) {
                 ESP_LOGI(TAG, "Rate change requested: %lu Hz", current_sample_rate);
                 rate_changed = false;
@@ -706,9 +732,10 @@ static void audio_task(void *arg)
                 uint32_t actual_rate = i2s_output_init(current_sample_rate, current_bits_per_sample);
                 if (actual_rate == 0) actual_rate = current_sample_rate;
                 audio_pipeline_update_format(actual_rate, current_bits_per_sample);
+                AUDIO_TRACE_INSTANT(AUDIO_TRACE_FORMAT, actual_rate);
 
                 // Discard stale audio data from old format
-                xStreamBufferReset(s_audio_stream);
+                audio_ring_configure(AUDIO_RING_PROFILE_USB, actual_rate, current_bits_per_sample);
 
                 s_i2s_reconfiguring = false;
                 ESP_LOGI(TAG, "Audio format reconfigured: requested=%lu actual=%lu Hz, %d-bit",
@@ -716,16 +743,23 @@ static void audio_task(void *arg)
             }
         }
 
-        // Check stream buffer space BEFORE reading FIFO
-        // If no space: don't drain FIFO → FIFO fills → feedback slows host
-        size_t stream_space = xStreamBufferSpacesAvailable(s_audio_stream);
-        if (stream_space < CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX) {
-            // No space in stream buffer — sleep until feeder or ISR wakes us
-            s_diag.zero_reads++;
-            ulTaskNotifyTake(pdTRUE, 1);
-            continue;
+        // Acquire a ring block BEFORE reading FIFO
+        // If none free: don't drain FIFO → FIFO fills → feedback slows host
+        if (!spk_buf) {
+            spk_buf = audio_ring_acquire(&stream_space);
+            if (!spk_buf) {
+                // Ring full — sleep until feeder or ISR wakes us
+                s_diag.stream_overflow++;
+                s_diag.zero_reads++;
+                ulTaskNotifyTake(pdTRUE, 1);
+                continue;
+            }
+            spk_fill = 0;
         }
 
+        uint8_t bytes_per_sample = (current_bits_per_sample == 16) ? 2 : 4;
+        uint32_t frame_size = bytes_per_sample * 2;
+
         uint16_t available = tud_audio_available();
         if (available > 0) {
             // Track USB FIFO levels
@@ -735,47 +769,63 @@ static void audio_task(void *arg)
 
             uint32_t t_loop = esp_timer_get_time();
 
-            // Limit read to available stream space
-            uint16_t max_read = (stream_space < sizeof(spk_buf)) ? stream_space : sizeof(spk_buf);
+            // Limit read to one USB burst and to whole frames left in the block
+            size_t room = stream_space - spk_fill;
+            uint16_t max_read = (room < spk_max) ? room : spk_max;
             uint16_t to_read = (available < max_read) ? available : max_read;
-            uint16_t n_read = tud_audio_read(spk_buf, to_read);
+            to_read -= to_read % frame_size;
+            uint8_t *dst = spk_buf + spk_fill;
+            AUDIO_TRACE_BEGIN(AUDIO_TRACE_USB_READ);
+            uint16_t n_read = to_read ? tud_audio_read(dst, to_read) : 0;
+            AUDIO_TRACE_END(AUDIO_TRACE_USB_READ, n_read);
+            n_read -= n_read % frame_size;
             if (n_read > 0) {
-                // DSP processing
-                uint8_t bytes_per_sample = (current_bits_per_sample == 16) ? 2 : 4;
-                uint32_t frame_size = bytes_per_sample * 2;
+                // DSP processing, in place on the slice just read
                 uint32_t frames = n_read / frame_size;
                 uint32_t num_samples = frames * 2;
 
                 uint32_t t_dsp = esp_timer_get_time();
                 if (bytes_per_sample == 2) {
-                    int16_t *src = (int16_t*)spk_buf;
-                    int32_t dsp_buf[sizeof(spk_buf) / 2];
+                    int16_t *src = (int16_t*)dst;
+                    int32_t dsp_buf[CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX * 8 / 2];
                     for (uint32_t i = 0; i < num_samples; i++)
                         dsp_buf[i] = (int32_t)src[i] << 16;
                     audio_pipeline_process(dsp_buf, frames);
+                    // Exact: the chain already requantised to 16 bits (dithered)
                     for (uint32_t i = 0; i < num_samples; i++)
                         src[i] = (int16_t)(dsp_buf[i] >> 16);
                 } else {
-                    int32_t *buf_i32 = (int32_t*)spk_buf;
+                    int32_t *buf_i32 = (int32_t*)dst;
                     audio_pipeline_process(buf_i32, frames);
                 }
                 uint32_t dsp_us = esp_timer_get_time() - t_dsp;
                 if (dsp_us > s_diag.dsp_max_us) s_diag.dsp_max_us = dsp_us;
 
-                // Non-blocking write — space guaranteed by check above
-                size_t sent = xStreamBufferSend(s_audio_stream, spk_buf, n_read, 0);
-                if (sent < (size_t)n_read) s_diag.stream_overflow++;
+                if (spk_fill == 0) spk_t0 = t_loop;
+                spk_fill += n_read;
             }
 
             uint32_t loop_us = esp_timer_get_time() - t_loop;
             if (loop_us > s_diag.loop_max_us) s_diag.loop_max_us = loop_us;
         } else {
             s_diag.zero_reads++;
+        }
+
+        // Hand the block to the feeder — no copy — once it is full or has
+        // held audio for USB_BLOCK_FILL_US. Committing every read would
+        // leave the ring only AUDIO_RING_FAST_BLOCKS reads deep.
+        if (spk_fill > 0 &&
+            (stream_space - spk_fill < frame_size ||
+             (uint32_t)esp_timer_get_time() - spk_t0 >= USB_BLOCK_FILL_US)) {
+            audio_ring_commit(spk_fill);
+            spk_buf = NULL;
+            spk_fill = 0;
+        } else if (available == 0) {
             ulTaskNotifyTake(pdTRUE, 1);
         }
 
-        // Track stream buffer fill level
-        size_t stream_used = xStreamBufferBytesAvailable(s_audio_stream);
+        // Track ring fill level
+        size_t stream_used = audio_ring_used_bytes();
         if (stream_used < s_diag.stream_min) s_diag.stream_min = stream_used;
         if (stream_used > s_diag.stream_max) s_diag.stream_max = stream_used;
 
@@ -826,6 +876,28 @@ static void cdc_printf(const char *fmt, ...)
     tud_cdc_write_flush();
 }
 
+// Blocking CDC write for bulk output (trace dump): waits for FIFO space
+// instead of dropping. Only call from cdc_task — TinyUSB runs separately.
+static void cdc_write_all(const char *data, size_t len)
+{
+    uint32_t stalls = 0;
+    while (len > 0 && tud_cdc_connected()) {
+        uint32_t n = tud_cdc_write_available();
+        if (n == 0) {
+            tud_cdc_write_flush();
+            if (++stalls > 500) return;     // Host stopped reading (~5 s)
+            vTaskDelay(1);
+            continue;
+        }
+        stalls = 0;
+        if (n > len) n = len;
+        n = tud_cdc_write(data, n);
+        data += n;
+        len  -= n;
+    }
+    tud_cdc_write_flush();
+}
+
 static void save_audio_settings(void)
 {
     settings_audio_t cfg = {
@@ -1368,6 +1440,433 @@ static void sd_cmd_part(void)
     free(mbr);
 }
 
+// Dispatch all "dsp ..." commands. Returns true if handled.
+static bool handle_dsp_command(const char *cmd)
+{
+    if (strncmp(cmd, "dsp bench conv", 14) == 0) {
+        const char *arg = cmd + 14;
+        while (*arg == ' ') arg++;
+        uint32_t taps = *arg ? strtoul(arg, NULL, 10) : 4096;
+        cdc_printf("FIR convolution, %lu taps (cyc/sample per channel):\r\n",
+                   (unsigned long)taps);
+        for (uint16_t block = DSP_CONV_BLOCK_MIN; block <= DSP_CONV_BLOCK_MAX; block <<= 1) {
+            audio_pipeline_conv_bench_t r;
+            audio_pipeline_bench_conv(block, taps, &r);
+            if (r.ok) {
+                cdc_printf("  block %4u: %7.1f measured, %5u model\r\n",
+                           block, r.cycles_per_sample, r.model_cycles);
+            } else {
+                cdc_printf("  block %4u: failed (memory?)\r\n", block);
+            }
+        }
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp bench src ", 14) == 0) {
+        unsigned in_rate = 0, out_rate = 0;
+        char q[8] = "";
+        if (sscanf(cmd + 14, "%u %u %7s", &in_rate, &out_rate, q) < 2) {
+            cdc_printf("Usage: dsp bench src <in_rate> <out_rate> [low|medium|high]\r\n");
+            return true;
+        }
+        dsp_src_quality_t first = DSP_SRC_QUALITY_LOW, last = DSP_SRC_QUALITY_HIGH;
+        for (int i = 0; i < DSP_SRC_QUALITY_COUNT; i++) {
+            if (strcmp(q, dsp_src_quality_name((dsp_src_quality_t)i)) == 0) {
+                first = last = (dsp_src_quality_t)i;
+            }
+        }
+        cdc_printf("SRC %u -> %u Hz (cyc per output frame, stereo):\r\n", in_rate, out_rate);
+        for (int i = first; i <= (int)last; i++) {
+            audio_pipeline_src_bench_t r;
+            audio_pipeline_bench_src(in_rate, out_rate, (dsp_src_quality_t)i, &r);
+            if (r.ok) {
+                cdc_printf("  %-6s %3u taps: %6.1f measured, %4u model | passband %.0f Hz, "
+                           "ripple %.4f dB, rejection %.1f dB\r\n",
+                           dsp_src_quality_name(r.quality), r.taps, r.cycles_per_frame,
+                           r.model_cycles, r.passband_hz, r.ripple_db, r.rejection_db);
+            } else {
+                cdc_printf("  %-6s failed (unsupported ratio or memory)\r\n",
+                           dsp_src_quality_name((dsp_src_quality_t)i));
+            }
+        }
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp bench os", 12) == 0 && (cmd[12] == '\0' || cmd[12] == ' ')) {
+        const char *arg = cmd + 12;
+        while (*arg == ' ') arg++;
+        dsp_os_phase_t phase = DSP_OS_PHASE_LINEAR;
+        if (*arg) {
+            if (strcmp(arg, dsp_os_phase_name(DSP_OS_PHASE_MINIMUM)) == 0) {
+                phase = DSP_OS_PHASE_MINIMUM;
+            } else if (strcmp(arg, dsp_os_phase_name(DSP_OS_PHASE_LINEAR)) != 0) {
+                cdc_printf("Usage: dsp bench os [linear|minimum]\r\n");
+                return true;
+            }
+        }
+        cdc_printf("Oversampler, %s phase (cyc per input frame, stereo):\r\n",
+                   dsp_os_phase_name(phase));
+        for (uint8_t factor = 2; factor <= DSP_OS_MAX_FACTOR; factor *= 2) {
+            audio_pipeline_os_bench_t r;
+            audio_pipeline_bench_os(factor, phase, &r);
+            if (r.ok) {
+                cdc_printf("  %ux (%u stage%s, taps %u", factor, r.stages,
+                           r.stages > 1 ? "s" : "", r.taps[0]);
+                for (uint8_t st = 1; st < r.stages; st++) cdc_printf("/%u", r.taps[st]);
+                cdc_printf("): %6.1f measured, %4u model | ripple %.5f dB, "
+                           "rejection %.1f dB, latency %.1f frames\r\n",
+                           r.cycles_per_frame, r.model_cycles, r.ripple_db,
+                           r.rejection_db, r.latency_frames);
+            } else {
+                cdc_printf("  %ux failed (memory?)\r\n", factor);
+            }
+        }
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp bench limiter", 17) == 0) {
+        const char *arg = cmd + 17;
+        while (*arg == ' ') arg++;
+        uint32_t rate = *arg ? strtoul(arg, NULL, 10) : 384000;
+        cdc_printf("Look-ahead limiter @ %lu Hz (cyc/sample per channel):\r\n",
+                   (unsigned long)rate);
+        for (int m = DSP_LIMITER_LOOKAHEAD; m < DSP_LIMITER_MODE_COUNT; m++) {
+            audio_pipeline_limiter_bench_t r;
+            audio_pipeline_bench_limiter((dsp_limiter_mode_t)m, rate, &r);
+            if (r.ok) {
+                cdc_printf("  %-9s %6.1f measured, %3u model | look-ahead %u, latency %u frames, "
+                           "peak %.2f dBFS\r\n", dsp_chain_limiter_name(r.mode),
+                           r.cycles_per_sample, r.model_cycles, r.lookahead, r.latency, r.peak_db);
+            } else {
+                cdc_printf("  %-9s failed (memory?)\r\n", dsp_chain_limiter_name((dsp_limiter_mode_t)m));
+            }
+        }
+        return true;
+    }
+
+    if (strcmp(cmd, "dsp bench dsd") == 0) {
+        static const uint32_t dsd_rates[] = { 2822400, 5644800, 11289600 };
+        static const uint32_t pcm_rates[] = { DSD2PCM_RATE_88K, DSD2PCM_RATE_176K };
+        cdc_printf("DSD -> PCM decimator (cyc per output frame, stereo):\r\n");
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 2; j++) {
+                audio_pipeline_dsd_bench_t r;
+                audio_pipeline_bench_dsd(dsd_rates[i], pcm_rates[j], &r);
+                if (r.ok) {
+                    cdc_printf("  DSD%-3lu -> %6lu Hz: %7.1f measured, %5lu model | %6.1f Mcyc/s\r\n",
+                               (unsigned long)(r.dsd_rate / 44100), (unsigned long)r.pcm_rate,
+                               r.cycles_per_frame, (unsigned long)r.model_cycles,
+                               r.mcycles_per_sec);
+                } else {
+                    cdc_printf("  DSD%-3lu -> %6lu Hz: failed (memory?)\r\n",
+                               (unsigned long)(dsd_rates[i] / 44100), (unsigned long)pcm_rates[j]);
+                }
+            }
+        }
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp dsd", 7) == 0 && (cmd[7] == '\0' || cmd[7] == ' ')) {
+        static const char *const names[CODEC_DSD_OUTPUT_COUNT] = { "dop", "88k", "176k" };
+        const char *arg = cmd + 7;
+        while (*arg == ' ') arg++;
+        if (*arg) {
+            int mode = -1;
+            for (int i = 0; i < CODEC_DSD_OUTPUT_COUNT; i++) {
+                if (strcmp(arg, names[i]) == 0) mode = i;
+            }
+            if (mode < 0) {
+                cdc_printf("Usage: dsp dsd [dop|88k|176k]\r\n");
+                return true;
+            }
+            codec_set_dsd_output((codec_dsd_output_t)mode);
+        }
+        codec_dsd_output_t mode = codec_get_dsd_output();
+        if (mode == CODEC_DSD_DOP) {
+            cdc_printf("DSD output: DoP (bit-exact, DSP bypassed)\r\n");
+            return true;
+        }
+        uint32_t pcm_rate = (mode == CODEC_DSD_PCM_88K) ? DSD2PCM_RATE_88K : DSD2PCM_RATE_176K;
+        cdc_printf("DSD output: PCM %lu Hz through the DSP chain, from the next track\r\n",
+                   (unsigned long)pcm_rate);
+        for (uint32_t dsd = 2822400; dsd <= 11289600; dsd *= 2) {
+            uint32_t cyc = dsd2pcm_cycles_per_frame(dsd, pcm_rate);
+            cdc_printf("  DSD%-3lu: ~%4lu cyc/frame, %5.1f Mcyc/s decoder load\r\n",
+                       (unsigned long)(dsd / 44100), (unsigned long)cyc,
+                       (float)cyc * (float)pcm_rate / 1e6f);
+        }
+        // Decimation runs in the decoder on the audio core: it adds to the chain's load
+        dsp_budget_t b;
+        audio_pipeline_get_budget(&b);
+        cdc_printf("DSP budget @ %lu Hz: %u / %u cycles used\r\n",
+                   (unsigned long)b.sample_rate, b.cycles_used, b.cycles_available);
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp kernel", 10) == 0 && (cmd[10] == '\0' || cmd[10] == ' ')) {
+        const char *arg = cmd + 10;
+        while (*arg == ' ') arg++;
+        if (*arg) {
+            int mode = -1;
+            for (int i = 0; i < DSP_KERNEL_MODE_COUNT; i++) {
+                if (strcmp(arg, dsp_chain_kernel_name((dsp_kernel_mode_t)i)) == 0) mode = i;
+            }
+            if (mode < 0) {
+                cdc_printf("Usage: dsp kernel [auto|float|fixed]\r\n");
+                return true;
+            }
+            audio_pipeline_set_kernel_mode((dsp_kernel_mode_t)mode);
+        }
+        dsp_budget_t b;
+        audio_pipeline_get_budget(&b);
+        cdc_printf("Biquad kernel: %s, %u of %u filters on Q31 @ %lu Hz\r\n",
+                   dsp_chain_kernel_name(audio_pipeline_get_kernel_mode()),
+                   b.filters_fixed, b.filters_active, (unsigned long)b.sample_rate);
+        cdc_printf("DSP budget: %u / %u cycles used\r\n", b.cycles_used, b.cycles_available);
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp dither", 10) == 0 && (cmd[10] == '\0' || cmd[10] == ' ')) {
+        const char *arg = cmd + 10;
+        while (*arg == ' ') arg++;
+        if (*arg) {
+            int mode = -1;
+            for (int i = 0; i < DSP_DITHER_COUNT; i++) {
+                if (strcmp(arg, dsp_dither_name((dsp_dither_t)i)) == 0) mode = i;
+            }
+            if (mode < 0) {
+                cdc_printf("Usage: dsp dither [off|tpdf|shaped]\r\n");
+                return true;
+            }
+            audio_pipeline_set_dither((dsp_dither_t)mode);
+        }
+        uint32_t rate;
+        uint8_t bits;
+        audio_pipeline_get_format(&rate, &bits);
+        cdc_printf("Dither: %s (%s)\r\n", dsp_dither_name(audio_pipeline_get_dither()),
+                   (bits <= 16) ? "16-bit output: applied" : "32-bit output: rounding only");
+        return true;
+    }
+
+    if (strcmp(cmd, "dsp meters") == 0) {
+        audio_analysis_t m;
+        if (!audio_analysis_get(&m)) {
+            cdc_printf("Meters: no data yet\r\n");
+            return true;
+        }
+        cdc_printf("Meters @ %lu Hz%s\r\n", (unsigned long)m.sample_rate, m.clip ? "  CLIP" : "");
+        for (int ch = 0; ch < 2; ch++) {
+            cdc_printf("  %c: peak %6.1f  rms %6.1f  true-peak %6.1f  hold %6.1f dB\r\n",
+                       ch ? 'R' : 'L', m.peak_db[ch], m.rms_db[ch],
+                       m.true_peak_db[ch], m.hold_db[ch]);
+        }
+        if (!m.spectrum_valid) {
+            // This read woke the FFT up; the next one has bands
+            cdc_printf("  Spectrum: idle, run again\r\n");
+            return true;
+        }
+        for (int b = 0; b < AUDIO_ANALYSIS_BANDS; b++) {
+            cdc_printf("  %7.0f Hz %6.1f dB\r\n", audio_analysis_band_hz(b), m.band_db[b]);
+        }
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp quality", 11) == 0 && (cmd[11] == '\0' || cmd[11] == ' ')) {
+        const char *arg = cmd + 11;
+        while (*arg == ' ') arg++;
+        if (strcmp(arg, "on") == 0) {
+            audio_pipeline_set_quality_adaptive(true);
+        } else if (strcmp(arg, "off") == 0) {
+            audio_pipeline_set_quality_adaptive(false);
+        } else if (*arg) {
+            cdc_printf("Usage: dsp quality [on|off]\r\n");
+            return true;
+        }
+        dsp_budget_t b;
+        audio_pipeline_get_budget(&b);
+        const dsp_stats_t *st = audio_pipeline_get_stats();
+        cdc_printf("Adaptive quality: %s, level %s (%u filters folded away)\r\n",
+                   audio_pipeline_get_quality_adaptive() ? "on" : "off",
+                   dsp_chain_quality_name(b.quality), b.filters_merged);
+        cdc_printf("Measured load: %.1f%% of block deadline (last block %lu / %lu cyc), "
+                   "%lu overruns\r\n", b.load_percent, (unsigned long)st->cycles_used,
+                   (unsigned long)st->cycles_available, (unsigned long)st->buffer_underruns);
+        cdc_printf("DSP budget @ %lu Hz: %u / %u cycles used\r\n",
+                   (unsigned long)b.sample_rate, b.cycles_used, b.cycles_available);
+        return true;
+    }
+
+    if (strcmp(cmd, "dsp prof") == 0 || strcmp(cmd, "dsp prof reset") == 0) {
+        if (cmd[8] == ' ') {
+            audio_pipeline_reset_profile();
+            cdc_printf("DSP profile cleared\r\n");
+            return true;
+        }
+        dsp_budget_t b;
+        audio_pipeline_get_budget(&b);
+        cdc_printf("DSP profile @ %lu Hz, cyc/sample (budget %u, model %u):\r\n",
+                   (unsigned long)b.sample_rate, b.cycles_per_sample, b.cycles_model);
+        cdc_printf("  stage       p50      p99      max  records\r\n");
+        for (int st = 0; st < DSP_STAGE_COUNT; st++) {
+            dsp_prof_stats_t p;
+            audio_pipeline_get_stage_stats(b.sample_rate, (dsp_stage_t)st, &p);
+            if (p.count == 0) continue;
+            cdc_printf("  %-8s %7.2f  %7.2f  %7.2f  %7lu\r\n",
+                       dsp_chain_stage_name((dsp_stage_t)st), p.p50, p.p99, p.max,
+                       (unsigned long)p.count);
+        }
+        dsp_prof_stats_t bq;
+        uint8_t n_float = b.filters_active - b.filters_fixed;
+        audio_pipeline_get_stage_stats(b.sample_rate, DSP_STAGE_BIQUAD, &bq);
+        if (bq.count && n_float) {
+            cdc_printf("  float biquad: %.2f cyc/sample per section (p50)\r\n", bq.p50 / n_float);
+        }
+        static const uint32_t rates[] = {
+            44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000,
+        };
+        for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+            dsp_prof_stats_t p;
+            audio_pipeline_get_stage_stats(rates[i], DSP_STAGE_TOTAL, &p);
+            if (p.count == 0 || rates[i] == b.sample_rate) continue;
+            cdc_printf("  total @ %6lu Hz: p50 %.2f  p99 %.2f  max %.2f\r\n",
+                       (unsigned long)rates[i], p.p50, p.p99, p.max);
+        }
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp src", 7) == 0 && (cmd[7] == '\0' || cmd[7] == ' ')) {
+        const char *arg = cmd + 7;
+        while (*arg == ' ') arg++;
+        if (strcmp(arg, "off") == 0) {
+            audio_engine_set_fixed_rate(0, DSP_SRC_QUALITY_MEDIUM);
+        } else if (*arg) {
+            unsigned rate = 0;
+            char q[8] = "medium";
+            sscanf(arg, "%u %7s", &rate, q);
+            int quality = -1;
+            for (int i = 0; i < DSP_SRC_QUALITY_COUNT; i++) {
+                if (strcmp(q, dsp_src_quality_name((dsp_src_quality_t)i)) == 0) quality = i;
+            }
+            if (rate < 8000 || rate > 384000 || quality < 0) {
+                cdc_printf("Usage: dsp src [off|<rate> [low|medium|high]]\r\n");
+                return true;
+            }
+            audio_engine_set_fixed_rate(rate, (dsp_src_quality_t)quality);
+        }
+        dsp_src_quality_t q;
+        uint32_t rate = audio_engine_get_fixed_rate(&q);
+        if (rate) {
+            cdc_printf("Fixed output rate: %lu Hz, SRC %s (~%u cyc/frame from 44.1k), "
+                       "from the next track/stream\r\n", (unsigned long)rate,
+                       dsp_src_quality_name(q), dsp_src_cycles_per_frame(44100, rate, q));
+        } else {
+            cdc_printf("Fixed output rate: off (I2S follows each stream)\r\n");
+        }
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp os", 6) == 0 && (cmd[6] == '\0' || cmd[6] == ' ')) {
+        const char *arg = cmd + 6;
+        while (*arg == ' ') arg++;
+        if (*arg) {
+            char f[8] = "", ph[8] = "linear";
+            sscanf(arg, "%7s %7s", f, ph);
+            unsigned factor = (strcmp(f, "off") == 0) ? 1 : (unsigned)strtoul(f, NULL, 10);
+            int phase = -1;
+            for (int i = 0; i < DSP_OS_PHASE_COUNT; i++) {
+                if (strcmp(ph, dsp_os_phase_name((dsp_os_phase_t)i)) == 0) phase = i;
+            }
+            if ((factor != 1 && factor != 2 && factor != 4 && factor != 8) || phase < 0) {
+                cdc_printf("Usage: dsp os [off|2|4|8 [linear|minimum]]\r\n");
+                return true;
+            }
+            audio_engine_set_oversampling((uint8_t)factor, (dsp_os_phase_t)phase);
+        }
+        dsp_os_phase_t phase;
+        uint8_t factor = audio_engine_get_oversampling(&phase);
+        if (factor > 1) {
+            cdc_printf("Oversampling: up to %ux, %s phase, capped at %u Hz "
+                       "(~%u cyc/input frame), from the next track/stream\r\n",
+                       factor, dsp_os_phase_name(phase), DSP_OS_MAX_RATE,
+                       dsp_os_cycles_per_frame(factor, phase));
+        } else {
+            cdc_printf("Oversampling: off (DAC interpolates)\r\n");
+        }
+        dsp_budget_t b;
+        audio_pipeline_get_budget(&b);
+        if (b.os_factor > 1) {
+            cdc_printf("Now: DSP @ %lu Hz, %ux to the DAC, %u cyc/sample reserved\r\n",
+                       (unsigned long)b.sample_rate, b.os_factor, b.os_cycles);
+        }
+        cdc_printf("DSP budget: %u / %u cycles used\r\n", b.cycles_used, b.cycles_available);
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp fir load ", 13) == 0) {
+        char file[128];
+        char path[160];
+        unsigned block = 0;
+        if (sscanf(cmd + 13, "%127s %u", file, &block) < 1) {
+            cdc_printf("Usage: dsp fir load <file> [block]\r\n");
+            return true;
+        }
+        // Relative paths are under the SD mount point, like "play"
+        if (file[0] == '/') {
+            snprintf(path, sizeof(path), "%s", file);
+        } else {
+            snprintf(path, sizeof(path), "%s/%s", STORAGE_MOUNT_POINT, file);
+        }
+        cdc_printf("Loading FIR %s ...\r\n", path);
+        cdc_printf(audio_pipeline_load_fir(path, (uint16_t)block) ? "FIR loaded\r\n"
+                                                                   : "FIR load failed\r\n");
+        return true;
+    }
+
+    if (strcmp(cmd, "dsp fir off") == 0) {
+        audio_pipeline_clear_fir();
+        cdc_printf("FIR: off\r\n");
+        return true;
+    }
+
+    if (strcmp(cmd, "dsp fir") == 0) {
+        dsp_budget_t b;
+        audio_pipeline_get_budget(&b);
+        if (b.conv_taps) {
+            cdc_printf("FIR: %lu taps, %u cyc/sample%s\r\n", (unsigned long)b.conv_taps,
+                       b.conv_cycles, b.conv_cycles ? "" : " (inactive: rate mismatch)");
+        } else {
+            cdc_printf("FIR: off\r\n");
+        }
+        cdc_printf("Budget @ %lu Hz: %u / %u cycles used\r\n",
+                   (unsigned long)b.sample_rate, b.cycles_used, b.cycles_available);
+        return true;
+    }
+
+    if (strncmp(cmd, "dsp bench", 9) == 0) {
+        const char *arg = cmd + 9;
+        while (*arg == ' ') arg++;
+        uint8_t n = *arg ? (uint8_t)strtoul(arg, NULL, 10) : DSP_MAX_BIQUADS;
+        audio_pipeline_bench_t r;
+        audio_pipeline_bench_biquads(n, &r);
+        cdc_printf("Biquad kernel: %u sections, %lu frames/pass\r\n",
+                   r.num_filters, (unsigned long)r.frames);
+        cdc_printf("  reference: %.1f cyc/frame\r\n", r.ref_cycles_per_frame);
+        cdc_printf("  cascade:   %.1f cyc/frame (%.2fx)\r\n", r.cascade_cycles_per_frame,
+                   r.cascade_cycles_per_frame > 0.0f
+                   ? r.ref_cycles_per_frame / r.cascade_cycles_per_frame : 0.0f);
+        cdc_printf("  output:    %s\r\n", r.identical ? "bit-identical" : "MISMATCH");
+        cdc_printf("  Q31:       %.1f cyc/frame (%u sections)\r\n",
+                   r.q31_cycles_per_frame, r.q31_sections);
+        if (r.q31_snr_db > 0.0f) {
+            cdc_printf("  SNR vs double: float %.1f dB, Q31 %.1f dB\r\n",
+                       r.float_snr_db, r.q31_snr_db);
+        }
+        return true;
+    }
+
+    return false;
+}
+
 // Format progress callback — prints percentage to CDC
 static void sd_format_progress_cb(uint8_t pct)
 {
@@ -1663,6 +2162,9 @@ static void cdc_task(void *arg)
     ESP_LOGI(TAG, "CDC task started - Type 'help' for commands");
 
     while (1) {
+        // Apply DSP quality steps requested by the audio task
+        audio_pipeline_update_quality();
+
         // Check for MSC eject (host "Safely Remove Hardware")
         if (storage_msc_eject_pending() && usb_mode_get() == USB_MODE_STORAGE) {
             usb_mode_switch(USB_MODE_AUDIO);
@@ -1711,11 +2213,31 @@ static void cdc_task(void *arg)
                         tud_cdc_write_str("Control:\r\n");
                         tud_cdc_write_str("  on        - Enable DSP\r\n");
                         tud_cdc_write_str("  off       - Disable DSP (bypass)\r\n");
-                        tud_cdc_write_str("  limiter hard|soft - Set limiter mode\r\n");
+                        tud_cdc_write_str("  limiter hard|soft|lookahead|truepeak - Set limiter mode\r\n");
                         tud_cdc_write_str("  crossfeed on|off  - Headphone crossfeed\r\n");
+                        tud_cdc_write_str("  loudness on|off   - ISO 226 loudness (follows USB volume)\r\n");
+                        tud_cdc_write_str("  volume [dB|mute|unmute] - Digital volume (64-bit, ramped)\r\n");
                         tud_cdc_write_str("  eq band/show/save/load - Parametric EQ\r\n");
                         tud_cdc_write_str("  status    - Show current settings\r\n");
                         tud_cdc_write_str("  cpu       - Task CPU%% / stack usage\r\n");
+                        tud_cdc_write_str("  ring      - Jitter buffer level / underruns\r\n");
+                        tud_cdc_write_str("  trace start [underrun] - Record audio path events\r\n");
+                        tud_cdc_write_str("  trace [stop|dump] - Trace status / Chrome trace JSON\r\n");
+                        tud_cdc_write_str("  dsp bench [n] - Biquad kernel cycles/frame, float vs Q31 SNR\r\n");
+                        tud_cdc_write_str("  dsp kernel [auto|float|fixed] - Biquad kernel per section\r\n");
+                        tud_cdc_write_str("  dsp quality [on|off] - Load-adaptive quality level\r\n");
+                        tud_cdc_write_str("  dsp dither [off|tpdf|shaped] - Dither for 16-bit output\r\n");
+                        tud_cdc_write_str("  dsp meters - Output peak/RMS/true-peak and spectrum\r\n");
+                        tud_cdc_write_str("  dsp prof [reset] - Measured cycles per DSP stage (p50/p99/max)\r\n");
+                        tud_cdc_write_str("  dsp bench conv [taps] - FIR cycles per partition size\r\n");
+                        tud_cdc_write_str("  dsp fir [load <file> [block]|off] - FIR convolution\r\n");
+                        tud_cdc_write_str("  dsp src [off|<rate> [low|medium|high]] - Fixed output rate (SRC)\r\n");
+                        tud_cdc_write_str("  dsp bench src <in> <out> [q] - SRC cost, ripple, rejection\r\n");
+                        tud_cdc_write_str("  dsp os [off|2|4|8 [linear|minimum]] - Oversample to the DAC\r\n");
+                        tud_cdc_write_str("  dsp bench os [linear|minimum] - Oversampler cost per stage count\r\n");
+                        tud_cdc_write_str("  dsp bench limiter [rate] - Look-ahead limiter cost (384k)\r\n");
+                        tud_cdc_write_str("  dsp dsd [dop|88k|176k] - DSD as DoP or decimated to PCM\r\n");
+                        tud_cdc_write_str("  dsp bench dsd - DSD->PCM decimator cost per DSD rate\r\n");
                         tud_cdc_write_str("Player:\r\n");
                         tud_cdc_write_str("  play <path>   - Play file (relative to /sdcard)\r\n");
                         tud_cdc_write_str("  pause         - Pause playback\r\n");
@@ -1863,21 +2385,23 @@ static void cdc_task(void *arg)
                     } else if (strncmp(rx_buf, "limiter ", 8) == 0) {
                         const char *mode = rx_buf + 8;
                         while (*mode == ' ') mode++;
-                        if (strcmp(mode, "hard") == 0) {
-                            audio_pipeline_set_limiter_mode(DSP_LIMITER_HARD_CLIP);
-                            save_audio_settings();
-                            cdc_printf("Limiter: Hard Clip\r\n");
-                        } else if (strcmp(mode, "soft") == 0) {
-                            audio_pipeline_set_limiter_mode(DSP_LIMITER_SOFT);
+                        int m = -1;
+                        for (int i = 0; i < DSP_LIMITER_MODE_COUNT; i++) {
+                            if (strcmp(mode, dsp_chain_limiter_name((dsp_limiter_mode_t)i)) == 0) m = i;
+                        }
+                        if (m >= 0) {
+                            audio_pipeline_set_limiter_mode((dsp_limiter_mode_t)m);
                             save_audio_settings();
-                            cdc_printf("Limiter: Soft (Pade tanh)\r\n");
+                            dsp_budget_t b;
+                            audio_pipeline_get_budget(&b);
+                            cdc_printf("Limiter: %s (+%u cyc/sample)\r\n",
+                                       dsp_chain_limiter_name((dsp_limiter_mode_t)m), b.limiter_cycles);
                         } else {
-                            cdc_printf("Usage: limiter hard|soft\r\n");
+                            cdc_printf("Usage: limiter hard|soft|lookahead|truepeak\r\n");
                         }
                     } else if (strcmp(rx_buf, "limiter") == 0) {
                         cdc_printf("Limiter: %s\r\n",
-                                   audio_pipeline_get_limiter_mode() == DSP_LIMITER_SOFT
-                                   ? "Soft" : "Hard Clip");
+                                   dsp_chain_limiter_name(audio_pipeline_get_limiter_mode()));
                     } else if (strncmp(rx_buf, "crossfeed ", 10) == 0) {
                         const char *arg = rx_buf + 10;
                         while (*arg == ' ') arg++;
@@ -1893,6 +2417,58 @@ static void cdc_task(void *arg)
                     } else if (strcmp(rx_buf, "crossfeed") == 0) {
                         cdc_printf("Crossfeed: %s\r\n",
                                    audio_pipeline_get_crossfeed() ? "ON" : "OFF");
+                    } else if (strncmp(rx_buf, "loudness ", 9) == 0) {
+                        const char *arg = rx_buf + 9;
+                        while (*arg == ' ') arg++;
+                        if (strcmp(arg, "on") == 0) {
+                            audio_pipeline_set_loudness(true);
+                            cdc_printf("Loudness: ON\r\n");
+                        } else if (strcmp(arg, "off") == 0) {
+                            audio_pipeline_set_loudness(false);
+                            cdc_printf("Loudness: OFF\r\n");
+                        } else {
+                            cdc_printf("Usage: loudness on|off\r\n");
+                        }
+                    } else if (strcmp(rx_buf, "loudness") == 0) {
+                        float level = audio_pipeline_get_listening_level();
+                        float bass, treble;
+                        dsp_loudness_get_gains(level, &bass, &treble);
+                        cdc_printf("Loudness: %s, level %.1f dB (%.0f phon)\r\n",
+                                   audio_pipeline_get_loudness() ? "ON" : "OFF",
+                                   level, DSP_LOUDNESS_REF_PHON + level);
+                        cdc_printf("  Shelves: bass %+.1f dB @ %.0f Hz, treble %+.1f dB @ %.0f Hz\r\n",
+                                   bass, DSP_LOUDNESS_BASS_HZ, treble, DSP_LOUDNESS_TREBLE_HZ);
+                        cdc_printf("  ISO 226: %+.1f dB @ 31.5 Hz, %+.1f dB @ 100 Hz, %+.1f dB @ 10 kHz\r\n",
+                                   dsp_loudness_target_db(level, 31.5f),
+                                   dsp_loudness_target_db(level, 100.0f),
+                                   dsp_loudness_target_db(level, 10000.0f));
+                    } else if (strncmp(rx_buf, "volume", 6) == 0 &&
+                               (rx_buf[6] == '\0' || rx_buf[6] == ' ')) {
+                        const char *arg = rx_buf + 6;
+                        while (*arg == ' ') arg++;
+                        bool ok = true;
+                        if (strcmp(arg, "mute") == 0) {
+                            audio_pipeline_set_mute(true);
+                        } else if (strcmp(arg, "unmute") == 0) {
+                            audio_pipeline_set_mute(false);
+                        } else if (*arg) {
+                            char *end;
+                            float db = strtof(arg, &end);
+                            ok = (end != arg && db <= 0.0f);
+                            if (ok) {
+                                audio_pipeline_set_volume(db);
+                            } else {
+                                cdc_printf("Usage: volume [<dB 0..-100>|mute|unmute]\r\n");
+                            }
+                        }
+                        if (ok) {
+                            dsp_budget_t b;
+                            audio_pipeline_get_budget(&b);
+                            cdc_printf("Volume: %.1f dB%s, dither %s (+%u cyc/sample)\r\n",
+                                       audio_pipeline_get_volume(),
+                                       audio_pipeline_get_mute() ? " (muted)" : "",
+                                       dsp_dither_name(audio_pipeline_get_dither()), b.volume_cycles);
+                        }
                     } else if (strncmp(rx_buf, "eq ", 3) == 0) {
                         const char *eq_cmd = rx_buf + 3;
                         while (*eq_cmd == ' ') eq_cmd++;
@@ -2025,14 +2601,55 @@ static void cdc_task(void *arg)
                         const char *rpt_names[] = {"OFF", "ONE", "ALL"};
                         repeat_mode_t rpt = sd_player_get_repeat();
                         cdc_printf("Status:\r\n  Preset: %s\r\n  DSP: %s\r\n  Limiter: %s\r\n  Crossfeed: %s\r\n"
-                                   "  Shuffle: %s\r\n  Repeat: %s\r\n",
+                                   "  Loudness: %s\r\n  Shuffle: %s\r\n  Repeat: %s\r\n",
                                    preset_get_name(audio_pipeline_get_preset()),
                                    audio_pipeline_is_enabled() ? "ON" : "OFF",
-                                   audio_pipeline_get_limiter_mode() == DSP_LIMITER_SOFT
-                                   ? "Soft" : "Hard Clip",
+                                   dsp_chain_limiter_name(audio_pipeline_get_limiter_mode()),
                                    audio_pipeline_get_crossfeed() ? "ON" : "OFF",
+                                   audio_pipeline_get_loudness() ? "ON" : "OFF",
                                    sd_player_get_shuffle() ? "ON" : "OFF",
                                    (rpt <= REPEAT_ALL) ? rpt_names[rpt] : "?");
+                    } else if (strcmp(rx_buf, "ring") == 0) {
+                        // Jitter buffer level + counters since last 'ring' call
+                        static const char *prof_names[] = { "USB", "SD", "Stream" };
+                        audio_ring_stats_t rs;
+                        audio_ring_get_stats(&rs);
+                        audio_ring_reset_stats();
+                        cdc_printf("Ring (%s, %s): %lu/%lu blocks, %lu/%lu ms%s\r\n",
+                                   prof_names[rs.profile], rs.in_psram ? "PSRAM" : "internal",
+                                   rs.used_blocks, rs.depth, rs.fill_ms, rs.depth_ms,
+                                   rs.buffering ? " [buffering]" : "");
+                        cdc_printf("  watermarks high=%lu low=%lu | min=%lu max=%lu\r\n",
+                                   rs.high_wm, rs.low_wm, rs.min_blocks, rs.max_blocks);
+                        cdc_printf("  underruns=%lu rebuffers=%lu low=%lu full=%lu committed=%lu\r\n",
+                                   rs.underruns, rs.rebuffers, rs.low_events,
+                                   rs.full_count, rs.committed);
+                    } else if (strcmp(rx_buf, "trace start") == 0) {
+                        if (audio_trace_start(AUDIO_TRACE_SYNC))
+                            cdc_printf("Trace recording\r\n");
+                        else
+                            cdc_printf("ERR: no memory for trace rings\r\n");
+                    } else if (strcmp(rx_buf, "trace start underrun") == 0) {
+                        // Free-running until the first underrun, then frozen
+                        if (audio_trace_start(AUDIO_TRACE_UNDERRUN))
+                            cdc_printf("Trace armed: freezes on underrun\r\n");
+                        else
+                            cdc_printf("ERR: no memory for trace rings\r\n");
+                    } else if (strcmp(rx_buf, "trace stop") == 0) {
+                        audio_trace_stop();
+                        cdc_printf("Trace stopped\r\n");
+                    } else if (strcmp(rx_buf, "trace") == 0) {
+                        audio_trace_status_t ts;
+                        audio_trace_get_status(&ts);
+                        cdc_printf("Trace: %s%s | core0 %lu core1 %lu events (ring %lu)\r\n",
+                                   ts.running ? "recording" : "stopped",
+                                   ts.triggered ? " [triggered]" : (ts.armed ? " [armed]" : ""),
+                                   ts.events[0], ts.events[1], ts.capacity);
+                    } else if (strcmp(rx_buf, "trace dump") == 0) {
+                        // Raw JSON: capture the terminal output to a .json file
+                        // and open it in ui.perfetto.dev or chrome://tracing
+                        uint32_t n = audio_trace_dump(cdc_write_all);
+                        ESP_LOGI(TAG, "Trace dump: %lu events", n);
                     } else if (strcmp(rx_buf, "cpu") == 0) {
                         // Delta-mode CPU stats: shows usage since last 'cpu' call
                         #define CPU_MAX_TASKS 16
@@ -2160,6 +2777,8 @@ static void cdc_task(void *arg)
                             sd_player_cmd_set_repeat(next);
                         }
                         save_audio_settings();
+                    } else if (strncmp(rx_buf, "dsp ", 4) == 0 && handle_dsp_command(rx_buf)) {
+                        // Handled by handle_dsp_command
                     } else if (strncmp(rx_buf, "sd", 2) == 0 && handle_sd_command(rx_buf)) {
                         // Handled by handle_sd_command
                     } else if (strncmp(rx_buf, "wifi ", 5) == 0 && handle_wifi_command(rx_buf)) {
@@ -2476,9 +3095,11 @@ void app_main(void)
     ESP_LOGI(TAG, "Waiting for USB enumeration...");
     vTaskDelay(pdMS_TO_TICKS(500));
 
-    // 5. Audio stream buffer (decouples producer from I2S DMA blocking)
-    s_audio_stream = xStreamBufferCreate(AUDIO_STREAM_BUF_SIZE, 1);
-    assert(s_audio_stream);
+    // 5. Audio block ring (decouples producer from I2S DMA blocking)
+    if (!audio_ring_init()) {
+        ESP_LOGE(TAG, "Audio ring allocation failed!");
+        return;
+    }
 
     // 5.5. Audio source manager
     audio_source_init();
@@ -2488,12 +3109,14 @@ void app_main(void)
     // CPU 0: USB stack (TinyUSB), CDC, and system tasks
     xTaskCreatePinnedToCore(tusb_device_task, "TinyUSB", 16384, NULL, 5, NULL, 0);
     xTaskCreatePinnedToCore(cdc_task, "cdc", 8192, NULL, 3, NULL, 0);
+    audio_analysis_start();     // prio 1: spectrum and meters for the UI
 
     // CPU 1: Audio pipeline (prio 5) + I2S feeder (prio 4)
     // audio_task has higher priority: must drain USB FIFO promptly to avoid overflow
-    // feeder_task runs when audio_task sleeps: feeds I2S DMA from stream buffer
+    // feeder_task runs when audio_task sleeps: feeds I2S DMA from the audio ring
     xTaskCreatePinnedToCore(audio_task, "audio", 16384, NULL, 5, &s_audio_task_handle, 1);
     xTaskCreatePinnedToCore(i2s_feeder_task, "i2s_feed", 8192, NULL, 4, &s_feeder_task_handle, 1);
+    audio_ring_set_consumer(s_feeder_task_handle);
 
     // Set USB audio as default source and register producer handle
     audio_source_set_producer_handle(s_audio_task_handle);
@@ -2504,7 +3127,11 @@ void app_main(void)
         .get_source         = sd_player_cb_get_source,
         .switch_source      = sd_player_cb_switch_source,
         .set_producer_handle = audio_source_set_producer_handle,
-        .get_stream_buffer  = audio_get_stream_buffer,
+        .ring_acquire       = audio_ring_acquire_frames,
+        .ring_commit        = audio_ring_commit_frames,
+        .ring_reset         = audio_ring_reset,
+        .ring_hold          = audio_ring_set_hold,
+        .ring_used          = audio_ring_used_bytes,
         .process_audio      = audio_pipeline_process,
     };
     sd_player_init(cdc_printf, &sd_audio_cbs);
@@ -2524,7 +3151,10 @@ void app_main(void)
         .get_source           = net_audio_cb_get_source,
         .switch_source        = net_audio_cb_switch_source,
         .set_producer_handle  = audio_source_set_producer_handle,
-        .get_stream_buffer    = audio_get_stream_buffer,
+        .ring_acquire         = audio_ring_acquire_frames,
+        .ring_commit          = audio_ring_commit_frames,
+        .ring_used            = audio_ring_used_bytes,
+        .ring_hold            = audio_ring_set_hold,
         .process_audio        = audio_pipeline_process,
         .audio_source_none    = (int)AUDIO_SOURCE_NONE,
         .audio_source_usb     = (int)AUDIO_SOURCE_USB,
@@ -2539,7 +3169,10 @@ void app_main(void)
         .get_source          = net_audio_cb_get_source,
         .switch_source       = net_audio_cb_switch_source,
         .set_producer_handle = audio_source_set_producer_handle,
-        .get_stream_buffer   = audio_get_stream_buffer,
+        .ring_acquire        = audio_ring_acquire_frames,
+        .ring_commit         = audio_ring_commit_frames,
+        .ring_reset          = audio_ring_reset,
+        .ring_hold           = audio_ring_set_hold,
         .process_audio       = audio_pipeline_process,
     };
     spotify_init("Lyra", &spotify_cbs);
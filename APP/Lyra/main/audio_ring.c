@@ -0,0 +1,477 @@
+#include "audio_ring.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "audio_trace.h"
+
+static const char *TAG = "audio_ring";
+
+//--------------------------------------------------------------------+
+// Profiles
+//--------------------------------------------------------------------+
+
+typedef struct {
+    uint16_t depth_ms;      // Target capacity
+    uint8_t  high_pct;      // Prefill, % of depth (0 = start immediately)
+    uint8_t  low_pct;       // Low watermark, % of depth
+    bool     psram;         // Use the deep pool
+    bool     rebuffer;      // Re-enter prefill after an underrun
+} ring_profile_t;
+
+static const ring_profile_t s_profiles[] = {
+    [AUDIO_RING_PROFILE_USB]    = { .depth_ms = 0,    .high_pct = 0,  .low_pct = 25, .psram = false, .rebuffer = false },
+    [AUDIO_RING_PROFILE_LOCAL]  = { .depth_ms = 500,  .high_pct = 50, .low_pct = 20, .psram = true,  .rebuffer = false },
+    [AUDIO_RING_PROFILE_STREAM] = { .depth_ms = 2000, .high_pct = 50, .low_pct = 15, .psram = true,  .rebuffer = true  },
+};
+
+//--------------------------------------------------------------------+
+// State
+//--------------------------------------------------------------------+
+//
+// head and tail are free-running block counters: the producer only writes
+// head, the consumer only writes tail. Block i lives at slot i % depth.
+// Queued = head - tail (unsigned wrap is harmless).
+//
+// Everything that moves tail or changes the geometry (reset, configure)
+// is posted as a request and applied by the feeder in audio_ring_peek(),
+// so tail, mem and depth keep a single writer.
+//
+// The producer is not stopped while the feeder applies a geometry change:
+// a commit can check the epoch, lose the CPU to the feeder and land after
+// the change, filled in a slot of the old geometry. Each committed slot is
+// tagged with the epoch of its acquire, and the feeder skips any block
+// whose tag is not the current epoch.
+//
+// The feeder copies cfg into g field by field, so nothing but the feeder
+// reads g directly: the producer takes a snapshot (geom_snapshot(),
+// seqlock on cfg_pending / epoch) at acquire and works from it until the
+// commit. A torn read could otherwise pair the fast pool with the deep
+// pool's depth.
+
+typedef struct {
+    uint8_t *mem;
+    uint32_t depth;
+    uint32_t high_wm;
+    uint32_t low_wm;
+    bool     rebuffer;
+    bool     in_psram;
+} ring_geom_t;
+
+static struct {
+    uint8_t *fast_mem;                      // FAST_BLOCKS, internal RAM
+    uint8_t *deep_mem;                      // MAX_BLOCKS, PSRAM (may be NULL)
+
+    ring_geom_t g;                          // Active geometry (feeder writes)
+    uint32_t len[AUDIO_RING_MAX_BLOCKS];    // Valid bytes per slot
+    uint32_t tag[AUDIO_RING_MAX_BLOCKS];    // Epoch the slot was acquired in
+    uint32_t head;                          // Blocks committed (producer)
+    uint32_t tail;                          // Blocks released (consumer)
+    uint32_t epoch;                         // Bumped on every geometry change
+    uint32_t acq_epoch;                     // Epoch seen by the last acquire
+    uint32_t acq_depth;                     // Depth of that geometry (producer)
+
+    // Requests (control / producer → feeder)
+    ring_geom_t cfg;
+    bool     cfg_pending;
+    uint32_t drop_to;
+    bool     drop_pending;
+
+    // Feeder state
+    bool     buffering;                     // Waiting for high_wm
+    bool     starved;                       // Underrun already counted
+    bool     low;                           // Below low_wm already counted
+    volatile bool hold;                     // Paused: don't drain
+    volatile uint32_t last_commit_tick;
+
+    audio_ring_profile_t profile;
+    uint32_t sample_rate;
+    uint32_t frame_bytes;
+    volatile TaskHandle_t consumer;
+} s_ring;
+
+static volatile struct {
+    uint32_t min_blocks;
+    uint32_t max_blocks;
+    uint32_t full_count;
+    uint32_t underruns;
+    uint32_t rebuffers;
+    uint32_t low_events;
+    uint32_t committed;
+} s_stats;
+
+static inline uint32_t load_acq(const uint32_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_rel(uint32_t *p, uint32_t v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline uint8_t *slot_ptr(const ring_geom_t *g, uint32_t index)
+{
+    return g->mem + (index % g->depth) * AUDIO_RING_BLOCK_BYTES;
+}
+
+// Consistent copy of the active geometry for readers other than the
+// feeder. False while a change is pending (the caller reports the ring
+// full / empty until the feeder has applied it).
+static bool geom_snapshot(ring_geom_t *g, uint32_t *epoch)
+{
+    for (;;) {
+        if (__atomic_load_n(&s_ring.cfg_pending, __ATOMIC_ACQUIRE)) return false;
+        const uint32_t e = load_acq(&s_ring.epoch);
+        *g = s_ring.g;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&s_ring.cfg_pending, __ATOMIC_ACQUIRE)) return false;
+        if (__atomic_load_n(&s_ring.epoch, __ATOMIC_RELAXED) == e) {
+            if (epoch) *epoch = e;
+            return true;
+        }
+        // Applied while we copied: take the new one
+    }
+}
+
+static void notify_consumer(void)
+{
+    TaskHandle_t consumer = s_ring.consumer;
+    if (consumer) xTaskNotifyGive(consumer);
+}
+
+//--------------------------------------------------------------------+
+// Geometry
+//--------------------------------------------------------------------+
+
+static ring_geom_t build_geom(audio_ring_profile_t profile, uint32_t sample_rate)
+{
+    const ring_profile_t *p = &s_profiles[profile];
+    ring_geom_t g = {
+        .mem      = s_ring.fast_mem,
+        .depth    = AUDIO_RING_FAST_BLOCKS,
+        .rebuffer = p->rebuffer,
+        .in_psram = false,
+    };
+
+    if (p->psram && s_ring.deep_mem && sample_rate > 0) {
+        uint64_t frames = (uint64_t)p->depth_ms * sample_rate / 1000;
+        uint32_t blocks = (uint32_t)((frames + AUDIO_RING_BLOCK_FRAMES - 1) / AUDIO_RING_BLOCK_FRAMES);
+        if (blocks < AUDIO_RING_FAST_BLOCKS) blocks = AUDIO_RING_FAST_BLOCKS;
+        if (blocks > AUDIO_RING_MAX_BLOCKS)  blocks = AUDIO_RING_MAX_BLOCKS;
+        g.mem = s_ring.deep_mem;
+        g.depth = blocks;
+        g.in_psram = true;
+    } else if (p->psram) {
+        ESP_LOGW(TAG, "No PSRAM pool — %u block internal ring only",
+                 (unsigned)AUDIO_RING_FAST_BLOCKS);
+    }
+
+    g.high_wm = g.depth * p->high_pct / 100;
+    g.low_wm  = g.depth * p->low_pct / 100;
+    if (p->high_pct > 0 && g.high_wm == 0) g.high_wm = 1;
+    return g;
+}
+
+//--------------------------------------------------------------------+
+// Init
+//--------------------------------------------------------------------+
+
+bool audio_ring_init(void)
+{
+    if (s_ring.fast_mem) return true;
+
+    // Internal RAM for the low-latency pool: USB refills it every 1 ms and
+    // PSRAM bandwidth is shared with the display
+    s_ring.fast_mem = heap_caps_aligned_calloc(AUDIO_RING_ALIGN, AUDIO_RING_FAST_BLOCKS,
+                                               AUDIO_RING_BLOCK_BYTES,
+                                               MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!s_ring.fast_mem) {
+        ESP_LOGE(TAG, "Failed to allocate %u x %u byte ring",
+                 (unsigned)AUDIO_RING_FAST_BLOCKS, (unsigned)AUDIO_RING_BLOCK_BYTES);
+        return false;
+    }
+
+    // Deep pool for SD / network: optional, sources fall back to the fast pool
+    s_ring.deep_mem = heap_caps_aligned_calloc(AUDIO_RING_ALIGN, AUDIO_RING_MAX_BLOCKS,
+                                               AUDIO_RING_BLOCK_BYTES,
+                                               MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s_ring.deep_mem) {
+        ESP_LOGW(TAG, "PSRAM jitter pool unavailable (%u KB)",
+                 (unsigned)(AUDIO_RING_MAX_BLOCKS * AUDIO_RING_BLOCK_BYTES / 1024));
+    }
+
+    s_ring.profile = AUDIO_RING_PROFILE_USB;
+    s_ring.frame_bytes = 2 * sizeof(int32_t);
+    s_ring.g = build_geom(AUDIO_RING_PROFILE_USB, 0);
+    audio_ring_reset_stats();
+
+    ESP_LOGI(TAG, "Ring: %u blocks x %u bytes internal, %u blocks PSRAM",
+             (unsigned)AUDIO_RING_FAST_BLOCKS, (unsigned)AUDIO_RING_BLOCK_BYTES,
+             s_ring.deep_mem ? (unsigned)AUDIO_RING_MAX_BLOCKS : 0u);
+    return true;
+}
+
+void audio_ring_set_consumer(TaskHandle_t handle)
+{
+    s_ring.consumer = handle;
+}
+
+//--------------------------------------------------------------------+
+// Producer side
+//--------------------------------------------------------------------+
+
+void *audio_ring_acquire(size_t *capacity)
+{
+    // Geometry change in flight: report full until the feeder applies it
+    ring_geom_t g;
+    uint32_t epoch;
+    if (!geom_snapshot(&g, &epoch)) {
+        return NULL;
+    }
+
+    uint32_t head = s_ring.head;
+    if (head - load_acq(&s_ring.tail) >= g.depth) {
+        s_stats.full_count++;
+        AUDIO_TRACE_INSTANT(AUDIO_TRACE_RING_FULL, head - s_ring.tail);
+        return NULL;
+    }
+    s_ring.acq_epoch = epoch;
+    s_ring.acq_depth = g.depth;
+    if (capacity) *capacity = AUDIO_RING_BLOCK_BYTES;
+    return slot_ptr(&g, head);
+}
+
+void audio_ring_commit(size_t bytes)
+{
+    if (bytes == 0) return;
+    if (bytes > AUDIO_RING_BLOCK_BYTES) bytes = AUDIO_RING_BLOCK_BYTES;
+
+    // Block was acquired under an older geometry, or one is about to be
+    // applied — its slot is gone. (A change applied right after this check
+    // is caught by the feeder through the tag.)
+    if (__atomic_load_n(&s_ring.cfg_pending, __ATOMIC_ACQUIRE) ||
+        s_ring.acq_epoch != load_acq(&s_ring.epoch)) {
+        return;
+    }
+
+    uint32_t head = s_ring.head;
+    uint32_t slot = head % s_ring.acq_depth;
+    s_ring.len[slot] = (uint32_t)bytes;
+    s_ring.tag[slot] = s_ring.acq_epoch;
+    store_rel(&s_ring.head, head + 1);
+    s_ring.last_commit_tick = xTaskGetTickCount();
+
+    uint32_t used = head + 1 - load_acq(&s_ring.tail);
+    if (used > s_stats.max_blocks) s_stats.max_blocks = used;
+    s_stats.committed++;
+    AUDIO_TRACE_INSTANT(AUDIO_TRACE_RING_COMMIT, used);
+
+    notify_consumer();
+}
+
+int32_t *audio_ring_acquire_frames(uint32_t *max_frames)
+{
+    int32_t *blk = audio_ring_acquire(NULL);
+    if (blk && max_frames) *max_frames = AUDIO_RING_BLOCK_FRAMES;
+    return blk;
+}
+
+void audio_ring_commit_frames(uint32_t frames)
+{
+    audio_ring_commit((size_t)frames * 2 * sizeof(int32_t));
+}
+
+//--------------------------------------------------------------------+
+// Consumer side
+//--------------------------------------------------------------------+
+
+static bool producer_idle(void)
+{
+    return (xTaskGetTickCount() - s_ring.last_commit_tick) >= pdMS_TO_TICKS(AUDIO_RING_IDLE_MS);
+}
+
+const void *audio_ring_peek(size_t *bytes)
+{
+    // Apply pending requests here so tail and geometry keep a single writer
+    if (__atomic_load_n(&s_ring.cfg_pending, __ATOMIC_ACQUIRE)) {
+        // The producer may still commit a block acquired before this (see
+        // State); it lands past the new tail with the old epoch's tag
+        s_ring.g = s_ring.cfg;
+        store_rel(&s_ring.tail, load_acq(&s_ring.head));
+        store_rel(&s_ring.epoch, s_ring.epoch + 1);
+        __atomic_store_n(&s_ring.drop_pending, false, __ATOMIC_RELAXED);
+        s_ring.buffering = (s_ring.g.high_wm > 0);
+        s_ring.starved = true;
+        s_ring.low = false;
+        __atomic_store_n(&s_ring.cfg_pending, false, __ATOMIC_RELEASE);
+    } else if (__atomic_load_n(&s_ring.drop_pending, __ATOMIC_ACQUIRE)) {
+        uint32_t target = load_acq(&s_ring.drop_to);
+        __atomic_store_n(&s_ring.drop_pending, false, __ATOMIC_RELAXED);
+        if ((int32_t)(target - s_ring.tail) > 0) {
+            store_rel(&s_ring.tail, target);
+        }
+        s_ring.buffering = (s_ring.g.high_wm > 0);
+        s_ring.starved = true;
+        s_ring.low = false;
+    }
+
+    if (s_ring.hold) return NULL;
+
+    uint32_t tail = s_ring.tail;
+    const uint32_t head = load_acq(&s_ring.head);
+
+    // Commits that raced a geometry change: drop them unplayed
+    while (tail != head && s_ring.tag[tail % s_ring.g.depth] != s_ring.epoch) {
+        store_rel(&s_ring.tail, ++tail);
+    }
+    uint32_t used = head - tail;
+
+    if (s_ring.buffering) {
+        // High watermark reached, ring full, or producer went quiet
+        // (end of track shorter than the prefill)
+        if (used >= s_ring.g.high_wm || used >= s_ring.g.depth ||
+            (used > 0 && producer_idle())) {
+            s_ring.buffering = false;
+        } else {
+            return NULL;
+        }
+    }
+
+    if (used < s_stats.min_blocks) s_stats.min_blocks = used;
+
+    if (used == 0) {
+        // Only a gap the producer didn't intend counts as an underrun
+        if (!s_ring.starved && !producer_idle()) {
+            s_stats.underruns++;
+            AUDIO_TRACE_INSTANT(AUDIO_TRACE_UNDERRUN, s_stats.underruns);
+            if (s_ring.g.rebuffer) {
+                s_ring.buffering = true;
+                s_stats.rebuffers++;
+            }
+        }
+        s_ring.starved = true;
+        return NULL;
+    }
+    s_ring.starved = false;
+
+    if (used < s_ring.g.low_wm) {
+        if (!s_ring.low) s_stats.low_events++;
+        s_ring.low = true;
+    } else {
+        s_ring.low = false;
+    }
+
+    AUDIO_TRACE_INSTANT(AUDIO_TRACE_RING_PEEK, used);
+    if (bytes) *bytes = s_ring.len[tail % s_ring.g.depth];
+    return slot_ptr(&s_ring.g, tail);
+}
+
+void audio_ring_release(void)
+{
+    store_rel(&s_ring.tail, s_ring.tail + 1);
+}
+
+//--------------------------------------------------------------------+
+// Control
+//--------------------------------------------------------------------+
+
+void audio_ring_configure(audio_ring_profile_t profile, uint32_t sample_rate,
+                          uint8_t bits_per_sample)
+{
+    if (!s_ring.fast_mem || profile > AUDIO_RING_PROFILE_STREAM) return;
+
+    s_ring.cfg = build_geom(profile, sample_rate);
+    s_ring.profile = profile;
+    s_ring.sample_rate = sample_rate;
+    s_ring.frame_bytes = (bits_per_sample == 16) ? 2 * sizeof(int16_t) : 2 * sizeof(int32_t);
+    s_ring.hold = false;
+    __atomic_store_n(&s_ring.cfg_pending, true, __ATOMIC_RELEASE);
+    notify_consumer();
+
+    static const char *names[] = { "USB", "LOCAL", "STREAM" };
+    ESP_LOGI(TAG, "Profile %s @ %lu Hz: %lu blocks (%s), prefill %lu, low %lu",
+             names[profile], sample_rate, s_ring.cfg.depth,
+             s_ring.cfg.in_psram ? "PSRAM" : "internal",
+             s_ring.cfg.high_wm, s_ring.cfg.low_wm);
+}
+
+void audio_ring_reset(void)
+{
+    store_rel(&s_ring.drop_to, load_acq(&s_ring.head));
+    __atomic_store_n(&s_ring.drop_pending, true, __ATOMIC_RELEASE);
+
+    // Wake the feeder so the drop is applied promptly
+    notify_consumer();
+}
+
+size_t audio_ring_used_bytes(void)
+{
+    ring_geom_t g;
+    if (!geom_snapshot(&g, NULL)) return 0;
+
+    uint32_t tail = load_acq(&s_ring.tail);
+    uint32_t head = load_acq(&s_ring.head);
+    uint32_t depth = g.depth;
+    size_t total = 0;
+    for (uint32_t i = tail; i != head; i++) {
+        total += s_ring.len[i % depth];
+    }
+    return total;
+}
+
+uint32_t audio_ring_fill_ms(void)
+{
+    uint32_t rate = s_ring.sample_rate;
+    if (rate == 0) return 0;
+    return (uint32_t)((uint64_t)audio_ring_used_bytes() * 1000 / ((uint64_t)rate * s_ring.frame_bytes));
+}
+
+bool audio_ring_is_buffering(void)
+{
+    return s_ring.buffering || __atomic_load_n(&s_ring.cfg_pending, __ATOMIC_ACQUIRE);
+}
+
+void audio_ring_set_hold(bool hold)
+{
+    s_ring.hold = hold;
+    if (!hold) notify_consumer();
+}
+
+void audio_ring_get_stats(audio_ring_stats_t *out)
+{
+    uint32_t tail = load_acq(&s_ring.tail);
+    uint32_t head = load_acq(&s_ring.head);
+    uint32_t rate = s_ring.sample_rate;
+    ring_geom_t g;
+    if (!geom_snapshot(&g, NULL)) g = s_ring.cfg;   // the one about to apply
+
+    out->profile     = s_ring.profile;
+    out->sample_rate = rate;
+    out->depth       = g.depth;
+    out->depth_ms    = rate ? (uint32_t)((uint64_t)g.depth * AUDIO_RING_BLOCK_FRAMES * 1000 / rate) : 0;
+    out->block_bytes = AUDIO_RING_BLOCK_BYTES;
+    out->high_wm     = g.high_wm;
+    out->low_wm      = g.low_wm;
+    out->used_blocks = head - tail;
+    out->used_bytes  = (uint32_t)audio_ring_used_bytes();
+    out->fill_ms     = audio_ring_fill_ms();
+    out->buffering   = audio_ring_is_buffering();
+    out->in_psram    = g.in_psram;
+    out->min_blocks  = (s_stats.min_blocks == UINT32_MAX) ? 0 : s_stats.min_blocks;
+    out->max_blocks  = s_stats.max_blocks;
+    out->full_count  = s_stats.full_count;
+    out->underruns   = s_stats.underruns;
+    out->rebuffers   = s_stats.rebuffers;
+    out->low_events  = s_stats.low_events;
+    out->committed   = s_stats.committed;
+}
+
+void audio_ring_reset_stats(void)
+{
+    s_stats.min_blocks = UINT32_MAX;
+    s_stats.max_blocks = 0;
+    s_stats.full_count = 0;
+    s_stats.underruns  = 0;
+    s_stats.rebuffers  = 0;
+    s_stats.low_events = 0;
+    s_stats.committed  = 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+//--------------------------------------------------------------------+
+// Audio block ring: producer → I2S feeder (single producer, single consumer)
+//--------------------------------------------------------------------+
+//
+// Fixed-size, cache-line-aligned blocks. The active producer decodes and
+// runs DSP directly inside the block it acquired; the feeder hands the
+// same memory to i2s_channel_write(). No intermediate copies.
+//
+// Only one producer is active at a time (audio_source guarantees this by
+// passing through AUDIO_SOURCE_NONE on every switch). Backpressure is the
+// same as with the old StreamBuffer: when the ring is full the producer
+// waits on its task notification, which the feeder gives after every
+// block it releases.
+//
+// Elastic depth: audio_ring_configure() sizes the ring from the source
+// profile and sample rate. USB keeps a few blocks in internal RAM for low
+// latency; SD and network sources get hundreds of milliseconds to seconds
+// from a PSRAM pool, with a prefill (high watermark) before playback
+// starts and a low watermark that flags imminent underruns.
+//--------------------------------------------------------------------+
+
+#define AUDIO_RING_BLOCK_FRAMES  1152    // int32 stereo frames: one MPEG-1 Layer III frame
+#define AUDIO_RING_BLOCK_BYTES   (AUDIO_RING_BLOCK_FRAMES * 2 * sizeof(int32_t))  // 9KB = 144 cache lines
+#define AUDIO_RING_ALIGN         64                                    // cache line
+
+#define AUDIO_RING_FAST_BLOCKS   4       // Internal RAM pool (USB, fallback)
+#define AUDIO_RING_MAX_BLOCKS    256     // PSRAM pool: 2.25 MB, 6.7 s @ 44.1k, 768 ms @ 384k
+
+// Producer silent for this long → play out whatever is queued (end of
+// track during prefill) and don't count the gap as an underrun
+#define AUDIO_RING_IDLE_MS       100
+
+typedef enum {
+    AUDIO_RING_PROFILE_USB,      // UAC2: host clocks the stream, keep latency minimal
+    AUDIO_RING_PROFILE_LOCAL,    // SD card: absorbs FAT / card latency spikes
+    AUDIO_RING_PROFILE_STREAM,   // HTTP, Spotify: absorbs WiFi stalls, rebuffers on underrun
+} audio_ring_profile_t;
+
+typedef struct {
+    audio_ring_profile_t profile;
+    uint32_t sample_rate;
+    uint32_t depth;           // Active ring capacity (blocks)
+    uint32_t depth_ms;        // Capacity in ms at the configured rate
+    uint32_t block_bytes;     // Bytes per block
+    uint32_t high_wm;         // Prefill level before playback (blocks, 0 = none)
+    uint32_t low_wm;          // Below this the feeder flags a near-underrun (blocks)
+    uint32_t used_blocks;     // Blocks queued for I2S right now
+    uint32_t used_bytes;      // Bytes queued for I2S right now
+    uint32_t fill_ms;         // Queued audio in ms
+    bool     buffering;       // Feeder holding off until high_wm
+    bool     in_psram;        // Active pool is the PSRAM one
+    uint32_t min_blocks;      // Min queued blocks seen by the feeder since last reset_stats
+    uint32_t max_blocks;      // Max queued blocks seen by producers since last reset_stats
+    uint32_t full_count;      // Producer found no free block
+    uint32_t underruns;       // Feeder ran dry while the producer was active
+    uint32_t rebuffers;       // Underruns that re-entered prefill (STREAM)
+    uint32_t low_events;      // Dips below low_wm (counted once per dip)
+    uint32_t committed;       // Blocks committed since last reset_stats
+} audio_ring_stats_t;
+
+// Allocate the pools (call once at startup, before any producer runs).
+// Starts in the USB profile.
+bool audio_ring_init(void);
+
+// Register the consumer task (notified on every commit)
+void audio_ring_set_consumer(TaskHandle_t handle);
+
+//--- Producer side ---
+
+// Get the next free block, or NULL if the ring is full (or being
+// reconfigured). *capacity receives the block size in bytes.
+void *audio_ring_acquire(size_t *capacity);
+
+// Queue the acquired block with the number of valid bytes (0 = drop it).
+// Dropped silently if the ring was (or is being) reconfigured since the
+// acquire.
+void audio_ring_commit(size_t bytes);
+
+// Same as above, in int32 stereo frames (used by component producers)
+int32_t *audio_ring_acquire_frames(uint32_t *max_frames);
+void audio_ring_commit_frames(uint32_t frames);
+
+//--- Consumer side ---
+
+// Oldest queued block, or NULL if empty or still prefilling.
+// *bytes receives its length.
+const void *audio_ring_peek(size_t *bytes);
+
+// Return the peeked block to the producer
+void audio_ring_release(void);
+
+//--- Control ---
+
+// Flush and resize for a source profile / format. Call from control
+// context while the producer is idle (audio_source_switch, format change).
+// bits_per_sample only affects the ms figures (16-bit USB packs 4 B/frame).
+void audio_ring_configure(audio_ring_profile_t profile, uint32_t sample_rate,
+                          uint8_t bits_per_sample);
+
+// Drop every queued block and prefill again (seek). Safe from the producer
+// or from a control task; the feeder applies the drop on its next peek.
+void audio_ring_reset(void);
+
+// Bytes / milliseconds currently queued
+size_t audio_ring_used_bytes(void);
+uint32_t audio_ring_fill_ms(void);
+
+// True while the feeder waits for the high watermark
+bool audio_ring_is_buffering(void);
+
+// Pause: the feeder stops draining so queued audio survives until resume
+// (a deep buffer would otherwise keep playing for up to its depth).
+// Cleared by audio_ring_configure().
+void audio_ring_set_hold(bool hold);
+
+void audio_ring_get_stats(audio_ring_stats_t *out);
+void audio_ring_reset_stats(void);
@@ -1,5 +1,7 @@
 #include "audio_source.h"
 #include "audio_pipeline.h"
+#include "audio_ring.h"
+#include "audio_trace.h"
 #include "esp_log.h"
 
 static const char *TAG = "audio_src";
@@ -18,6 +20,17 @@ static audio_source_net_resume_cb_t s_net_resume_cb = NULL;
 // Optional DAC mute callback for click-free transitions
 static audio_source_dac_mute_cb_t s_dac_mute_cb = NULL;
 
+// Jitter buffer profile per source: USB stays low-latency, file and
+// network sources buffer deep in PSRAM
+static audio_ring_profile_t ring_profile_for(audio_source_t src)
+{
+    switch (src) {
+        case AUDIO_SOURCE_SD:  return AUDIO_RING_PROFILE_LOCAL;
+        case AUDIO_SOURCE_NET: return AUDIO_RING_PROFILE_STREAM;
+        default:               return AUDIO_RING_PROFILE_USB;
+    }
+}
+
 void audio_source_register_net_cbs(audio_source_net_pause_cb_t pause_cb,
                                     audio_source_net_resume_cb_t resume_cb)
 {
@@ -60,11 +73,12 @@ void audio_source_switch(audio_source_t new_source,
                 if (s_dac_mute_cb) s_dac_mute_cb(true);
                 audio_set_reconfiguring(true);
                 while (audio_is_feeder_writing()) vTaskDelay(1);
-                StreamBufferHandle_t stream = audio_get_stream_buffer();
-                if (stream) xStreamBufferReset(stream);
                 uint32_t actual_rate = i2s_output_init(new_sample_rate, new_bits_per_sample);
                 if (actual_rate == 0) actual_rate = new_sample_rate;  // safety
                 audio_pipeline_update_format(actual_rate, new_bits_per_sample);
+                AUDIO_TRACE_INSTANT(AUDIO_TRACE_FORMAT, actual_rate);
+                // Flush stale audio and resize the jitter buffer for the new rate
+                audio_ring_configure(ring_profile_for(old), actual_rate, new_bits_per_sample);
                 audio_set_reconfiguring(false);
                 if (s_dac_mute_cb) s_dac_mute_cb(false);
                 ESP_LOGI(TAG, "Reconfig done: requested=%lu actual=%lu Hz",
@@ -75,6 +89,7 @@ void audio_source_switch(audio_source_t new_source,
     }
 
     ESP_LOGI(TAG, "Switching audio source: %s -> %s", names[old], names[new_source]);
+    AUDIO_TRACE_BEGIN(AUDIO_TRACE_SOURCE_SWITCH);
 
     // Hardware mute DAC before transition — prevents clicks from stale DMA data
     if (s_dac_mute_cb) s_dac_mute_cb(true);
@@ -109,9 +124,12 @@ void audio_source_switch(audio_source_t new_source,
     }
 
     // Step 3: Flush stale audio data
-    StreamBufferHandle_t stream = audio_get_stream_buffer();
-    if (stream) {
-        xStreamBufferReset(stream);
+    audio_ring_reset();
+
+    // USB audio is never oversampled (the engines set their factor at
+    // stream start): the chain must run at the I2S rate again
+    if (new_source == AUDIO_SOURCE_USB) {
+        audio_pipeline_set_oversampling(1, DSP_OS_PHASE_LINEAR);
     }
 
     // Step 4: Reconfigure I2S + DSP if format changed
@@ -121,11 +139,21 @@ void audio_source_switch(audio_source_t new_source,
         if (actual_rate == 0) actual_rate = new_sample_rate;  // safety
         audio_pipeline_update_format(actual_rate, new_bits_per_sample);
         audio_set_reconfiguring(false);
+        AUDIO_TRACE_INSTANT(AUDIO_TRACE_FORMAT, actual_rate);
         ESP_LOGI(TAG, "I2S reconfigured: requested=%lu actual=%lu Hz, %d-bit",
                  new_sample_rate, actual_rate, new_bits_per_sample);
     }
 
-    // Step 5: Activate new source
+    // Step 5: Size the jitter buffer for the new source (flushes again) —
+    // prefill starts as soon as the new producer commits
+    {
+        uint32_t rate;
+        uint8_t  bits;
+        audio_pipeline_get_format(&rate, &bits);
+        audio_ring_configure(ring_profile_for(new_source), rate, bits);
+    }
+
+    // Step 6: Activate new source
     s_current_source = new_source;
     ESP_LOGI(TAG, "Audio source active: %s", names[new_source]);
 
@@ -136,6 +164,7 @@ void audio_source_switch(audio_source_t new_source,
 
     // Hardware unmute DAC after transition is complete
     if (s_dac_mute_cb) s_dac_mute_cb(false);
+    AUDIO_TRACE_END(AUDIO_TRACE_SOURCE_SWITCH, new_source);
 }
 
 void audio_source_set_producer_handle(TaskHandle_t handle)
@@ -4,7 +4,6 @@
 #include <stdint.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/stream_buffer.h"
 
 //--------------------------------------------------------------------+
 // Audio source types
@@ -56,9 +55,6 @@ TaskHandle_t audio_source_get_producer_handle(void);
 // Shared pipeline access (owned by app_main, used by sd_player)
 //--------------------------------------------------------------------+
 
-// Get the shared stream buffer handle
-StreamBufferHandle_t audio_get_stream_buffer(void);
-
 // Get reconfiguring flag (feeder checks this)
 bool audio_is_reconfiguring(void);
 void audio_set_reconfiguring(bool val);
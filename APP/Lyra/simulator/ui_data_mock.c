@@ -37,6 +37,9 @@ static ui_now_playing_t s_np = {
     .is_dsd          = false,
     .state           = UI_PLAYBACK_PLAYING,
     .source          = UI_SOURCE_SD,
+    .buffer_pct      = 92,
+    .buffer_ms       = 460,
+    .buffering       = false,
 };
 
 static ui_system_status_t s_sys = {
@@ -49,6 +52,7 @@ static ui_system_status_t s_sys = {
     .bt_connected     = false,
     .dsp_preset       = "Rock",
     .dsp_enabled      = true,
+    .dsp_quality      = 0,
     .eq_bands         = { 5, 3, -1, 4, 6 },   /* Rock preset */
 };
 
@@ -666,6 +670,42 @@ void ui_cmd_wifi_disconnect(void)
     s_wifi.state = UI_WIFI_IDLE;
 }
 
+/* -----------------------------------------------------------------------
+ * Mock output meters
+ * ----------------------------------------------------------------------- */
+
+static ui_meters_data_t s_meters;
+
+ui_meters_data_t ui_data_get_meters(void)
+{
+    bool playing = (s_np.state == UI_PLAYBACK_PLAYING);
+
+    s_meters.valid = true;
+    s_meters.spectrum_valid = playing;
+    s_meters.clip = false;
+
+    for (int ch = 0; ch < 2; ch++) {
+        if (playing) {
+            /* Pseudo-random peak between -12 and -1 dBFS, RMS ~10 dB below */
+            s_meters.peak_db[ch] = -12.0f + (float)(rand() % 110) / 10.0f;
+            s_meters.true_peak_db[ch] = s_meters.peak_db[ch] + 0.2f;
+            s_meters.rms_db[ch] = s_meters.peak_db[ch] - 10.0f;
+        } else {
+            s_meters.peak_db[ch] = s_meters.true_peak_db[ch] = -120.0f;
+            s_meters.rms_db[ch] = -120.0f;
+        }
+    }
+
+    /* Music-like tilt: strong bass, falling ~1 dB per band, jittered */
+    for (int i = 0; i < UI_METER_BANDS; i++) {
+        s_meters.band_db[i] = playing
+            ? -14.0f - (float)i - (float)(rand() % 120) / 10.0f
+            : -120.0f;
+    }
+
+    return s_meters;
+}
+
 /* -----------------------------------------------------------------------
  * Mock USB DAC data
  * ----------------------------------------------------------------------- */
@@ -908,6 +948,8 @@ ui_device_info_t ui_data_get_device_info(void)
     /* System */
     info.uptime_seconds = lv_tick_get() / 1000;
     info.cpu_temp_c     = 47;
+    info.dsp_load_pct     = 18;
+    info.dsp_load_max_pct = 31;
 
     switch (s_np.source) {
         case UI_SOURCE_SD:        strncpy(info.audio_source, "SD Card", sizeof(info.audio_source)); break;